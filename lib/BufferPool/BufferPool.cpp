@@ -0,0 +1,67 @@
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "BufferPool.hpp"
+
+static const char* TAG = "BufferPool";
+
+const pool_class_config_t BUFFER_POOL_DEFAULT_CLASSES[] = {
+    {64, 64, true},
+    {256, 16, true},
+    {256, 64, false},
+    {1024, 32, false},
+    {4096, 16, false},
+    {16384, 4, false},
+};
+const size_t BUFFER_POOL_DEFAULT_CLASS_COUNT = sizeof(BUFFER_POOL_DEFAULT_CLASSES) / sizeof(BUFFER_POOL_DEFAULT_CLASSES[0]);
+
+static void* pool_alloc(size_t bytes, bool internal) {
+    if (internal) return heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return heap_caps_malloc_prefer(bytes, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+// Regions must come from PSRAM when asked, not silently from internal RAM
+static void* pool_region_alloc(size_t bytes, bool internal) {
+    if (internal) return heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
+esp_err_t buffer_pool_begin(const pool_class_config_t* classes, size_t count) {
+    // Regions are reserved first with the strict provider, then oversize requests
+    // switch to the one that may fall back
+    static const pool_memory_t region_memory = {pool_region_alloc, heap_caps_free};
+    static const pool_memory_t memory = {pool_alloc, heap_caps_free};
+
+    SizeClassPool& pool = SizeClassPool::global();
+    if (!pool.configure(classes, count, &region_memory)) return ESP_ERR_INVALID_STATE;
+    pool.set_memory(memory);
+
+    pool_stats_t s = pool.stats();
+    ESP_LOGI(TAG, "Reserved %lu bytes internal, %lu bytes PSRAM", (unsigned long) s.reserved_internal,
+             (unsigned long) s.reserved_psram);
+
+    pool_class_stats_t cs[SizeClassPool::MAX_CLASSES];
+    size_t n = pool.class_stats(cs, SizeClassPool::MAX_CLASSES);
+    for (size_t i = 0; i < n; i++) {
+        if (cs[i].blocks == 0) ESP_LOGW(TAG, "No room for %lu byte %s class", (unsigned long) cs[i].block_size,
+                                        cs[i].internal ? "internal" : "PSRAM");
+    }
+    return ESP_OK;
+}
+
+void buffer_pool_log_stats() {
+    SizeClassPool& pool = SizeClassPool::global();
+    pool_stats_t s = pool.stats();
+    ESP_LOGI(TAG, "allocs %lu, frees %lu, fallback %lu (%lu live), live %lu/%lu bytes, waste %lu%%",
+             (unsigned long) s.allocs, (unsigned long) s.frees, (unsigned long) s.fallback_allocs,
+             (unsigned long) s.fallback_live, (unsigned long) s.live_requested, (unsigned long) s.live_block_bytes,
+             (unsigned long) s.waste_pct);
+
+    pool_class_stats_t cs[SizeClassPool::MAX_CLASSES];
+    size_t n = pool.class_stats(cs, SizeClassPool::MAX_CLASSES);
+    for (size_t i = 0; i < n; i++) {
+        ESP_LOGI(TAG, "  %5lu B %-8s %3u blocks, %3lu in use, peak %3lu, allocs %lu, exhausted %lu",
+                 (unsigned long) cs[i].block_size, cs[i].internal ? "internal" : "PSRAM", (unsigned) cs[i].blocks,
+                 (unsigned long) cs[i].in_use, (unsigned long) cs[i].peak, (unsigned long) cs[i].allocs,
+                 (unsigned long) cs[i].exhausted);
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <stddef.h>
+#include "esp_err.h"
+#include "SizeClassPool.hpp"
+
+// Default classes: a small internal-RAM tier for topics, headers and short
+// payloads (8 KB), and a PSRAM tier up to 16 KB blocks (about 180 KB). Without
+// PSRAM the PSRAM classes stay empty and their requests fall back to the heap.
+extern const pool_class_config_t BUFFER_POOL_DEFAULT_CLASSES[];
+extern const size_t BUFFER_POOL_DEFAULT_CLASS_COUNT;
+
+// Reserve the regions of SizeClassPool::global() with heap_caps: internal
+// classes from MALLOC_CAP_INTERNAL, the others from MALLOC_CAP_SPIRAM. Call once
+// early in app_main, before network traffic starts. Oversize requests go to
+// PSRAM when larger than every internal class, else to internal RAM.
+esp_err_t buffer_pool_begin(const pool_class_config_t* classes = BUFFER_POOL_DEFAULT_CLASSES,
+                            size_t count = BUFFER_POOL_DEFAULT_CLASS_COUNT);
+
+// Totals plus one line per class, at INFO level
+void buffer_pool_log_stats();
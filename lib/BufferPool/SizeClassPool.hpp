@@ -0,0 +1,317 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+typedef struct {
+    uint32_t block_size;   // Rounded up to a multiple of 8
+    uint16_t blocks;
+    bool internal;         // Fast tier in internal RAM; false places the region in PSRAM
+} pool_class_config_t;
+
+// Where regions and oversize requests come from. internal = false means PSRAM is
+// preferred; the provider may fall back to internal RAM or return nullptr.
+typedef struct {
+    void* (*alloc)(size_t bytes, bool internal);
+    void (*free)(void* p);
+} pool_memory_t;
+
+typedef struct {
+    uint32_t block_size;
+    uint16_t blocks;        // 0 if the region could not be reserved
+    bool internal;
+    uint32_t in_use;
+    uint32_t peak;
+    uint32_t allocs;
+    uint32_t exhausted;     // Requests that found this class empty and moved on
+} pool_class_stats_t;
+
+typedef struct {
+    uint32_t allocs;            // Served from a pool block
+    uint32_t frees;
+    uint32_t fallback_allocs;   // Larger than every class, or every fitting class empty
+    uint32_t fallback_live;
+    uint32_t live_requested;    // Bytes asked for by blocks in use
+    uint32_t live_block_bytes;  // Bytes of blocks in use
+    uint32_t waste_pct;         // Internal fragmentation: block bytes not asked for
+    uint32_t reserved_internal;
+    uint32_t reserved_psram;
+} pool_stats_t;
+
+// Size-class block allocator for network payloads. Each class is one region
+// reserved up front and cut into fixed-size blocks, so buffers that come and go
+// with every message never split the heap. Classes are tried smallest first and
+// internal RAM before PSRAM at the same size; when its own class is empty a
+// request may take a block up to MAX_SPILL times that class's size. Anything
+// else goes to the memory provider (the heap) and is counted as a fallback.
+//
+// Free lists are lock-free (a tagged 16-bit index per class), so allocate and
+// deallocate are safe from any task on either core. Block bookkeeping lives
+// outside the blocks: PSRAM blocks are not touched until the caller uses them.
+// configure() must finish before the first allocation; until then, and for
+// pointers it does not own, everything goes to the provider.
+class SizeClassPool {
+public:
+    static const size_t MAX_CLASSES = 12;
+    static const size_t MAX_SPILL = 4;
+
+    SizeClassPool() : _memory(default_memory()) {}
+
+    ~SizeClassPool() {
+        for (size_t i = 0; i < _count; i++) {
+            if (_classes[i].base) _memory.free(_classes[i].base);
+        }
+    }
+
+    SizeClassPool(const SizeClassPool&) = delete;
+    SizeClassPool& operator=(const SizeClassPool&) = delete;
+
+    // The pool behind PoolAllocator, pool_string and pool_vector
+    static SizeClassPool& global() {
+        static SizeClassPool pool;
+        return pool;
+    }
+
+    // Reserve the regions. Classes whose region cannot be allocated are kept with
+    // zero blocks. False if already configured or the table is invalid.
+    bool configure(const pool_class_config_t* classes, size_t count, const pool_memory_t* memory = nullptr) {
+        if (_count || count > MAX_CLASSES) return false;
+        if (memory) _memory = *memory;
+
+        // Insertion sort by size, internal first: the allocation search order
+        const pool_class_config_t* order[MAX_CLASSES];
+        for (size_t i = 0; i < count; i++) {
+            if (classes[i].blocks == 0 || classes[i].blocks >= NIL || classes[i].block_size == 0) return false;
+            size_t j = i;
+            while (j > 0 && before(classes[i], *order[j - 1])) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = &classes[i];
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            Class& c = _classes[i];
+            c.block_size = (order[i]->block_size + 7) & ~7u;
+            c.internal = order[i]->internal;
+            c.base = (uint8_t*) _memory.alloc((size_t) c.block_size * order[i]->blocks, c.internal);
+            if (!c.base) continue;
+            c.blocks = order[i]->blocks;
+            c.next.reset(new std::atomic<uint16_t>[c.blocks]);
+            c.requested.reset(new std::atomic<uint32_t>[c.blocks]);
+            for (uint16_t b = 0; b < c.blocks; b++) {
+                c.next[b].store(b + 1 < c.blocks ? b + 1 : NIL);
+                c.requested[b].store(0);
+            }
+            c.head.store(0);
+            if (c.internal) {
+                _reserved_internal += c.block_size * c.blocks;
+                if (c.block_size > _internal_max) _internal_max = c.block_size;
+            } else {
+                _reserved_psram += c.block_size * c.blocks;
+            }
+        }
+        _count = count;
+        return true;
+    }
+
+    // Provider for later oversize requests; regions already reserved stay put.
+    // Its free must also accept pointers from the previous provider.
+    void set_memory(const pool_memory_t& memory) { _memory = memory; }
+
+    void* allocate(size_t size) {
+        if (size == 0) size = 1;
+        size_t limit = 0;
+        for (size_t i = 0; i < _count; i++) {
+            Class& c = _classes[i];
+            if (c.block_size < size) continue;
+            if (!limit) limit = (size_t) c.block_size * MAX_SPILL;
+            if (c.block_size > limit) break;
+            if (!c.blocks) continue;
+            uint16_t idx = pop(c);
+            if (idx == NIL) {
+                c.exhausted.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            c.requested[idx].store((uint32_t) size, std::memory_order_relaxed);
+            uint32_t used = c.in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+            uint32_t peak = c.peak.load(std::memory_order_relaxed);
+            while (used > peak && !c.peak.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {}
+            c.allocs.fetch_add(1, std::memory_order_relaxed);
+            return c.base + (size_t) idx * c.block_size;
+        }
+
+        void* p = _memory.alloc(size, size <= _internal_max);
+        if (p) {
+            _fallback_allocs.fetch_add(1, std::memory_order_relaxed);
+            _fallback_live.fetch_add(1, std::memory_order_relaxed);
+        }
+        return p;
+    }
+
+    void deallocate(void* p) {
+        if (!p) return;
+        for (size_t i = 0; i < _count; i++) {
+            Class& c = _classes[i];
+            uint8_t* b = (uint8_t*) p;
+            if (b < c.base || b >= c.base + (size_t) c.block_size * c.blocks) continue;
+            uint16_t idx = (uint16_t) ((b - c.base) / c.block_size);
+            c.requested[idx].store(0, std::memory_order_relaxed);
+            c.in_use.fetch_sub(1, std::memory_order_relaxed);
+            push(c, idx);
+            return;
+        }
+        _fallback_live.fetch_sub(1, std::memory_order_relaxed);
+        _memory.free(p);
+    }
+
+    bool owns(const void* p) const {
+        for (size_t i = 0; i < _count; i++) {
+            const Class& c = _classes[i];
+            if ((const uint8_t*) p >= c.base && (const uint8_t*) p < c.base + (size_t) c.block_size * c.blocks) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Walks every block for the live byte counts: meant for periodic reporting,
+    // not the allocation path. Counters are read without stopping allocators.
+    pool_stats_t stats() const {
+        pool_stats_t s = {};
+        for (size_t i = 0; i < _count; i++) {
+            const Class& c = _classes[i];
+            uint32_t in_use = c.in_use.load(std::memory_order_relaxed);
+            s.allocs += c.allocs.load(std::memory_order_relaxed);
+            s.frees += c.allocs.load(std::memory_order_relaxed) - in_use;
+            s.live_block_bytes += in_use * c.block_size;
+            for (uint16_t b = 0; b < c.blocks; b++) s.live_requested += c.requested[b].load(std::memory_order_relaxed);
+        }
+        s.fallback_allocs = _fallback_allocs.load(std::memory_order_relaxed);
+        s.fallback_live = _fallback_live.load(std::memory_order_relaxed);
+        s.waste_pct = s.live_block_bytes > s.live_requested
+            ? (uint32_t) ((uint64_t) (s.live_block_bytes - s.live_requested) * 100 / s.live_block_bytes) : 0;
+        s.reserved_internal = _reserved_internal;
+        s.reserved_psram = _reserved_psram;
+        return s;
+    }
+
+    // Per class, in search order. Returns the number written.
+    size_t class_stats(pool_class_stats_t* out, size_t max) const {
+        size_t n = _count < max ? _count : max;
+        for (size_t i = 0; i < n; i++) {
+            const Class& c = _classes[i];
+            out[i] = {c.block_size, c.blocks, c.internal, c.in_use.load(std::memory_order_relaxed),
+                      c.peak.load(std::memory_order_relaxed), c.allocs.load(std::memory_order_relaxed),
+                      c.exhausted.load(std::memory_order_relaxed)};
+        }
+        return n;
+    }
+
+private:
+    static const uint16_t NIL = 0xFFFF;
+
+    struct Class {
+        uint8_t* base = nullptr;
+        uint32_t block_size = 0;
+        uint16_t blocks = 0;
+        bool internal = false;
+        std::atomic<uint32_t> head{NIL};   // Free list: low 16 bits index, high 16 bits ABA tag
+        std::unique_ptr<std::atomic<uint16_t>[]> next;
+        std::unique_ptr<std::atomic<uint32_t>[]> requested;   // 0 while free
+        std::atomic<uint32_t> in_use{0};
+        std::atomic<uint32_t> peak{0};
+        std::atomic<uint32_t> allocs{0};
+        std::atomic<uint32_t> exhausted{0};
+    };
+
+    Class _classes[MAX_CLASSES];
+    size_t _count = 0;
+    pool_memory_t _memory;
+    uint32_t _internal_max = 0;
+    uint32_t _reserved_internal = 0;
+    uint32_t _reserved_psram = 0;
+    std::atomic<uint32_t> _fallback_allocs{0};
+    std::atomic<uint32_t> _fallback_live{0};
+
+    static bool before(const pool_class_config_t& a, const pool_class_config_t& b) {
+        return a.block_size < b.block_size || (a.block_size == b.block_size && a.internal && !b.internal);
+    }
+
+    // The tag changes on every successful pop and push, so a head that was popped
+    // and pushed back between our load and our CAS is not mistaken for unchanged
+    static uint16_t pop(Class& c) {
+        uint32_t head = c.head.load(std::memory_order_acquire);
+        while (true) {
+            uint16_t idx = head & 0xFFFF;
+            if (idx == NIL) return NIL;
+            uint32_t next = c.next[idx].load(std::memory_order_relaxed);
+            uint32_t tagged = ((head + 0x10000) & 0xFFFF0000u) | next;
+            if (c.head.compare_exchange_weak(head, tagged, std::memory_order_acquire, std::memory_order_acquire)) {
+                return idx;
+            }
+        }
+    }
+
+    static void push(Class& c, uint16_t idx) {
+        uint32_t head = c.head.load(std::memory_order_relaxed);
+        while (true) {
+            c.next[idx].store(head & 0xFFFF, std::memory_order_relaxed);
+            uint32_t tagged = ((head + 0x10000) & 0xFFFF0000u) | idx;
+            if (c.head.compare_exchange_weak(head, tagged, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    static pool_memory_t default_memory() {
+        return {[](size_t bytes, bool) { return malloc(bytes); }, free};
+    }
+};
+
+// std-compatible allocator drawing from a SizeClassPool (the global one by default)
+template <typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    PoolAllocator() noexcept : _pool(&SizeClassPool::global()) {}
+    explicit PoolAllocator(SizeClassPool& pool) noexcept : _pool(&pool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : _pool(other.pool()) {}
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= 8, "pool blocks are 8-byte aligned");
+        void* p = _pool->allocate(n * sizeof(T));
+        if (!p) {
+#if __cpp_exceptions
+            throw std::bad_alloc();
+#else
+            abort();
+#endif
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) noexcept { _pool->deallocate(p); }
+
+    SizeClassPool* pool() const noexcept { return _pool; }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const noexcept { return _pool == other.pool(); }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const noexcept { return _pool != other.pool(); }
+
+private:
+    SizeClassPool* _pool;
+};
+
+typedef std::basic_string<char, std::char_traits<char>, PoolAllocator<char>> pool_string;
+
+template <typename T>
+using pool_vector = std::vector<T, PoolAllocator<T>>;
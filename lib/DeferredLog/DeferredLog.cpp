@@ -0,0 +1,145 @@
+#include "DeferredLog.hpp"
+#include <new>
+#include "DlogFormat.hpp"
+
+static const char* TAG = "DLOG";
+
+// Frames are batched up to this size before the binary sink is called
+static const size_t FRAME_BATCH = 512;
+
+DeferredLog& DeferredLog::instance() {
+    static DeferredLog log;
+    return log;
+}
+
+DeferredLog::DeferredLog() {
+    _drain_lock = xSemaphoreCreateMutex();
+}
+
+esp_err_t DeferredLog::begin(const DeferredLogConfig& config) {
+    if (_task) return ESP_OK;
+    _config = config;
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        _rings[core] = new (std::nothrow) DlogRing(config.ring_words);
+        if (!_rings[core]) return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreatePinnedToCore(format_task, "dlog", config.task_stack, this, config.task_priority, &_task,
+                                config.core) != pdPASS) {
+        _task = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void DeferredLog::format_task(void* arg) {
+    auto self = static_cast<DeferredLog*>(arg);
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(self->_config.flush_ms));
+        self->drain();
+    }
+}
+
+void DeferredLog::flush() {
+    drain();
+}
+
+void DeferredLog::set_binary_sink(dlog_binary_sink_t sink, void* ctx) {
+    xSemaphoreTake(_drain_lock, portMAX_DELAY);
+    flush_frames();
+    _sink = sink;
+    _sink_ctx = ctx;
+    _announced.clear();
+    xSemaphoreGive(_drain_lock);
+}
+
+// Merge the per-core rings by timestamp. Each ring is in order on its own, so
+// holding one pending record per core is enough.
+void DeferredLog::drain() {
+    xSemaphoreTake(_drain_lock, portMAX_DELAY);
+    for (;;) {
+        int oldest = -1;
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            if (!_rings[core]) continue;
+            if (!_have[core]) _have[core] = _rings[core]->read(&_pending[core]);
+            if (!_have[core]) continue;
+            // Wrap-aware: the 32-bit stamp rolls over every ~71 minutes
+            if (oldest < 0 || (int32_t) (_pending[core].time_us - _pending[oldest].time_us) < 0) oldest = core;
+        }
+        if (oldest < 0) break;
+        emit(_pending[oldest]);
+        _have[oldest] = false;
+    }
+    flush_frames();
+
+    uint32_t dropped = stats().dropped;
+    bool report = dropped != _reported_drops;
+    uint32_t lost = dropped - _reported_drops;
+    _reported_drops = dropped;
+    xSemaphoreGive(_drain_lock);
+
+    if (report) ESP_LOGW(TAG, "%lu records dropped (ring full)", (unsigned long) lost);
+}
+
+void DeferredLog::emit(const dlog_record_t& rec) {
+    _written++;
+    if (_sink) {
+        emit_binary(rec);
+    } else {
+        emit_text(rec);
+    }
+}
+
+// Milliseconds since boot for a record stamped with the low 32 bits of the
+// microsecond clock, assuming it is less than ~71 minutes old
+static uint32_t record_ms(const dlog_record_t& rec) {
+    int64_t now = esp_timer_get_time();
+    uint32_t age = (uint32_t) now - rec.time_us;
+    return (uint32_t) ((now - age) / 1000);
+}
+
+void DeferredLog::emit_text(const dlog_record_t& rec) {
+    const dlog_site_t* site = rec.site;
+    const char* tag = site->tag && *site->tag ? *site->tag : "";
+
+    char text[256];
+    dlog_render(site->fmt, rec.words, rec.nwords, rec.types, text, sizeof(text));
+
+    static const char* const colors[] = {"", LOG_COLOR_E, LOG_COLOR_W, LOG_COLOR_I, LOG_COLOR_D, LOG_COLOR_V};
+    const char* color = site->level <= DLOG_LEVEL_VERBOSE ? colors[site->level] : "";
+    esp_log_write((esp_log_level_t) site->level, tag, "%s%c (%lu) %s: %s%s\n", color, dlog_level_letter(site->level),
+                  (unsigned long) record_ms(rec), tag, text, *color ? LOG_RESET_COLOR : "");
+}
+
+// A dictionary frame goes out before the first record of each call site
+void DeferredLog::emit_binary(const dlog_record_t& rec) {
+    uint8_t frame[1 + 4 + 1 + 255 + 2 + 256];
+    if (_announced.insert(rec.site->id).second) {
+        size_t n = dlog_encode_dict(rec.site, frame, sizeof(frame));
+        if (_frames.size() + n > FRAME_BATCH) flush_frames();
+        _frames.insert(_frames.end(), frame, frame + n);
+    }
+
+    size_t n = dlog_encode_record(rec, record_ms(rec), frame, sizeof(frame));
+    if (_frames.size() + n > FRAME_BATCH) flush_frames();
+    _frames.insert(_frames.end(), frame, frame + n);
+}
+
+void DeferredLog::flush_frames() {
+    if (_frames.empty()) return;
+    if (_sink) _sink(_frames.data(), _frames.size(), _sink_ctx);
+    _frames.clear();
+}
+
+deferred_log_stats_t DeferredLog::stats() {
+    deferred_log_stats_t out = {_written, 0, 0, 0};
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        if (!_rings[core]) continue;
+        dlog_ring_stats_t s = _rings[core]->stats();
+        out.dropped += s.dropped;
+        if (s.peak_words > out.peak_words) out.peak_words = s.peak_words;
+        out.capacity_words = s.capacity_words;
+    }
+    return out;
+}
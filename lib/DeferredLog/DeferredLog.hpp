@@ -0,0 +1,116 @@
+#pragma once
+#include <unordered_set>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "DlogRing.hpp"
+
+// Highest level compiled in. Defaults to the ESP_LOG one (LOG_LOCAL_LEVEL, which
+// follows CONFIG_LOG_MAXIMUM_LEVEL), so a file can raise or lower both together.
+#ifndef DLOG_LEVEL
+#define DLOG_LEVEL LOG_LOCAL_LEVEL
+#endif
+
+// Drop-in for ESP_LOGx on hot paths: records the call site and the raw arguments
+// (tens of nanoseconds) and leaves formatting and the UART to a low-priority
+// task. Calls above DLOG_LEVEL compile to nothing. Arguments may be numbers,
+// pointers, C strings (copied, up to DLOG_MAX_STR bytes) or dlog_str(view) for
+// strings that are not NUL-terminated; %.*s is not supported.
+#define DLOG_AT(level, tag, fmt, ...)                                                          \
+    do {                                                                                       \
+        if constexpr ((level) <= DLOG_LEVEL) {                                                 \
+            static constexpr dlog_site_t _dlog_site = {dlog_hash(fmt), (level), &(tag), fmt};  \
+            DeferredLog::instance().write(&_dlog_site, ##__VA_ARGS__);                         \
+        }                                                                                      \
+    } while (0)
+
+#define DLOGE(tag, fmt, ...) DLOG_AT(DLOG_LEVEL_ERROR, tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) DLOG_AT(DLOG_LEVEL_WARN, tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) DLOG_AT(DLOG_LEVEL_INFO, tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) DLOG_AT(DLOG_LEVEL_DEBUG, tag, fmt, ##__VA_ARGS__)
+#define DLOGV(tag, fmt, ...) DLOG_AT(DLOG_LEVEL_VERBOSE, tag, fmt, ##__VA_ARGS__)
+
+struct DeferredLogConfig {
+    size_t ring_words = 1024;        // Per core; 4 bytes per word, ~40 typical records
+    uint32_t flush_ms = 20;          // How often the formatter task drains the rings
+    UBaseType_t task_priority = 1;
+    uint32_t task_stack = 3072;
+    int core = tskNO_AFFINITY;
+};
+
+// Receives binary frames (see DlogFormat.hpp) instead of formatted lines
+typedef void (*dlog_binary_sink_t)(const uint8_t* frames, size_t len, void* ctx);
+
+typedef struct {
+    uint32_t written;        // Records formatted or exported
+    uint32_t dropped;        // Ring full or record too large
+    uint32_t peak_words;     // Highest fill of any core's ring
+    uint32_t capacity_words; // Per core
+} deferred_log_stats_t;
+
+// One DlogRing per core; writers pick the ring of the core they run on, so
+// the only shared write is a CAS on a core-local head. Writing is ISR-safe
+// once begin() has run. Before that, records are formatted and written at once.
+// Lines come out in timestamp order with ESP_LOG's layout and colours through
+// esp_log_write, so runtime esp_log_level_set() filtering still applies.
+class DeferredLog {
+public:
+    static DeferredLog& instance();
+
+    esp_err_t begin(const DeferredLogConfig& config = DeferredLogConfig());
+
+    template <typename... Args>
+    void write(const dlog_site_t* site, const Args&... args) {
+        uint32_t now = (uint32_t) esp_timer_get_time();
+        DlogRing* ring = _rings[xPortGetCoreID()];
+        if (ring) {
+            ring->write(site, now, args...);
+        } else {
+            write_unbuffered(site, now, args...);
+        }
+    }
+
+    // Format everything queued so far on the calling task (e.g. before esp_restart)
+    void flush();
+
+    // Export binary frames to sink (e.g. an MQTT publish) instead of formatting
+    // on the device; decode them with DlogDecoder. nullptr goes back to text.
+    void set_binary_sink(dlog_binary_sink_t sink, void* ctx);
+
+    deferred_log_stats_t stats();
+
+private:
+    DeferredLog();
+
+    DlogRing* _rings[portNUM_PROCESSORS] = {};
+    dlog_record_t _pending[portNUM_PROCESSORS];
+    bool _have[portNUM_PROCESSORS] = {};
+    DeferredLogConfig _config;
+    TaskHandle_t _task = nullptr;
+    SemaphoreHandle_t _drain_lock;
+    uint32_t _written = 0;
+    uint32_t _reported_drops = 0;
+
+    dlog_binary_sink_t _sink = nullptr;
+    void* _sink_ctx = nullptr;
+    std::vector<uint8_t> _frames;
+    std::unordered_set<uint32_t> _announced;
+
+    // Kept out of line so the record buffer never lands on the caller's stack frame
+    template <typename... Args>
+    __attribute__((noinline)) void write_unbuffered(const dlog_site_t* site, uint32_t now, const Args&... args) {
+        dlog_record_t rec;
+        if (dlog_record(&rec, site, now, args...)) emit_text(rec);
+    }
+
+    static void format_task(void* arg);
+    void drain();
+    void emit(const dlog_record_t& rec);
+    void emit_text(const dlog_record_t& rec);
+    void emit_binary(const dlog_record_t& rec);
+    void flush_frames();
+};
@@ -0,0 +1,284 @@
+#pragma once
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include "DlogRing.hpp"
+
+// Reads encoded arguments back in order; an argument missing from the record
+// reads as type DLOG_ARG_NONE
+class DlogArgReader {
+public:
+    DlogArgReader(const uint32_t* words, size_t nwords, uint32_t types)
+        : _words(words), _nwords(nwords), _types(types) {}
+
+    uint8_t next_type() {
+        uint8_t t = _index < DLOG_MAX_ARGS ? (uint8_t) ((_types >> (4 * _index)) & 0xF) : (uint8_t) DLOG_ARG_NONE;
+        _index++;
+        return t;
+    }
+
+    uint32_t word() { return _pos < _nwords ? _words[_pos++] : 0; }
+
+    uint64_t dword() {
+        uint64_t lo = word();
+        return lo | ((uint64_t) word() << 32);
+    }
+
+    // Copies at most cap - 1 bytes and terminates
+    void str(char* out, size_t cap) {
+        size_t n = word();
+        size_t copy = n < cap - 1 ? n : cap - 1;
+        for (size_t i = 0; i < n; i += 4) {
+            uint32_t w = word();
+            if (i < copy) memcpy(out + i, &w, copy - i < 4 ? copy - i : 4);
+        }
+        out[copy] = '\0';
+    }
+
+private:
+    const uint32_t* _words;
+    size_t _nwords;
+    uint32_t _types;
+    size_t _pos = 0;
+    size_t _index = 0;
+};
+
+// printf the recorded arguments into fmt. Each conversion is formatted on its
+// own with the type the argument was recorded as; length modifiers in fmt are
+// ignored, and a conversion that does not match its argument (e.g. %d given a
+// float) prints the value converted rather than garbage. Returns the length
+// written, truncated to cap - 1.
+inline size_t dlog_render(const char* fmt, const uint32_t* words, size_t nwords, uint32_t types, char* out,
+                          size_t cap) {
+    if (cap == 0) return 0;
+    DlogArgReader args(words, nwords, types);
+    size_t o = 0;
+    auto emit = [&](const char* s, size_t n) {
+        if (n > cap - 1 - o) n = cap - 1 - o;
+        memcpy(out + o, s, n);
+        o += n;
+    };
+    // '*' width or precision: the argument is an int
+    auto star = [&](char* spec, size_t* s) {
+        args.next_type();
+        *s += snprintf(spec + *s, 12, "%d", (int) args.word());
+    };
+
+    const char* p = fmt;
+    while (*p) {
+        if (*p != '%') {
+            const char* q = p;
+            while (*q && *q != '%') q++;
+            emit(p, q - p);
+            p = q;
+            continue;
+        }
+        if (p[1] == '%') {
+            emit("%", 1);
+            p += 2;
+            continue;
+        }
+
+        char spec[40] = "%";
+        size_t s = 1;
+        p++;
+        while (*p && strchr("-+ #0", *p)) {
+            if (s < 6) spec[s++] = *p;
+            p++;
+        }
+        if (*p == '*') {
+            star(spec, &s);
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            if (s < 16) spec[s++] = *p;
+            p++;
+        }
+        if (*p == '.') {
+            spec[s++] = '.';
+            p++;
+            if (*p == '*') {
+                star(spec, &s);
+                p++;
+            }
+            while (*p >= '0' && *p <= '9') {
+                if (s < 28) spec[s++] = *p;
+                p++;
+            }
+        }
+        while (*p && strchr("hljztL", *p)) p++;
+        char conv = *p;
+        if (!conv) break;
+        p++;
+
+        bool int_conv = strchr("diouxXc", conv) != nullptr;
+        bool float_conv = strchr("fFeEgGaA", conv) != nullptr;
+        char buf[96];
+        int n = 0;
+        uint8_t type = args.next_type();
+
+        if (type == DLOG_ARG_NONE) {
+            n = snprintf(buf, sizeof(buf), "(?)");
+        } else if (type == DLOG_ARG_STR) {
+            char str[DLOG_MAX_STR + 1];
+            args.str(str, sizeof(str));
+            memcpy(spec + s, "s", 2);
+            n = snprintf(buf, sizeof(buf), spec, str);
+        } else if (type == DLOG_ARG_F64) {
+            uint64_t u = args.dword();
+            double d;
+            memcpy(&d, &u, sizeof(d));
+            if (int_conv) {
+                memcpy(spec + s, "lld", 4);
+                n = snprintf(buf, sizeof(buf), spec, (long long) d);
+            } else {
+                spec[s] = float_conv ? conv : 'g';
+                spec[s + 1] = '\0';
+                n = snprintf(buf, sizeof(buf), spec, d);
+            }
+        } else {
+            bool wide = type == DLOG_ARG_I64 || type == DLOG_ARG_U64 || (type == DLOG_ARG_PTR && DLOG_PTR_WORDS > 1);
+            uint64_t u = wide ? args.dword() : args.word();
+            long long v = type == DLOG_ARG_I32 ? (long long) (int32_t) u : (long long) u;
+            if (conv == 'p' || type == DLOG_ARG_PTR) {
+                n = snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long) u);
+            } else if (float_conv) {
+                spec[s] = conv;
+                spec[s + 1] = '\0';
+                n = snprintf(buf, sizeof(buf), spec, (double) v);
+            } else if (conv == 'c') {
+                memcpy(spec + s, "c", 2);
+                n = snprintf(buf, sizeof(buf), spec, (int) v);
+            } else {
+                spec[s] = 'l';
+                spec[s + 1] = 'l';
+                spec[s + 2] = int_conv ? conv : 'd';
+                spec[s + 3] = '\0';
+                n = snprintf(buf, sizeof(buf), spec, v);
+            }
+        }
+        if (n > 0) emit(buf, (size_t) n < sizeof(buf) ? (size_t) n : sizeof(buf) - 1);
+    }
+    out[o] = '\0';
+    return o;
+}
+
+inline char dlog_level_letter(uint8_t level) {
+    static const char letters[] = "NEWIDV";
+    return level <= DLOG_LEVEL_VERBOSE ? letters[level] : '?';
+}
+
+// Binary export, little-endian, for shipping records off the device and
+// formatting them elsewhere:
+//   dictionary: 'D' id:u32 level:u8 tag_len:u8 tag fmt_len:u16 fmt
+//   record:     'R' id:u32 time_ms:u32 types:u32 nwords:u8 words:u32[nwords]
+// A dictionary frame is sent before the first record of each call site.
+
+inline void dlog_put_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    p[2] = (uint8_t) (v >> 16);
+    p[3] = (uint8_t) (v >> 24);
+}
+
+inline uint32_t dlog_get_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// Returns the frame length, or 0 if it does not fit
+inline size_t dlog_encode_dict(const dlog_site_t* site, uint8_t* out, size_t cap) {
+    const char* tag = site->tag && *site->tag ? *site->tag : "";
+    size_t tag_len = strnlen(tag, 255);
+    size_t fmt_len = strlen(site->fmt);
+    if (fmt_len > 0xFFFF) return 0;
+    size_t len = 1 + 4 + 1 + 1 + tag_len + 2 + fmt_len;
+    if (len > cap) return 0;
+    out[0] = 'D';
+    dlog_put_u32(out + 1, site->id);
+    out[5] = site->level;
+    out[6] = (uint8_t) tag_len;
+    memcpy(out + 7, tag, tag_len);
+    out[7 + tag_len] = (uint8_t) fmt_len;
+    out[8 + tag_len] = (uint8_t) (fmt_len >> 8);
+    memcpy(out + 9 + tag_len, site->fmt, fmt_len);
+    return len;
+}
+
+// time_ms: milliseconds since boot, rebuilt from the record's 32-bit microsecond stamp
+inline size_t dlog_encode_record(const dlog_record_t& rec, uint32_t time_ms, uint8_t* out, size_t cap) {
+    size_t len = 1 + 4 + 4 + 4 + 1 + 4 * rec.nwords;
+    if (len > cap) return 0;
+    out[0] = 'R';
+    dlog_put_u32(out + 1, rec.site->id);
+    dlog_put_u32(out + 5, time_ms);
+    dlog_put_u32(out + 9, rec.types);
+    out[13] = (uint8_t) rec.nwords;
+    for (uint32_t i = 0; i < rec.nwords; i++) dlog_put_u32(out + 14 + 4 * i, rec.words[i]);
+    return len;
+}
+
+// Host-side decoder for the binary export: feed it the frames in order and it
+// formats each record the way the device would have ("I (1234) TAG: text").
+// Records of a call site whose dictionary frame was missed are counted and skipped.
+class DlogDecoder {
+public:
+    typedef void (*line_cb_t)(const char* line, size_t len, void* ctx);
+
+    // Decode a buffer of whole frames. Returns the bytes consumed; less than len
+    // means the buffer ends in a partial frame or holds a malformed one.
+    size_t decode(const uint8_t* data, size_t len, line_cb_t callback, void* ctx) {
+        size_t off = 0;
+        while (off < len) {
+            const uint8_t* f = data + off;
+            size_t left = len - off;
+            if (f[0] == 'D') {
+                if (left < 7 || left < 9 + (size_t) f[6]) break;
+                size_t tag_len = f[6];
+                size_t fmt_len = f[7 + tag_len] | (f[8 + tag_len] << 8);
+                if (left < 9 + tag_len + fmt_len) break;
+                Entry& e = _dict[dlog_get_u32(f + 1)];
+                e.level = f[5];
+                e.tag.assign((const char*) f + 7, tag_len);
+                e.fmt.assign((const char*) f + 9 + tag_len, fmt_len);
+                off += 9 + tag_len + fmt_len;
+            } else if (f[0] == 'R') {
+                if (left < 14 || left < 14 + 4 * (size_t) f[13]) break;
+                size_t nwords = f[13];
+                off += 14 + 4 * nwords;
+                if (nwords > DLOG_MAX_RECORD_WORDS) continue;
+                auto it = _dict.find(dlog_get_u32(f + 1));
+                if (it == _dict.end()) {
+                    _unknown++;
+                    continue;
+                }
+                uint32_t words[DLOG_MAX_RECORD_WORDS];
+                for (size_t i = 0; i < nwords; i++) words[i] = dlog_get_u32(f + 14 + 4 * i);
+
+                char line[256];
+                const Entry& e = it->second;
+                int n = snprintf(line, sizeof(line), "%c (%lu) %s: ", dlog_level_letter(e.level),
+                                 (unsigned long) dlog_get_u32(f + 5), e.tag.c_str());
+                if (n < 0 || (size_t) n >= sizeof(line)) n = 0;
+                size_t total = n + dlog_render(e.fmt.c_str(), words, nwords, dlog_get_u32(f + 9), line + n,
+                                               sizeof(line) - n);
+                callback(line, total, ctx);
+            } else {
+                break;
+            }
+        }
+        return off;
+    }
+
+    size_t unknown() const { return _unknown; }
+
+private:
+    struct Entry {
+        uint8_t level;
+        std::string tag;
+        std::string fmt;
+    };
+
+    std::unordered_map<uint32_t, Entry> _dict;
+    size_t _unknown = 0;
+};
@@ -0,0 +1,301 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+
+// Same values as esp_log_level_t
+#define DLOG_LEVEL_NONE     0
+#define DLOG_LEVEL_ERROR    1
+#define DLOG_LEVEL_WARN     2
+#define DLOG_LEVEL_INFO     3
+#define DLOG_LEVEL_DEBUG    4
+#define DLOG_LEVEL_VERBOSE  5
+
+static const size_t DLOG_MAX_ARGS = 8;
+static const size_t DLOG_MAX_STR = 64;            // String arguments are cut to this many bytes
+static const size_t DLOG_MAX_RECORD_WORDS = 64;   // Larger records are dropped
+
+// One per call site, constant-initialized: the format is never copied, only the
+// site's address is recorded
+typedef struct {
+    uint32_t id;                // FNV-1a of the format string, stable across builds
+    uint8_t level;
+    const char* const* tag;     // Address of the caller's TAG variable
+    const char* fmt;
+} dlog_site_t;
+
+constexpr uint32_t dlog_hash(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) h = (h ^ (uint8_t) *s++) * 16777619u;
+    return h;
+}
+
+// A string argument with an explicit length (e.g. a std::string_view topic)
+struct DlogStr {
+    const char* ptr;
+    size_t len;
+};
+
+inline DlogStr dlog_str(const char* ptr, size_t len) { return {ptr, len}; }
+inline DlogStr dlog_str(std::string_view s) { return {s.data(), s.size()}; }
+
+enum : uint8_t {
+    DLOG_ARG_NONE = 0,
+    DLOG_ARG_I32,
+    DLOG_ARG_U32,
+    DLOG_ARG_I64,
+    DLOG_ARG_U64,
+    DLOG_ARG_F64,
+    DLOG_ARG_STR,
+    DLOG_ARG_PTR,
+};
+
+static const size_t DLOG_PTR_WORDS = sizeof(uintptr_t) / 4;
+// State, time, site, argument types
+static const size_t DLOG_HEADER_WORDS = 3 + DLOG_PTR_WORDS;
+
+template <typename>
+struct dlog_unsupported : std::false_type {};
+
+template <typename T>
+constexpr uint8_t dlog_arg_type() {
+    typedef typename std::decay<T>::type U;
+    if constexpr (std::is_same<U, DlogStr>::value || std::is_same<U, const char*>::value ||
+                  std::is_same<U, char*>::value) {
+        return DLOG_ARG_STR;
+    } else if constexpr (std::is_floating_point<U>::value) {
+        return DLOG_ARG_F64;
+    } else if constexpr (std::is_pointer<U>::value) {
+        return DLOG_ARG_PTR;
+    } else if constexpr (std::is_enum<U>::value) {
+        return sizeof(U) > 4 ? DLOG_ARG_I64 : DLOG_ARG_I32;
+    } else if constexpr (std::is_integral<U>::value) {
+        if (sizeof(U) > 4) return std::is_signed<U>::value ? DLOG_ARG_I64 : DLOG_ARG_U64;
+        return std::is_signed<U>::value ? DLOG_ARG_I32 : DLOG_ARG_U32;
+    } else {
+        static_assert(dlog_unsupported<U>::value, "deferred log arguments must be numbers, pointers or strings");
+        return DLOG_ARG_NONE;
+    }
+}
+
+// Four bits per argument, first argument lowest
+template <typename... Args>
+constexpr uint32_t dlog_type_word() {
+    uint32_t word = 0;
+    uint32_t shift = 0;
+    ((word |= (uint32_t) dlog_arg_type<Args>() << shift, shift += 4), ...);
+    return word;
+}
+
+inline void dlog_str_parts(const char* s, const char** ptr, size_t* len) {
+    if (!s) s = "(null)";
+    *ptr = s;
+    *len = strnlen(s, DLOG_MAX_STR);
+}
+
+inline void dlog_str_parts(const DlogStr& s, const char** ptr, size_t* len) {
+    *ptr = s.ptr;
+    *len = s.len < DLOG_MAX_STR ? s.len : DLOG_MAX_STR;
+}
+
+// String literals arrive as arrays: never scan past their end
+template <typename T>
+inline void dlog_str_of(const T& v, const char** ptr, size_t* len) {
+    if constexpr (std::is_array<T>::value) {
+        *ptr = v;
+        *len = strnlen(v, std::extent<T>::value < DLOG_MAX_STR ? std::extent<T>::value : DLOG_MAX_STR);
+    } else {
+        dlog_str_parts(v, ptr, len);
+    }
+}
+
+template <typename T>
+inline size_t dlog_arg_words(const T& v) {
+    constexpr uint8_t type = dlog_arg_type<T>();
+    if constexpr (type == DLOG_ARG_STR) {
+        const char* p;
+        size_t n;
+        dlog_str_of(v, &p, &n);
+        return 1 + (n + 3) / 4;
+    } else if constexpr (type == DLOG_ARG_I64 || type == DLOG_ARG_U64 || type == DLOG_ARG_F64) {
+        return 2;
+    } else if constexpr (type == DLOG_ARG_PTR) {
+        return DLOG_PTR_WORDS;
+    } else {
+        return 1;
+    }
+}
+
+// Strings: length word, then the bytes packed four to a word. 64-bit values: low word first.
+template <typename T, typename Put>
+inline void dlog_put_arg(const T& v, Put& put) {
+    constexpr uint8_t type = dlog_arg_type<T>();
+    if constexpr (type == DLOG_ARG_STR) {
+        const char* p;
+        size_t n;
+        dlog_str_of(v, &p, &n);
+        put((uint32_t) n);
+        for (size_t i = 0; i < n; i += 4) {
+            uint32_t w = 0;
+            memcpy(&w, p + i, n - i < 4 ? n - i : 4);
+            put(w);
+        }
+    } else if constexpr (type == DLOG_ARG_F64) {
+        double d = (double) v;
+        uint64_t u;
+        memcpy(&u, &d, sizeof(u));
+        put((uint32_t) u);
+        put((uint32_t) (u >> 32));
+    } else if constexpr (type == DLOG_ARG_I64 || type == DLOG_ARG_U64) {
+        uint64_t u = (uint64_t) v;
+        put((uint32_t) u);
+        put((uint32_t) (u >> 32));
+    } else if constexpr (type == DLOG_ARG_PTR) {
+        uintptr_t u = (uintptr_t) v;
+        put((uint32_t) u);
+        if (DLOG_PTR_WORDS > 1) put((uint32_t) ((uint64_t) u >> 32));
+    } else {
+        put((uint32_t) v);
+    }
+}
+
+typedef struct {
+    const dlog_site_t* site;
+    uint32_t time_us;           // Low 32 bits of the microsecond clock
+    uint32_t types;             // dlog_type_word of the arguments
+    uint32_t nwords;
+    uint32_t words[DLOG_MAX_RECORD_WORDS];   // Encoded arguments
+} dlog_record_t;
+
+// Encode everything after the state word through put(word); the caller stores
+// the state word itself once the rest is in place
+template <typename Put, typename... Args>
+inline void dlog_encode(Put& put, const dlog_site_t* site, uint32_t time_us, const Args&... args) {
+    put(time_us);
+    uintptr_t s = (uintptr_t) site;
+    put((uint32_t) s);
+    if (DLOG_PTR_WORDS > 1) put((uint32_t) ((uint64_t) s >> 32));
+    put(dlog_type_word<Args...>());
+    (dlog_put_arg(args, put), ...);
+}
+
+// Encode straight into a record, for logging before a ring exists
+template <typename... Args>
+inline bool dlog_record(dlog_record_t* rec, const dlog_site_t* site, uint32_t time_us, const Args&... args) {
+    size_t n = ((size_t) 0 + ... + dlog_arg_words(args));
+    if (n > DLOG_MAX_RECORD_WORDS) return false;
+    rec->site = site;
+    rec->time_us = time_us;
+    rec->types = dlog_type_word<Args...>();
+    rec->nwords = (uint32_t) n;
+    uint32_t pos = 0;
+    auto put = [&](uint32_t w) { rec->words[pos++] = w; };
+    (void) put;
+    (dlog_put_arg(args, put), ...);
+    return true;
+}
+
+typedef struct {
+    uint32_t read;
+    uint32_t dropped;       // Ring full or record too large
+    uint32_t peak_words;    // Highest fill seen by the reader
+    uint32_t capacity_words;
+} dlog_ring_stats_t;
+
+// Multi-producer, single-consumer ring of 32-bit words holding encoded log
+// records. A writer reserves its record with one CAS on the head, fills it and
+// publishes it by storing the record's state word last, so writers on the same
+// core may preempt each other (or come from an ISR) without a lock. The reader
+// stops at the first record not yet published and zeroes what it consumed, so
+// a stale word can never look like a published header. One ring per core keeps
+// the head's cache line from bouncing between cores.
+//
+// No ESP-IDF dependencies: the caller supplies the timestamp.
+class DlogRing {
+public:
+    // Capacity is rounded up to a power of two (at least 2 * DLOG_MAX_RECORD_WORDS)
+    explicit DlogRing(size_t words) {
+        size_t cap = 2 * DLOG_MAX_RECORD_WORDS;
+        while (cap < words && cap < 0x8000) cap <<= 1;
+        _mask = (uint32_t) cap - 1;
+        _words.reset(new std::atomic<uint32_t>[cap]);
+        for (size_t i = 0; i < cap; i++) _words[i].store(0, std::memory_order_relaxed);
+    }
+
+    DlogRing(const DlogRing&) = delete;
+    DlogRing& operator=(const DlogRing&) = delete;
+
+    // False (and counted as dropped) when the ring is full
+    template <typename... Args>
+    bool write(const dlog_site_t* site, uint32_t time_us, const Args&... args) {
+        static_assert(sizeof...(Args) <= DLOG_MAX_ARGS, "too many deferred log arguments");
+        size_t n = DLOG_HEADER_WORDS + ((size_t) 0 + ... + dlog_arg_words(args));
+        if (n - DLOG_HEADER_WORDS > DLOG_MAX_RECORD_WORDS) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        do {
+            if (head + n - _tail.load(std::memory_order_acquire) > _mask + 1) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while (!_head.compare_exchange_weak(head, head + (uint32_t) n, std::memory_order_relaxed));
+
+        uint32_t pos = head + 1;
+        auto put = [&](uint32_t w) { _words[pos++ & _mask].store(w, std::memory_order_relaxed); };
+        dlog_encode(put, site, time_us, args...);
+        _words[head & _mask].store(COMMITTED | (uint32_t) n, std::memory_order_release);
+        return true;
+    }
+
+    // Take the oldest published record. Single reader only.
+    bool read(dlog_record_t* rec) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        uint32_t state = _words[tail & _mask].load(std::memory_order_acquire);
+        if (!(state & COMMITTED)) return false;
+
+        uint32_t fill = _head.load(std::memory_order_relaxed) - tail;
+        if (fill > _peak) _peak = fill;
+
+        uint32_t n = state & 0xFFFF;
+        uint32_t pos = tail + 1;
+        auto get = [&]() {
+            uint32_t w = _words[pos & _mask].load(std::memory_order_relaxed);
+            _words[pos++ & _mask].store(0, std::memory_order_relaxed);
+            return w;
+        };
+        rec->time_us = get();
+        uintptr_t site = get();
+        if (DLOG_PTR_WORDS > 1) site |= (uintptr_t) ((uint64_t) get() << 32);
+        rec->site = (const dlog_site_t*) site;
+        rec->types = get();
+        rec->nwords = n - (uint32_t) DLOG_HEADER_WORDS;
+        for (uint32_t i = 0; i < rec->nwords; i++) rec->words[i] = get();
+
+        _words[tail & _mask].store(0, std::memory_order_relaxed);
+        _tail.store(tail + n, std::memory_order_release);
+        _read++;
+        return true;
+    }
+
+    dlog_ring_stats_t stats() const {
+        return {_read, _dropped.load(std::memory_order_relaxed), _peak, _mask + 1};
+    }
+
+private:
+    static const uint32_t COMMITTED = 0x80000000u;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> _words;
+    uint32_t _mask = 0;
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+    std::atomic<uint32_t> _dropped{0};
+    uint32_t _read = 0;       // Reader side only
+    uint32_t _peak = 0;
+};
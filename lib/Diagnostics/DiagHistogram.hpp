@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+static const size_t DIAG_HIST_BUCKETS = 33;   // Bucket 0 holds 0, bucket i holds [2^(i-1), 2^i)
+
+typedef struct {
+    uint32_t count;
+    uint32_t sum;         // Wraps after 2^32; interval snapshots keep it in range
+    uint32_t min;
+    uint32_t max;
+    uint32_t buckets[DIAG_HIST_BUCKETS];
+} diag_hist_snapshot_t;
+
+// Bucket index of a value: 0 for 0, otherwise the bit length of v
+inline size_t diag_hist_bucket(uint32_t v) {
+    return v ? 32 - __builtin_clz(v) : 0;
+}
+
+// Upper bound of the bucket holding the p-quantile (0 < p <= 1), clamped to the
+// observed range. Resolution is a factor of two, enough to spot a regression.
+inline uint32_t diag_hist_percentile(const diag_hist_snapshot_t& s, float p) {
+    if (s.count == 0) return 0;
+    uint32_t rank = (uint32_t) (p * s.count + 0.5f);
+    if (rank < 1) rank = 1;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < DIAG_HIST_BUCKETS; i++) {
+        seen += s.buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = i == 0 ? 0 : (i == 32 ? UINT32_MAX : (1u << i) - 1);
+            if (upper > s.max) upper = s.max;
+            if (upper < s.min) upper = s.min;
+            return upper;
+        }
+    }
+    return s.max;
+}
+
+// {"n":..,"mean":..,"min":..,"p50":..,"p90":..,"p99":..,"max":..}; returns bytes
+// written (no terminator) or 0 if cap is too small
+inline size_t diag_hist_json(const diag_hist_snapshot_t& s, char* buf, size_t cap) {
+    int n = snprintf(buf, cap, "{\"n\":%lu,\"mean\":%lu,\"min\":%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu}",
+                     (unsigned long) s.count, (unsigned long) (s.count ? s.sum / s.count : 0),
+                     (unsigned long) (s.count ? s.min : 0), (unsigned long) diag_hist_percentile(s, 0.5f),
+                     (unsigned long) diag_hist_percentile(s, 0.9f), (unsigned long) diag_hist_percentile(s, 0.99f),
+                     (unsigned long) s.max);
+    return n > 0 && (size_t) n < cap ? (size_t) n : 0;
+}
+
+// Log2 histogram with relaxed atomic counters: record() costs a handful of
+// uncontended atomic ops, takes no lock and may be called from any task, either
+// core or an ISR. Snapshots are taken bucket by bucket, so one racing with
+// record() can be off by that one sample.
+class DiagHistogram {
+public:
+    DiagHistogram() { reset(); }
+
+    void record(uint32_t value) {
+        _buckets[diag_hist_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(value, std::memory_order_relaxed);
+        uint32_t cur = _max.load(std::memory_order_relaxed);
+        while (value > cur && !_max.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+        cur = _min.load(std::memory_order_relaxed);
+        while (value < cur && !_min.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+    }
+
+    // Negative durations (clock skew between cores) count as 0
+    void record_us(int64_t us) { record(us <= 0 ? 0 : (us > UINT32_MAX ? UINT32_MAX : (uint32_t) us)); }
+
+    // reset = true starts a new interval, so each snapshot covers one publish period
+    diag_hist_snapshot_t snapshot(bool reset_after = true) {
+        diag_hist_snapshot_t s;
+        for (size_t i = 0; i < DIAG_HIST_BUCKETS; i++) {
+            s.buckets[i] = reset_after ? _buckets[i].exchange(0, std::memory_order_relaxed)
+                                       : _buckets[i].load(std::memory_order_relaxed);
+        }
+        s.count = reset_after ? _count.exchange(0, std::memory_order_relaxed) : _count.load(std::memory_order_relaxed);
+        s.sum = reset_after ? _sum.exchange(0, std::memory_order_relaxed) : _sum.load(std::memory_order_relaxed);
+        s.min = reset_after ? _min.exchange(UINT32_MAX, std::memory_order_relaxed) : _min.load(std::memory_order_relaxed);
+        s.max = reset_after ? _max.exchange(0, std::memory_order_relaxed) : _max.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void reset() { snapshot(true); }
+
+private:
+    std::atomic<uint32_t> _buckets[DIAG_HIST_BUCKETS];
+    std::atomic<uint32_t> _count;
+    std::atomic<uint32_t> _sum;
+    std::atomic<uint32_t> _min;
+    std::atomic<uint32_t> _max;
+};
+
+// Event counter; take() returns the count since the previous take()
+class DiagCounter {
+public:
+    void add(uint32_t n = 1) { _value.fetch_add(n, std::memory_order_relaxed); }
+    uint32_t take() { return _value.exchange(0, std::memory_order_relaxed); }
+    uint32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> _value{0};
+};
+
+// Per-task CPU share between two samples of cumulative run-time counters (as
+// reported by uxTaskGetSystemState). Tasks are matched by id, so tasks created
+// or deleted between samples are handled; a new task's first sample counts from 0.
+class DiagCpuShare {
+public:
+    static const size_t MAX_TASKS = 48;
+
+    // ids/runtime: n tasks; total: cumulative run time of one core; cores: the
+    // share is of the whole CPU (all cores). percent_out gets one value per task.
+    void update(const uint32_t* ids, const uint32_t* runtime, size_t n, uint32_t total, size_t cores,
+                uint8_t* percent_out) {
+        uint32_t elapsed = total - _last_total;
+        uint64_t capacity = (uint64_t) elapsed * (cores ? cores : 1);
+        _last_total = total;
+
+        Slot next[MAX_TASKS];
+        size_t next_count = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint32_t prev = 0;
+            for (size_t j = 0; j < _count; j++) {
+                if (_slots[j].id == ids[i]) {
+                    prev = _slots[j].runtime;
+                    break;
+                }
+            }
+            uint32_t delta = runtime[i] - prev;
+            uint64_t pct = capacity ? ((uint64_t) delta * 100 + capacity / 2) / capacity : 0;
+            percent_out[i] = (uint8_t) (pct > 100 ? 100 : pct);
+            if (next_count < MAX_TASKS) next[next_count++] = {ids[i], runtime[i]};
+        }
+        for (size_t i = 0; i < next_count; i++) _slots[i] = next[i];
+        _count = next_count;
+    }
+
+private:
+    struct Slot {
+        uint32_t id;
+        uint32_t runtime;
+    };
+
+    Slot _slots[MAX_TASKS];
+    size_t _count = 0;
+    uint32_t _last_total = 0;
+};
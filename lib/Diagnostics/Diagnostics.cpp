@@ -0,0 +1,204 @@
+#include <stdarg.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "Diagnostics.hpp"
+#include "Mqtt_Connection.hpp"
+#include "SizeClassPool.hpp"
+
+static const char* TAG = "Diagnostics";
+
+Diagnostics& Diagnostics::instance() {
+    static Diagnostics diag;
+    return diag;
+}
+
+Diagnostics::Diagnostics() {
+    _lock = xSemaphoreCreateMutex();
+}
+
+template <typename T>
+static T* find_or_add(T* slots, size_t count, const char* name) {
+    for (size_t i = 0; i < count; i++) {
+        if (slots[i].name && strcmp(slots[i].name, name) == 0) return &slots[i];
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!slots[i].name) {
+            slots[i].name = name;
+            return &slots[i];
+        }
+    }
+    return nullptr;
+}
+
+DiagHistogram* Diagnostics::histogram(const char* name) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    auto slot = find_or_add(_histograms, MAX_NAMED, name);
+    xSemaphoreGive(_lock);
+    if (!slot) ESP_LOGW(TAG, "No room for histogram %s", name);
+    return slot ? &slot->metric : nullptr;
+}
+
+DiagCounter* Diagnostics::counter(const char* name) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    auto slot = find_or_add(_counters, MAX_NAMED, name);
+    xSemaphoreGive(_lock);
+    if (!slot) ESP_LOGW(TAG, "No room for counter %s", name);
+    return slot ? &slot->metric : nullptr;
+}
+
+// Append formatted text; on overflow nothing is kept and false is returned
+static bool put(char* buf, size_t cap, size_t* len, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + *len, cap - *len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t) n >= cap - *len) {
+        buf[*len] = '\0';
+        return false;
+    }
+    *len += (size_t) n;
+    return true;
+}
+
+static bool put_histogram(char* buf, size_t cap, size_t* len, const char* name, DiagHistogram& hist) {
+    size_t start = *len;
+    diag_hist_snapshot_t s = hist.snapshot();
+    if (!put(buf, cap, len, ",\"%s\":", name)) return false;
+    size_t n = diag_hist_json(s, buf + *len, cap - *len);
+    if (n == 0) {
+        *len = start;
+        return false;
+    }
+    *len += n;
+    return true;
+}
+
+// "tasks":[{"name":..,"prio":..,"stack_free":..,"cpu":..},...]
+size_t Diagnostics::write_tasks(char* buf, size_t cap) {
+#if configUSE_TRACE_FACILITY
+    _task_status.resize(uxTaskGetNumberOfTasks() + 4);
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t n = uxTaskGetSystemState(_task_status.data(), _task_status.size(), &total);
+
+    _task_cpu.assign(n, 0);
+#if configGENERATE_RUN_TIME_STATS
+    _task_ids.resize(n);
+    _task_runtime.resize(n);
+    for (UBaseType_t i = 0; i < n; i++) {
+        _task_ids[i] = _task_status[i].xTaskNumber;
+        _task_runtime[i] = (uint32_t) _task_status[i].ulRunTimeCounter;
+    }
+    _cpu.update(_task_ids.data(), _task_runtime.data(), n, (uint32_t) total, portNUM_PROCESSORS, _task_cpu.data());
+#endif
+
+    size_t len = 0;
+    if (!put(buf, cap, &len, ",\"tasks\":[")) return 0;
+    for (UBaseType_t i = 0; i < n; i++) {
+        const TaskStatus_t& t = _task_status[i];
+        if (!put(buf, cap, &len, "%s{\"name\":\"%s\",\"prio\":%u,\"stack_free\":%lu,\"cpu\":%u}", i ? "," : "",
+                 t.pcTaskName, (unsigned) t.uxCurrentPriority, (unsigned long) t.usStackHighWaterMark,
+                 (unsigned) _task_cpu[i])) {
+            return 0;
+        }
+    }
+    if (!put(buf, cap, &len, "]")) return 0;
+    return len;
+#else
+    return 0;
+#endif
+}
+
+// Sections that do not fit are left out whole, so the report stays valid JSON
+size_t Diagnostics::report(char* buf, size_t cap) {
+    if (cap < 2) return 0;
+    size_t body_cap = cap - 1;   // Room for the closing brace
+    size_t len = 0;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    put(buf, body_cap, &len, "{\"uptime_s\":%lu", (unsigned long) (esp_timer_get_time() / 1000000));
+
+    size_t free_internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    put(buf, body_cap, &len,
+        ",\"heap\":{\"free\":%u,\"min_free\":%u,\"largest\":%u,\"frag_pct\":%u,\"psram_free\":%u}",
+        (unsigned) free_internal, (unsigned) heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+        (unsigned) largest, (unsigned) (free_internal ? 100 - largest * 100 / free_internal : 0),
+        (unsigned) heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+
+    len += write_tasks(buf + len, body_cap - len);
+
+    if (_mqtt) {
+        mqtt_outbox_stats_t m = _mqtt->outbox_stats();
+        put(buf, body_cap, &len,
+            ",\"mqtt\":{\"queued\":%lu,\"queued_bytes\":%lu,\"peak_bytes\":%lu,\"inflight_bytes\":%d,"
+            "\"store_pending\":%lu,\"dropped\":%lu,\"rejected\":%lu}",
+            (unsigned long) m.queued_messages, (unsigned long) m.queued_bytes, (unsigned long) m.peak_queued_bytes,
+            m.esp_outbox_bytes, (unsigned long) m.store_pending, (unsigned long) m.dropped,
+            (unsigned long) m.rejected);
+    }
+
+    pool_stats_t pool = SizeClassPool::global().stats();
+    if (pool.reserved_internal + pool.reserved_psram > 0) {
+        put(buf, body_cap, &len,
+            ",\"pool\":{\"allocs\":%lu,\"fallback\":%lu,\"live_bytes\":%lu,\"waste_pct\":%lu}",
+            (unsigned long) pool.allocs, (unsigned long) pool.fallback_allocs, (unsigned long) pool.live_block_bytes,
+            (unsigned long) pool.waste_pct);
+    }
+
+    put_histogram(buf, body_cap, &len, "gpio_edge_latency_us", gpio_edge_latency_us);
+    put_histogram(buf, body_cap, &len, "http_connect_us", http_connect_us);
+    put_histogram(buf, body_cap, &len, "http_wait_us", http_wait_us);
+    put_histogram(buf, body_cap, &len, "http_transfer_us", http_transfer_us);
+    put(buf, body_cap, &len, ",\"http_errors\":%lu", (unsigned long) http_errors.take());
+
+    for (auto& h : _histograms) {
+        if (h.name) put_histogram(buf, body_cap, &len, h.name, h.metric);
+    }
+    for (auto& c : _counters) {
+        if (c.name) put(buf, body_cap, &len, ",\"%s\":%lu", c.name, (unsigned long) c.metric.take());
+    }
+    xSemaphoreGive(_lock);
+
+    buf[len++] = '}';
+    return len;
+}
+
+void Diagnostics::publish_task(void* arg) {
+    Diagnostics* diag = static_cast<Diagnostics*>(arg);
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (diag->_running) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(diag->_config.period_ms));
+        if (!diag->_running) break;
+
+        size_t len = diag->report(diag->_report.data(), diag->_report.size());
+        diag->_mqtt->publish(diag->_config.topic, std::string_view(diag->_report.data(), len), 0, false);
+    }
+
+    diag->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+esp_err_t Diagnostics::start(Mqtt_Connection& mqtt, const DiagnosticsConfig& config) {
+    if (_task) return ESP_ERR_INVALID_STATE;
+
+    _mqtt = &mqtt;
+    _config = config;
+    _report.resize(config.max_report_size);
+    _running = true;
+
+    if (xTaskCreatePinnedToCore(publish_task, "diag", config.task_stack, this, config.task_priority,
+                                &_task, config.core) != pdPASS) {
+        _running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Publishing to %s every %lu ms", config.topic.c_str(), (unsigned long) config.period_ms);
+    return ESP_OK;
+}
+
+// The task exits at its next wake-up
+void Diagnostics::stop() {
+    _running = false;
+}
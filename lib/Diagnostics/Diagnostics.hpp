@@ -0,0 +1,90 @@
+#pragma once
+#ifdef __cplusplus
+#include <string>
+#endif
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "DiagHistogram.hpp"
+
+class Mqtt_Connection;
+
+struct DiagnosticsConfig {
+    std::string topic = "diagnostics";
+    uint32_t period_ms = 10000;
+    UBaseType_t task_priority = 1;
+    uint32_t task_stack = 4096;
+    int core = tskNO_AFFINITY;
+    size_t max_report_size = 3072;   // Larger reports are truncated to the sections that fit
+};
+
+// Process-wide performance counters and histograms, published as one JSON
+// report per period on a diagnostics topic. The built-in metrics below are fed
+// by the GPIO and HttpClient libraries; applications add their own by name.
+// Task CPU share needs CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS, task stack
+// high-water marks need CONFIG_FREERTOS_USE_TRACE_FACILITY; without them those
+// sections are left out.
+class Diagnostics {
+public:
+    static Diagnostics& instance();
+
+    // Edge timestamp taken in the GPIO ISR to the event reaching GPIO::read_edges
+    DiagHistogram gpio_edge_latency_us;
+
+    // esp_http_client_open plus the request body: DNS, TCP and TLS on a new
+    // connection, just the request on a pooled one
+    DiagHistogram http_connect_us;
+
+    // Request sent to response headers received (server time plus one round trip)
+    DiagHistogram http_wait_us;
+
+    // Response body read into the sink
+    DiagHistogram http_transfer_us;
+
+    DiagCounter http_errors;
+
+    // Named application metrics. Register during start-up and keep the pointer;
+    // the same name returns the same metric. nullptr once MAX_NAMED are in use.
+    DiagHistogram* histogram(const char* name);
+    DiagCounter* counter(const char* name);
+
+    // Publish a report every period_ms through mqtt, from a task of our own
+    esp_err_t start(Mqtt_Connection& mqtt, const DiagnosticsConfig& config = DiagnosticsConfig());
+
+    void stop();
+
+    // Build a report now into buf; interval metrics restart from zero.
+    // Returns bytes written (no terminator).
+    size_t report(char* buf, size_t cap);
+
+    static const size_t MAX_NAMED = 8;
+
+private:
+    Diagnostics();
+
+    template <typename T>
+    struct Named {
+        const char* name = nullptr;
+        T metric;
+    };
+
+    Named<DiagHistogram> _histograms[MAX_NAMED];
+    Named<DiagCounter> _counters[MAX_NAMED];
+    SemaphoreHandle_t _lock;
+
+    Mqtt_Connection* _mqtt = nullptr;
+    DiagnosticsConfig _config;
+    TaskHandle_t _task = nullptr;
+    volatile bool _running = false;
+    std::vector<char> _report;
+    std::vector<TaskStatus_t> _task_status;
+    std::vector<uint32_t> _task_ids;
+    std::vector<uint32_t> _task_runtime;
+    std::vector<uint8_t> _task_cpu;
+    DiagCpuShare _cpu;
+
+    static void publish_task(void* arg);
+    size_t write_tasks(char* buf, size_t cap);
+};
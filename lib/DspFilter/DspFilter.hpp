@@ -0,0 +1,365 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#if defined(__has_include)
+#if __has_include("dsps_biquad.h")
+#include "dsps_biquad.h"
+#define DSP_FILTER_HAS_ESP_DSP 1
+#endif
+#endif
+
+// Block-based filters for ADC and distance streams. Every filter keeps its state
+// between calls, so a stream can be fed in blocks of any size (including 1) and
+// gives the same output as one long call. Fixed-point kernels use Q15 (int16_t)
+// or Q31 (int32_t) samples; raw 12-bit ADC counts are valid Q15 input.
+// No heap: window sizes are template parameters.
+
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+namespace dsp {
+
+inline q15_t sat_q15(int64_t v) {
+    return v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : (q15_t) v;
+}
+
+inline q31_t sat_q31(int64_t v) {
+    return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (q31_t) v;
+}
+
+// Accumulator wide enough to sum a window of T without overflow
+template <typename T>
+using accum_t = std::conditional_t<std::is_floating_point_v<T>, double,
+                std::conditional_t<(sizeof(T) <= 2), int32_t, int64_t>>;
+
+}  // namespace dsp
+
+// Type-erased int16 stage, used where a filter is chosen at run time (GPIO::set_filter).
+// process() may run in place (in == out) and returns the number of samples written,
+// which is less than n only for decimating filters.
+class BlockFilter {
+public:
+    virtual ~BlockFilter() = default;
+    virtual size_t process(const int16_t* in, int16_t* out, size_t n) = 0;
+    virtual void reset() = 0;
+};
+
+// Running mean over the last N samples (the first outputs average what has been seen)
+template <typename T, size_t N>
+class MovingAverage {
+public:
+    static_assert(N > 0, "window must not be empty");
+
+    size_t process(const T* in, T* out, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            T x = in[i];
+            if (_count == N) _sum -= _window[_pos];
+            else _count++;
+            _window[_pos] = x;
+            _sum += x;
+            _pos = _pos + 1 == N ? 0 : _pos + 1;
+            out[i] = mean();
+        }
+        return n;
+    }
+
+    void reset() {
+        _sum = 0;
+        _pos = 0;
+        _count = 0;
+    }
+
+private:
+    T _window[N] = {};
+    dsp::accum_t<T> _sum = 0;
+    size_t _pos = 0;
+    size_t _count = 0;
+
+    T mean() const {
+        if constexpr (std::is_floating_point_v<T>) {
+            return (T) (_sum / (dsp::accum_t<T>) _count);
+        } else {
+            // Round half away from zero
+            dsp::accum_t<T> half = (dsp::accum_t<T>) (_count / 2);
+            return (T) ((_sum >= 0 ? _sum + half : _sum - half) / (dsp::accum_t<T>) _count);
+        }
+    }
+};
+
+// Median of the last N samples (N odd). Rejects single spikes such as missed
+// ultrasonic echoes without smearing steps like an average does. O(N) per sample.
+template <typename T, size_t N>
+class MedianFilter {
+public:
+    static_assert(N % 2 == 1 && N <= 31, "median window must be odd and at most 31");
+
+    size_t process(const T* in, T* out, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            T x = in[i];
+            if (_count == N) {
+                remove_sorted(_window[_pos]);
+            } else {
+                _count++;
+            }
+            _window[_pos] = x;
+            _pos = _pos + 1 == N ? 0 : _pos + 1;
+            insert_sorted(x);
+            out[i] = _sorted[(_count - 1) / 2];
+        }
+        return n;
+    }
+
+    void reset() {
+        _pos = 0;
+        _count = 0;
+    }
+
+private:
+    T _window[N] = {};
+    T _sorted[N] = {};
+    size_t _pos = 0;
+    size_t _count = 0;
+
+    // Called with a full window; leaves N - 1 sorted values
+    void remove_sorted(T x) {
+        size_t live = _count;
+        size_t i = 0;
+        while (i < live && _sorted[i] != x) i++;
+        for (; i + 1 < live; i++) _sorted[i] = _sorted[i + 1];
+    }
+
+    // Expects _count - 1 sorted values
+    void insert_sorted(T x) {
+        size_t i = _count - 1;
+        while (i > 0 && _sorted[i - 1] > x) {
+            _sorted[i] = _sorted[i - 1];
+            i--;
+        }
+        _sorted[i] = x;
+    }
+};
+
+// Normalised biquad coefficients (a0 = 1): y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2
+struct BiquadCoeffs {
+    static constexpr float PI = 3.14159265f;
+
+    float b0, b1, b2, a1, a2;
+
+    // RBJ cookbook designs; fc and fs in Hz, q = 0.7071 for Butterworth
+    static BiquadCoeffs lowpass(float fc, float fs, float q = 0.7071f) {
+        float w = 2.0f * PI * fc / fs;
+        float alpha = sinf(w) / (2.0f * q);
+        float c = cosf(w);
+        float a0 = 1.0f + alpha;
+        return {(1.0f - c) / 2.0f / a0, (1.0f - c) / a0, (1.0f - c) / 2.0f / a0,
+                -2.0f * c / a0, (1.0f - alpha) / a0};
+    }
+
+    static BiquadCoeffs highpass(float fc, float fs, float q = 0.7071f) {
+        float w = 2.0f * PI * fc / fs;
+        float alpha = sinf(w) / (2.0f * q);
+        float c = cosf(w);
+        float a0 = 1.0f + alpha;
+        return {(1.0f + c) / 2.0f / a0, -(1.0f + c) / a0, (1.0f + c) / 2.0f / a0,
+                -2.0f * c / a0, (1.0f - alpha) / a0};
+    }
+};
+
+// Direct form I biquad on fixed-point samples with a 64-bit accumulator.
+// Coefficients are Q30 for both sample widths: one bit of headroom keeps |a1| up
+// to 2 representable, and the extra precision holds the DC gain of low cut-off
+// designs that Q14 coefficients would round away. The rounding remainder is fed
+// back into the next sample (error feedback), which removes the dead band that
+// low cut-off filters otherwise settle into. Output saturates, never wraps.
+// For Q31 leave one bit of input headroom (|x| < 2^30) with high-Q designs, where
+// |a1| + |a2| approaches 3 and the accumulator would otherwise overflow.
+template <typename T>
+class BiquadFixed {
+public:
+    static_assert(std::is_same_v<T, q15_t> || std::is_same_v<T, q31_t>, "Q15 or Q31 samples");
+
+    explicit BiquadFixed(const BiquadCoeffs& c) { set_coeffs(c); }
+
+    void set_coeffs(const BiquadCoeffs& c) {
+        const double scale = (double) (1LL << COEFF_FRAC);
+        _b0 = (int32_t) llrint(c.b0 * scale);
+        _b1 = (int32_t) llrint(c.b1 * scale);
+        _b2 = (int32_t) llrint(c.b2 * scale);
+        _a1 = (int32_t) llrint(c.a1 * scale);
+        _a2 = (int32_t) llrint(c.a2 * scale);
+    }
+
+    size_t process(const T* in, T* out, size_t n) {
+        int64_t x1 = _x1, x2 = _x2, y1 = _y1, y2 = _y2;
+        int64_t err = _err;
+        for (size_t i = 0; i < n; i++) {
+            int64_t x0 = in[i];
+            int64_t acc = (int64_t) _b0 * x0 + (int64_t) _b1 * x1 + (int64_t) _b2 * x2
+                        - (int64_t) _a1 * y1 - (int64_t) _a2 * y2 + err;
+            T y = saturate(acc >> COEFF_FRAC);
+            err = acc - ((int64_t) y << COEFF_FRAC);
+            if (err < 0 || err >= ONE) err = 0;   // Saturated: drop the remainder
+            x2 = x1;
+            x1 = x0;
+            y2 = y1;
+            y1 = y;
+            out[i] = y;
+        }
+        _x1 = (T) x1;
+        _x2 = (T) x2;
+        _y1 = (T) y1;
+        _y2 = (T) y2;
+        _err = err;
+        return n;
+    }
+
+    void reset() {
+        _x1 = _x2 = _y1 = _y2 = 0;
+        _err = 0;
+    }
+
+private:
+    static constexpr int COEFF_FRAC = 30;
+    static constexpr int64_t ONE = 1LL << COEFF_FRAC;
+
+    int32_t _b0, _b1, _b2, _a1, _a2;
+    T _x1 = 0, _x2 = 0, _y1 = 0, _y2 = 0;
+    int64_t _err = 0;
+
+    static T saturate(int64_t v) {
+        if constexpr (std::is_same_v<T, q15_t>) return dsp::sat_q15(v);
+        else return dsp::sat_q31(v);
+    }
+};
+
+typedef BiquadFixed<q15_t> BiquadQ15;
+typedef BiquadFixed<q31_t> BiquadQ31;
+
+// Float biquad (transposed direct form II) for distances and other float streams.
+// Uses the esp-dsp optimised kernel when that component is available.
+class BiquadF32 {
+public:
+    explicit BiquadF32(const BiquadCoeffs& c) { set_coeffs(c); }
+
+    void set_coeffs(const BiquadCoeffs& c) {
+        _coef[0] = c.b0;
+        _coef[1] = c.b1;
+        _coef[2] = c.b2;
+        _coef[3] = c.a1;
+        _coef[4] = c.a2;
+    }
+
+    size_t process(const float* in, float* out, size_t n) {
+#if DSP_FILTER_HAS_ESP_DSP
+        dsps_biquad_f32((float*) in, out, (int) n, _coef, _w);
+#else
+        float w0 = _w[0], w1 = _w[1];
+        for (size_t i = 0; i < n; i++) {
+            float x = in[i];
+            float y = _coef[0] * x + w0;
+            w0 = _coef[1] * x - _coef[3] * y + w1;
+            w1 = _coef[2] * x - _coef[4] * y;
+            out[i] = y;
+        }
+        _w[0] = w0;
+        _w[1] = w1;
+#endif
+        return n;
+    }
+
+    void reset() { _w[0] = _w[1] = 0.0f; }
+
+private:
+    float _coef[5];
+    float _w[2] = {0.0f, 0.0f};
+};
+
+// Keep one output per Factor inputs, averaging the group (a boxcar anti-alias
+// stage; put a biquad low-pass in front for sharper cut-off). Partial groups
+// carry over to the next call. Returns the number of outputs written.
+template <typename T, size_t Factor>
+class Decimator {
+public:
+    static_assert(Factor > 0, "decimation factor must be positive");
+
+    size_t process(const T* in, T* out, size_t n) {
+        size_t produced = 0;
+        for (size_t i = 0; i < n; i++) {
+            _sum += in[i];
+            if (++_phase == Factor) {
+                out[produced++] = average();
+                _sum = 0;
+                _phase = 0;
+            }
+        }
+        return produced;
+    }
+
+    void reset() {
+        _sum = 0;
+        _phase = 0;
+    }
+
+private:
+    dsp::accum_t<T> _sum = 0;
+    size_t _phase = 0;
+
+    T average() const {
+        if constexpr (std::is_floating_point_v<T>) {
+            return (T) (_sum / (dsp::accum_t<T>) Factor);
+        } else {
+            dsp::accum_t<T> half = (dsp::accum_t<T>) (Factor / 2);
+            return (T) ((_sum >= 0 ? _sum + half : _sum - half) / (dsp::accum_t<T>) Factor);
+        }
+    }
+};
+
+// Adapts any of the int16 filters above to the BlockFilter interface
+template <typename F>
+class BlockFilterAdapter : public BlockFilter {
+public:
+    template <typename... Args>
+    explicit BlockFilterAdapter(Args&&... args) : _filter(static_cast<Args&&>(args)...) {}
+
+    size_t process(const int16_t* in, int16_t* out, size_t n) override { return _filter.process(in, out, n); }
+
+    void reset() override { _filter.reset(); }
+
+    F& filter() { return _filter; }
+
+private:
+    F _filter;
+};
+
+// Runs up to MAX_STAGES filters back to back in place on the same block
+class FilterChain : public BlockFilter {
+public:
+    static const size_t MAX_STAGES = 4;
+
+    bool add(BlockFilter* stage) {
+        if (_count == MAX_STAGES) return false;
+        _stages[_count++] = stage;
+        return true;
+    }
+
+    size_t process(const int16_t* in, int16_t* out, size_t n) override {
+        if (_count == 0) {
+            for (size_t i = 0; i < n; i++) out[i] = in[i];
+            return n;
+        }
+        n = _stages[0]->process(in, out, n);
+        for (size_t s = 1; s < _count && n > 0; s++) n = _stages[s]->process(out, out, n);
+        return n;
+    }
+
+    void reset() override {
+        for (size_t s = 0; s < _count; s++) _stages[s]->reset();
+    }
+
+private:
+    BlockFilter* _stages[MAX_STAGES] = {};
+    size_t _count = 0;
+};
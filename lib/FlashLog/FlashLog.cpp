@@ -0,0 +1,330 @@
+#include <string.h>
+#include "FlashLog.hpp"
+
+static const uint32_t SECTOR_MAGIC = 0x474F4C46;   // "FLOG"
+static const uint8_t RECORD_PENDING = 0xFF;
+static const uint8_t RECORD_CONSUMED = 0x00;       // Marker: delivered up to and including this record
+static const uint16_t RECORD_ERASED = 0xFFFF;
+
+struct SectorHeader {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t crc;     // Over magic and seq
+};
+
+struct RecordHeader {
+    uint16_t len;
+    uint8_t state;    // Not covered by the CRC: cleared in place when consumed
+    uint8_t reserved;
+    uint32_t crc;     // Over len and the payload
+};
+
+static const size_t SH = sizeof(SectorHeader);
+static const size_t RH = sizeof(RecordHeader);
+static const size_t STATE_OFFSET = offsetof(RecordHeader, state);
+
+// CRC-32 (IEEE 802.3, reflected), table built on first use
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t len) {
+    static uint32_t table[256];
+    static bool ready = false;
+    if (!ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        ready = true;
+    }
+    const uint8_t* p = (const uint8_t*) data;
+    crc = ~crc;
+    while (len--) crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static bool record_valid(const RecordHeader& rh, const uint8_t* payload) {
+    uint32_t crc = crc32_update(0, &rh.len, sizeof(rh.len));
+    return crc32_update(crc, payload, rh.len) == rh.crc;
+}
+
+static bool record_erased(const RecordHeader& rh) {
+    return rh.len == RECORD_ERASED && rh.state == 0xFF && rh.reserved == 0xFF && rh.crc == 0xFFFFFFFFu;
+}
+
+FlashLog::FlashLog(FlashStorage& storage) : _storage(storage) {}
+
+bool FlashLog::mount() {
+    std::lock_guard<std::mutex> guard(_lock);
+    _sector_size = _storage.sector_size();
+    _sector_count = _sector_size ? _storage.size() / _sector_size : 0;
+    if (_sector_count < 2 || _sector_size < SH + RH + 16) return false;
+
+    _seq.assign(_sector_count, 0);
+    _scratch.resize(_sector_size);
+    _stats = {};
+
+    size_t head = 0;
+    uint32_t head_seq = 0;
+    for (size_t i = 0; i < _sector_count; i++) {
+        SectorHeader sh;
+        if (!_storage.read(addr(i, 0), &sh, SH)) return false;
+        if (sh.magic != SECTOR_MAGIC || sh.seq == 0 || crc32_update(0, &sh, 8) != sh.crc) continue;
+        _seq[i] = sh.seq;
+        if (sh.seq > head_seq) {
+            head_seq = sh.seq;
+            head = i;
+        }
+    }
+
+    _head_seq = head_seq;
+    if (head_seq == 0) {
+        _head = {0, 0};
+        _tail = _head;
+        _mounted = true;
+        return true;
+    }
+
+    // Walk back from the newest sector while sequence numbers are consecutive;
+    // anything outside that chain is stale and treated as free
+    size_t oldest = head;
+    for (size_t n = 1; n < _sector_count; n++) {
+        size_t prev = (oldest + _sector_count - 1) % _sector_count;
+        if (_seq[prev] == 0 || _seq[prev] != _seq[oldest] - 1) break;
+        oldest = prev;
+    }
+    for (size_t i = 0; i < _sector_count; i++) {
+        bool in_chain = (i + _sector_count - oldest) % _sector_count <= (head + _sector_count - oldest) % _sector_count;
+        if (!in_chain) _seq[i] = 0;
+    }
+
+    _tail = {oldest, SH};
+    for (size_t s = oldest; ; s = (s + 1) % _sector_count) {
+        bool torn = false;
+        size_t marker_next = 0;
+        uint32_t records = 0;
+        size_t end = scan_sector(s, SH, &torn, &marker_next, &records);
+        if (marker_next) {
+            _tail = {s, marker_next};
+            _stats.pending = records;
+        } else {
+            _stats.pending += records;
+        }
+        if (s == head) {
+            // Never append behind a torn record: its bits are no longer erased
+            _head = {head, torn ? _sector_size : end};
+            break;
+        }
+    }
+
+    _mounted = true;
+    return true;
+}
+
+// Parse a sector from offset `from`. Returns where the data ends; reports the
+// position after the last consumed marker (0 if none) and the number of valid
+// records after it.
+size_t FlashLog::scan_sector(size_t sector, size_t from, bool* torn, size_t* marker_next, uint32_t* records) {
+    *torn = false;
+    *marker_next = 0;
+    *records = 0;
+    if (!_storage.read(addr(sector, 0), _scratch.data(), _sector_size)) {
+        *torn = true;
+        return from;
+    }
+
+    size_t off = from;
+    while (off + RH <= _sector_size) {
+        RecordHeader rh;
+        memcpy(&rh, &_scratch[off], RH);
+        if (record_erased(rh)) break;
+        if (rh.len == 0 || off + RH + rh.len > _sector_size || !record_valid(rh, &_scratch[off + RH])) {
+            _stats.corrupt++;
+            *torn = true;
+            break;
+        }
+        off += RH + rh.len;
+        if (rh.state == RECORD_CONSUMED) {
+            *marker_next = off;
+            *records = 0;
+        } else {
+            (*records)++;
+        }
+    }
+    return off;
+}
+
+bool FlashLog::format() {
+    std::lock_guard<std::mutex> guard(_lock);
+    _sector_size = _storage.sector_size();
+    _sector_count = _sector_size ? _storage.size() / _sector_size : 0;
+    if (_sector_count < 2) return false;
+
+    for (size_t i = 0; i < _sector_count; i++) {
+        if (!_storage.erase_sector(addr(i, 0))) return false;
+    }
+    _seq.assign(_sector_count, 0);
+    _scratch.resize(_sector_size);
+    _stats = {};
+    _stats.erases = _sector_count;
+    _head = {0, 0};
+    _tail = _head;
+    _head_seq = 0;
+    _mounted = true;
+    return true;
+}
+
+size_t FlashLog::max_record_size() const {
+    size_t max = _sector_size > SH + RH ? _sector_size - SH - RH : 0;
+    return max < RECORD_ERASED ? max : RECORD_ERASED - 1;
+}
+
+// The head moves into `sector`; if that is where the oldest pending data lives,
+// those records are dropped first
+bool FlashLog::open_sector(size_t sector) {
+    if (_stats.pending > 0 && _tail.sector == sector && _seq[sector] != 0) drop_sector(sector);
+
+    if (!_storage.erase_sector(addr(sector, 0))) return false;
+    _stats.erases++;
+
+    SectorHeader sh = {SECTOR_MAGIC, _head_seq + 1, 0};
+    sh.crc = crc32_update(0, &sh, 8);
+    if (!_storage.write(addr(sector, 0), &sh, SH)) return false;
+
+    _head_seq = sh.seq;
+    _seq[sector] = sh.seq;
+    _head = {sector, SH};
+    if (_stats.pending == 0) _tail = _head;
+    return true;
+}
+
+void FlashLog::drop_sector(size_t sector) {
+    bool torn;
+    size_t marker_next;
+    uint32_t records;
+    scan_sector(sector, _tail.offset, &torn, &marker_next, &records);
+    uint32_t lost = records < _stats.pending ? records : _stats.pending;
+    _stats.dropped += lost;
+    _stats.pending -= lost;
+    advance_tail_sector();
+}
+
+bool FlashLog::advance_tail_sector() {
+    _tail = {(_tail.sector + 1) % _sector_count, SH};
+    return _seq[_tail.sector] != 0;
+}
+
+bool FlashLog::mark_consumed(size_t sector, size_t record_offset) {
+    uint8_t consumed = RECORD_CONSUMED;
+    return _storage.write(addr(sector, record_offset + STATE_OFFSET), &consumed, 1);
+}
+
+bool FlashLog::append(const void* data, size_t len) {
+    flash_log_part_t part = {data, len};
+    return append(&part, 1);
+}
+
+bool FlashLog::append(const flash_log_part_t* parts, size_t count) {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_mounted) return false;
+
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) total += parts[i].len;
+    if (total == 0 || total > max_record_size()) return false;
+
+    if (_head.offset == 0 || _head.offset + RH + total > _sector_size) {
+        size_t next = _head.offset == 0 ? _head.sector : (_head.sector + 1) % _sector_count;
+        if (!open_sector(next)) return false;
+    }
+
+    RecordHeader rh = {(uint16_t) total, RECORD_PENDING, 0xFF, 0};
+    uint32_t crc = crc32_update(0, &rh.len, sizeof(rh.len));
+    for (size_t i = 0; i < count; i++) crc = crc32_update(crc, parts[i].data, parts[i].len);
+    rh.crc = crc;
+
+    // Header first: a payload cut short by power loss then fails the CRC
+    size_t off = _head.offset;
+    bool ok = _storage.write(addr(_head.sector, off), &rh, RH);
+    off += RH;
+    for (size_t i = 0; ok && i < count; i++) {
+        if (parts[i].len == 0) continue;
+        ok = _storage.write(addr(_head.sector, off), parts[i].data, parts[i].len);
+        off += parts[i].len;
+    }
+
+    // Even on failure the space is spent; the next append starts after it
+    _head.offset += RH + total;
+    if (!ok) return false;
+
+    _stats.appended++;
+    _stats.pending++;
+    return true;
+}
+
+size_t FlashLog::replay(flash_log_replay_cb_t callback, void* ctx, size_t max_records) {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_mounted) return 0;
+
+    size_t delivered = 0;
+    while (delivered < max_records && _stats.pending > 0) {
+        size_t sector = _tail.sector;
+        size_t limit = sector == _head.sector ? _head.offset : _sector_size;
+        if (_tail.offset + RH > limit) {
+            if (sector == _head.sector) break;
+            if (!advance_tail_sector()) break;
+            continue;
+        }
+
+        // One read for the whole remaining span of this sector
+        size_t span = limit - _tail.offset;
+        if (!_storage.read(addr(sector, _tail.offset), _scratch.data(), span)) break;
+
+        size_t off = 0;
+        size_t last = SIZE_MAX;
+        bool end_of_sector = false;
+        bool stopped = false;
+        while (off + RH <= span && delivered < max_records) {
+            RecordHeader rh;
+            memcpy(&rh, &_scratch[off], RH);
+            if (record_erased(rh)) {
+                end_of_sector = true;
+                break;
+            }
+            if (rh.len == 0 || off + RH + rh.len > span || !record_valid(rh, &_scratch[off + RH])) {
+                _stats.corrupt++;
+                end_of_sector = true;
+                break;
+            }
+            if (!callback(&_scratch[off + RH], rh.len, ctx)) {
+                stopped = true;
+                break;
+            }
+            last = _tail.offset + off;
+            off += RH + rh.len;
+            delivered++;
+            _stats.replayed++;
+            _stats.pending--;
+        }
+
+        if (last != SIZE_MAX) mark_consumed(sector, last);
+        _tail.offset += off;
+        if (stopped) break;
+
+        if (end_of_sector || _tail.offset + RH > limit) {
+            if (sector == _head.sector) break;
+            if (!advance_tail_sector()) break;
+        }
+    }
+
+    // Caught up with the head: whatever pending still says was lost to corruption
+    if (_tail == _head) _stats.pending = 0;
+    return delivered;
+}
+
+bool FlashLog::empty() {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _stats.pending == 0;
+}
+
+flash_log_stats_t FlashLog::stats() {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _stats;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+#include "FlashStorage.hpp"
+
+typedef struct {
+    uint32_t appended;
+    uint32_t replayed;
+    uint32_t dropped;         // Unconsumed records overwritten because the log was full
+    uint32_t corrupt;         // Records skipped on a CRC or framing error (torn writes)
+    uint32_t erases;          // Sector erases since mount
+    uint32_t pending;         // Records waiting to be replayed
+} flash_log_stats_t;
+
+typedef struct {
+    const void* data;
+    size_t len;
+} flash_log_part_t;
+
+// Return false to stop the replay; that record and the ones after it stay in the log
+typedef bool (*flash_log_replay_cb_t)(const uint8_t* data, size_t len, void* ctx);
+
+// Persistent FIFO of variable-size records on a FlashStorage, used to hold
+// telemetry while the network is down.
+//
+// Layout: the storage is a ring of sectors. Each in-use sector starts with a
+// header carrying a sequence number; records follow back to back, each framed by
+// its length and a CRC32. Consuming records clears a marker byte in the last
+// record of a replay batch, meaning "everything up to here is delivered". Sectors
+// are erased only when the head wraps onto them, so every sector sees the same
+// number of erase cycles. mount() rebuilds head and tail from this alone: a torn
+// record fails its CRC and ends its sector, a torn sector header leaves the sector
+// free, so power loss at any point loses at most the record being written.
+//
+// Not usable from ISRs. The replay callback must not call back into the log.
+class FlashLog {
+public:
+    explicit FlashLog(FlashStorage& storage);
+
+    FlashLog(const FlashLog&) = delete;
+    FlashLog& operator=(const FlashLog&) = delete;
+
+    // Scan the storage and recover head and tail; false if the geometry is unusable
+    bool mount();
+
+    // Erase everything
+    bool format();
+
+    // Append one record. When the ring is full the oldest sector is dropped to make room.
+    bool append(const void* data, size_t len);
+
+    // Append one record gathered from several buffers (e.g. a header and a payload)
+    bool append(const flash_log_part_t* parts, size_t count);
+
+    // Deliver pending records oldest first, reading a sector span per flash access.
+    // Returns the number delivered.
+    size_t replay(flash_log_replay_cb_t callback, void* ctx, size_t max_records = SIZE_MAX);
+
+    bool empty();
+
+    size_t max_record_size() const;
+
+    flash_log_stats_t stats();
+
+private:
+    struct Position {
+        size_t sector;
+        size_t offset;
+        bool operator==(const Position& o) const { return sector == o.sector && offset == o.offset; }
+    };
+
+    FlashStorage& _storage;
+    size_t _sector_size = 0;
+    size_t _sector_count = 0;
+    std::vector<uint32_t> _seq;      // Per-sector sequence number, 0 = free
+    std::vector<uint8_t> _scratch;   // One sector, for mount and replay
+    Position _head = {0, 0};
+    Position _tail = {0, 0};
+    uint32_t _head_seq = 0;
+    bool _mounted = false;
+    flash_log_stats_t _stats = {};
+    std::mutex _lock;
+
+    size_t addr(size_t sector, size_t offset) const { return sector * _sector_size + offset; }
+    bool open_sector(size_t sector);
+    size_t scan_sector(size_t sector, size_t from, bool* torn, size_t* marker_next, uint32_t* records);
+    void drop_sector(size_t sector);
+    bool mark_consumed(size_t sector, size_t record_offset);
+    bool advance_tail_sector();
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+
+// Erase-before-write storage seen by FlashLog: bits only go from 1 to 0 on write,
+// erase_sector sets a whole sector back to 0xFF. Offsets are relative to the start
+// of the storage. PartitionStorage maps this onto an esp_partition; a file or RAM
+// backed implementation lets FlashLog run off-target.
+class FlashStorage {
+public:
+    virtual ~FlashStorage() = default;
+
+    virtual size_t size() const = 0;
+
+    virtual size_t sector_size() const = 0;
+
+    virtual bool read(size_t offset, void* dst, size_t len) = 0;
+
+    virtual bool write(size_t offset, const void* src, size_t len) = 0;
+
+    virtual bool erase_sector(size_t offset) = 0;
+};
@@ -0,0 +1,35 @@
+#include "esp_log.h"
+#include "PartitionStorage.hpp"
+
+static const char* TAG = "PartitionStorage";
+
+PartitionStorage::PartitionStorage(const char* label) {
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!_partition) ESP_LOGE(TAG, "Partition '%s' not found", label);
+}
+
+size_t PartitionStorage::size() const {
+    return _partition ? _partition->size : 0;
+}
+
+size_t PartitionStorage::sector_size() const {
+    return _partition ? _partition->erase_size : 0;
+}
+
+bool PartitionStorage::read(size_t offset, void* dst, size_t len) {
+    esp_err_t err = esp_partition_read(_partition, offset, dst, len);
+    if (err != ESP_OK) ESP_LOGE(TAG, "Read at 0x%x failed: %s", (unsigned) offset, esp_err_to_name(err));
+    return err == ESP_OK;
+}
+
+bool PartitionStorage::write(size_t offset, const void* src, size_t len) {
+    esp_err_t err = esp_partition_write(_partition, offset, src, len);
+    if (err != ESP_OK) ESP_LOGE(TAG, "Write at 0x%x failed: %s", (unsigned) offset, esp_err_to_name(err));
+    return err == ESP_OK;
+}
+
+bool PartitionStorage::erase_sector(size_t offset) {
+    esp_err_t err = esp_partition_erase_range(_partition, offset, _partition->erase_size);
+    if (err != ESP_OK) ESP_LOGE(TAG, "Erase at 0x%x failed: %s", (unsigned) offset, esp_err_to_name(err));
+    return err == ESP_OK;
+}
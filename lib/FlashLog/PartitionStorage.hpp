@@ -0,0 +1,26 @@
+#pragma once
+#include "esp_partition.h"
+#include "FlashStorage.hpp"
+
+// FlashStorage over a data partition from the partition table, e.g.
+//   flashlog, data, 0x40, , 64K
+// Check ok() after construction: false if no partition has that label.
+class PartitionStorage : public FlashStorage {
+public:
+    explicit PartitionStorage(const char* label);
+
+    bool ok() const { return _partition != nullptr; }
+
+    size_t size() const override;
+
+    size_t sector_size() const override;
+
+    bool read(size_t offset, void* dst, size_t len) override;
+
+    bool write(size_t offset, const void* src, size_t len) override;
+
+    bool erase_sector(size_t offset) override;
+
+private:
+    const esp_partition_t* _partition;
+};
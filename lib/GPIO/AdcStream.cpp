@@ -0,0 +1,189 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "AdcStream.hpp"
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_STREAM_OUTPUT_TYPE   ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_STREAM_GET_CHANNEL(p) ((p)->type1.channel)
+#define ADC_STREAM_GET_DATA(p)    ((p)->type1.data)
+#else
+#define ADC_STREAM_OUTPUT_TYPE   ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_STREAM_GET_CHANNEL(p) ((p)->type2.channel)
+#define ADC_STREAM_GET_DATA(p)    ((p)->type2.data)
+#endif
+
+static const char* TAG = "AdcStream";
+
+// Samples per DMA frame
+static const size_t FRAME_SAMPLES = 64;
+static const size_t FRAME_BYTES = FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES;
+
+AdcStream::AdcStream(const adc_channel_t* channels, size_t channel_count,
+                     uint32_t sample_rate_hz, size_t ring_samples)
+    : _channel_count(channel_count < MAX_CHANNELS ? channel_count : MAX_CHANNELS),
+      _sample_rate_hz(sample_rate_hz),
+      _ring(ring_samples) {
+    for (size_t i = 0; i < _channel_count; i++) {
+        _channels[i] = channels[i];
+    }
+    _data_ready = xSemaphoreCreateBinary();
+    _exited = xSemaphoreCreateBinary();
+}
+
+// Conversions stop first, so no callback notifies the worker once it is gone; the
+// worker then leaves its loop between reads and signals _exited
+AdcStream::~AdcStream() {
+    stop();
+    if (_worker) {
+        _stopping = true;
+        xTaskNotifyGive(_worker);
+        xSemaphoreTake(_exited, portMAX_DELAY);
+    }
+    if (_handle) adc_continuous_deinit(_handle);
+    vSemaphoreDelete(_exited);
+    vSemaphoreDelete(_data_ready);
+}
+
+// Create the continuous driver on first start, then start conversions
+esp_err_t AdcStream::start() {
+    if (_running) return ESP_OK;
+
+    if (!_handle) {
+        adc_continuous_handle_cfg_t handle_cfg = {};
+        handle_cfg.max_store_buf_size = FRAME_BYTES * 4;
+        handle_cfg.conv_frame_size = FRAME_BYTES;
+        esp_err_t err = adc_continuous_new_handle(&handle_cfg, &_handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create continuous handle: %s", esp_err_to_name(err));
+            return err;
+        }
+
+        adc_digi_pattern_config_t pattern[MAX_CHANNELS] = {};
+        for (size_t i = 0; i < _channel_count; i++) {
+            pattern[i].atten = ADC_ATTEN_DB_12;
+            pattern[i].channel = _channels[i];
+            pattern[i].unit = ADC_UNIT_1;
+            pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        }
+
+        adc_continuous_config_t dig_cfg = {};
+        dig_cfg.pattern_num = _channel_count;
+        dig_cfg.adc_pattern = pattern;
+        dig_cfg.sample_freq_hz = _sample_rate_hz;
+        dig_cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+        dig_cfg.format = ADC_STREAM_OUTPUT_TYPE;
+        err = adc_continuous_config(_handle, &dig_cfg);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Invalid stream config: %s", esp_err_to_name(err));
+            // Drop the unconfigured handle so the next start() configures from scratch
+            adc_continuous_deinit(_handle);
+            _handle = nullptr;
+            return err;
+        }
+
+        adc_continuous_evt_cbs_t cbs = {};
+        cbs.on_conv_done = on_conv_done;
+        cbs.on_pool_ovf = on_pool_ovf;
+        ESP_ERROR_CHECK(adc_continuous_register_event_callbacks(_handle, &cbs, this));
+
+        if (xTaskCreate(worker_task, "adc_stream", 3072, this, 10, &_worker) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create worker task");
+            _worker = nullptr;
+            adc_continuous_deinit(_handle);
+            _handle = nullptr;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t err = adc_continuous_start(_handle);
+    if (err == ESP_OK) _running = true;
+    else ESP_LOGE(TAG, "Failed to start stream: %s", esp_err_to_name(err));
+    return err;
+}
+
+esp_err_t AdcStream::stop() {
+    if (!_running) return ESP_OK;
+    _running = false;
+    return adc_continuous_stop(_handle);
+}
+
+size_t AdcStream::read(adc_sample_t* out, size_t max_samples, TickType_t timeout) {
+    size_t n = _ring.pop(out, max_samples);
+    if (n == 0 && timeout > 0 && xSemaphoreTake(_data_ready, timeout) == pdTRUE) {
+        n = _ring.pop(out, max_samples);
+    }
+    return n;
+}
+
+size_t AdcStream::push(const adc_sample_t* samples, size_t count) {
+    size_t pushed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (_ring.push(samples[i])) pushed++;
+    }
+    if (pushed) xSemaphoreGive(_data_ready);
+    return pushed;
+}
+
+size_t AdcStream::available() const {
+    return _ring.size();
+}
+
+uint32_t AdcStream::ring_overruns() const {
+    return _ring.overruns();
+}
+
+uint32_t AdcStream::driver_overruns() const {
+    return _driver_overruns;
+}
+
+// DMA frame ready: wake the worker, it does the parsing outside the ISR
+bool IRAM_ATTR AdcStream::on_conv_done(adc_continuous_handle_t handle,
+                                       const adc_continuous_evt_data_t* edata, void* user_data) {
+    AdcStream* obj = (AdcStream*) user_data;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(obj->_worker, &xHigherPriorityTaskWoken);
+    return xHigherPriorityTaskWoken == pdTRUE;
+}
+
+// Driver pool full: conversions are being lost before we get to read them
+bool IRAM_ATTR AdcStream::on_pool_ovf(adc_continuous_handle_t handle,
+                                      const adc_continuous_evt_data_t* edata, void* user_data) {
+    AdcStream* obj = (AdcStream*) user_data;
+    obj->_driver_overruns = obj->_driver_overruns + 1;
+    return false;
+}
+
+// Drains DMA frames, timestamps each sample back from the read time and pushes to the ring
+void AdcStream::worker_task(void* arg) {
+    AdcStream* obj = (AdcStream*) arg;
+    uint8_t frame[FRAME_BYTES];
+    adc_sample_t samples[FRAME_SAMPLES];
+    const int64_t period_us = obj->_sample_rate_hz ? 1000000LL / obj->_sample_rate_hz : 0;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (obj->_stopping) break;
+
+        uint32_t ret_num = 0;
+        while (obj->_running && !obj->_stopping &&
+               adc_continuous_read(obj->_handle, frame, FRAME_BYTES, &ret_num, 0) == ESP_OK) {
+            int64_t now = esp_timer_get_time();
+            size_t count = ret_num / SOC_ADC_DIGI_RESULT_BYTES;
+            size_t n = 0;
+            for (size_t i = 0; i < count; i++) {
+                adc_digi_output_data_t* p =
+                    (adc_digi_output_data_t*) &frame[i * SOC_ADC_DIGI_RESULT_BYTES];
+                samples[n].channel = ADC_STREAM_GET_CHANNEL(p);
+                samples[n].value = ADC_STREAM_GET_DATA(p);
+                samples[n].timestamp_us = now - (int64_t)(count - 1 - i) * period_us;
+                n++;
+            }
+            obj->push(samples, n);
+        }
+    }
+
+    xSemaphoreGive(obj->_exited);
+    vTaskDelete(NULL);
+}
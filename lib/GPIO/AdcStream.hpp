@@ -0,0 +1,60 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_adc/adc_continuous.h"
+#include "SpscRing.hpp"
+
+typedef struct {
+    int64_t timestamp_us;
+    uint16_t value;
+    uint8_t channel;
+} adc_sample_t;
+
+// Continuous (DMA) ADC streaming on ADC_UNIT_1. Scans the given channels at
+// sample_rate_hz (total conversions per second) into a ring of timestamped samples.
+// The oneshot GPIO(adc_channel_t) path must not use the same unit while streaming.
+class AdcStream {
+public:
+    AdcStream(const adc_channel_t* channels, size_t channel_count,
+              uint32_t sample_rate_hz, size_t ring_samples = 1024);
+    ~AdcStream();
+
+    AdcStream(const AdcStream&) = delete;
+    AdcStream& operator=(const AdcStream&) = delete;
+
+    esp_err_t start();
+    esp_err_t stop();
+
+    // Block read of up to max_samples, waiting up to timeout for the first sample
+    size_t read(adc_sample_t* out, size_t max_samples, TickType_t timeout);
+
+    // Feed samples into the ring; used by the DMA worker and by simulated sources
+    size_t push(const adc_sample_t* samples, size_t count);
+
+    size_t available() const;
+    uint32_t ring_overruns() const;
+    uint32_t driver_overruns() const;
+
+private:
+    static const size_t MAX_CHANNELS = 8;
+
+    adc_channel_t _channels[MAX_CHANNELS];
+    size_t _channel_count;
+    uint32_t _sample_rate_hz;
+
+    adc_continuous_handle_t _handle = nullptr;
+    TaskHandle_t _worker = nullptr;
+    SemaphoreHandle_t _data_ready;
+    SemaphoreHandle_t _exited;
+    SpscRing<adc_sample_t> _ring;
+    volatile uint32_t _driver_overruns = 0;
+    volatile bool _running = false;
+    volatile bool _stopping = false;
+
+    static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t handle,
+                                       const adc_continuous_evt_data_t* edata, void* user_data);
+    static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t handle,
+                                      const adc_continuous_evt_data_t* edata, void* user_data);
+    static void worker_task(void* arg);
+};
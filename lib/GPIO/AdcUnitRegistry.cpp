@@ -0,0 +1,57 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "AdcUnitRegistry.hpp"
+
+static const char* TAG = "AdcUnitRegistry";
+
+AdcUnitRegistry::Entry AdcUnitRegistry::_units[AdcUnitRegistry::MAX_UNITS] = {};
+
+SemaphoreHandle_t AdcUnitRegistry::registry_mutex() {
+    static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+    return mutex;
+}
+
+// Create the unit on first use, otherwise hand out the existing handle
+adc_oneshot_unit_handle_t AdcUnitRegistry::acquire(adc_unit_t unit) {
+    if ((int) unit >= MAX_UNITS) return nullptr;
+
+    xSemaphoreTake(registry_mutex(), portMAX_DELAY);
+    Entry& e = _units[unit];
+    if (e.refs == 0) {
+        adc_oneshot_unit_init_cfg_t init_config = {
+            .unit_id = unit,
+            .clk_src = ADC_RTC_CLK_SRC_DEFAULT,
+            .ulp_mode = ADC_ULP_MODE_DISABLE,
+        };
+        esp_err_t err = adc_oneshot_new_unit(&init_config, &e.handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create ADC unit %d: %s", (int) unit, esp_err_to_name(err));
+            xSemaphoreGive(registry_mutex());
+            return nullptr;
+        }
+        if (!e.mutex) e.mutex = xSemaphoreCreateMutex();
+    }
+    e.refs++;
+    adc_oneshot_unit_handle_t handle = e.handle;
+    xSemaphoreGive(registry_mutex());
+    return handle;
+}
+
+// Delete the unit when its last user goes away
+void AdcUnitRegistry::release(adc_unit_t unit) {
+    if ((int) unit >= MAX_UNITS) return;
+
+    xSemaphoreTake(registry_mutex(), portMAX_DELAY);
+    Entry& e = _units[unit];
+    if (e.refs > 0 && --e.refs == 0) {
+        adc_oneshot_del_unit(e.handle);
+        e.handle = nullptr;
+    }
+    xSemaphoreGive(registry_mutex());
+}
+
+SemaphoreHandle_t AdcUnitRegistry::lock(adc_unit_t unit) {
+    if ((int) unit >= MAX_UNITS) return nullptr;
+    return _units[unit].mutex;
+}
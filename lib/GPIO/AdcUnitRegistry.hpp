@@ -0,0 +1,28 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_adc/adc_oneshot.h"
+
+// Refcounted owner of ADC oneshot unit handles. Every analog GPIO on a unit
+// shares one handle and one lock instead of creating its own unit.
+class AdcUnitRegistry {
+public:
+    static adc_oneshot_unit_handle_t acquire(adc_unit_t unit);
+
+    static void release(adc_unit_t unit);
+
+    // Per-unit lock held around reads so multi-channel snapshots are not interleaved
+    static SemaphoreHandle_t lock(adc_unit_t unit);
+
+private:
+    struct Entry {
+        adc_oneshot_unit_handle_t handle;
+        int refs;
+        SemaphoreHandle_t mutex;
+    };
+
+    static const int MAX_UNITS = 2;
+    static Entry _units[MAX_UNITS];
+
+    static SemaphoreHandle_t registry_mutex();
+};
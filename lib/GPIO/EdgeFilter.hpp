@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+
+typedef struct {
+    int64_t timestamp_us;
+    uint16_t coalesced;  // Edges suppressed since the previous record
+    uint8_t pin;
+    uint8_t level;
+} gpio_edge_event_t;
+
+// Debounce and coalescing decision for one pin, run inside the GPIO ISR.
+// Leading-edge debounce: the first edge is recorded, edges inside the window
+// are dropped. Edges that repeat the last recorded level are dropped as well.
+// A bounce that ends inside the window can leave the pin at another level than
+// the one recorded, with no further edge to report it, so once the window has
+// passed the pin is sampled again (settle()) and the settled level recorded if
+// it differs.
+class EdgeFilter {
+public:
+    explicit EdgeFilter(uint32_t debounce_us = 0) : _debounce_us(debounce_us) {}
+
+    // Returns true if the edge should be recorded; fills in the coalesced count
+    inline bool accept(int level, int64_t now_us, uint16_t* coalesced) {
+        bool bounce = _has_last && (now_us - _last_us) < (int64_t) _debounce_us;
+        bool repeat = _has_last && level == _last_level;
+        if (bounce || repeat) {
+            if (_suppressed < UINT16_MAX) _suppressed++;
+            if (bounce) _unsettled = true;
+            return false;
+        }
+        record(level, now_us, coalesced);
+        return true;
+    }
+
+    // Edges were dropped inside the current window: settle() is due at *when_us
+    inline bool settle_due(int64_t* when_us) const {
+        if (!_unsettled) return false;
+        *when_us = _last_us + _debounce_us;
+        return true;
+    }
+
+    // Called with the pin sampled once the window has passed. Returns true if
+    // the settled level differs from the last recorded one and should be recorded
+    // (at now_us, which also starts a new window); false if nothing was pending,
+    // the level matches, or the window is still open.
+    inline bool settle(int level, int64_t now_us, uint16_t* coalesced) {
+        if (!_unsettled || (now_us - _last_us) < (int64_t) _debounce_us) return false;
+        _unsettled = false;
+        if (level == _last_level) return false;
+        record(level, now_us, coalesced);
+        return true;
+    }
+
+    int last_level() const { return _last_level; }
+
+    void reset() {
+        _has_last = false;
+        _unsettled = false;
+        _suppressed = 0;
+    }
+
+private:
+    uint32_t _debounce_us;
+    int64_t _last_us = 0;
+    int _last_level = -1;
+    uint16_t _suppressed = 0;
+    bool _has_last = false;
+    bool _unsettled = false;
+
+    inline void record(int level, int64_t now_us, uint16_t* coalesced) {
+        *coalesced = _suppressed;
+        _suppressed = 0;
+        _last_level = level;
+        _last_us = now_us;
+        _has_last = true;
+        _unsettled = false;
+    }
+};
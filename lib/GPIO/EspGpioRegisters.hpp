@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "soc/soc.h"
+#include "soc/soc_caps.h"
+#include "soc/gpio_reg.h"
+#include "GpioPort.hpp"
+
+// GpioPort register access on the ESP32: gpio_config for setup, then the
+// set/clear and input registers directly
+struct EspGpioRegisters {
+    typedef gpio_mode_t mode_type;
+
+    static void configure(uint64_t mask, gpio_mode_t mode) {
+        gpio_config_t io_conf = {};
+        io_conf.intr_type = GPIO_INTR_DISABLE;
+        io_conf.mode = mode;
+        io_conf.pin_bit_mask = mask;
+        io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+        io_conf.pull_up_en = GPIO_PULLUP_DISABLE;
+        gpio_config(&io_conf);
+    }
+
+    static inline void set(uint64_t mask) {
+        if ((uint32_t) mask) REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t) mask);
+#if SOC_GPIO_PIN_COUNT > 32
+        if (mask >> 32) REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t) (mask >> 32));
+#endif
+    }
+
+    static inline void clear(uint64_t mask) {
+        if ((uint32_t) mask) REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t) mask);
+#if SOC_GPIO_PIN_COUNT > 32
+        if (mask >> 32) REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t) (mask >> 32));
+#endif
+    }
+
+    static inline uint64_t read() {
+        uint64_t levels = REG_READ(GPIO_IN_REG);
+#if SOC_GPIO_PIN_COUNT > 32
+        levels |= (uint64_t) REG_READ(GPIO_IN1_REG) << 32;
+#endif
+        return levels;
+    }
+};
+
+using GpioPort = GpioPortT<EspGpioRegisters>;
+
+template <gpio_num_t... Pins>
+using StaticGpioPort = StaticGpioPortT<EspGpioRegisters, Pins...>;
@@ -1,7 +1,10 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
 #include "GPIO.hpp"
+#include "DspFilter.hpp"
+#include "Diagnostics.hpp"
 
 // Constructor for Digital GPIO
 GPIO::GPIO(gpio_num_t pin, gpio_mode_t mode) : _pin(pin), _mode(mode) {
@@ -16,12 +19,8 @@ GPIO::GPIO(gpio_num_t pin, gpio_mode_t mode) : _pin(pin), _mode(mode) {
 
 // Constructor for Analog GPIO (ADC)
 GPIO::GPIO(adc_channel_t channel) : _adc_chan(channel), _is_analog(true) {
-    adc_oneshot_unit_init_cfg_t init_config = {
-        .unit_id = ADC_UNIT_1,
-        .clk_src = ADC_RTC_CLK_SRC_DEFAULT,
-        .ulp_mode = ADC_ULP_MODE_DISABLE,
-    };
-    adc_oneshot_new_unit(&init_config, &_adc_handle);
+    _adc_handle = AdcUnitRegistry::acquire(_adc_unit);
+    if (!_adc_handle) return;
 
     adc_oneshot_chan_cfg_t config = {
         .atten = ADC_ATTEN_DB_12, 
@@ -30,6 +29,20 @@ GPIO::GPIO(adc_channel_t channel) : _adc_chan(channel), _is_analog(true) {
     adc_oneshot_config_channel(_adc_handle, _adc_chan, &config);
 }
 
+// Release the shared ADC unit (analog only)
+GPIO::~GPIO() {
+    if (_is_analog && _adc_handle) AdcUnitRegistry::release(_adc_unit);
+    if (_edges) {
+        gpio_isr_handler_remove(_pin);
+        if (_settle_timer) {
+            esp_timer_stop(_settle_timer);
+            esp_timer_delete(_settle_timer);
+        }
+        delete _edges;
+    }
+    delete _pulses;
+}
+
 // Set GPIO output level (digital only)
 void GPIO::set_level(uint32_t level) {
     if (!_is_analog) gpio_set_level(_pin, level);
@@ -38,9 +51,13 @@ void GPIO::set_level(uint32_t level) {
 // Get GPIO input level (digital or analog)
 int GPIO::get_level() {
     if (_is_analog) {
-        int val;
+        int val = 0;
+        if (!_adc_handle) return val;
+        SemaphoreHandle_t lock = AdcUnitRegistry::lock(_adc_unit);
+        xSemaphoreTake(lock, portMAX_DELAY);
         adc_oneshot_read(_adc_handle, _adc_chan, &val);
-        return val;
+        xSemaphoreGive(lock);
+        return apply_filter(val);
     } else {
         return gpio_get_level(_pin);
     }
@@ -56,6 +73,46 @@ gpio_num_t GPIO::get_pin() {
     return _pin;
 }
 
+// Read a group of analog pins in one locked pass
+esp_err_t GPIO::read_many(GPIO* const* pins, size_t count, int* values, int64_t* timestamp_us) {
+    if (count == 0) return ESP_OK;
+    adc_unit_t unit = pins[0]->_adc_unit;
+    for (size_t i = 0; i < count; i++) {
+        if (!pins[i]->_is_analog || !pins[i]->_adc_handle || pins[i]->_adc_unit != unit) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    SemaphoreHandle_t lock = AdcUnitRegistry::lock(unit);
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = ESP_OK;
+    for (size_t i = 0; i < count && err == ESP_OK; i++) {
+        err = adc_oneshot_read(pins[i]->_adc_handle, pins[i]->_adc_chan, &values[i]);
+    }
+    int64_t end = esp_timer_get_time();
+    xSemaphoreGive(lock);
+
+    if (timestamp_us) *timestamp_us = start + (end - start) / 2;
+    if (err == ESP_OK) {
+        for (size_t i = 0; i < count; i++) values[i] = pins[i]->apply_filter(values[i]);
+    }
+    return err;
+}
+
+void GPIO::set_filter(BlockFilter* filter) {
+    _filter = filter;
+    if (_filter) _filter->reset();
+}
+
+// Run one raw sample through the attached filter, holding the last output if it produced none
+int GPIO::apply_filter(int raw) {
+    if (!_filter) return raw;
+    int16_t sample = (int16_t) raw;
+    if (_filter->process(&sample, &sample, 1) == 1) _filtered = sample;
+    return _filtered;
+}
+
 // Enable interrupt and attach ISR handler
 void GPIO::enable_interrupt(QueueHandle_t queue) {
     _target_queue = queue;
@@ -75,3 +132,161 @@ void IRAM_ATTR GPIO::gpio_isr_handler(void* arg) {
         portYIELD_FROM_ISR();
     }
 }
+
+
+// Switch the pin to any-edge interrupts feeding the edge ring
+esp_err_t GPIO::enable_edge_capture(size_t ring_size, uint32_t debounce_us,
+                                    size_t batch_size, TaskHandle_t consumer) {
+    if (_is_analog) return ESP_ERR_NOT_SUPPORTED;
+    if (_edges) return ESP_ERR_INVALID_STATE;
+
+    _edges = new SpscRing<gpio_edge_event_t>(ring_size);
+    _edge_filter = EdgeFilter(debounce_us);
+    _edge_batch = batch_size ? batch_size : 1;
+    _edge_consumer = consumer ? consumer : xTaskGetCurrentTaskHandle();
+
+    if (debounce_us > 0) {
+        esp_timer_create_args_t timer_args = {};
+        timer_args.callback = edge_settle_cb;
+        timer_args.arg = this;
+        timer_args.name = "gpio_settle";
+        esp_err_t err = esp_timer_create(&timer_args, &_settle_timer);
+        if (err != ESP_OK) {
+            delete _edges;
+            _edges = nullptr;
+            return err;
+        }
+    }
+
+    gpio_install_isr_service(0);
+    gpio_set_intr_type(_pin, GPIO_INTR_ANYEDGE);
+    esp_err_t err = gpio_isr_handler_add(_pin, gpio_edge_isr_handler, (void*) this);
+    if (err == ESP_OK) err = gpio_intr_enable(_pin);
+    return err;
+}
+
+size_t GPIO::read_edges(gpio_edge_event_t* out, size_t max_events, TickType_t timeout) {
+    if (!_edges) return 0;
+    size_t n = _edges->pop(out, max_events);
+    if (n == 0 && timeout > 0) {
+        ulTaskNotifyTake(pdTRUE, timeout);
+        n = _edges->pop(out, max_events);
+    }
+
+    // ISR entry to consumer, including the time spent waiting for a full batch
+    if (n > 0) {
+        int64_t now = esp_timer_get_time();
+        DiagHistogram& latency = Diagnostics::instance().gpio_edge_latency_us;
+        for (size_t i = 0; i < n; i++) latency.record_us(now - out[i].timestamp_us);
+    }
+    return n;
+}
+
+uint32_t GPIO::edge_overflows() const {
+    return _edges ? _edges->overruns() : 0;
+}
+
+// ISR for edge capture: filter, record, and only wake the consumer on batch boundaries
+void IRAM_ATTR GPIO::gpio_edge_isr_handler(void* arg) {
+    GPIO* obj = (GPIO*) arg;
+    int64_t now = esp_timer_get_time();
+    int64_t settle_at = 0;
+    bool arm = false;
+
+    portENTER_CRITICAL_ISR(&obj->_edge_mux);
+    int level = gpio_get_level(obj->_pin);
+    gpio_edge_event_t ev;
+    bool record = obj->_edge_filter.accept(level, now, &ev.coalesced);
+    if (record) {
+        ev.timestamp_us = now;
+        ev.pin = (uint8_t) obj->_pin;
+        ev.level = (uint8_t) level;
+        obj->_edges->push(ev);
+    } else if (!obj->_settle_armed && obj->_edge_filter.settle_due(&settle_at)) {
+        // A bounce was dropped: look at the pin again when the window closes
+        obj->_settle_armed = arm = true;
+    }
+    portEXIT_CRITICAL_ISR(&obj->_edge_mux);
+
+    if (arm) esp_timer_start_once(obj->_settle_timer, settle_at > now ? settle_at - now : 1);
+
+    if (record && obj->_edges->size() % obj->_edge_batch == 0) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(obj->_edge_consumer, &xHigherPriorityTaskWoken);
+        if (xHigherPriorityTaskWoken) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+// Debounce window closed after dropped edges: record the level the pin settled
+// at if it is not the last one recorded. It ends a burst, so the consumer is
+// woken whatever the batch size.
+void GPIO::edge_settle_cb(void* arg) {
+    GPIO* obj = (GPIO*) arg;
+    int64_t settle_at = 0;
+    bool again = false;
+
+    portENTER_CRITICAL(&obj->_edge_mux);
+    int64_t now = esp_timer_get_time();
+    int level = gpio_get_level(obj->_pin);
+    gpio_edge_event_t ev;
+    bool record = obj->_edge_filter.settle(level, now, &ev.coalesced);
+    if (record) {
+        ev.timestamp_us = now;
+        ev.pin = (uint8_t) obj->_pin;
+        ev.level = (uint8_t) level;
+        obj->_edges->push(ev);
+    } else {
+        // A newer edge restarted the window and bounced too
+        again = obj->_edge_filter.settle_due(&settle_at);
+    }
+    obj->_settle_armed = again;
+    portEXIT_CRITICAL(&obj->_edge_mux);
+
+    if (again) esp_timer_start_once(obj->_settle_timer, settle_at > now ? settle_at - now : 1);
+    if (record) xTaskNotifyGive(obj->_edge_consumer);
+}
+
+// Hand the pin to a PCNT unit; the GPIO ISR paths stay unused
+esp_err_t GPIO::enable_pulse_counter(const PulseCounterConfig& config) {
+    if (_is_analog) return ESP_ERR_NOT_SUPPORTED;
+    if (_pulses) return ESP_ERR_INVALID_STATE;
+
+    _pulses = new PulseCounter();
+    esp_err_t err = _pulses->begin(_pin, config);
+    if (err != ESP_OK) {
+        delete _pulses;
+        _pulses = nullptr;
+    }
+    return err;
+}
+
+esp_err_t GPIO::enable_quadrature(gpio_num_t pin_b, const PulseCounterConfig& config) {
+    if (_is_analog) return ESP_ERR_NOT_SUPPORTED;
+    if (_pulses) return ESP_ERR_INVALID_STATE;
+
+    _pulses = new PulseCounter();
+    esp_err_t err = _pulses->begin_quadrature(_pin, pin_b, config);
+    if (err != ESP_OK) {
+        delete _pulses;
+        _pulses = nullptr;
+    }
+    return err;
+}
+
+int64_t GPIO::pulse_count() {
+    return _pulses ? _pulses->count() : 0;
+}
+
+double GPIO::pulse_frequency_hz() {
+    return _pulses ? _pulses->frequency_hz() : 0.0;
+}
+
+double GPIO::pulse_rpm(double counts_per_rev) {
+    return _pulses ? _pulses->rpm(counts_per_rev) : 0.0;
+}
+
+void GPIO::reset_pulse_count() {
+    if (_pulses) _pulses->reset();
+}
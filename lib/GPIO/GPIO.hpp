@@ -4,7 +4,14 @@
 #include "freertos/queue.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
+#include "esp_timer.h"
 #include "esp_adc/adc_oneshot.h"
+#include "AdcUnitRegistry.hpp"
+#include "EdgeFilter.hpp"
+#include "SpscRing.hpp"
+#include "PulseCounter.hpp"
+
+class BlockFilter;
 
 class GPIO {
 public:
@@ -13,6 +20,11 @@ public:
 
     GPIO(adc_channel_t channel);
 
+    ~GPIO();
+
+    GPIO(const GPIO&) = delete;
+    GPIO& operator=(const GPIO&) = delete;
+
     void set_level(uint32_t level);
 
     int get_level();
@@ -23,17 +35,64 @@ public:
 
     void enable_interrupt(QueueHandle_t queue);
 
+    // Record timestamped edges into a lock-free ring; the consumer task is notified
+    // once batch_size records are pending (nullptr = calling task). With a debounce
+    // window, a bounce that leaves the pin at a new level is recorded when the window closes.
+    esp_err_t enable_edge_capture(size_t ring_size = 256, uint32_t debounce_us = 0,
+                                  size_t batch_size = 16, TaskHandle_t consumer = nullptr);
+
+    // Drain captured edges, waiting up to timeout for a batch if none are pending
+    size_t read_edges(gpio_edge_event_t* out, size_t max_events, TickType_t timeout);
+
+    uint32_t edge_overflows() const;
+
+    // Count edges in the PCNT peripheral instead of taking an interrupt per edge
+    esp_err_t enable_pulse_counter(const PulseCounterConfig& config = PulseCounterConfig());
+
+    // Quadrature decoding (4 counts per cycle, signed) with this pin as A and pin_b as B
+    esp_err_t enable_quadrature(gpio_num_t pin_b, const PulseCounterConfig& config = PulseCounterConfig());
+
+    // 64-bit count, and its rate over the configured window (0 until counting is enabled)
+    int64_t pulse_count();
+    double pulse_frequency_hz();
+    double pulse_rpm(double counts_per_rev);
+    void reset_pulse_count();
+
+    // Sample several analog pins of one ADC unit under a single lock with one shared timestamp
+    static esp_err_t read_many(GPIO* const* pins, size_t count, int* values, int64_t* timestamp_us);
+
+    // Pass every analog reading through filter (see DspFilter); nullptr restores raw reads.
+    // The filter is not owned. A decimating filter repeats its last output between results.
+    void set_filter(BlockFilter* filter);
+
 private:
     gpio_num_t _pin;
     gpio_mode_t _mode;
 
     adc_channel_t _adc_chan;
-    adc_oneshot_unit_handle_t _adc_handle;
+    adc_unit_t _adc_unit = ADC_UNIT_1;
+    adc_oneshot_unit_handle_t _adc_handle = nullptr;
     bool _is_analog = false;
+    BlockFilter* _filter = nullptr;
+    int _filtered = 0;
 
     QueueHandle_t _target_queue;
 
+    SpscRing<gpio_edge_event_t>* _edges = nullptr;
+    EdgeFilter _edge_filter;
+    portMUX_TYPE _edge_mux = portMUX_INITIALIZER_UNLOCKED;   // Filter and ring: ISR vs settle timer
+    esp_timer_handle_t _settle_timer = nullptr;
+    bool _settle_armed = false;
+    TaskHandle_t _edge_consumer = nullptr;
+    size_t _edge_batch = 1;
+
+    PulseCounter* _pulses = nullptr;
+
+    int apply_filter(int raw);
+
     static void IRAM_ATTR gpio_isr_handler(void* arg);
+    static void IRAM_ATTR gpio_edge_isr_handler(void* arg);
+    static void edge_settle_cb(void* arg);
 };
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <utility>
+
+// A group of pins driven through the set/clear registers. All pins in the mask
+// change within one register write per 32-pin bank instead of one driver call each.
+// "Packed" values map bit i to the i-th lowest pin in the mask.
+//
+// Regs is the register access (see EspGpioRegisters.hpp): a mode_type, and static
+// configure(mask, mode) / set(mask) / clear(mask) / read(). No ESP-IDF headers
+// here, so the port logic runs off-target against a fake register file.
+template <typename Regs>
+class GpioPortT {
+public:
+    // A packed value holds at most this many pins
+    static const size_t MAX_PINS = 32;
+
+    // A mask with more than MAX_PINS pins is rejected: the port stays empty
+    // (width() == 0, every call a no-op) and nothing is configured
+    GpioPortT(uint64_t pin_mask, typename Regs::mode_type mode) {
+        if (__builtin_popcountll(pin_mask) > (int) MAX_PINS) return;
+        _mask = pin_mask;
+        for (int pin = 0; pin < 64; pin++) {
+            if (pin_mask & (1ULL << pin)) _pins[_count++] = (uint8_t) pin;
+        }
+        Regs::configure(_mask, mode);
+    }
+
+    // Levels given in pin space (bit N = GPIO N); pins outside the mask are ignored
+    void write_pins(uint64_t levels) {
+        Regs::set(levels & _mask);
+        Regs::clear(~levels & _mask);
+    }
+
+    void set(uint64_t pins) { Regs::set(pins & _mask); }
+
+    void clear(uint64_t pins) { Regs::clear(pins & _mask); }
+
+    uint64_t read_pins() const { return Regs::read() & _mask; }
+
+    void write(uint32_t value) {
+        uint64_t levels = 0;
+        for (size_t i = 0; i < _count; i++) {
+            levels |= (uint64_t) ((value >> i) & 1u) << _pins[i];
+        }
+        write_pins(levels);
+    }
+
+    uint32_t read() const {
+        uint64_t levels = Regs::read();
+        uint32_t value = 0;
+        for (size_t i = 0; i < _count; i++) {
+            value |= (uint32_t) ((levels >> _pins[i]) & 1u) << i;
+        }
+        return value;
+    }
+
+    uint64_t mask() const { return _mask; }
+
+    size_t width() const { return _count; }
+
+private:
+    uint64_t _mask = 0;
+    uint8_t _pins[MAX_PINS] = {};
+    size_t _count = 0;
+};
+
+// Compile-time pin list: mask and bit spreading are resolved by the compiler,
+// so write()/read() reduce to shifts and the register accesses.
+template <typename Regs, int... Pins>
+class StaticGpioPortT {
+public:
+    static constexpr uint64_t MASK = (0ULL | ... | (1ULL << Pins));
+    static constexpr size_t WIDTH = sizeof...(Pins);
+
+    static_assert(WIDTH > 0 && WIDTH <= 32, "StaticGpioPort supports 1 to 32 pins");
+    static_assert(((Pins >= 0 && Pins < 64) && ...), "StaticGpioPort pins must be 0 to 63");
+
+    explicit StaticGpioPortT(typename Regs::mode_type mode) { Regs::configure(MASK, mode); }
+
+    static void write(uint32_t value) {
+        uint64_t levels = spread(value, std::make_index_sequence<WIDTH>{});
+        Regs::set(levels);
+        Regs::clear(~levels & MASK);
+    }
+
+    static uint32_t read() {
+        return gather(Regs::read(), std::make_index_sequence<WIDTH>{});
+    }
+
+private:
+    static constexpr int PINS[WIDTH] = {Pins...};
+
+    template <size_t... I>
+    static constexpr uint64_t spread(uint32_t value, std::index_sequence<I...>) {
+        return (0ULL | ... | ((uint64_t) ((value >> I) & 1u) << PINS[I]));
+    }
+
+    template <size_t... I>
+    static constexpr uint32_t gather(uint64_t levels, std::index_sequence<I...>) {
+        return (0u | ... | ((uint32_t) ((levels >> PINS[I]) & 1u) << I));
+    }
+};
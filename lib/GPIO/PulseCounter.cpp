@@ -0,0 +1,161 @@
+#include "PulseCounter.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "PULSE_CNT";
+
+PulseCounter::PulseCounter() : _extender(COUNTER_LIMIT), _rate(1000000) {
+    _lock = xSemaphoreCreateMutex();
+}
+
+PulseCounter::~PulseCounter() {
+    if (_timer) {
+        esp_timer_stop(_timer);
+        esp_timer_delete(_timer);
+    }
+    if (_unit) {
+        pcnt_unit_stop(_unit);
+        pcnt_unit_disable(_unit);
+        for (auto& chan : _channels) {
+            if (chan) pcnt_del_channel(chan);
+        }
+        pcnt_del_unit(_unit);
+    }
+    vSemaphoreDelete(_lock);
+}
+
+// Unit with symmetric limits (the extension relies on them) and the glitch filter
+esp_err_t PulseCounter::create_unit(const PulseCounterConfig& config) {
+    if (_unit) return ESP_ERR_INVALID_STATE;
+
+    pcnt_unit_config_t unit_config = {};
+    unit_config.low_limit = -COUNTER_LIMIT;
+    unit_config.high_limit = COUNTER_LIMIT;
+    esp_err_t err = pcnt_new_unit(&unit_config, &_unit);
+    if (err != ESP_OK) return err;
+
+    if (config.glitch_ns > 0) {
+        pcnt_glitch_filter_config_t filter_config = {};
+        filter_config.max_glitch_ns = config.glitch_ns;
+        err = pcnt_unit_set_glitch_filter(_unit, &filter_config);
+    }
+    return err;
+}
+
+esp_err_t PulseCounter::begin(gpio_num_t pin, const PulseCounterConfig& config) {
+    esp_err_t err = create_unit(config);
+    if (err != ESP_OK) return err;
+
+    pcnt_chan_config_t chan_config = {};
+    chan_config.edge_gpio_num = pin;
+    chan_config.level_gpio_num = -1;
+    err = pcnt_new_channel(_unit, &chan_config, &_channels[0]);
+    if (err != ESP_OK) return err;
+
+    pcnt_channel_edge_action_t rising = config.edge == PULSE_EDGE_FALLING ? PCNT_CHANNEL_EDGE_ACTION_HOLD
+                                                                          : PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+    pcnt_channel_edge_action_t falling = config.edge == PULSE_EDGE_RISING ? PCNT_CHANNEL_EDGE_ACTION_HOLD
+                                                                          : PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+    err = pcnt_channel_set_edge_action(_channels[0], rising, falling);
+    if (err != ESP_OK) return err;
+    return start(config);
+}
+
+// Each pin's edges count up or down depending on the other pin's level, which
+// gives four counts per quadrature cycle; A leading B counts up
+esp_err_t PulseCounter::begin_quadrature(gpio_num_t pin_a, gpio_num_t pin_b, const PulseCounterConfig& config) {
+    esp_err_t err = create_unit(config);
+    if (err != ESP_OK) return err;
+
+    const gpio_num_t edges[2] = {pin_a, pin_b};
+    const gpio_num_t levels[2] = {pin_b, pin_a};
+    for (int i = 0; i < 2 && err == ESP_OK; i++) {
+        pcnt_chan_config_t chan_config = {};
+        chan_config.edge_gpio_num = edges[i];
+        chan_config.level_gpio_num = levels[i];
+        err = pcnt_new_channel(_unit, &chan_config, &_channels[i]);
+        if (err != ESP_OK) break;
+
+        // Level actions are (high, low): an edge on A counts as given while B is
+        // high and inverted while B is low, and the same for B against A
+        err = i == 0 ? pcnt_channel_set_edge_action(_channels[i], PCNT_CHANNEL_EDGE_ACTION_DECREASE,
+                                                    PCNT_CHANNEL_EDGE_ACTION_INCREASE)
+                     : pcnt_channel_set_edge_action(_channels[i], PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                                    PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+        if (err == ESP_OK) {
+            err = pcnt_channel_set_level_action(_channels[i], PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+                                                PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+        }
+    }
+    if (err != ESP_OK) return err;
+    return start(config);
+}
+
+// Start counting and the poll timer: one step of the frequency window, or
+// shorter if max_hz could otherwise move the counter half its range between polls
+esp_err_t PulseCounter::start(const PulseCounterConfig& config) {
+    _rate = PulseRateWindow(config.window_ms * 1000);
+    uint32_t period_us = _rate.step_us();
+    uint32_t safe_us = pulse_poll_period_us(COUNTER_LIMIT, config.max_hz);
+    if (safe_us < period_us) period_us = safe_us;
+
+    esp_err_t err = pcnt_unit_enable(_unit);
+    if (err == ESP_OK) err = pcnt_unit_clear_count(_unit);
+    if (err == ESP_OK) err = pcnt_unit_start(_unit);
+    if (err != ESP_OK) return err;
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = poll_cb;
+    timer_args.arg = this;
+    timer_args.name = "pulse_cnt";
+    err = esp_timer_create(&timer_args, &_timer);
+    if (err == ESP_OK) err = esp_timer_start_periodic(_timer, period_us);
+    if (err != ESP_OK) ESP_LOGE(TAG, "Poll timer failed: %s", esp_err_to_name(err));
+    return err;
+}
+
+// Read the hardware counter into the extension; caller holds _lock
+int64_t PulseCounter::update() {
+    int raw = 0;
+    pcnt_unit_get_count(_unit, &raw);
+    return _extender.update(raw);
+}
+
+void PulseCounter::poll_cb(void* arg) {
+    PulseCounter* self = static_cast<PulseCounter*>(arg);
+    xSemaphoreTake(self->_lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    self->_rate.add(now, self->update());
+    xSemaphoreGive(self->_lock);
+}
+
+int64_t PulseCounter::count() {
+    if (!_unit) return 0;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    int64_t total = update();
+    xSemaphoreGive(_lock);
+    return total;
+}
+
+double PulseCounter::frequency_hz() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    double hz = _rate.rate_hz();
+    xSemaphoreGive(_lock);
+    return hz;
+}
+
+double PulseCounter::rpm(double counts_per_rev) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    double value = _rate.rpm(counts_per_rev);
+    xSemaphoreGive(_lock);
+    return value;
+}
+
+// Zero the count; the frequency window starts over
+void PulseCounter::reset() {
+    if (!_unit) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    pcnt_unit_clear_count(_unit);
+    _extender.reset(0);
+    _rate.reset();
+    xSemaphoreGive(_lock);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+#include "esp_timer.h"
+#include "PulseCounterMath.hpp"
+
+typedef enum {
+    PULSE_EDGE_RISING,
+    PULSE_EDGE_FALLING,
+    PULSE_EDGE_BOTH,
+} pulse_edge_t;
+
+struct PulseCounterConfig {
+    pulse_edge_t edge = PULSE_EDGE_RISING;   // Single-pin counting only
+    uint32_t glitch_ns = 1000;               // Pulses shorter than this are ignored; 0 = no filter
+    uint32_t window_ms = 1000;               // Frequency averaging window
+    uint32_t max_hz = 200000;                // Highest expected count rate; sets the poll period
+};
+
+// Counts edges in the PCNT peripheral, so a flow meter or encoder at tens of
+// kHz costs no interrupts. A periodic esp_timer reads the 16-bit counter often
+// enough to extend it to 64 bits and samples it for the frequency window.
+// Either one pin (counting the configured edges) or an A/B quadrature pair
+// (x4 decoding: every edge of both pins, up or down by direction).
+class PulseCounter {
+public:
+    PulseCounter();
+    ~PulseCounter();
+
+    PulseCounter(const PulseCounter&) = delete;
+    PulseCounter& operator=(const PulseCounter&) = delete;
+
+    esp_err_t begin(gpio_num_t pin, const PulseCounterConfig& config);
+    esp_err_t begin_quadrature(gpio_num_t pin_a, gpio_num_t pin_b, const PulseCounterConfig& config);
+
+    int64_t count();
+    double frequency_hz();
+    double rpm(double counts_per_rev);
+    void reset();
+
+private:
+    // Counter clears at +/- this; the largest the 16-bit PCNT accepts
+    static const int COUNTER_LIMIT = 32767;
+
+    pcnt_unit_handle_t _unit = nullptr;
+    pcnt_channel_handle_t _channels[2] = {};
+    esp_timer_handle_t _timer = nullptr;
+    SemaphoreHandle_t _lock;
+    PulseExtender _extender;
+    PulseRateWindow _rate;
+
+    esp_err_t create_unit(const PulseCounterConfig& config);
+    esp_err_t start(const PulseCounterConfig& config);
+    int64_t update();
+
+    static void poll_cb(void* arg);
+};
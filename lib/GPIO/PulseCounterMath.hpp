@@ -0,0 +1,101 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Extends a hardware pulse counter to 64 bits. The PCNT counter runs between
+// -limit and +limit and clears to 0 when it reaches either, so its value is
+// always the true count modulo limit; the extension sums the shortest signed
+// step between successive readings. Correct as long as the count moves less
+// than limit / 2 between two updates, which the caller guarantees by polling
+// (see pulse_poll_period_us).
+//
+// No ESP-IDF dependencies: feed it readings from a simulated counter off-target.
+class PulseExtender {
+public:
+    explicit PulseExtender(int32_t limit) : _limit(limit > 1 ? limit : 2) {}
+
+    // Fold in a new raw reading and return the extended count
+    int64_t update(int32_t raw) {
+        int32_t step = (raw - _last_raw) % _limit;
+        if (step > _limit / 2) step -= _limit;
+        else if (step < -(_limit / 2)) step += _limit;
+        _last_raw = raw;
+        _total += step;
+        return _total;
+    }
+
+    int64_t total() const { return _total; }
+
+    // Restart from zero with raw as the counter's current value
+    void reset(int32_t raw = 0) {
+        _last_raw = raw;
+        _total = 0;
+    }
+
+private:
+    int32_t _limit;
+    int32_t _last_raw = 0;
+    int64_t _total = 0;
+};
+
+// Longest safe poll period for a counter of the given limit at max_hz counts
+// per second: half the counter range, with a 2x margin for scheduling jitter
+inline uint32_t pulse_poll_period_us(int32_t limit, uint32_t max_hz) {
+    if (max_hz == 0) return UINT32_MAX;
+    uint64_t us = (uint64_t) (limit / 4) * 1000000ULL / max_hz;
+    if (us < 1) us = 1;
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t) us;
+}
+
+// Count rate over a sliding window of (time, count) samples. The rate is the
+// count difference between the newest sample and the oldest one still inside
+// the window, divided by their time difference, so it is exact to one count
+// per window and needs no per-edge work. Negative for a quadrature encoder
+// turning backwards.
+class PulseRateWindow {
+public:
+    static const size_t SAMPLES = 17;   // Window split into 16 steps
+
+    explicit PulseRateWindow(uint32_t window_us) : _window_us(window_us ? window_us : 1) {}
+
+    void add(int64_t time_us, int64_t count) {
+        _head = (_head + 1) % SAMPLES;
+        _time[_head] = time_us;
+        _count[_head] = count;
+        if (_size < SAMPLES) _size++;
+    }
+
+    // Counts per second; 0 until two samples are in
+    double rate_hz() const {
+        if (_size < 2) return 0.0;
+        size_t oldest = _head;
+        for (size_t i = 1; i < _size; i++) {
+            size_t idx = (_head + SAMPLES - i) % SAMPLES;
+            if (_time[_head] - _time[idx] > (int64_t) _window_us) break;
+            oldest = idx;
+        }
+        // Window shorter than one step: use the previous sample anyway
+        if (oldest == _head) oldest = (_head + SAMPLES - 1) % SAMPLES;
+        int64_t dt = _time[_head] - _time[oldest];
+        if (dt <= 0) return 0.0;
+        return (double) (_count[_head] - _count[oldest]) * 1e6 / (double) dt;
+    }
+
+    // Revolutions per minute for a sensor giving counts_per_rev counts per turn
+    // (pulses per turn for single-edge counting, 4x the lines for quadrature)
+    double rpm(double counts_per_rev) const {
+        return counts_per_rev > 0 ? rate_hz() * 60.0 / counts_per_rev : 0.0;
+    }
+
+    // Step between samples that keeps the window filled
+    uint32_t step_us() const { return _window_us / (SAMPLES - 1) ? _window_us / (SAMPLES - 1) : 1; }
+
+    void reset() { _size = 0; }
+
+private:
+    uint32_t _window_us;
+    int64_t _time[SAMPLES] = {};
+    int64_t _count[SAMPLES] = {};
+    size_t _head = 0;
+    size_t _size = 0;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Single-producer / single-consumer ring buffer. The producer side may run in an ISR,
+// the consumer side in a task. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        _capacity = cap;
+        _mask = cap - 1;
+        _buf = new T[cap];
+    }
+
+    ~SpscRing() { delete[] _buf; }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: returns false and counts an overrun when the ring is full
+    bool push(const T& item) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == _capacity) {
+            _overruns.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        _buf[head & _mask] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: copies up to max_items into out, returns the number copied
+    size_t pop(T* out, size_t max_items) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t avail = _head.load(std::memory_order_acquire) - tail;
+        size_t n = avail < max_items ? avail : max_items;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = _buf[(tail + i) & _mask];
+        }
+        _tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return _capacity; }
+
+    uint32_t overruns() const { return _overruns.load(std::memory_order_relaxed); }
+
+private:
+    T* _buf;
+    size_t _capacity;
+    size_t _mask;
+    std::atomic<size_t> _head{0};
+    std::atomic<size_t> _tail{0};
+    std::atomic<uint32_t> _overruns{0};
+};
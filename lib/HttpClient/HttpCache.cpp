@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include "HttpCache.hpp"
+#include "Diagnostics.hpp"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+static const char* TAG = "HTTP_CACHE";
+static const char* NVS_NAMESPACE = "http_cache";
+
+// Bodies prefer PSRAM and fall back to internal RAM on boards without it
+static void* cache_alloc(size_t bytes) {
+    return heap_caps_malloc_prefer(bytes, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+static const http_cache_memory_t CACHE_MEMORY = {cache_alloc, heap_caps_free};
+
+// One NVS blob per spilled entry, named by the URL hash
+class NvsCacheSpill : public HttpCacheSpill {
+public:
+    explicit NvsCacheSpill(size_t max_bytes) : _max_bytes(max_bytes) {}
+
+    bool save(uint32_t key, const void* data, size_t len) override {
+        if (len > _max_bytes) return false;
+        nvs_handle_t nvs;
+        if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) return false;
+        char name[9];
+        key_name(key, name);
+        bool ok = nvs_set_blob(nvs, name, data, len) == ESP_OK && nvs_commit(nvs) == ESP_OK;
+        nvs_close(nvs);
+        return ok;
+    }
+
+    bool load(uint32_t key, std::string* out) override {
+        nvs_handle_t nvs;
+        if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) return false;
+        char name[9];
+        key_name(key, name);
+        size_t len = 0;
+        esp_err_t err = nvs_get_blob(nvs, name, nullptr, &len);
+        if (err == ESP_OK) {
+            out->resize(len);
+            err = nvs_get_blob(nvs, name, &(*out)[0], &len);
+        }
+        nvs_close(nvs);
+        return err == ESP_OK;
+    }
+
+    // Only a key that exists costs a flash write
+    void erase(uint32_t key) override {
+        nvs_handle_t nvs;
+        if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) return;
+        char name[9];
+        key_name(key, name);
+        if (nvs_erase_key(nvs, name) == ESP_OK) nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+
+private:
+    size_t _max_bytes;
+
+    static void key_name(uint32_t key, char* name) { snprintf(name, 9, "%08lx", (unsigned long) key); }
+};
+
+HttpCache& HttpCache::instance() {
+    static HttpCache cache;
+    return cache;
+}
+
+HttpCache::HttpCache() {
+    _lock = xSemaphoreCreateMutex();
+}
+
+esp_err_t HttpCache::begin(const HttpCacheConfig& config) {
+    if (_store) return ESP_ERR_INVALID_STATE;
+    _config = config;
+
+    HttpCacheStore* store = new HttpCacheStore(config.budget_bytes, config.max_entry_bytes, &CACHE_MEMORY);
+    if (config.nvs_spill) {
+        _spill = new NvsCacheSpill(config.max_spill_bytes);
+        store->set_spill(_spill);
+    }
+
+    Diagnostics& diag = Diagnostics::instance();
+    _diag_hits = diag.counter("http_cache_hits");
+    _diag_misses = diag.counter("http_cache_misses");
+    _diag_saved = diag.counter("http_cache_saved_bytes");
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _store = store;
+    xSemaphoreGive(_lock);
+    return ESP_OK;
+}
+
+http_cache_state_t HttpCache::lookup(const std::string& url, HttpCacheHit* hit) {
+    if (!_store) return HTTP_CACHE_MISS;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    http_cache_state_t state = _store->lookup(url, esp_timer_get_time(), hit);
+    xSemaphoreGive(_lock);
+
+    if (state == HTTP_CACHE_FRESH) {
+        if (_diag_hits) _diag_hits->add();
+        if (_diag_saved) _diag_saved->add((uint32_t) hit->body->len);
+    } else if (state == HTTP_CACHE_MISS) {
+        if (_diag_misses) _diag_misses->add();
+    }
+    return state;
+}
+
+void HttpCache::record_miss() {
+    if (_diag_misses) _diag_misses->add();
+}
+
+bool HttpCache::store(const std::string& url, const HttpCacheHeaders& headers, const char* body, size_t len) {
+    if (!_store) return false;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool kept = _store->store(url, headers, body, len, esp_timer_get_time());
+    xSemaphoreGive(_lock);
+    return kept;
+}
+
+bool HttpCache::revalidated(const std::string& url, const HttpCacheHeaders& headers, HttpCacheHit* hit) {
+    if (!_store) return false;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool found = _store->revalidated(url, headers, esp_timer_get_time(), hit);
+    xSemaphoreGive(_lock);
+
+    if (found) {
+        if (_diag_hits) _diag_hits->add();
+        if (_diag_saved) _diag_saved->add((uint32_t) hit->body->len);
+    }
+    return found;
+}
+
+void HttpCache::remove(const std::string& url) {
+    if (!_store) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _store->remove(url);
+    xSemaphoreGive(_lock);
+}
+
+void HttpCache::clear() {
+    if (!_store) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _store->clear();
+    xSemaphoreGive(_lock);
+}
+
+http_cache_stats_t HttpCache::stats() {
+    http_cache_stats_t s = {};
+    if (!_store) return s;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    s = _store->stats();
+    xSemaphoreGive(_lock);
+    return s;
+}
+
+void HttpCache::log_stats() {
+    http_cache_stats_t s = stats();
+    ESP_LOGI(TAG, "%lu entries, %lu/%u bytes, hit rate %u%% (%lu fresh, %lu revalidated, %lu misses), "
+             "%llu bytes saved, %lu evicted, %lu from flash",
+             (unsigned long) s.entries, (unsigned long) s.bytes_used, (unsigned) _config.budget_bytes,
+             (unsigned) s.hit_rate_pct, (unsigned long) s.fresh_hits, (unsigned long) s.revalidated,
+             (unsigned long) s.misses, (unsigned long long) s.bytes_saved, (unsigned long) s.evicted,
+             (unsigned long) s.spill_loads);
+}
+
+esp_err_t HttpCache::replay(const HttpCacheBody& body, HttpSink* sink) {
+    esp_err_t err = sink->begin(200, (int64_t) body.len);
+    for (size_t off = 0; err == ESP_OK && off < body.len; off += REPLAY_FRAGMENT) {
+        size_t n = body.len - off < REPLAY_FRAGMENT ? body.len - off : REPLAY_FRAGMENT;
+        err = sink->write(body.data + off, n);
+    }
+    return err;
+}
+
+esp_err_t HttpCacheSink::begin(int status, int64_t content_length) {
+    HttpCache& cache = HttpCache::instance();
+    if (status == 304 && _exchange->hit.body) {
+        // The body stays valid through the shared pointer even if the entry was evicted meanwhile
+        cache.revalidated(_url, _exchange->headers, &_exchange->hit);
+        _not_modified = true;
+        return HttpCache::replay(*_exchange->hit.body, _inner);
+    }
+
+    if (_exchange->hit.state == HTTP_CACHE_STALE) cache.record_miss();
+    _capturing = status == 200 && (content_length < 0 || (size_t) content_length <= cache.max_entry_bytes());
+    if (_capturing && content_length > 0) _copy.reserve((size_t) content_length);
+    return _inner->begin(status, content_length);
+}
+
+esp_err_t HttpCacheSink::write(const char* data, size_t len) {
+    if (_not_modified) return ESP_OK;
+    if (_capturing) {
+        if (_copy.size() + len > HttpCache::instance().max_entry_bytes()) {
+            _capturing = false;
+            pool_string().swap(_copy);
+        } else {
+            _copy.append(data, len);
+        }
+    }
+    return _inner->write(data, len);
+}
+
+void HttpCacheSink::end(esp_err_t result) {
+    if (result == ESP_OK && _capturing) {
+        HttpCache::instance().store(_url, _exchange->headers, _copy.data(), _copy.size());
+    }
+    _inner->end(result);
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "HttpCacheStore.hpp"
+#include "HttpSink.hpp"
+
+class DiagCounter;
+
+struct HttpCacheConfig {
+    size_t budget_bytes = 64 * 1024;      // Bodies, URLs and validators; in PSRAM when present
+    size_t max_entry_bytes = 16 * 1024;   // Larger responses pass through uncached
+    bool nvs_spill = false;               // Keep entries evicted from RAM in NVS for revalidation
+    size_t max_spill_bytes = 4000;        // Larger entries are dropped instead of spilled
+};
+
+// One conditional GET in flight: the validators sent and the response headers
+// captured by HttpClient's event handler
+struct HttpCacheExchange {
+    HttpCacheHit hit;
+    HttpCacheHeaders headers;
+};
+
+// Process-wide response cache for HttpClient GETs. Until begin() is called the
+// cache is off and every GET goes to the server. A fresh entry (within
+// Cache-Control max-age) is served without a request; a stale one is
+// revalidated with If-None-Match / If-Modified-Since and served from RAM when
+// the server answers 304 Not Modified. Hits and bytes saved are kept in stats()
+// and fed to the Diagnostics counters http_cache_hits, http_cache_misses and
+// http_cache_saved_bytes.
+class HttpCache {
+public:
+    static HttpCache& instance();
+
+    esp_err_t begin(const HttpCacheConfig& config = HttpCacheConfig());
+
+    bool enabled() const { return _store != nullptr; }
+
+    http_cache_state_t lookup(const std::string& url, HttpCacheHit* hit);
+
+    // A complete 200 response; returns true if it was kept
+    bool store(const std::string& url, const HttpCacheHeaders& headers, const char* body, size_t len);
+
+    // A 304 for a lookup that returned HTTP_CACHE_STALE
+    bool revalidated(const std::string& url, const HttpCacheHeaders& headers, HttpCacheHit* hit);
+
+    // A stale lookup answered with a full response (for the Diagnostics counter)
+    void record_miss();
+
+    void remove(const std::string& url);
+
+    void clear();
+
+    http_cache_stats_t stats();
+
+    void log_stats();
+
+    size_t max_entry_bytes() const { return _config.max_entry_bytes; }
+
+    // Hand a cached body to sink as a 200 response: begin() and the body in
+    // read-window sized fragments, but not end()
+    static esp_err_t replay(const HttpCacheBody& body, HttpSink* sink);
+
+private:
+    HttpCache();
+
+    HttpCacheStore* _store = nullptr;
+    HttpCacheSpill* _spill = nullptr;
+    HttpCacheConfig _config;
+    SemaphoreHandle_t _lock;
+
+    DiagCounter* _diag_hits = nullptr;
+    DiagCounter* _diag_misses = nullptr;
+    DiagCounter* _diag_saved = nullptr;
+
+    static const size_t REPLAY_FRAGMENT = 512;
+};
+
+// Wraps the caller's sink for a cacheable GET: passes a 200 through while
+// keeping a copy for the cache, and turns a 304 into the cached body
+class HttpCacheSink : public HttpSink {
+public:
+    HttpCacheSink(const std::string& url, HttpSink* inner, HttpCacheExchange* exchange)
+        : _url(url), _inner(inner), _exchange(exchange) {}
+
+    esp_err_t begin(int status, int64_t content_length) override;
+    esp_err_t write(const char* data, size_t len) override;
+    void end(esp_err_t result) override;
+
+    // The response was a 304 answered from the cache
+    bool not_modified() const { return _not_modified; }
+
+private:
+    const std::string& _url;
+    HttpSink* _inner;
+    HttpCacheExchange* _exchange;
+    pool_string _copy;
+    bool _capturing = false;
+    bool _not_modified = false;
+};
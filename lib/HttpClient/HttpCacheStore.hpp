@@ -0,0 +1,348 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Where cached bodies live; the ESP-IDF wrapper points this at PSRAM
+typedef struct {
+    void* (*alloc)(size_t bytes);
+    void (*free)(void* p);
+} http_cache_memory_t;
+
+typedef enum {
+    HTTP_CACHE_MISS,     // Nothing usable: plain request
+    HTTP_CACHE_FRESH,    // Within max-age: serve without a request
+    HTTP_CACHE_STALE,    // Send the validators; a 304 serves the cached body
+} http_cache_state_t;
+
+typedef struct {
+    uint32_t fresh_hits;     // Served without a request
+    uint32_t revalidated;    // Served after a 304
+    uint32_t misses;         // Full download (including changed content)
+    uint32_t stored;
+    uint32_t evicted;        // Dropped (or spilled) to stay within the byte budget
+    uint32_t spill_loads;    // Brought back from flash
+    uint64_t bytes_saved;    // Body bytes served from the cache instead of downloaded
+    uint32_t bytes_used;
+    uint32_t entries;
+    uint8_t hit_rate_pct;    // (fresh_hits + revalidated) of all lookups
+} http_cache_stats_t;
+
+// Response headers that decide caching, collected as they arrive
+struct HttpCacheHeaders {
+    std::string etag;
+    std::string last_modified;
+    std::string cache_control;
+    uint32_t age_s = 0;
+
+    void reset() {
+        etag.clear();
+        last_modified.clear();
+        cache_control.clear();
+        age_s = 0;
+    }
+
+    // Header names are case-insensitive
+    void capture(const char* key, const char* value) {
+        if (!key || !value) return;
+        if (strcasecmp(key, "ETag") == 0) etag = value;
+        else if (strcasecmp(key, "Last-Modified") == 0) last_modified = value;
+        else if (strcasecmp(key, "Cache-Control") == 0) cache_control = value;
+        else if (strcasecmp(key, "Age") == 0) age_s = (uint32_t) strtoul(value, nullptr, 10);
+    }
+};
+
+typedef struct {
+    bool no_store;
+    bool no_cache;       // Always revalidate
+    int64_t max_age_s;   // -1 if absent
+} http_cache_control_t;
+
+// Reads the directives that matter to a private cache; unknown ones are ignored
+inline http_cache_control_t http_cache_parse_control(const std::string& value) {
+    http_cache_control_t cc = {false, false, -1};
+    size_t pos = 0;
+    while (pos < value.size()) {
+        size_t end = value.find(',', pos);
+        if (end == std::string::npos) end = value.size();
+        size_t a = pos, b = end;
+        while (a < b && (value[a] == ' ' || value[a] == '\t')) a++;
+        while (b > a && (value[b - 1] == ' ' || value[b - 1] == '\t')) b--;
+        const char* d = value.c_str() + a;
+        size_t n = b - a;
+        if (n == 8 && strncasecmp(d, "no-store", 8) == 0) cc.no_store = true;
+        else if (n == 8 && strncasecmp(d, "no-cache", 8) == 0) cc.no_cache = true;
+        else if (n > 8 && strncasecmp(d, "max-age=", 8) == 0) cc.max_age_s = strtoll(d + 8, nullptr, 10);
+        pos = end + 1;
+    }
+    return cc;
+}
+
+// A cached body; shared so a reader can keep serving it after the entry is evicted
+struct HttpCacheBody {
+    char* data = nullptr;
+    size_t len = 0;
+    void (*release)(void*) = nullptr;
+
+    ~HttpCacheBody() {
+        if (data && release) release(data);
+    }
+};
+
+typedef std::shared_ptr<const HttpCacheBody> http_cache_body_ptr;
+
+struct HttpCacheHit {
+    http_cache_state_t state = HTTP_CACHE_MISS;
+    std::string etag;            // Validators for a conditional request
+    std::string last_modified;
+    http_cache_body_ptr body;
+};
+
+// Second tier for entries evicted from RAM (e.g. NVS). Keys are a hash of the
+// URL; the stored record carries the URL so a collision reads as a miss.
+class HttpCacheSpill {
+public:
+    virtual ~HttpCacheSpill() = default;
+
+    virtual bool save(uint32_t key, const void* data, size_t len) = 0;
+
+    virtual bool load(uint32_t key, std::string* out) = 0;
+
+    virtual void erase(uint32_t key) = 0;
+};
+
+// LRU map of URL to response body and validators, bounded by a byte budget
+// (bodies, URLs and validators). Freshness follows Cache-Control max-age minus
+// Age; without max-age an entry is always revalidated, and a response with
+// neither validators nor max-age is not kept. Entries that come back from the
+// spill tier are always revalidated, since their age is unknown.
+//
+// Not thread-safe; HttpCache wraps it in a mutex. The clock is passed in, so
+// expiry can be checked off-target.
+class HttpCacheStore {
+public:
+    HttpCacheStore(size_t budget_bytes, size_t max_entry_bytes, const http_cache_memory_t* memory = nullptr)
+        : _budget(budget_bytes), _max_entry(max_entry_bytes), _memory(memory ? *memory : default_memory()) {}
+
+    HttpCacheStore(const HttpCacheStore&) = delete;
+    HttpCacheStore& operator=(const HttpCacheStore&) = delete;
+
+    void set_spill(HttpCacheSpill* spill) { _spill = spill; }
+
+    http_cache_state_t lookup(const std::string& url, int64_t now_us, HttpCacheHit* hit) {
+        auto it = _index.find(url);
+        if (it == _index.end() && !load_spilled(url)) {
+            _stats.misses++;
+            *hit = HttpCacheHit();
+            return HTTP_CACHE_MISS;
+        }
+        it = _index.find(url);
+        Entry& e = *it->second;
+        _lru.splice(_lru.begin(), _lru, it->second);
+
+        hit->etag = e.etag;
+        hit->last_modified = e.last_modified;
+        hit->body = e.body;
+        hit->state = now_us < e.fresh_until_us ? HTTP_CACHE_FRESH : HTTP_CACHE_STALE;
+        if (hit->state == HTTP_CACHE_FRESH) {
+            _stats.fresh_hits++;
+            _stats.bytes_saved += e.body->len;
+        } else {
+            _stale_lookups++;
+        }
+        return hit->state;
+    }
+
+    // A 200 response. Returns false if it may not or need not be kept (and drops
+    // any older copy, whose validators no longer match).
+    bool store(const std::string& url, const HttpCacheHeaders& headers, const char* body, size_t len,
+               int64_t now_us) {
+        remove(url);
+        http_cache_control_t cc = http_cache_parse_control(headers.cache_control);
+        bool validators = !headers.etag.empty() || !headers.last_modified.empty();
+        if (cc.no_store || (!validators && (cc.no_cache || cc.max_age_s <= 0))) return false;
+
+        return insert(url, headers, body, len, fresh_until(cc, headers.age_s, now_us), false);
+    }
+
+    // A 304: the cached body is current. Freshness is renewed from the new
+    // headers, and a changed validator replaces the old one.
+    bool revalidated(const std::string& url, const HttpCacheHeaders& headers, int64_t now_us, HttpCacheHit* hit) {
+        auto it = _index.find(url);
+        if (it == _index.end()) return false;
+        Entry& e = *it->second;
+        if (!headers.etag.empty() && headers.etag != e.etag) {
+            e.etag = headers.etag;
+            e.spilled = false;
+        }
+        if (!headers.last_modified.empty() && headers.last_modified != e.last_modified) {
+            e.last_modified = headers.last_modified;
+            e.spilled = false;
+        }
+        if (!headers.cache_control.empty()) {
+            e.fresh_until_us = fresh_until(http_cache_parse_control(headers.cache_control), headers.age_s, now_us);
+        }
+        _used -= e.cost;
+        e.cost = entry_cost(e.url, e.etag, e.last_modified, e.body->len);
+        _used += e.cost;
+
+        hit->state = HTTP_CACHE_STALE;
+        hit->etag = e.etag;
+        hit->last_modified = e.last_modified;
+        hit->body = e.body;
+        _stats.revalidated++;
+        _stats.bytes_saved += e.body->len;
+        trim();
+        return true;
+    }
+
+    void remove(const std::string& url) {
+        auto it = _index.find(url);
+        if (it == _index.end()) return;
+        _used -= it->second->cost;
+        _lru.erase(it->second);
+        _index.erase(it);
+    }
+
+    void clear() {
+        _lru.clear();
+        _index.clear();
+        _used = 0;
+    }
+
+    http_cache_stats_t stats() const {
+        http_cache_stats_t s = _stats;
+        // A stale lookup that did not end in a 304 was a full download
+        s.misses += _stale_lookups - s.revalidated;
+        s.bytes_used = (uint32_t) _used;
+        s.entries = (uint32_t) _index.size();
+        uint32_t lookups = s.fresh_hits + s.revalidated + s.misses;
+        s.hit_rate_pct = lookups ? (uint8_t) ((uint64_t) (s.fresh_hits + s.revalidated) * 100 / lookups) : 0;
+        return s;
+    }
+
+    static uint32_t key(const std::string& url) {
+        uint32_t h = 2166136261u;
+        for (char c : url) h = (h ^ (uint8_t) c) * 16777619u;
+        return h;
+    }
+
+private:
+    struct Entry {
+        std::string url;
+        std::string etag;
+        std::string last_modified;
+        http_cache_body_ptr body;
+        size_t cost = 0;
+        int64_t fresh_until_us = 0;
+        bool spilled = false;     // Flash already holds this exact entry
+    };
+
+    std::list<Entry> _lru;       // Most recent first
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+    size_t _budget;
+    size_t _max_entry;
+    size_t _used = 0;
+    http_cache_memory_t _memory;
+    HttpCacheSpill* _spill = nullptr;
+    http_cache_stats_t _stats = {};
+    uint32_t _stale_lookups = 0;
+
+    static http_cache_memory_t default_memory() { return {malloc, free}; }
+
+    static size_t entry_cost(const std::string& url, const std::string& etag, const std::string& last_modified,
+                             size_t len) {
+        return len + url.size() + etag.size() + last_modified.size();
+    }
+
+    static int64_t fresh_until(const http_cache_control_t& cc, uint32_t age_s, int64_t now_us) {
+        if (cc.no_cache || cc.max_age_s <= (int64_t) age_s) return 0;
+        return now_us + (cc.max_age_s - (int64_t) age_s) * 1000000;
+    }
+
+    bool insert(const std::string& url, const HttpCacheHeaders& headers, const char* body, size_t len,
+                int64_t fresh_until_us, bool from_spill) {
+        size_t cost = entry_cost(url, headers.etag, headers.last_modified, len);
+        if (len > _max_entry || cost > _budget) return false;
+
+        auto b = std::make_shared<HttpCacheBody>();
+        if (len > 0) {
+            b->data = (char*) _memory.alloc(len);
+            if (!b->data) return false;
+            b->release = _memory.free;
+            memcpy(b->data, body, len);
+        }
+        b->len = len;
+
+        _lru.emplace_front();
+        Entry& e = _lru.front();
+        e.url = url;
+        e.etag = headers.etag;
+        e.last_modified = headers.last_modified;
+        e.body = b;
+        e.cost = cost;
+        e.fresh_until_us = fresh_until_us;
+        e.spilled = from_spill;
+        _index[url] = _lru.begin();
+        _used += cost;
+        if (from_spill) {
+            _stats.spill_loads++;
+        } else {
+            _stats.stored++;
+            if (_spill) _spill->erase(key(url));
+        }
+        trim();
+        return true;
+    }
+
+    // Evict least recently used entries until within budget, spilling those
+    // that can be revalidated later
+    void trim() {
+        while (_used > _budget && !_lru.empty()) {
+            Entry& e = _lru.back();
+            if (_spill && !e.spilled) spill(e);
+            _used -= e.cost;
+            _index.erase(e.url);
+            _lru.pop_back();
+            _stats.evicted++;
+        }
+    }
+
+    // Record: url_len u16, etag_len u8, lm_len u8, url, etag, last_modified, body
+    void spill(const Entry& e) {
+        if (e.etag.empty() && e.last_modified.empty()) return;
+        if (e.url.size() > 0xFFFF || e.etag.size() > 0xFF || e.last_modified.size() > 0xFF) return;
+        std::string rec;
+        rec.reserve(4 + e.cost);
+        rec += (char) (e.url.size() & 0xFF);
+        rec += (char) (e.url.size() >> 8);
+        rec += (char) e.etag.size();
+        rec += (char) e.last_modified.size();
+        rec += e.url;
+        rec += e.etag;
+        rec += e.last_modified;
+        rec.append(e.body->data ? e.body->data : "", e.body->len);
+        _spill->save(key(e.url), rec.data(), rec.size());
+    }
+
+    bool load_spilled(const std::string& url) {
+        std::string rec;
+        if (!_spill || !_spill->load(key(url), &rec) || rec.size() < 4) return false;
+        size_t url_len = (uint8_t) rec[0] | ((uint8_t) rec[1] << 8);
+        size_t etag_len = (uint8_t) rec[2];
+        size_t lm_len = (uint8_t) rec[3];
+        size_t head = 4 + url_len + etag_len + lm_len;
+        if (head > rec.size() || rec.compare(4, url_len, url) != 0) return false;
+
+        HttpCacheHeaders h;
+        h.etag = rec.substr(4 + url_len, etag_len);
+        h.last_modified = rec.substr(4 + url_len + etag_len, lm_len);
+        return insert(url, h, rec.data() + head, rec.size() - head, 0, true);
+    }
+};
@@ -1,19 +1,52 @@
+#include <string.h>
+#include <strings.h>
 #include "HttpClient.hpp"
+#include "FlashLog.hpp"
+#include "HttpConnectionPool.hpp"
+#include "HttpCache.hpp"
+#include "HttpInflateSink.hpp"
+#include "Diagnostics.hpp"
+#include "esp_timer.h"
+#include "JsonEscape.hpp"
+#include "DeferredLog.hpp"
 
 const char* HttpClient::TAG = "HTTP_CLIENT";
 
+HttpCompressionConfig HttpClient::_compression = {false, HTTP_ENCODING_NONE, 256};
+
+static http_compression_stats_t s_compression_stats = {};
+static portMUX_TYPE s_compression_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// What the event handler collects from the response headers of one request
+struct HttpResponseContext {
+    HttpCacheExchange* exchange = nullptr;   // Cacheable GETs only
+    http_encoding_t content_encoding = HTTP_ENCODING_NONE;
+
+    void reset() {
+        if (exchange) exchange->headers.reset();
+        content_encoding = HTTP_ENCODING_NONE;
+    }
+};
+
 HttpClient::HttpClient() {}
 HttpClient::~HttpClient() {}
 
 esp_err_t HttpClient::_http_event_handler(esp_http_client_event_t *evt) {
     switch(evt->event_id) {
         case HTTP_EVENT_ERROR:
-            ESP_LOGD(TAG, "HTTP_EVENT_ERROR");
+            DLOGD(TAG, "HTTP_EVENT_ERROR");
+            break;
+        case HTTP_EVENT_ON_CONNECTED:
+            HttpConnectionPool::instance().record_handshake();
             break;
-        case HTTP_EVENT_ON_DATA:
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                std::string *response = static_cast<std::string*>(evt->user_data);
-                response->append((char*)evt->data, evt->data_len);
+        case HTTP_EVENT_ON_HEADER:
+            if (evt->user_data) {
+                HttpResponseContext* ctx = static_cast<HttpResponseContext*>(evt->user_data);
+                if (strcasecmp(evt->header_key, "Content-Encoding") == 0) {
+                    ctx->content_encoding = http_parse_content_encoding(evt->header_value);
+                }
+                // Only cacheable GETs attach an exchange to collect validators and Cache-Control
+                if (ctx->exchange) ctx->exchange->headers.capture(evt->header_key, evt->header_value);
             }
             break;
         default:
@@ -22,81 +55,370 @@ esp_err_t HttpClient::_http_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
-std::string HttpClient::get(const std::string& url) {
-    std::string response_buffer;
+// Send the request line, headers and body, then read the response headers.
+// Follows up to MAX_REDIRECTS redirects on the same handle. sent is set once
+// the request has started going out.
+esp_err_t HttpClient::open_request(esp_http_client_handle_t client, const char* body, size_t body_len,
+                                   int64_t* content_length, bool* sent) {
+    Diagnostics& diag = Diagnostics::instance();
+    void* ctx = nullptr;
+    esp_http_client_get_user_data(client, &ctx);
+    for (int redirects = 0; ; redirects++) {
+        // Only the final response's headers count
+        if (ctx) static_cast<HttpResponseContext*>(ctx)->reset();
+        int64_t start = esp_timer_get_time();
+        esp_err_t err = esp_http_client_open(client, (int) body_len);
+        if (err != ESP_OK) return err;
+        *sent = true;
 
-    esp_http_client_config_t config = {};
-    config.url = url.c_str();
-    config.event_handler = _http_event_handler;
-    config.user_data = &response_buffer;
-    config.method = HTTP_METHOD_GET;
-    config.crt_bundle_attach = esp_crt_bundle_attach; 
-    config.transport_type = HTTP_TRANSPORT_OVER_SSL;
+        if (body_len > 0 && esp_http_client_write(client, body, (int) body_len) != (int) body_len) {
+            return ESP_ERR_HTTP_WRITE_DATA;
+        }
+        int64_t sent = esp_timer_get_time();
+        diag.http_connect_us.record_us(sent - start);
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_err_t err = esp_http_client_perform(client);
+        int64_t len = esp_http_client_fetch_headers(client);
+        if (len < 0) return ESP_ERR_HTTP_FETCH_HEADER;
+        diag.http_wait_us.record_us(esp_timer_get_time() - sent);
 
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTPS Status = %d", esp_http_client_get_status_code(client));
+        int status = esp_http_client_get_status_code(client);
+        bool redirect = status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+        if (!redirect || redirects >= MAX_REDIRECTS) {
+            *content_length = esp_http_client_is_chunked_response(client) ? -1 : len;
+            return ESP_OK;
+        }
+
+        esp_http_client_flush_response(client, nullptr);
+        esp_http_client_set_redirection(client);
+    }
+}
+
+// Run one request on a pooled keep-alive handle and stream the body into sink
+// through a fixed read window. A reused handle whose connection was dropped by
+// the server is reopened and the request retried once, if it never went out or
+// is a GET or HEAD. GETs go through the
+// response cache once HttpCache::begin() has been called. With compression on,
+// an encoded response is decoded between the read window and sink, so sink (and
+// the cache) only ever see the plain body.
+esp_err_t HttpClient::perform(const std::string& url, esp_http_client_method_t method,
+                              const char* body, size_t body_len, HttpSink* sink, int* status, int timeout_ms,
+                              const char* content_type, HttpCacheExchange* exchange) {
+    if (method == HTTP_METHOD_GET && !body && !exchange && HttpCache::instance().enabled()) {
+        return perform_cached(url, sink, status, timeout_ms);
+    }
+
+    // Compress into a pool buffer no larger than the body: if it does not shrink, it goes as it is
+    pool_string packed;
+    http_encoding_t body_encoding = HTTP_ENCODING_NONE;
+    if (body && _compression.request_encoding != HTTP_ENCODING_NONE && body_len >= _compression.min_request_bytes) {
+        pool_vector<uint32_t> hash(HTTP_DEFLATE_HASH_SIZE, 0);
+        packed.resize(body_len);
+        size_t packed_len = 0;
+        if (HttpDeflater::compress((const uint8_t*) body, body_len, _compression.request_encoding,
+                                   (uint8_t*) &packed[0], packed.size(), &packed_len, hash.data())) {
+            portENTER_CRITICAL(&s_compression_mux);
+            s_compression_stats.requests_encoded++;
+            s_compression_stats.request_body_bytes += body_len;
+            s_compression_stats.request_wire_bytes += packed_len;
+            portEXIT_CRITICAL(&s_compression_mux);
+            body = packed.data();
+            body_len = packed_len;
+            body_encoding = _compression.request_encoding;
+        }
+    }
+
+    bool reused = false;
+    esp_http_client_handle_t client = HttpConnectionPool::instance().acquire(url, _http_event_handler, &reused);
+    if (!client) return ESP_ERR_NO_MEM;
+
+    int64_t start = esp_timer_get_time();
+    esp_http_client_set_method(client, method);
+    esp_http_client_set_timeout_ms(client, timeout_ms > 0 ? timeout_ms : DEFAULT_TIMEOUT_MS);
+    if (body) {
+        esp_http_client_set_header(client, "Content-Type", content_type ? content_type : DEFAULT_CONTENT_TYPE);
+    } else {
+        esp_http_client_delete_header(client, "Content-Type");
+    }
+    // Pooled handles keep their headers: clear the validators of an earlier conditional GET
+    const HttpCacheHit* hit = exchange ? &exchange->hit : nullptr;
+    if (hit && !hit->etag.empty()) {
+        esp_http_client_set_header(client, "If-None-Match", hit->etag.c_str());
+    } else {
+        esp_http_client_delete_header(client, "If-None-Match");
+    }
+    if (hit && !hit->last_modified.empty()) {
+        esp_http_client_set_header(client, "If-Modified-Since", hit->last_modified.c_str());
     } else {
-        ESP_LOGE(TAG, "Error: %s", esp_err_to_name(err));
+        esp_http_client_delete_header(client, "If-Modified-Since");
     }
+    if (body_encoding != HTTP_ENCODING_NONE) {
+        esp_http_client_set_header(client, "Content-Encoding", http_encoding_name(body_encoding));
+    } else {
+        esp_http_client_delete_header(client, "Content-Encoding");
+    }
+    if (_compression.accept_encoding) {
+        esp_http_client_set_header(client, "Accept-Encoding", "gzip, deflate");
+    } else {
+        esp_http_client_delete_header(client, "Accept-Encoding");
+    }
+
+    HttpResponseContext ctx;
+    ctx.exchange = exchange;
+    esp_http_client_set_user_data(client, &ctx);
 
-    esp_http_client_cleanup(client);
-    return response_buffer;
+    // Once the request has gone out the server may have acted on it: only a GET
+    // or HEAD is sent again
+    int64_t content_length = -1;
+    bool sent = false;
+    esp_err_t err = open_request(client, body, body_len, &content_length, &sent);
+    if (err != ESP_OK && reused && (!sent || method == HTTP_METHOD_GET || method == HTTP_METHOD_HEAD)) {
+        esp_http_client_close(client);
+        err = open_request(client, body, body_len, &content_length, &sent);
+    }
+
+    // A HEAD, 204 or 304 has no body to decode, whatever its headers say
+    HttpInflateSink inflate(sink, ctx.content_encoding);
+    HttpSink* body_sink = sink;
+    bool aborted = false;
+    if (err == ESP_OK) {
+        int code = esp_http_client_get_status_code(client);
+        if (status) *status = code;
+        if (ctx.content_encoding == HTTP_ENCODING_UNSUPPORTED) {
+            err = ESP_ERR_NOT_SUPPORTED;
+        } else if (ctx.content_encoding != HTTP_ENCODING_NONE && method != HTTP_METHOD_HEAD && code != 204 &&
+                   code != 304) {
+            body_sink = &inflate;
+        }
+        if (err == ESP_OK) {
+            err = body_sink->begin(code, content_length);
+            aborted = err != ESP_OK;
+        }
+    }
+
+    char window[HTTP_READ_WINDOW];
+    int64_t transfer_start = esp_timer_get_time();
+    while (err == ESP_OK) {
+        int n = esp_http_client_read(client, window, sizeof(window));
+        if (n < 0) {
+            err = ESP_ERR_HTTP_INCOMPLETE_DATA;
+        } else if (n == 0) {
+            break;
+        } else {
+            err = body_sink->write(window, n);
+            aborted = err != ESP_OK;
+        }
+    }
+    if (body_sink == &inflate) {
+        if (err == ESP_OK) err = inflate.finish();
+        if (err == ESP_OK) {
+            portENTER_CRITICAL(&s_compression_mux);
+            s_compression_stats.responses_decoded++;
+            s_compression_stats.response_wire_bytes += inflate.encoded_bytes();
+            s_compression_stats.response_body_bytes += inflate.decoded_bytes();
+            portEXIT_CRITICAL(&s_compression_mux);
+        }
+    }
+    body_sink->end(err);
+    if (err == ESP_OK) Diagnostics::instance().http_transfer_us.record_us(esp_timer_get_time() - transfer_start);
+    else Diagnostics::instance().http_errors.add();
+
+    bool reusable = err == ESP_OK && esp_http_client_is_complete_data_received(client);
+    if (!reusable) esp_http_client_close(client);
+
+    esp_http_client_set_user_data(client, nullptr);
+    HttpConnectionPool::instance().record(esp_timer_get_time() - start, reused);
+    HttpConnectionPool::instance().release(client, reusable || aborted);
+    return err;
 }
 
-std::string HttpClient::post(const std::string& url, const std::string& post_data) {
-    std::string response_buffer;
+// Serve a fresh entry without touching the network; otherwise send the cached
+// validators and let HttpCacheSink turn a 304 into the cached body (reported as 200)
+esp_err_t HttpClient::perform_cached(const std::string& url, HttpSink* sink, int* status, int timeout_ms) {
+    HttpCache& cache = HttpCache::instance();
+    HttpCacheExchange exchange;
+    if (cache.lookup(url, &exchange.hit) == HTTP_CACHE_FRESH) {
+        if (status) *status = 200;
+        esp_err_t err = HttpCache::replay(*exchange.hit.body, sink);
+        sink->end(err);
+        return err;
+    }
 
-    esp_http_client_config_t config = {};
-    config.url = url.c_str();
-    config.event_handler = _http_event_handler;
-    config.user_data = &response_buffer;
-    config.method = HTTP_METHOD_POST;
-    config.crt_bundle_attach = esp_crt_bundle_attach;
-    config.transport_type = HTTP_TRANSPORT_OVER_SSL;
+    HttpCacheSink cache_sink(url, sink, &exchange);
+    esp_err_t err = perform(url, HTTP_METHOD_GET, nullptr, 0, &cache_sink, status, timeout_ms, nullptr, &exchange);
+    if (status && cache_sink.not_modified()) *status = 200;
+    return err;
+}
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    
-    esp_http_client_set_post_field(client, post_data.c_str(), post_data.length());
-    esp_http_client_set_header(client, "Content-Type", "application/json");
+void HttpClient::set_compression(const HttpCompressionConfig& config) {
+    _compression = config;
+}
 
-    esp_err_t err = esp_http_client_perform(client);
+http_compression_stats_t HttpClient::compression_stats() {
+    portENTER_CRITICAL(&s_compression_mux);
+    http_compression_stats_t s = s_compression_stats;
+    portEXIT_CRITICAL(&s_compression_mux);
+    return s;
+}
+
+esp_err_t HttpClient::get(const std::string& url, HttpSink& sink) {
+    return perform(url, HTTP_METHOD_GET, nullptr, 0, &sink, nullptr);
+}
+
+esp_err_t HttpClient::post(const std::string& url, const std::string& post_data, HttpSink& sink,
+                           const char* content_type) {
+    return perform(url, HTTP_METHOD_POST, post_data.data(), post_data.length(), &sink, nullptr, 0, content_type);
+}
+
+esp_err_t HttpClient::post(const std::string& url, const uint8_t* body, size_t body_len,
+                           const char* content_type, HttpSink& sink) {
+    return perform(url, HTTP_METHOD_POST, (const char*) body, body_len, &sink, nullptr, 0, content_type);
+}
+
+esp_err_t HttpClient::request(esp_http_client_method_t method, const std::string& url, const std::string* body,
+                              HttpSink& sink, int* status, int timeout_ms, const char* content_type) {
+    return perform(url, method, body ? body->data() : nullptr, body ? body->length() : 0, &sink, status,
+                   timeout_ms, content_type);
+}
+
+esp_err_t HttpClient::request(esp_http_client_method_t method, const std::string& url, const char* body,
+                              size_t body_len, HttpSink& sink, int* status, int timeout_ms,
+                              const char* content_type) {
+    return perform(url, method, body, body_len, &sink, status, timeout_ms, content_type);
+}
+
+esp_err_t HttpClient::post_or_store(const std::string& url, const uint8_t* body, size_t body_len,
+                                    const char* content_type, FlashLog& store) {
+    if (store.empty()) {
+        DiscardSink sink;
+        int status = 0;
+        esp_err_t err = perform(url, HTTP_METHOD_POST, (const char*) body, body_len, &sink, &status, 0,
+                                content_type);
+        if (err == ESP_OK && status < 500) return ESP_OK;
+    }
+
+    // Record layout: [url length, 2 bytes][content type length][url][content type][body]
+    if (!content_type) content_type = DEFAULT_CONTENT_TYPE;
+    size_t ct_len = strlen(content_type);
+    if (url.size() > UINT16_MAX || ct_len > UINT8_MAX) return ESP_ERR_INVALID_ARG;
+    uint8_t header[3] = {(uint8_t) (url.size() & 0xFF), (uint8_t) (url.size() >> 8), (uint8_t) ct_len};
+    flash_log_part_t parts[] = {
+        {header, sizeof(header)},
+        {url.data(), url.size()},
+        {content_type, ct_len},
+        {body, body_len},
+    };
+    if (!store.append(parts, 4)) {
+        DLOGE(TAG, "POST to %s lost: offline store refused it", url.c_str());
+        return ESP_FAIL;
+    }
+    DLOGW(TAG, "POST to %s stored for later", url.c_str());
+    return ESP_OK;
+}
+
+size_t HttpClient::replay(FlashLog& store, size_t max_posts) {
+    struct ReplayCtx {
+        HttpClient* client;
+        std::string url;
+        std::string content_type;
+    } ctx = {this, {}, {}};
+
+    return store.replay([](const uint8_t* record, size_t len, void* arg) {
+        auto ctx = static_cast<ReplayCtx*>(arg);
+        if (len < 3) return true;   // Not ours, skip it
+        size_t url_len = record[0] | (record[1] << 8);
+        size_t ct_len = record[2];
+        if (3 + url_len + ct_len > len) return true;
+
+        ctx->url.assign((const char*) record + 3, url_len);
+        ctx->content_type.assign((const char*) record + 3 + url_len, ct_len);
+        const char* body = (const char*) record + 3 + url_len + ct_len;
+
+        DiscardSink sink;
+        int status = 0;
+        esp_err_t err = ctx->client->perform(ctx->url, HTTP_METHOD_POST, body, len - 3 - url_len - ct_len, &sink,
+                                             &status, 0, ctx->content_type.c_str());
+        return err == ESP_OK && status < 500;
+    }, &ctx, max_posts);
+}
+
+// The body grows in pool blocks and is copied once, at its final size, into the
+// returned string: one heap allocation however the server chunks it
+std::string HttpClient::get(const std::string& url) {
+    pool_string response_buffer;
+    PoolStringSink sink(response_buffer);
+    int status = 0;
+
+    esp_err_t err = perform(url, HTTP_METHOD_GET, nullptr, 0, &sink, &status);
+
+    if (err == ESP_OK) {
+        DLOGI(TAG, "HTTPS Status = %d", status);
+    } else {
+        DLOGE(TAG, "Error: %s", esp_err_to_name(err));
+    }
+
+    return std::string(response_buffer.data(), response_buffer.size());
+}
+
+std::string HttpClient::post(const std::string& url, const std::string& post_data, const char* content_type) {
+    pool_string response_buffer;
+    PoolStringSink sink(response_buffer);
+
+    esp_err_t err = perform(url, HTTP_METHOD_POST, post_data.data(), post_data.length(), &sink, nullptr, 0,
+                            content_type);
 
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
+        DLOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
     }
 
-    esp_http_client_cleanup(client);
-    return response_buffer;
+    return std::string(response_buffer.data(), response_buffer.size());
 }
 
-esp_err_t HttpClient::sendTelegramMessage(const std::string& token, const std::string& chat_id, const std::string& text) {
-    std::string url = "https://api.telegram.org/bot" + token + "/sendMessage";
-    
-    std::string payload = "{\"chat_id\": \"" + chat_id + "\", \"text\": \"" + text + "\"}";
+std::string HttpClient::telegramUrl(const std::string& token) {
+    return "https://api.telegram.org/bot" + token + "/sendMessage";
+}
+
+// Escape into a worst-case sized buffer so quotes, backslashes and newlines in text stay valid JSON
+template <typename String>
+static void append_json_escaped(String& out, const std::string& text) {
+    size_t start = out.size();
+    out.resize(start + text.size() * 6);
+    size_t n = json_escape(text.data(), text.size(), &out[start], text.size() * 6);
+    out.resize(start + n);
+}
 
-    esp_http_client_config_t config = {};
-    config.url = url.c_str();
-    config.method = HTTP_METHOD_POST;
-    config.crt_bundle_attach = esp_crt_bundle_attach; 
-    config.transport_type = HTTP_TRANSPORT_OVER_SSL;
+// Reserve for the worst-case escape so building the payload takes a single allocation
+template <typename String>
+static void build_telegram_payload(String& payload, const std::string& chat_id, const std::string& text) {
+    payload.reserve(32 + (chat_id.size() + text.size()) * 6);
+    payload += "{\"chat_id\": \"";
+    append_json_escaped(payload, chat_id);
+    payload += "\", \"text\": \"";
+    append_json_escaped(payload, text);
+    payload += "\"}";
+}
+
+std::string HttpClient::telegramPayload(const std::string& chat_id, const std::string& text) {
+    std::string payload;
+    build_telegram_payload(payload, chat_id, text);
+    return payload;
+}
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+esp_err_t HttpClient::sendTelegramMessage(const std::string& token, const std::string& chat_id, const std::string& text) {
+    std::string url = telegramUrl(token);
     
-    esp_http_client_set_post_field(client, payload.c_str(), payload.length());
-    esp_http_client_set_header(client, "Content-Type", "application/json");
+    pool_string payload;
+    build_telegram_payload(payload, chat_id, text);
 
-    esp_err_t err = esp_http_client_perform(client);
+    // Only the status is reported
+    DiscardSink sink;
+    int status = 0;
+    esp_err_t err = perform(url, HTTP_METHOD_POST, payload.data(), payload.length(), &sink, &status);
 
     if (err == ESP_OK) {
-        int status = esp_http_client_get_status_code(client);
-        ESP_LOGI(TAG, "Telegram sent! Status: %d", status);
+        DLOGI(TAG, "Telegram sent! Status: %d", status);
     } else {
-        ESP_LOGE(TAG, "Telegram failed: %s", esp_err_to_name(err));
+        DLOGE(TAG, "Telegram failed: %s", esp_err_to_name(err));
     }
 
-    esp_http_client_cleanup(client);
     return err;
 }
\ No newline at end of file
@@ -7,6 +7,26 @@
 #include "esp_http_client.h"
 #include "esp_log.h" 
 #include "esp_crt_bundle.h"
+#include "HttpSink.hpp"
+#include "HttpDeflate.hpp"
+
+class FlashLog;
+struct HttpCacheExchange;
+
+struct HttpCompressionConfig {
+    bool accept_encoding = true;                              // Ask for gzip/deflate and decode on the fly
+    http_encoding_t request_encoding = HTTP_ENCODING_NONE;    // Compress request bodies; the server must accept it
+    size_t min_request_bytes = 256;                           // Smaller bodies are sent as they are
+};
+
+typedef struct {
+    uint32_t responses_decoded;
+    uint64_t response_wire_bytes;    // Encoded bytes received for decoded responses
+    uint64_t response_body_bytes;    // Their size after decoding
+    uint32_t requests_encoded;
+    uint64_t request_body_bytes;     // Request bodies before compression
+    uint64_t request_wire_bytes;     // Their size as sent
+} http_compression_stats_t;
 
 class HttpClient {
 public:
@@ -15,11 +35,67 @@ public:
 
     std::string get(const std::string& url);
 
-    std::string post(const std::string& url, const std::string& post_data);
+    std::string post(const std::string& url, const std::string& post_data,
+                     const char* content_type = DEFAULT_CONTENT_TYPE);
+
+    // Streaming variants: the body goes to sink in fixed-size fragments, never buffered whole
+    esp_err_t get(const std::string& url, HttpSink& sink);
+
+    esp_err_t post(const std::string& url, const std::string& post_data, HttpSink& sink,
+                   const char* content_type = DEFAULT_CONTENT_TYPE);
+
+    // Binary bodies (e.g. CBOR from the Telemetry library) without a std::string copy
+    esp_err_t post(const std::string& url, const uint8_t* body, size_t body_len,
+                   const char* content_type, HttpSink& sink);
+
+    // Store-and-forward POST: sent now if nothing older is waiting in store and the
+    // server answers below 500, otherwise appended to store (already mounted) for
+    // replay(). ESP_OK means sent or stored.
+    esp_err_t post_or_store(const std::string& url, const uint8_t* body, size_t body_len,
+                            const char* content_type, FlashLog& store);
+
+    // Re-send stored POSTs oldest first, stopping at the first one that fails again
+    // (it stays stored). Returns the number sent.
+    size_t replay(FlashLog& store, size_t max_posts = SIZE_MAX);
+
+    // Generic request used by HttpRequestQueue; timeout_ms = 0 keeps the default timeout,
+    // content_type = nullptr sends DEFAULT_CONTENT_TYPE with a body
+    esp_err_t request(esp_http_client_method_t method, const std::string& url, const std::string* body,
+                      HttpSink& sink, int* status, int timeout_ms = 0, const char* content_type = nullptr);
+
+    esp_err_t request(esp_http_client_method_t method, const std::string& url, const char* body,
+                      size_t body_len, HttpSink& sink, int* status, int timeout_ms = 0,
+                      const char* content_type = nullptr);
+
+    static std::string telegramUrl(const std::string& token);
+
+    static std::string telegramPayload(const std::string& chat_id, const std::string& text);
 
     esp_err_t sendTelegramMessage(const std::string& token, const std::string& chat_id, const std::string& text);
 
+    static constexpr const char* DEFAULT_CONTENT_TYPE = "application/json";
+
+    // Process-wide: off until called. Set before requests start, not while they run.
+    static void set_compression(const HttpCompressionConfig& config);
+
+    static http_compression_stats_t compression_stats();
+
 private:
     static esp_err_t _http_event_handler(esp_http_client_event_t *evt);
+
+    static const int MAX_REDIRECTS = 3;
+    static const size_t HTTP_READ_WINDOW = 512;
+    static const int DEFAULT_TIMEOUT_MS = 5000;
+
+    esp_err_t open_request(esp_http_client_handle_t client, const char* body, size_t body_len,
+                           int64_t* content_length, bool* sent);
+
+    esp_err_t perform(const std::string& url, esp_http_client_method_t method,
+                      const char* body, size_t body_len, HttpSink* sink, int* status, int timeout_ms = 0,
+                      const char* content_type = nullptr, HttpCacheExchange* exchange = nullptr);
+
+    esp_err_t perform_cached(const std::string& url, HttpSink* sink, int* status, int timeout_ms);
+
+    static HttpCompressionConfig _compression;
     static const char* TAG;
 };
\ No newline at end of file
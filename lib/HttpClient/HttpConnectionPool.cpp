@@ -0,0 +1,122 @@
+#include "HttpConnectionPool.hpp"
+#include "esp_crt_bundle.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char* TAG = "HTTP_POOL";
+
+HttpConnectionPool& HttpConnectionPool::instance() {
+    static HttpConnectionPool pool;
+    return pool;
+}
+
+HttpConnectionPool::HttpConnectionPool() {
+    _lock = xSemaphoreCreateMutex();
+}
+
+// "https://api.telegram.org/bot.../sendMessage" -> "https://api.telegram.org"
+std::string HttpConnectionPool::host_key(const std::string& url) {
+    size_t scheme_end = url.find("://");
+    size_t host_start = scheme_end == std::string::npos ? 0 : scheme_end + 3;
+    size_t host_end = url.find_first_of("/?#", host_start);
+    return url.substr(0, host_end);
+}
+
+esp_http_client_handle_t HttpConnectionPool::acquire(const std::string& url, http_event_handle_cb handler, bool* reused) {
+    std::string key = host_key(url);
+    int64_t now = esp_timer_get_time();
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    evict_idle_locked(now);
+    for (auto& e : _entries) {
+        if (!e.in_use && e.host_key == key) {
+            e.in_use = true;
+            *reused = true;
+            esp_http_client_handle_t client = e.client;
+            xSemaphoreGive(_lock);
+            esp_http_client_set_url(client, url.c_str());
+            return client;
+        }
+    }
+    xSemaphoreGive(_lock);
+
+    esp_http_client_config_t config = {};
+    config.url = url.c_str();
+    config.event_handler = handler;
+    config.crt_bundle_attach = esp_crt_bundle_attach;
+    config.keep_alive_enable = true;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    config.save_client_session = true;
+#endif
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return nullptr;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _entries.push_back({key, client, now, true});
+    xSemaphoreGive(_lock);
+    *reused = false;
+    return client;
+}
+
+void HttpConnectionPool::release(esp_http_client_handle_t client, bool keep_open) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    for (size_t i = 0; i < _entries.size(); i++) {
+        Entry& e = _entries[i];
+        if (e.client != client) continue;
+
+        size_t idle_same_host = 0;
+        for (auto& other : _entries) {
+            if (!other.in_use && other.host_key == e.host_key) idle_same_host++;
+        }
+        if (keep_open && idle_same_host < _max_idle_per_host) {
+            e.in_use = false;
+            e.last_used_us = esp_timer_get_time();
+        } else {
+            esp_http_client_cleanup(client);
+            _entries.erase(_entries.begin() + i);
+        }
+        break;
+    }
+    xSemaphoreGive(_lock);
+}
+
+void HttpConnectionPool::record(int64_t latency_us, bool reused) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _stats.requests++;
+    if (reused) _stats.reused++;
+    _stats.total_latency_us += latency_us;
+    xSemaphoreGive(_lock);
+}
+
+void HttpConnectionPool::record_handshake() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _stats.handshakes++;
+    xSemaphoreGive(_lock);
+}
+
+void HttpConnectionPool::evict_idle() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    evict_idle_locked(esp_timer_get_time());
+    xSemaphoreGive(_lock);
+}
+
+void HttpConnectionPool::evict_idle_locked(int64_t now) {
+    for (size_t i = 0; i < _entries.size();) {
+        Entry& e = _entries[i];
+        if (!e.in_use && now - e.last_used_us > _idle_timeout_us) {
+            ESP_LOGD(TAG, "Closing idle connection to %s", e.host_key.c_str());
+            esp_http_client_cleanup(e.client);
+            _entries.erase(_entries.begin() + i);
+            _stats.evicted++;
+        } else {
+            i++;
+        }
+    }
+}
+
+http_pool_stats_t HttpConnectionPool::stats() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    http_pool_stats_t s = _stats;
+    xSemaphoreGive(_lock);
+    return s;
+}
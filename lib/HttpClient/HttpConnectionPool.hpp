@@ -0,0 +1,60 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_http_client.h"
+#ifdef __cplusplus
+#include <string>
+#endif
+#include <vector>
+
+typedef struct {
+    uint32_t requests;
+    uint32_t handshakes;     // New TCP/TLS connections established
+    uint32_t reused;         // Requests served on an already open handle
+    uint32_t evicted;        // Handles closed for idling too long
+    int64_t total_latency_us;
+} http_pool_stats_t;
+
+// Process-wide pool of keep-alive esp_http_client handles, keyed by scheme://host:port.
+// Handles keep their TLS connection (and session ticket when enabled) between requests,
+// so back-to-back requests to one host skip the handshake.
+class HttpConnectionPool {
+public:
+    static HttpConnectionPool& instance();
+
+    // Borrow a handle for url; reused is set when the handle already served a request
+    esp_http_client_handle_t acquire(const std::string& url, http_event_handle_cb handler, bool* reused);
+
+    // Return a handle; keep_open = false closes it instead of pooling it
+    void release(esp_http_client_handle_t client, bool keep_open);
+
+    void record(int64_t latency_us, bool reused);
+    void record_handshake();
+
+    void set_idle_timeout_ms(uint32_t ms) { _idle_timeout_us = (int64_t) ms * 1000; }
+    void set_max_idle_per_host(size_t n) { _max_idle_per_host = n; }
+
+    // Close handles idle for longer than the idle timeout
+    void evict_idle();
+
+    http_pool_stats_t stats();
+
+private:
+    HttpConnectionPool();
+
+    struct Entry {
+        std::string host_key;
+        esp_http_client_handle_t client;
+        int64_t last_used_us;
+        bool in_use;
+    };
+
+    std::vector<Entry> _entries;
+    SemaphoreHandle_t _lock;
+    http_pool_stats_t _stats = {};
+    int64_t _idle_timeout_us = 30 * 1000 * 1000;
+    size_t _max_idle_per_host = 2;
+
+    static std::string host_key(const std::string& url);
+    void evict_idle_locked(int64_t now);
+};
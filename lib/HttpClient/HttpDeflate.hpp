@@ -0,0 +1,317 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+typedef enum {
+    HTTP_ENCODING_NONE,
+    HTTP_ENCODING_GZIP,       // RFC 1952 framing around deflate data
+    HTTP_ENCODING_DEFLATE,    // RFC 1950 (zlib) framing; raw deflate is accepted on receive
+    HTTP_ENCODING_UNSUPPORTED,
+} http_encoding_t;
+
+// Content-Encoding value to encoding; "identity" and empty mean none
+inline http_encoding_t http_parse_content_encoding(const char* value) {
+    if (!value) return HTTP_ENCODING_NONE;
+    while (*value == ' ' || *value == '\t') value++;
+    size_t n = strlen(value);
+    while (n > 0 && (value[n - 1] == ' ' || value[n - 1] == '\t')) n--;
+    if (n == 0 || (n == 8 && strncasecmp(value, "identity", 8) == 0)) return HTTP_ENCODING_NONE;
+    if ((n == 4 && strncasecmp(value, "gzip", 4) == 0) || (n == 6 && strncasecmp(value, "x-gzip", 6) == 0)) {
+        return HTTP_ENCODING_GZIP;
+    }
+    if (n == 7 && strncasecmp(value, "deflate", 7) == 0) return HTTP_ENCODING_DEFLATE;
+    return HTTP_ENCODING_UNSUPPORTED;
+}
+
+inline const char* http_encoding_name(http_encoding_t encoding) {
+    return encoding == HTTP_ENCODING_GZIP ? "gzip" : encoding == HTTP_ENCODING_DEFLATE ? "deflate" : nullptr;
+}
+
+struct HttpCrc32Table {
+    uint32_t entry[256];
+
+    constexpr HttpCrc32Table() : entry() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entry[i] = c;
+        }
+    }
+};
+
+// CRC-32 as used by gzip; start with 0 and pass the previous result to continue
+inline uint32_t http_crc32(uint32_t crc, const void* data, size_t len) {
+    static constexpr HttpCrc32Table table;
+    const uint8_t* p = (const uint8_t*) data;
+    crc = ~crc;
+    while (len--) crc = table.entry[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Adler-32 as used by zlib; start with 1
+inline uint32_t http_adler32(uint32_t adler, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*) data;
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (len > 0) {
+        size_t n = len < 5552 ? len : 5552;   // Largest run before the sums can overflow
+        len -= n;
+        while (n--) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+// Reads a gzip member header (with its optional extra, name, comment and CRC
+// fields) as it arrives in fragments of any size
+class GzipHeaderParser {
+public:
+    void reset() {
+        _state = FIXED;
+        _got = 0;
+    }
+
+    // Returns the bytes consumed; stops at the first byte of deflate data
+    size_t feed(const uint8_t* data, size_t len) {
+        size_t used = 0;
+        while (used < len && _state != DONE && _state != FAILED) {
+            uint8_t b = data[used++];
+            switch (_state) {
+                case FIXED:
+                    _fixed[_got++] = b;
+                    if (_got == sizeof(_fixed)) {
+                        // Magic, CM = 8 (deflate) and no reserved flag bits
+                        if (_fixed[0] != 0x1F || _fixed[1] != 0x8B || _fixed[2] != 8 || (_fixed[3] & 0xE0)) {
+                            _state = FAILED;
+                        } else {
+                            next_field();
+                        }
+                    }
+                    break;
+                case XLEN:
+                    _need |= (uint16_t) (b << (8 * _got));
+                    if (++_got == 2) next_field();
+                    break;
+                case EXTRA:
+                case HCRC:
+                    if (--_need == 0) next_field();
+                    break;
+                case NAME:
+                case COMMENT:
+                    if (b == 0) next_field();
+                    break;
+                default:
+                    break;
+            }
+        }
+        return used;
+    }
+
+    bool done() const { return _state == DONE; }
+    bool failed() const { return _state == FAILED; }
+
+private:
+    enum State { FIXED, XLEN, EXTRA, NAME, COMMENT, HCRC, DONE, FAILED };
+
+    static const uint8_t FHCRC = 0x02, FEXTRA = 0x04, FNAME = 0x08, FCOMMENT = 0x10;
+
+    State _state = FIXED;
+    uint8_t _fixed[10];
+    size_t _got = 0;
+    uint16_t _need = 0;
+
+    // Skip to the next field the flags say is present
+    void next_field() {
+        uint8_t flags = _fixed[3];
+        for (;;) {
+            _state = (State) (_state + 1);
+            _got = 0;
+            switch (_state) {
+                case XLEN:
+                    _need = 0;
+                    if (flags & FEXTRA) return;
+                    break;
+                case EXTRA:
+                    if ((flags & FEXTRA) && _need) return;
+                    break;
+                case NAME:
+                    if (flags & FNAME) return;
+                    break;
+                case COMMENT:
+                    if (flags & FCOMMENT) return;
+                    break;
+                case HCRC:
+                    _need = 2;
+                    if (flags & FHCRC) return;
+                    break;
+                default:
+                    return;
+            }
+        }
+    }
+};
+
+// Positions remembered by the deflater's match finder; the caller provides
+// (and zeroes) the table so its memory comes from wherever suits the target
+static const size_t HTTP_DEFLATE_HASH_BITS = 11;
+static const size_t HTTP_DEFLATE_HASH_SIZE = (size_t) 1 << HTTP_DEFLATE_HASH_BITS;
+
+// Compresses a request body held in memory as one fixed-Huffman deflate block
+// with greedy LZ77 matching over the whole 32 KB window, framed as gzip or zlib.
+// Meant for small JSON and text payloads: no dynamic Huffman tables, so the
+// only working memory is the hash table. Writes at most out_cap bytes and
+// returns false when the result would not fit, i.e. when compressing does not pay.
+class HttpDeflater {
+public:
+    static bool compress(const uint8_t* in, size_t len, http_encoding_t encoding, uint8_t* out, size_t out_cap,
+                         size_t* out_len, uint32_t* hash) {
+        if (encoding != HTTP_ENCODING_GZIP && encoding != HTTP_ENCODING_DEFLATE) return false;
+        BitWriter w(out, out_cap);
+
+        if (encoding == HTTP_ENCODING_GZIP) {
+            // No name or timestamp; OS = unknown
+            static const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+            for (uint8_t b : header) w.byte(b);
+        } else {
+            w.byte(0x78);   // 32 KB window, deflate
+            w.byte(0x01);   // Fastest level, header check bits
+        }
+
+        w.bits(1, 1);   // BFINAL
+        w.bits(1, 2);   // BTYPE = fixed Huffman
+
+        size_t i = 0;
+        while (i + MIN_MATCH <= len && !w.overflow()) {
+            uint32_t* slot = &hash[hash3(in + i)];
+            size_t candidate = *slot;   // Position + 1, 0 = empty
+            *slot = (uint32_t) (i + 1);
+
+            size_t match = 0;
+            if (candidate && i - (candidate - 1) <= MAX_DISTANCE) {
+                const uint8_t* a = in + candidate - 1;
+                const uint8_t* b = in + i;
+                size_t limit = len - i < MAX_MATCH ? len - i : MAX_MATCH;
+                while (match < limit && a[match] == b[match]) match++;
+            }
+
+            if (match >= MIN_MATCH) {
+                put_match(w, match, i - (candidate - 1));
+                // Index the positions inside the match so later repeats find them
+                for (size_t k = i + 1; k < i + match && k + MIN_MATCH <= len; k++) {
+                    hash[hash3(in + k)] = (uint32_t) (k + 1);
+                }
+                i += match;
+            } else {
+                put_literal(w, in[i]);
+                i++;
+            }
+        }
+        while (i < len && !w.overflow()) put_literal(w, in[i++]);
+        put_symbol(w, 256);   // End of block
+        w.align();
+
+        if (encoding == HTTP_ENCODING_GZIP) {
+            w.le32(http_crc32(0, in, len));
+            w.le32((uint32_t) len);
+        } else {
+            uint32_t adler = http_adler32(1, in, len);
+            for (int shift = 24; shift >= 0; shift -= 8) w.byte((uint8_t) (adler >> shift));
+        }
+
+        if (w.overflow()) return false;
+        *out_len = w.size();
+        return true;
+    }
+
+private:
+    static const size_t MIN_MATCH = 3;
+    static const size_t MAX_MATCH = 258;
+    static const size_t MAX_DISTANCE = 32768;
+
+    // Deflate packs bits from the least significant end; Huffman codes go most significant bit first
+    class BitWriter {
+    public:
+        BitWriter(uint8_t* out, size_t cap) : _out(out), _cap(cap) {}
+
+        void bits(uint32_t value, int count) {
+            _acc |= value << _count;
+            _count += count;
+            while (_count >= 8) {
+                byte((uint8_t) _acc);
+                _acc >>= 8;
+                _count -= 8;
+            }
+        }
+
+        void code(uint32_t value, int count) {
+            uint32_t reversed = 0;
+            for (int k = 0; k < count; k++) reversed |= ((value >> k) & 1) << (count - 1 - k);
+            bits(reversed, count);
+        }
+
+        void align() {
+            if (_count > 0) bits(0, 8 - _count);
+        }
+
+        void byte(uint8_t b) {
+            if (_pos < _cap) _out[_pos++] = b;
+            else _overflow = true;
+        }
+
+        void le32(uint32_t v) {
+            for (int k = 0; k < 4; k++) byte((uint8_t) (v >> (8 * k)));
+        }
+
+        bool overflow() const { return _overflow; }
+        size_t size() const { return _pos; }
+
+    private:
+        uint8_t* _out;
+        size_t _cap;
+        size_t _pos = 0;
+        uint32_t _acc = 0;
+        int _count = 0;
+        bool _overflow = false;
+    };
+
+    static uint32_t hash3(const uint8_t* p) {
+        uint32_t v = (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16);
+        return (v * 2654435761u) >> (32 - HTTP_DEFLATE_HASH_BITS);
+    }
+
+    // Fixed literal/length code (RFC 1951 3.2.6)
+    static void put_symbol(BitWriter& w, uint32_t sym) {
+        if (sym < 144) w.code(0x30 + sym, 8);
+        else if (sym < 256) w.code(0x190 + sym - 144, 9);
+        else if (sym < 280) w.code(sym - 256, 7);
+        else w.code(0xC0 + sym - 280, 8);
+    }
+
+    static void put_literal(BitWriter& w, uint8_t b) { put_symbol(w, b); }
+
+    static void put_match(BitWriter& w, size_t length, size_t distance) {
+        static const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const uint16_t DIST_BASE[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                               33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                               1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+
+        size_t lc = 28;
+        while (LENGTH_BASE[lc] > length) lc--;
+        put_symbol(w, 257 + (uint32_t) lc);
+        if (LENGTH_EXTRA[lc]) w.bits((uint32_t) (length - LENGTH_BASE[lc]), LENGTH_EXTRA[lc]);
+
+        size_t dc = 29;
+        while (DIST_BASE[dc] > distance) dc--;
+        w.code((uint32_t) dc, 5);
+        int extra = dc < 4 ? 0 : (int) (dc / 2 - 1);
+        if (extra) w.bits((uint32_t) (distance - DIST_BASE[dc]), extra);
+    }
+};
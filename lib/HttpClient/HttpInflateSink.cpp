@@ -0,0 +1,138 @@
+#include "HttpInflateSink.hpp"
+#include "esp_heap_caps.h"
+#include "esp_http_client.h"
+#include "rom/miniz.h"
+
+struct HttpInflateSink::State {
+    tinfl_decompressor inflator;
+    uint8_t window[TINFL_LZ_DICT_SIZE];
+};
+
+HttpInflateSink::~HttpInflateSink() {
+    heap_caps_free(_state);
+}
+
+esp_err_t HttpInflateSink::begin(int status, int64_t content_length) {
+    if (!_state) {
+        _state = (State*) heap_caps_malloc_prefer(sizeof(State), 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT,
+                                                  MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!_state) return ESP_ERR_NO_MEM;
+    }
+    tinfl_init(&_state->inflator);
+    _gzip.reset();
+    _phase = _encoding == HTTP_ENCODING_GZIP ? PHASE_HEADER : PHASE_PROBE;
+    _bytes_len = 0;
+    _flags = TINFL_FLAG_HAS_MORE_INPUT;
+    _window_pos = 0;
+    _crc = 0;
+    _encoded = 0;
+    _decoded = 0;
+    return _inner->begin(status, -1);
+}
+
+esp_err_t HttpInflateSink::write(const char* data, size_t len) {
+    const uint8_t* p = (const uint8_t*) data;
+    _encoded += len;
+    while (len > 0) {
+        size_t used = 0;
+        esp_err_t err = ESP_OK;
+        switch (_phase) {
+            case PHASE_HEADER:
+                used = _gzip.feed(p, len);
+                if (_gzip.failed()) return ESP_ERR_INVALID_RESPONSE;
+                if (_gzip.done()) _phase = PHASE_BODY;
+                break;
+            case PHASE_PROBE:
+                // "deflate" should be zlib framed, but some servers send raw
+                // deflate: a valid zlib header (CM = 8, check bits) tells them apart
+                _bytes[_bytes_len++] = *p;
+                used = 1;
+                if (_bytes_len == 2) {
+                    if ((_bytes[0] & 0x0F) == 8 && ((_bytes[0] << 8) | _bytes[1]) % 31 == 0) {
+                        _flags |= TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32;
+                    }
+                    _phase = PHASE_BODY;
+                    size_t probe_used = 0;
+                    err = inflate(_bytes, 2, &probe_used);
+                    _bytes_len = 0;
+                }
+                break;
+            case PHASE_BODY:
+                err = inflate(p, len, &used);
+                break;
+            case PHASE_TRAILER:
+                while (used < len && _bytes_len < 8) _bytes[_bytes_len++] = p[used++];
+                if (_bytes_len == 8) err = check_trailer();
+                break;
+            case PHASE_DONE:
+                used = len;   // Anything after the stream is ignored
+                break;
+        }
+        if (err != ESP_OK) return err;
+        p += used;
+        len -= used;
+    }
+    return ESP_OK;
+}
+
+// Run the inflater over in until it needs more input or the stream ends; the
+// window fills from the front and wraps, handing each decoded run to emit()
+esp_err_t HttpInflateSink::inflate(const uint8_t* in, size_t len, size_t* used) {
+    size_t consumed = 0;
+    for (;;) {
+        size_t in_bytes = len - consumed;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - _window_pos;
+        tinfl_status status = tinfl_decompress(&_state->inflator, in + consumed, &in_bytes, _state->window,
+                                               _state->window + _window_pos, &out_bytes, _flags);
+        consumed += in_bytes;
+        if (out_bytes > 0) {
+            esp_err_t err = emit(_state->window + _window_pos, out_bytes);
+            if (err != ESP_OK) return err;
+            _window_pos = (_window_pos + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+
+        if (status == TINFL_STATUS_DONE) {
+            _phase = _encoding == HTTP_ENCODING_GZIP ? PHASE_TRAILER : PHASE_DONE;
+            break;
+        }
+        if (status == TINFL_STATUS_ADLER32_MISMATCH) return ESP_ERR_INVALID_CRC;
+        if (status < 0) return ESP_ERR_INVALID_RESPONSE;
+        if (in_bytes == 0 && out_bytes == 0 && consumed < len) return ESP_ERR_INVALID_RESPONSE;
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) break;
+    }
+    *used = consumed;
+    return ESP_OK;
+}
+
+esp_err_t HttpInflateSink::emit(const uint8_t* data, size_t len) {
+    if (_encoding == HTTP_ENCODING_GZIP) _crc = http_crc32(_crc, data, len);
+    _decoded += len;
+    for (size_t off = 0; off < len; off += FRAGMENT) {
+        size_t n = len - off < FRAGMENT ? len - off : FRAGMENT;
+        esp_err_t err = _inner->write((const char*) data + off, n);
+        if (err != ESP_OK) return err;
+    }
+    return ESP_OK;
+}
+
+// CRC-32 and size mod 2^32 of the decoded data, both little-endian
+esp_err_t HttpInflateSink::check_trailer() {
+    uint32_t crc = _bytes[0] | (_bytes[1] << 8) | (_bytes[2] << 16) | ((uint32_t) _bytes[3] << 24);
+    uint32_t isize = _bytes[4] | (_bytes[5] << 8) | (_bytes[6] << 16) | ((uint32_t) _bytes[7] << 24);
+    if (crc != _crc) return ESP_ERR_INVALID_CRC;
+    if (isize != (uint32_t) _decoded) return ESP_ERR_INVALID_SIZE;
+    _phase = PHASE_DONE;
+    return ESP_OK;
+}
+
+esp_err_t HttpInflateSink::finish() const {
+    if (_encoded == 0 || _phase == PHASE_DONE) return ESP_OK;
+    return ESP_ERR_HTTP_INCOMPLETE_DATA;
+}
+
+// The window goes back as soon as the body is done, not when the sink goes out of scope
+void HttpInflateSink::end(esp_err_t result) {
+    heap_caps_free(_state);
+    _state = nullptr;
+    _inner->end(result);
+}
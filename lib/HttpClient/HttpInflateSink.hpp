@@ -0,0 +1,53 @@
+#pragma once
+#include "HttpDeflate.hpp"
+#include "HttpSink.hpp"
+
+// Decodes a gzip or deflate response body as it streams in and hands the
+// result to the inner sink in fragments of at most FRAGMENT bytes, so the whole
+// body is never held in either form. Working memory is the ROM inflater's state
+// plus its 32 KB window (about 43 KB, in PSRAM when present), taken in begin()
+// and given back in end() whatever the body size.
+class HttpInflateSink : public HttpSink {
+public:
+    HttpInflateSink(HttpSink* inner, http_encoding_t encoding) : _inner(inner), _encoding(encoding) {}
+    ~HttpInflateSink();
+
+    HttpInflateSink(const HttpInflateSink&) = delete;
+    HttpInflateSink& operator=(const HttpInflateSink&) = delete;
+
+    // The inner sink sees content_length -1: the decoded size is not known up front
+    esp_err_t begin(int status, int64_t content_length) override;
+    esp_err_t write(const char* data, size_t len) override;
+    void end(esp_err_t result) override;
+
+    // Call after the last write(): ESP_OK if the stream was complete (or the
+    // response had no body), ESP_ERR_HTTP_INCOMPLETE_DATA if it was cut short
+    esp_err_t finish() const;
+
+    size_t encoded_bytes() const { return _encoded; }
+    size_t decoded_bytes() const { return _decoded; }
+
+    static const size_t FRAGMENT = 512;
+
+private:
+    enum Phase { PHASE_HEADER, PHASE_PROBE, PHASE_BODY, PHASE_TRAILER, PHASE_DONE };
+
+    struct State;   // Inflater and window; defined with the ROM header in the .cpp
+
+    HttpSink* _inner;
+    http_encoding_t _encoding;
+    State* _state = nullptr;
+    Phase _phase = PHASE_HEADER;
+    GzipHeaderParser _gzip;
+    uint8_t _bytes[8];        // First two bytes of a deflate body, or the gzip trailer
+    size_t _bytes_len = 0;
+    uint32_t _flags = 0;
+    size_t _window_pos = 0;
+    uint32_t _crc = 0;
+    size_t _encoded = 0;
+    size_t _decoded = 0;
+
+    esp_err_t inflate(const uint8_t* in, size_t len, size_t* used);
+    esp_err_t emit(const uint8_t* data, size_t len);
+    esp_err_t check_trailer();
+};
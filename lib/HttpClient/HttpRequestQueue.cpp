@@ -0,0 +1,226 @@
+#include <algorithm>
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "HttpRequestQueue.hpp"
+
+static const char* TAG = "HTTP_QUEUE";
+
+// Forwards to the real sink until the request is cancelled, then aborts the transfer
+class CancellableSink : public HttpSink {
+public:
+    CancellableSink(HttpSink& inner, const std::atomic<bool>& cancelled)
+        : _inner(inner), _cancelled(cancelled) {}
+
+    esp_err_t begin(int status, int64_t content_length) override {
+        if (_cancelled.load()) return HTTP_REQUEST_CANCELLED;
+        return _inner.begin(status, content_length);
+    }
+
+    esp_err_t write(const char* data, size_t len) override {
+        if (_cancelled.load()) return HTTP_REQUEST_CANCELLED;
+        return _inner.write(data, len);
+    }
+
+    void end(esp_err_t result) override { _inner.end(result); }
+
+private:
+    HttpSink& _inner;
+    const std::atomic<bool>& _cancelled;
+};
+
+HttpRequestQueue::HttpRequestQueue(size_t workers, uint32_t stack_size,
+                                   UBaseType_t task_priority, size_t max_pending)
+    : _workers(workers), _max_pending(max_pending) {
+    _lock = xSemaphoreCreateMutex();
+    _available = xSemaphoreCreateCounting(max_pending + workers, 0);
+    _exited = xSemaphoreCreateCounting(workers, 0);
+    _heap.reserve(max_pending);
+
+    for (size_t i = 0; i < workers; i++) {
+        xTaskCreate(worker_task, "http_worker", stack_size, this, task_priority, nullptr);
+    }
+}
+
+// Fail everything still queued, then wait for the workers to finish their current request
+HttpRequestQueue::~HttpRequestQueue() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _stopping = true;
+    std::vector<Job> leftover;
+    leftover.swap(_heap);
+    for (auto& r : _running) r.second->store(true);
+    xSemaphoreGive(_lock);
+
+    for (auto& job : leftover) {
+        HttpResponse response;
+        response.err = HTTP_REQUEST_CANCELLED;
+        complete(job, response);
+    }
+    for (size_t i = 0; i < _workers; i++) xSemaphoreGive(_available);
+    for (size_t i = 0; i < _workers; i++) xSemaphoreTake(_exited, portMAX_DELAY);
+
+    vSemaphoreDelete(_exited);
+    vSemaphoreDelete(_available);
+    vSemaphoreDelete(_lock);
+}
+
+// Heap order: higher priority first, then FIFO within a priority
+bool HttpRequestQueue::job_less(const Job& a, const Job& b) {
+    if (a.request.priority != b.request.priority) return a.request.priority < b.request.priority;
+    return a.seq > b.seq;
+}
+
+uint32_t HttpRequestQueue::submit(HttpRequest request) {
+    int64_t now = esp_timer_get_time();
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_stopping || _heap.size() >= _max_pending) {
+        _stats.rejected++;
+        xSemaphoreGive(_lock);
+        ESP_LOGW(TAG, "Request queue full, rejecting %s", request.url.c_str());
+        return 0;
+    }
+
+    Job job;
+    job.id = _next_id++;
+    if (_next_id == 0) _next_id = 1;
+    job.seq = _next_seq++;
+    job.deadline_us = request.timeout_ms ? now + (int64_t) request.timeout_ms * 1000 : 0;
+    job.cancelled = std::make_shared<std::atomic<bool>>(false);
+    job.request = std::move(request);
+    uint32_t id = job.id;
+
+    _heap.push_back(std::move(job));
+    std::push_heap(_heap.begin(), _heap.end(), job_less);
+    _stats.submitted++;
+    if (_heap.size() > _stats.peak_pending) _stats.peak_pending = _heap.size();
+    xSemaphoreGive(_lock);
+
+    xSemaphoreGive(_available);
+    return id;
+}
+
+std::future<HttpResponse> HttpRequestQueue::submit_future(HttpRequest request) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> future = promise->get_future();
+    HttpCompletion user_cb = std::move(request.on_complete);
+    request.on_complete = [promise, user_cb](const HttpResponse& response) {
+        if (user_cb) user_cb(response);
+        promise->set_value(response);
+    };
+
+    if (submit(std::move(request)) == 0) {
+        HttpResponse response;
+        response.err = ESP_ERR_NO_MEM;
+        promise->set_value(response);
+    }
+    return future;
+}
+
+bool HttpRequestQueue::cancel(uint32_t id) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    for (auto& job : _heap) {
+        if (job.id == id) {
+            job.cancelled->store(true);
+            xSemaphoreGive(_lock);
+            return true;
+        }
+    }
+    for (auto& r : _running) {
+        if (r.first == id) {
+            r.second->store(true);
+            xSemaphoreGive(_lock);
+            return true;
+        }
+    }
+    xSemaphoreGive(_lock);
+    return false;
+}
+
+size_t HttpRequestQueue::pending() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    size_t n = _heap.size();
+    xSemaphoreGive(_lock);
+    return n;
+}
+
+http_queue_stats_t HttpRequestQueue::stats() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    http_queue_stats_t s = _stats;
+    xSemaphoreGive(_lock);
+    return s;
+}
+
+void HttpRequestQueue::complete(Job& job, HttpResponse& response) {
+    if (job.request.on_complete) job.request.on_complete(response);
+}
+
+// Execute one job; deadline and cancellation are checked before touching the network
+void HttpRequestQueue::run(Job& job, HttpClient& http) {
+    HttpResponse response;
+    int64_t remaining_ms = 0;
+    if (job.deadline_us) {
+        remaining_ms = (job.deadline_us - esp_timer_get_time()) / 1000;
+    }
+
+    if (job.cancelled->load()) {
+        response.err = HTTP_REQUEST_CANCELLED;
+    } else if (job.deadline_us && remaining_ms <= 0) {
+        response.err = ESP_ERR_TIMEOUT;
+    } else {
+        StringSink string_sink(response.body);
+        HttpSink& target = job.request.sink ? *job.request.sink : (HttpSink&) string_sink;
+        CancellableSink sink(target, *job.cancelled);
+        const std::string* body = job.request.body.empty() ? nullptr : &job.request.body;
+        response.err = http.request(job.request.method, job.request.url, body, sink,
+                                    &response.status, (int) remaining_ms, job.request.content_type);
+    }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (response.err == ESP_OK) _stats.completed++;
+    else if (response.err == HTTP_REQUEST_CANCELLED) _stats.cancelled++;
+    else if (response.err == ESP_ERR_TIMEOUT) _stats.timed_out++;
+    else _stats.failed++;
+    xSemaphoreGive(_lock);
+
+    complete(job, response);
+}
+
+void HttpRequestQueue::worker_task(void* arg) {
+    HttpRequestQueue* queue = (HttpRequestQueue*) arg;
+    HttpClient http;
+
+    while (true) {
+        xSemaphoreTake(queue->_available, portMAX_DELAY);
+
+        xSemaphoreTake(queue->_lock, portMAX_DELAY);
+        if (queue->_stopping) {
+            xSemaphoreGive(queue->_lock);
+            break;
+        }
+        if (queue->_heap.empty()) {
+            xSemaphoreGive(queue->_lock);
+            continue;
+        }
+        std::pop_heap(queue->_heap.begin(), queue->_heap.end(), job_less);
+        Job job = std::move(queue->_heap.back());
+        queue->_heap.pop_back();
+        queue->_running.push_back({job.id, job.cancelled});
+        queue->_stats.in_flight++;
+        xSemaphoreGive(queue->_lock);
+
+        queue->run(job, http);
+
+        xSemaphoreTake(queue->_lock, portMAX_DELAY);
+        queue->_stats.in_flight--;
+        for (size_t i = 0; i < queue->_running.size(); i++) {
+            if (queue->_running[i].first == job.id) {
+                queue->_running.erase(queue->_running.begin() + i);
+                break;
+            }
+        }
+        xSemaphoreGive(queue->_lock);
+    }
+
+    xSemaphoreGive(queue->_exited);
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#ifdef __cplusplus
+#include <string>
+#endif
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+#include "HttpClient.hpp"
+
+// Completion status for cancelled requests, pending or mid-transfer. A code of
+// our own past the esp_http_client ones, so it never reads as a driver error.
+#define HTTP_REQUEST_CANCELLED (ESP_ERR_HTTP_BASE + 0x80)
+
+typedef enum {
+    HTTP_PRIORITY_LOW = 0,
+    HTTP_PRIORITY_NORMAL,
+    HTTP_PRIORITY_HIGH,
+} http_priority_t;
+
+struct HttpResponse {
+    esp_err_t err = ESP_OK;
+    int status = 0;
+    std::string body;
+};
+
+typedef std::function<void(const HttpResponse&)> HttpCompletion;
+
+struct HttpRequest {
+    std::string url;
+    esp_http_client_method_t method = HTTP_METHOD_GET;
+    std::string body;
+    const char* content_type = nullptr;  // Body type, nullptr = application/json
+    http_priority_t priority = HTTP_PRIORITY_NORMAL;
+    uint32_t timeout_ms = 0;           // Deadline from submit to completion, 0 = client default
+    HttpSink* sink = nullptr;          // Optional: stream the body here instead of HttpResponse::body
+    HttpCompletion on_complete;        // Runs on the worker task
+};
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t failed;
+    uint32_t cancelled;
+    uint32_t timed_out;
+    uint32_t rejected;      // Queue was full
+    uint32_t peak_pending;
+    uint32_t in_flight;
+} http_queue_stats_t;
+
+// Asynchronous request engine: requests wait in a priority queue and a fixed
+// pool of worker tasks executes them, so fire-and-forget calls share a few
+// stacks instead of spawning one task each.
+class HttpRequestQueue {
+public:
+    HttpRequestQueue(size_t workers = 2, uint32_t stack_size = 6144,
+                     UBaseType_t task_priority = 5, size_t max_pending = 16);
+    ~HttpRequestQueue();
+
+    HttpRequestQueue(const HttpRequestQueue&) = delete;
+    HttpRequestQueue& operator=(const HttpRequestQueue&) = delete;
+
+    // Returns a request id, or 0 if the queue is full
+    uint32_t submit(HttpRequest request);
+
+    std::future<HttpResponse> submit_future(HttpRequest request);
+
+    // Pending requests complete with HTTP_REQUEST_CANCELLED; a running transfer is aborted
+    bool cancel(uint32_t id);
+
+    size_t pending();
+
+    http_queue_stats_t stats();
+
+private:
+    struct Job {
+        uint32_t id;
+        uint32_t seq;
+        int64_t deadline_us;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        HttpRequest request;
+    };
+
+    static bool job_less(const Job& a, const Job& b);
+
+    std::vector<Job> _heap;
+    std::vector<std::pair<uint32_t, std::shared_ptr<std::atomic<bool>>>> _running;
+    SemaphoreHandle_t _lock;
+    SemaphoreHandle_t _available;
+    SemaphoreHandle_t _exited;
+    size_t _workers;
+    size_t _max_pending;
+    uint32_t _next_id = 1;
+    uint32_t _next_seq = 0;
+    volatile bool _stopping = false;
+    http_queue_stats_t _stats = {};
+
+    void run(Job& job, HttpClient& http);
+    static void complete(Job& job, HttpResponse& response);
+    static void worker_task(void* arg);
+};
@@ -0,0 +1,30 @@
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "HttpSink.hpp"
+
+// Prefer PSRAM so large download buffers stay out of internal SRAM
+BufferSink::BufferSink(size_t capacity) : _cap(capacity), _owned(true) {
+    _buf = (char*) heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!_buf) _buf = (char*) heap_caps_malloc(capacity, MALLOC_CAP_8BIT);
+    if (!_buf) _cap = 0;
+}
+
+BufferSink::BufferSink(char* buffer, size_t capacity) : _buf(buffer), _cap(capacity), _owned(false) {}
+
+BufferSink::~BufferSink() {
+    if (_owned) heap_caps_free(_buf);
+}
+
+esp_err_t BufferSink::begin(int status, int64_t content_length) {
+    _len = 0;
+    if (!_buf) return ESP_ERR_NO_MEM;
+    if (content_length > 0 && (size_t) content_length > _cap) return ESP_ERR_NO_MEM;
+    return ESP_OK;
+}
+
+esp_err_t BufferSink::write(const char* data, size_t len) {
+    if (len > _cap - _len) return ESP_ERR_NO_MEM;
+    memcpy(_buf + _len, data, len);
+    _len += len;
+    return ESP_OK;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#ifdef __cplusplus
+#include <string>
+#endif
+#include "esp_err.h"
+#include "SizeClassPool.hpp"
+
+// Receives a response body fragment by fragment. Fragments point into the
+// client's read window and are only valid for the duration of write().
+class HttpSink {
+public:
+    virtual ~HttpSink() {}
+
+    // Headers received; content_length is -1 for chunked or unknown length.
+    // Returning an error aborts the transfer before any body is read.
+    virtual esp_err_t begin(int status, int64_t content_length) { return ESP_OK; }
+
+    // One body fragment; returning an error aborts the transfer
+    virtual esp_err_t write(const char* data, size_t len) = 0;
+
+    virtual void end(esp_err_t result) {}
+};
+
+// Collects the body into a string, reserving content-length up front. A body
+// longer than max_size aborts the transfer with ESP_ERR_NO_MEM: announced ones
+// in begin(), before anything is reserved, chunked ones on the write past it.
+template <typename String>
+class BasicStringSink : public HttpSink {
+public:
+    static const size_t DEFAULT_MAX_SIZE = 64 * 1024;
+
+    explicit BasicStringSink(String& out, size_t max_size = DEFAULT_MAX_SIZE) : _out(out), _max(max_size) {}
+
+    esp_err_t begin(int status, int64_t content_length) override {
+        _out.clear();
+        if (content_length > 0) {
+            if ((uint64_t) content_length > _max) return ESP_ERR_NO_MEM;
+            _out.reserve((size_t) content_length);
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t write(const char* data, size_t len) override {
+        if (len > _max - _out.size()) return ESP_ERR_NO_MEM;
+        _out.append(data, len);
+        return ESP_OK;
+    }
+
+private:
+    String& _out;
+    size_t _max;
+};
+
+typedef BasicStringSink<std::string> StringSink;
+
+// Grows in BufferPool blocks instead of the heap: chunked bodies of unknown length
+// are regrown without splitting internal RAM
+typedef BasicStringSink<pool_string> PoolStringSink;
+
+// Drops the body; for requests where only the status matters
+class DiscardSink : public HttpSink {
+public:
+    esp_err_t write(const char* data, size_t len) override { return ESP_OK; }
+};
+
+// Fixed-capacity buffer, allocated in PSRAM when available or supplied by the caller.
+// Aborts the transfer with ESP_ERR_NO_MEM instead of growing.
+class BufferSink : public HttpSink {
+public:
+    explicit BufferSink(size_t capacity);
+    BufferSink(char* buffer, size_t capacity);
+    ~BufferSink();
+
+    BufferSink(const BufferSink&) = delete;
+    BufferSink& operator=(const BufferSink&) = delete;
+
+    esp_err_t begin(int status, int64_t content_length) override;
+    esp_err_t write(const char* data, size_t len) override;
+
+    const char* data() const { return _buf; }
+    size_t size() const { return _len; }
+    size_t capacity() const { return _cap; }
+
+private:
+    char* _buf;
+    size_t _cap;
+    size_t _len = 0;
+    bool _owned;
+};
+
+// Forwards each fragment to a plain callback (e.g. straight to flash or a parser)
+class CallbackSink : public HttpSink {
+public:
+    typedef esp_err_t (*data_cb_t)(const char* data, size_t len, void* user_ctx);
+
+    CallbackSink(data_cb_t callback, void* user_ctx) : _callback(callback), _ctx(user_ctx) {}
+
+    esp_err_t write(const char* data, size_t len) override {
+        return _callback(data, len, _ctx);
+    }
+
+private:
+    data_cb_t _callback;
+    void* _ctx;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Escape text for use inside a JSON string literal. Writes at most out_cap bytes
+// (no terminator) and returns the number written, or SIZE_MAX if the escaped
+// text does not fit. UTF-8 sequences pass through unchanged.
+inline size_t json_escape(const char* in, size_t in_len, char* out, size_t out_cap) {
+    static const char HEX[] = "0123456789abcdef";
+    size_t o = 0;
+    for (size_t i = 0; i < in_len; i++) {
+        unsigned char c = (unsigned char) in[i];
+        char esc = 0;
+        switch (c) {
+            case '"':  esc = '"'; break;
+            case '\\': esc = '\\'; break;
+            case '\n': esc = 'n'; break;
+            case '\r': esc = 'r'; break;
+            case '\t': esc = 't'; break;
+            case '\b': esc = 'b'; break;
+            case '\f': esc = 'f'; break;
+            default: break;
+        }
+        if (esc) {
+            if (out_cap - o < 2) return SIZE_MAX;
+            out[o++] = '\\';
+            out[o++] = esc;
+        } else if (c < 0x20) {
+            if (out_cap - o < 6) return SIZE_MAX;
+            out[o++] = '\\';
+            out[o++] = 'u';
+            out[o++] = '0';
+            out[o++] = '0';
+            out[o++] = HEX[c >> 4];
+            out[o++] = HEX[c & 0xF];
+        } else {
+            if (out_cap - o < 1) return SIZE_MAX;
+            out[o++] = (char) c;
+        }
+    }
+    return o;
+}
@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "JsonEscape.hpp"
+#include "TelegramNotifier.hpp"
+
+static const char* TAG = "TG_NOTIFIER";
+
+static const char* PAYLOAD_MID = "\", \"text\": \"";
+static const char* PAYLOAD_TAIL = "\"}";
+
+// Keeps the start of an error reply, enough for Telegram's "retry_after"; a 200 body is discarded
+class ReplySink : public HttpSink {
+public:
+    esp_err_t begin(int status, int64_t content_length) override {
+        _keep = status != 200;
+        _len = 0;
+        _head[0] = '\0';
+        return ESP_OK;
+    }
+
+    esp_err_t write(const char* data, size_t len) override {
+        if (!_keep) return ESP_OK;
+        size_t n = std::min(len, sizeof(_head) - 1 - _len);
+        memcpy(_head + _len, data, n);
+        _len += n;
+        _head[_len] = '\0';
+        return ESP_OK;
+    }
+
+    // Seconds from {"parameters": {"retry_after": N}}, 0 if absent
+    uint32_t retry_after() const {
+        const char* p = strstr(_head, "\"retry_after\"");
+        if (!p) return 0;
+        p = strchr(p, ':');
+        return p ? (uint32_t) strtoul(p + 1, nullptr, 10) : 0;
+    }
+
+private:
+    char _head[256] = "";
+    size_t _len = 0;
+    bool _keep = false;
+};
+
+// The chat_id part of the body never changes: escape it once, and refuse to start
+// if it leaves no room for text
+TelegramNotifier::TelegramNotifier(const TelegramNotifierConfig& config)
+    : _config(config),
+      _bucket(config.rate_per_sec, config.burst, esp_timer_get_time()) {
+    _url = _config.api_base + "/bot" + _config.token + "/sendMessage";
+    _pending.reserve(_config.max_pending);
+    _payload = new char[_config.max_payload];
+    _lock = xSemaphoreCreateMutex();
+    _exited = xSemaphoreCreateBinary();
+
+    size_t cap = _config.max_payload;
+    int n = snprintf(_payload, cap, "{\"chat_id\": \"");
+    if (n > 0 && (size_t) n < cap) {
+        size_t w = json_escape(_config.chat_id.data(), _config.chat_id.size(), _payload + n, cap - n);
+        size_t o = (size_t) n + w;
+        if (w != SIZE_MAX && cap - o > strlen(PAYLOAD_MID) + strlen(PAYLOAD_TAIL)) {
+            memcpy(_payload + o, PAYLOAD_MID, strlen(PAYLOAD_MID));
+            _header_len = o + strlen(PAYLOAD_MID);
+        }
+    }
+    if (_header_len == 0) {
+        ESP_LOGE(TAG, "chat_id does not fit in a %u byte payload", (unsigned) cap);
+    }
+}
+
+// A request in progress finishes (or times out) first; pending messages are discarded
+TelegramNotifier::~TelegramNotifier() {
+    if (_task) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        _stopping = true;
+        xSemaphoreGive(_lock);
+        xTaskNotifyGive(_task);
+        xSemaphoreTake(_exited, portMAX_DELAY);
+    }
+    vSemaphoreDelete(_exited);
+    vSemaphoreDelete(_lock);
+    delete[] _payload;
+}
+
+esp_err_t TelegramNotifier::begin(uint32_t stack_size, UBaseType_t priority) {
+    if (_task) return ESP_OK;
+    if (_header_len == 0) return ESP_ERR_INVALID_ARG;
+    if (xTaskCreate(flush_task, "tg_notifier", stack_size, this, priority, &_task) != pdPASS) {
+        _task = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool TelegramNotifier::notify(const std::string& text) {
+    bool accepted = true;
+    bool wake = false;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _stats.notified++;
+    Pending* existing = nullptr;
+    for (auto& p : _pending) {
+        if (p.text == text) {
+            existing = &p;
+            break;
+        }
+    }
+    if (existing) {
+        existing->count++;
+        _stats.deduplicated++;
+    } else if (_pending.size() < _config.max_pending) {
+        if (_pending.empty()) {
+            _window_start_us = esp_timer_get_time();
+            wake = true;
+        }
+        _pending.push_back({text, 1});
+    } else {
+        _stats.dropped++;
+        accepted = false;
+    }
+    xSemaphoreGive(_lock);
+
+    if (wake && _task) xTaskNotifyGive(_task);
+    return accepted;
+}
+
+void TelegramNotifier::flush() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _flush_requested = true;
+    xSemaphoreGive(_lock);
+    if (_task) xTaskNotifyGive(_task);
+}
+
+telegram_notifier_stats_t TelegramNotifier::stats() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    telegram_notifier_stats_t s = _stats;
+    xSemaphoreGive(_lock);
+    return s;
+}
+
+// Pack as many pending messages as fit into one sendMessage body, one per line,
+// with repeats shown as "(xN)". Returns the body length; *consumed = messages used.
+size_t TelegramNotifier::build_payload_locked(size_t* consumed) {
+    // Not started with such a config, but never leave the batch in place
+    if (_header_len == 0) {
+        _stats.dropped += _pending.size();
+        *consumed = _pending.size();
+        return 0;
+    }
+
+    char* out = _payload;
+    size_t cap = _config.max_payload;
+    size_t o = _header_len;
+    const size_t tail_len = strlen(PAYLOAD_TAIL);
+
+    size_t used = 0;
+    for (; used < _pending.size(); used++) {
+        const Pending& p = _pending[used];
+        size_t mark = o;
+        char suffix[24] = "";
+        if (p.count > 1) snprintf(suffix, sizeof(suffix), " (x%lu)", (unsigned long) p.count);
+        size_t room = cap - o - tail_len;
+
+        if (used > 0) {
+            if (room < 2) break;
+            out[o++] = '\\';
+            out[o++] = 'n';
+            room -= 2;
+        }
+        size_t w = json_escape(p.text.data(), p.text.size(), out + o, room);
+        if (w == SIZE_MAX || room - w < strlen(suffix)) {
+            o = mark;
+            break;
+        }
+        o += w;
+        memcpy(out + o, suffix, strlen(suffix));
+        o += strlen(suffix);
+    }
+
+    // A single message too long for the buffer would block the queue forever; drop it
+    if (used == 0 && !_pending.empty()) {
+        ESP_LOGW(TAG, "Message longer than payload buffer dropped");
+        _stats.dropped++;
+        *consumed = 1;
+        return 0;
+    }
+
+    memcpy(out + o, PAYLOAD_TAIL, tail_len);
+    o += tail_len;
+    *consumed = used;
+    return o;
+}
+
+// Transport errors, 429 and 5xx keep the body for a resend after a backoff (a 429's
+// retry_after when given); anything else, or the last attempt, drops the batch
+void TelegramNotifier::sent(size_t len, size_t messages, esp_err_t err, int status,
+                            uint32_t retry_after_s) {
+    bool ok = err == ESP_OK && status == 200;
+    bool retryable = err != ESP_OK || status == 429 || status >= 500;
+    uint32_t delay_ms = 0;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _stats.requests++;
+    if (ok) {
+        _attempts = 0;
+    } else {
+        _stats.failures++;
+        if (retryable && _attempts < _config.max_retries) {
+            if (status == 429 && retry_after_s > 0) {
+                delay_ms = retry_after_s * 1000;
+            } else {
+                uint64_t backoff = (uint64_t) _config.retry_base_ms << std::min<uint8_t>(_attempts, 16);
+                delay_ms = (uint32_t) std::min<uint64_t>(backoff, _config.retry_max_ms);
+            }
+            _attempts++;
+            _stats.retries++;
+            _retry_len = len;
+            _retry_messages = messages;
+            _retry_at_us = esp_timer_get_time() + (int64_t) delay_ms * 1000;
+        } else {
+            _attempts = 0;
+            _stats.dropped += messages;
+        }
+    }
+    xSemaphoreGive(_lock);
+
+    if (ok) return;
+    if (delay_ms > 0) {
+        ESP_LOGW(TAG, "sendMessage failed: %s, status %d; retrying in %lu ms", esp_err_to_name(err), status,
+                 (unsigned long) delay_ms);
+    } else {
+        ESP_LOGE(TAG, "sendMessage failed: %s, status %d; %u messages dropped", esp_err_to_name(err), status,
+                 (unsigned) messages);
+    }
+}
+
+void TelegramNotifier::flush_task(void* arg) {
+    TelegramNotifier* obj = (TelegramNotifier*) arg;
+    {
+        HttpClient http;
+
+        while (true) {
+            TickType_t wait = portMAX_DELAY;
+            size_t len = 0;
+            size_t consumed = 0;
+
+            xSemaphoreTake(obj->_lock, portMAX_DELAY);
+            if (obj->_stopping) {
+                xSemaphoreGive(obj->_lock);
+                break;
+            }
+            int64_t now = esp_timer_get_time();
+            if (obj->_retry_len > 0) {
+                // New messages keep coalescing behind the batch being resent
+                if (now < obj->_retry_at_us) {
+                    wait = pdMS_TO_TICKS((obj->_retry_at_us - now) / 1000 + 1);
+                } else if (!obj->_bucket.try_take(now)) {
+                    obj->_stats.rate_limited++;
+                    wait = pdMS_TO_TICKS(obj->_bucket.wait_us(now) / 1000 + 1);
+                } else {
+                    len = obj->_retry_len;
+                    consumed = obj->_retry_messages;
+                    obj->_retry_len = 0;
+                    wait = 0;
+                }
+            } else if (!obj->_pending.empty()) {
+                int64_t window_left = obj->_window_start_us + (int64_t) obj->_config.coalesce_ms * 1000 - now;
+                if (window_left > 0 && !obj->_flush_requested) {
+                    wait = pdMS_TO_TICKS(window_left / 1000 + 1);
+                } else if (!obj->_bucket.try_take(now)) {
+                    obj->_stats.rate_limited++;
+                    wait = pdMS_TO_TICKS(obj->_bucket.wait_us(now) / 1000 + 1);
+                } else {
+                    len = obj->build_payload_locked(&consumed);
+                    obj->_pending.erase(obj->_pending.begin(), obj->_pending.begin() + consumed);
+                    obj->_window_start_us = now;
+                    wait = 0;
+                }
+            }
+            if (obj->_pending.empty()) obj->_flush_requested = false;
+            xSemaphoreGive(obj->_lock);
+
+            // The payload buffer is only touched by this task once built
+            if (len > 0) {
+                ReplySink reply;
+                int status = 0;
+                esp_err_t err = http.request(HTTP_METHOD_POST, obj->_url, obj->_payload, len, reply, &status);
+                obj->sent(len, consumed, err, status, reply.retry_after());
+            }
+
+            if (wait > 0) ulTaskNotifyTake(pdTRUE, wait);
+        }
+    }
+
+    xSemaphoreGive(obj->_exited);
+    vTaskDelete(NULL);
+}
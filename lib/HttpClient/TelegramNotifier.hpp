@@ -0,0 +1,86 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#ifdef __cplusplus
+#include <string>
+#endif
+#include <vector>
+#include "HttpClient.hpp"
+#include "TokenBucket.hpp"
+
+struct TelegramNotifierConfig {
+    std::string token;
+    std::string chat_id;
+    std::string api_base = "https://api.telegram.org";  // Point at a local mock for testing
+    uint32_t coalesce_ms = 2000;   // Messages arriving within this window share one request
+    float rate_per_sec = 1.0f;     // Sustained request rate (Bot API allows ~1 msg/s per chat)
+    float burst = 3.0f;            // Requests allowed back to back
+    size_t max_pending = 32;       // Distinct messages buffered before new ones are dropped
+    size_t max_payload = 4096;     // Preallocated JSON body size
+    uint8_t max_retries = 4;       // Resends of a failed batch before it is dropped
+    uint32_t retry_base_ms = 1000; // First backoff, doubled per attempt
+    uint32_t retry_max_ms = 60000; // Backoff cap; a 429's retry_after is used as given
+};
+
+typedef struct {
+    uint32_t notified;
+    uint32_t deduplicated;
+    uint32_t dropped;
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t retries;
+    uint32_t rate_limited;
+} telegram_notifier_stats_t;
+
+// Buffers alerts and sends them through sendMessage in coalesced batches.
+// Repeats of a pending message only bump its counter, requests are throttled
+// by a token bucket, and the JSON body is escaped into a buffer allocated once.
+// Failed batches (transport errors, 429, 5xx) are resent with backoff.
+class TelegramNotifier {
+public:
+    explicit TelegramNotifier(const TelegramNotifierConfig& config);
+    ~TelegramNotifier();
+
+    TelegramNotifier(const TelegramNotifier&) = delete;
+    TelegramNotifier& operator=(const TelegramNotifier&) = delete;
+
+    // ESP_ERR_INVALID_ARG if the escaped chat_id leaves no room in max_payload
+    esp_err_t begin(uint32_t stack_size = 6144, UBaseType_t priority = 4);
+
+    // Queue a message; returns false if it was dropped because the buffer is full
+    bool notify(const std::string& text);
+
+    // Send whatever is pending without waiting for the coalescing window
+    void flush();
+
+    telegram_notifier_stats_t stats();
+
+private:
+    struct Pending {
+        std::string text;
+        uint32_t count;
+    };
+
+    TelegramNotifierConfig _config;
+    std::string _url;
+    std::vector<Pending> _pending;
+    int64_t _window_start_us = 0;
+    bool _flush_requested = false;
+    char* _payload;
+    size_t _header_len = 0;       // {"chat_id": "...", "text": " prefix, 0 if it does not fit
+    size_t _retry_len = 0;        // Body of a failed batch waiting to be resent, 0 if none
+    size_t _retry_messages = 0;
+    uint8_t _attempts = 0;
+    int64_t _retry_at_us = 0;
+    TokenBucket _bucket;
+    SemaphoreHandle_t _lock;
+    SemaphoreHandle_t _exited;
+    TaskHandle_t _task = nullptr;
+    volatile bool _stopping = false;
+    telegram_notifier_stats_t _stats = {};
+
+    size_t build_payload_locked(size_t* consumed);
+    void sent(size_t len, size_t messages, esp_err_t err, int status, uint32_t retry_after_s);
+    static void flush_task(void* arg);
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+
+// Token bucket rate limiter driven by a caller-supplied microsecond clock
+class TokenBucket {
+public:
+    TokenBucket(float rate_per_sec, float burst, int64_t now_us)
+        : _rate_per_us(rate_per_sec / 1000000.0f), _burst(burst), _tokens(burst), _last_us(now_us) {}
+
+    // A non-positive rate disables limiting
+    bool try_take(int64_t now_us) {
+        if (_rate_per_us <= 0.0f) return true;
+        refill(now_us);
+        if (_tokens < 1.0f) return false;
+        _tokens -= 1.0f;
+        return true;
+    }
+
+    // Microseconds until the next token is available (0 if one is available now)
+    int64_t wait_us(int64_t now_us) {
+        refill(now_us);
+        if (_tokens >= 1.0f || _rate_per_us <= 0.0f) return 0;
+        return (int64_t) ((1.0f - _tokens) / _rate_per_us) + 1;
+    }
+
+private:
+    float _rate_per_us;
+    float _burst;
+    float _tokens;
+    int64_t _last_us;
+
+    void refill(int64_t now_us) {
+        if (now_us > _last_us) {
+            _tokens += (float) (now_us - _last_us) * _rate_per_us;
+            if (_tokens > _burst) _tokens = _burst;
+            _last_us = now_us;
+        }
+    }
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include "SizeClassPool.hpp"
+
+typedef struct {
+    uint32_t aliased;        // Sent with the alias alone
+    uint32_t established;    // Sent with topic and alias, creating or moving a mapping
+    uint32_t plain;          // Sent with the topic alone: not hot yet, or no alias free
+    int64_t bytes_saved;     // Topic bytes left out, less 3 bytes per alias property
+} mqtt_alias_stats_t;
+
+// Outgoing topic aliases for one MQTT 5 connection. A topic earns an alias once
+// it has been published hot_after times while among the last CANDIDATES topics
+// seen; the first publish under a new alias carries the topic to set up the
+// mapping, later ones only the 2-byte alias. Aliases unused for COLD_AFTER
+// publishes are handed to hotter topics, so a fixed set of topics published in
+// rotation keeps its aliases instead of thrashing. Mappings die with the
+// connection: reset() on every connect.
+class MqttTopicAliases {
+public:
+    static const uint16_t MAX_ALIASES = 32;
+    static const size_t CANDIDATES = 16;
+    static const uint32_t COLD_AFTER = 64;
+
+    // capacity 0 turns aliasing off; above MAX_ALIASES is clamped
+    void reset(uint16_t capacity, uint8_t hot_after) {
+        _slots.clear();
+        _slots.resize(capacity < MAX_ALIASES ? capacity : MAX_ALIASES);
+        _hot_after = hot_after ? hot_after : 1;
+        for (Candidate& c : _candidates) c = Candidate();
+        _tick = 0;
+    }
+
+    bool enabled() const { return !_slots.empty(); }
+
+    // Drop every mapping for the rest of the connection (e.g. the broker refused one)
+    void disable() { pool_vector<Slot>().swap(_slots); }
+
+    // Alias to send with this publish, 0 for none. *with_topic is false when the
+    // broker already has the mapping and the topic can be left out.
+    uint16_t lookup(std::string_view topic, bool* with_topic) {
+        *with_topic = true;
+        if (_slots.empty() || topic.empty()) return plain();
+        uint32_t hash = fnv1a(topic);
+        _tick++;
+
+        for (size_t i = 0; i < _slots.size(); i++) {
+            Slot& s = _slots[i];
+            if (s.used && s.hash == hash && std::string_view(s.topic) == topic) {
+                s.last = _tick;
+                *with_topic = false;
+                _stats.aliased++;
+                _stats.bytes_saved += (int64_t) topic.size() - ALIAS_COST;
+                return (uint16_t) (i + 1);
+            }
+        }
+
+        if (!hot(hash)) return plain();
+
+        // A free alias, else the least recently used one gone cold
+        size_t pick = _slots.size();
+        for (size_t i = 0; i < _slots.size(); i++) {
+            if (!_slots[i].used) {
+                pick = i;
+                break;
+            }
+            if (_tick - _slots[i].last >= COLD_AFTER &&
+                (pick == _slots.size() || _slots[i].last < _slots[pick].last)) {
+                pick = i;
+            }
+        }
+        if (pick == _slots.size()) return plain();
+
+        Slot& s = _slots[pick];
+        s.topic.assign(topic.data(), topic.size());
+        s.hash = hash;
+        s.last = _tick;
+        s.used = true;
+        _stats.established++;
+        _stats.bytes_saved -= ALIAS_COST;
+        return (uint16_t) (pick + 1);
+    }
+
+    mqtt_alias_stats_t stats() const { return _stats; }
+
+private:
+    static const int ALIAS_COST = 3;   // Property identifier and 2-byte value
+
+    struct Slot {
+        pool_string topic;
+        uint32_t hash = 0;
+        uint32_t last = 0;
+        bool used = false;
+    };
+
+    struct Candidate {
+        uint32_t hash = 0;
+        uint32_t last = 0;
+        uint16_t count = 0;
+    };
+
+    pool_vector<Slot> _slots;
+    Candidate _candidates[CANDIDATES];
+    uint8_t _hot_after = 2;
+    uint32_t _tick = 0;
+    mqtt_alias_stats_t _stats = {};
+
+    uint16_t plain() {
+        _stats.plain++;
+        return 0;
+    }
+
+    // Count this publish against the topic; true once it has reached hot_after.
+    // Unknown topics replace the least recently seen candidate.
+    bool hot(uint32_t hash) {
+        Candidate* c = nullptr;
+        Candidate* oldest = &_candidates[0];
+        for (Candidate& k : _candidates) {
+            if (k.count && k.hash == hash) {
+                c = &k;
+                break;
+            }
+            if (k.last < oldest->last) oldest = &k;
+        }
+        if (!c) {
+            c = oldest;
+            c->hash = hash;
+            c->count = 0;
+        }
+        c->last = _tick;
+        if (c->count < UINT16_MAX) c->count++;
+        return c->count >= _hot_after;
+    }
+
+    static uint32_t fnv1a(std::string_view s) {
+        uint32_t h = 2166136261u;
+        for (char ch : s) h = (h ^ (uint8_t) ch) * 16777619u;
+        return h;
+    }
+};
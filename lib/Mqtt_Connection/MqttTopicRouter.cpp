@@ -0,0 +1,174 @@
+#include "MqttTopicRouter.hpp"
+
+MqttTopicRouter::MqttTopicRouter() : _root(new Node()) {}
+
+MqttTopicRouter::~MqttTopicRouter() {}
+
+// '#' only as the last level, wildcards only as whole levels, at most MAX_LEVELS levels
+bool MqttTopicRouter::valid_filter(std::string_view filter) {
+    if (filter.empty()) return false;
+    size_t start = 0;
+    for (size_t n = 1; n <= MAX_LEVELS; n++) {
+        size_t end = filter.find('/', start);
+        std::string_view level = filter.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+        bool has_plus = level.find('+') != std::string_view::npos;
+        bool has_hash = level.find('#') != std::string_view::npos;
+        if ((has_plus || has_hash) && level.size() != 1) return false;
+        if (has_hash && end != std::string_view::npos) return false;
+        if (end == std::string_view::npos) return true;
+        start = end + 1;
+    }
+    return false;
+}
+
+// Levels of topic into levels[]; 0 if it has more than MAX_LEVELS, so it is
+// refused rather than matched on a truncated prefix
+size_t MqttTopicRouter::split(std::string_view topic, std::string_view* levels) {
+    size_t n = 0;
+    size_t start = 0;
+    while (n < MAX_LEVELS) {
+        size_t end = topic.find('/', start);
+        if (end == std::string_view::npos) {
+            levels[n++] = topic.substr(start);
+            return n;
+        }
+        levels[n++] = topic.substr(start, end - start);
+        start = end + 1;
+    }
+    return 0;
+}
+
+int MqttTopicRouter::add(std::string_view filter, MqttMessageHandler handler) {
+    if (!valid_filter(filter)) return -1;
+
+    int id = _next_id++;
+    _count++;
+    // The entry vectors may be mid-iteration further up the stack
+    if (_dispatching) _pending.push_back({std::string(filter), {id, std::move(handler)}});
+    else insert(filter, {id, std::move(handler)});
+    return id;
+}
+
+void MqttTopicRouter::insert(std::string_view filter, Entry entry) {
+    std::string_view levels[MAX_LEVELS];
+    size_t depth = split(filter, levels);
+    Node* node = _root.get();
+
+    for (size_t i = 0; i < depth; i++) {
+        std::string_view level = levels[i];
+        if (level == "#") {
+            node->multi.push_back(std::move(entry));
+            return;
+        }
+        if (level == "+") {
+            if (!node->plus) node->plus.reset(new Node());
+            node = node->plus.get();
+            continue;
+        }
+        auto it = node->children.find(level);
+        if (it == node->children.end()) {
+            it = node->children.emplace(std::string(level), std::unique_ptr<Node>(new Node())).first;
+        }
+        node = it->second.get();
+    }
+    node->exact.push_back(std::move(entry));
+}
+
+// During dispatch entries are only marked (id 0): erasing would shift a vector
+// being iterated, and the handler being removed may be the one running
+bool MqttTopicRouter::remove_from(Node* node, int id, bool mark_only) {
+    for (auto* list : {&node->exact, &node->multi}) {
+        for (size_t i = 0; i < list->size(); i++) {
+            if ((*list)[i].id == id) {
+                if (mark_only) (*list)[i].id = 0;
+                else list->erase(list->begin() + i);
+                return true;
+            }
+        }
+    }
+    if (node->plus && remove_from(node->plus.get(), id, mark_only)) return true;
+    for (auto& child : node->children) {
+        if (remove_from(child.second.get(), id, mark_only)) return true;
+    }
+    return false;
+}
+
+bool MqttTopicRouter::remove(int id) {
+    if (id <= 0) return false;
+    bool removed = false;
+    for (size_t i = 0; i < _pending.size(); i++) {
+        if (_pending[i].entry.id == id) {
+            _pending.erase(_pending.begin() + i);
+            removed = true;
+            break;
+        }
+    }
+    if (!removed) removed = remove_from(_root.get(), id, _dispatching > 0);
+    if (!removed) return false;
+    if (_dispatching) _has_removed = true;
+    _count--;
+    return true;
+}
+
+void MqttTopicRouter::purge_removed(Node* node) {
+    for (auto* list : {&node->exact, &node->multi}) {
+        for (size_t i = list->size(); i-- > 0;) {
+            if ((*list)[i].id == 0) list->erase(list->begin() + i);
+        }
+    }
+    if (node->plus) purge_removed(node->plus.get());
+    for (auto& child : node->children) purge_removed(child.second.get());
+}
+
+void MqttTopicRouter::apply_deferred() {
+    if (_has_removed) {
+        purge_removed(_root.get());
+        _has_removed = false;
+    }
+    if (!_pending.empty()) {
+        std::vector<PendingAdd> pending;
+        pending.swap(_pending);
+        for (auto& p : pending) insert(p.filter, std::move(p.entry));
+    }
+}
+
+size_t MqttTopicRouter::call_all(const std::vector<Entry>& entries, std::string_view topic, std::string_view payload) {
+    // Index loop: a handler may mark entries removed, but the vector itself
+    // does not change until dispatch ends
+    size_t called = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].id == 0) continue;
+        entries[i].handler(topic, payload);
+        called++;
+    }
+    return called;
+}
+
+size_t MqttTopicRouter::match(const Node* node, const std::string_view* levels, size_t depth, size_t idx,
+                              std::string_view topic, std::string_view payload) const {
+    // Wildcards at the first level never match topics starting with '$' (e.g. $SYS)
+    bool wildcard_ok = !(idx == 0 && !levels[0].empty() && levels[0][0] == '$');
+    size_t called = wildcard_ok ? call_all(node->multi, topic, payload) : 0;
+
+    if (idx == depth) return called + call_all(node->exact, topic, payload);
+
+    auto it = node->children.find(levels[idx]);
+    if (it != node->children.end()) {
+        called += match(it->second.get(), levels, depth, idx + 1, topic, payload);
+    }
+    if (node->plus && wildcard_ok) {
+        called += match(node->plus.get(), levels, depth, idx + 1, topic, payload);
+    }
+    return called;
+}
+
+size_t MqttTopicRouter::dispatch(std::string_view topic, std::string_view payload) {
+    std::string_view levels[MAX_LEVELS];
+    size_t depth = split(topic, levels);
+    if (depth == 0) return 0;
+
+    _dispatching++;
+    size_t called = match(_root.get(), levels, depth, 0, topic, payload);
+    if (--_dispatching == 0) apply_deferred();
+    return called;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <stddef.h>
+#ifdef __cplusplus
+#include <string>
+#endif
+#include <string_view>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+typedef std::function<void(std::string_view topic, std::string_view payload)> MqttMessageHandler;
+
+// Topic trie for MQTT subscriptions with '+' and '#' wildcards. Dispatch walks one
+// trie level per topic level, so cost grows with topic depth rather than with the
+// number of subscriptions. Topic and payload reach handlers as views, never copied.
+// Handlers may add and remove subscriptions (their own included): changes made
+// during dispatch take effect once the outermost dispatch returns, and a handler
+// removed mid-dispatch is not called for the rest of it.
+class MqttTopicRouter {
+public:
+    static const size_t MAX_LEVELS = 32;
+
+    MqttTopicRouter();
+    ~MqttTopicRouter();
+
+    // Returns a subscription id (> 0), or -1 if the filter is malformed or has
+    // more than MAX_LEVELS levels
+    int add(std::string_view filter, MqttMessageHandler handler);
+
+    bool remove(int id);
+
+    // Calls every handler whose filter matches topic; returns how many ran.
+    // Topics deeper than MAX_LEVELS match nothing.
+    size_t dispatch(std::string_view topic, std::string_view payload);
+
+    size_t size() const { return _count; }
+
+    static bool valid_filter(std::string_view filter);
+
+    struct Entry {
+        int id;                      // 0 once removed during dispatch
+        MqttMessageHandler handler;
+    };
+
+    struct PendingAdd {
+        std::string filter;
+        Entry entry;
+    };
+
+    struct Node {
+        std::map<std::string, std::unique_ptr<Node>, std::less<>> children;
+        std::unique_ptr<Node> plus;
+        std::vector<Entry> exact;   // Filters ending at this node
+        std::vector<Entry> multi;   // Filters ending with '#' below this node
+    };
+
+    std::unique_ptr<Node> _root;
+    int _next_id = 1;
+    size_t _count = 0;
+    int _dispatching = 0;              // Nesting depth of dispatch()
+    std::vector<PendingAdd> _pending;  // Added during dispatch
+    bool _has_removed = false;         // Entries marked removed during dispatch
+
+    static size_t split(std::string_view topic, std::string_view* levels);
+    void insert(std::string_view filter, Entry entry);
+    static size_t call_all(const std::vector<Entry>& entries, std::string_view topic, std::string_view payload);
+    size_t match(const Node* node, const std::string_view* levels, size_t depth, size_t idx,
+                 std::string_view topic, std::string_view payload) const;
+    static bool remove_from(Node* node, int id, bool mark_only);
+    static void purge_removed(Node* node);
+    void apply_deferred();
+};
@@ -1,26 +1,74 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "Mqtt_Connection.hpp"
+#include "FlashLog.hpp"
+#include "DeferredLog.hpp"
 
 const char* Mqtt_Connection::TAG = "MQTT_CLASS";
 
+// How often queued messages are offered to esp-mqtt while a backlog exists
+static const uint64_t DRAIN_PERIOD_US = 20 * 1000;
+
+Mqtt_Connection::Mqtt_Connection() : client(nullptr) {
+    _lock = xSemaphoreCreateMutex();
+    _space = xSemaphoreCreateBinary();
+    _router_lock = xSemaphoreCreateRecursiveMutex();
+    _handoff_lock = xSemaphoreCreateMutex();
+}
+
+Mqtt_Connection::~Mqtt_Connection() {
+    if (_drain_timer) {
+        esp_timer_stop(_drain_timer);
+        esp_timer_delete(_drain_timer);
+    }
+    if (client) esp_mqtt_client_destroy(client);
+    vSemaphoreDelete(_space);
+    vSemaphoreDelete(_lock);
+    vSemaphoreDelete(_router_lock);
+    vSemaphoreDelete(_handoff_lock);
+}
+
 void Mqtt_Connection::mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
 
     auto event = (esp_mqtt_event_handle_t)event_data;
+    auto obj = static_cast<Mqtt_Connection*>(handler_args);
+    obj->_mqtt_task.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
     
     switch ((esp_mqtt_event_id_t)event_id) {
+        case MQTT_EVENT_BEFORE_CONNECT:
+            obj->_connect_start_us = esp_timer_get_time();
+            break;
+
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "Successfully connected to MQTT broker.");
+            obj->_connected = true;
+            obj->_connection_gen++;
+            obj->on_connected(event->session_present);
+            esp_timer_start_periodic(obj->_drain_timer, DRAIN_PERIOD_US);
             break;
             
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGW(TAG, "Connection lost. Automatic reconnection attempt will be made.");
+            obj->_connected = false;
+            obj->_connection_gen++;
+            break;
+
+        case MQTT_EVENT_SUBSCRIBED:
+            obj->on_subscribed();
+            break;
+
+        case MQTT_EVENT_PUBLISHED:
+            // Outbox space was freed; the drain timer moves queued messages (never from this
+            // task, which holds the esp-mqtt lock while dispatching events)
+            esp_timer_start_periodic(obj->_drain_timer, DRAIN_PERIOD_US);
             break;
 
         case MQTT_EVENT_ERROR:
             ESP_LOGE(TAG, "An MQTT error occurred");
             break;
         case MQTT_EVENT_DATA:
-            printf("TOPIC=%.*s\r\n", event->topic_len, event->topic);
-            printf("DATA=%.*s\r\n", event->data_len, event->data);
+            obj->on_data(event);
             break;
         default:
             break;
@@ -29,40 +77,486 @@ void Mqtt_Connection::mqtt_event_handler(void *handler_args, esp_event_base_t ba
 
 
 void Mqtt_Connection::begin(const std::string& broker_url) {
+    begin(broker_url, MqttOutboxConfig());
+}
+
+void Mqtt_Connection::begin(const std::string& broker_url, const MqttOutboxConfig& outbox) {
+    MqttSessionConfig session;
+    session.mqtt5 = false;
+    begin(broker_url, outbox, session);
+}
+
+void Mqtt_Connection::begin(const std::string& broker_url, const MqttOutboxConfig& outbox,
+                            const MqttSessionConfig& session) {
+
+    _outbox_cfg = outbox;
+    _session_cfg = session;
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = drain_timer_cb;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "mqtt_drain";
+    esp_timer_create(&timer_args, &_drain_timer);
 
     esp_mqtt_client_config_t mqtt_cfg = {};
     
 
     mqtt_cfg.broker.address.uri = broker_url.c_str();
 
+#if CONFIG_MQTT_PROTOCOL_5
+    _mqtt5 = session.mqtt5;
+    if (_mqtt5) {
+        mqtt_cfg.session.protocol_ver = MQTT_PROTOCOL_V_5;
+        // Clean Start = 0: the broker resumes the session if it has not expired
+        mqtt_cfg.session.disable_clean_session = session.session_expiry_s > 0;
+    }
+#else
+    if (session.mqtt5) ESP_LOGW(TAG, "esp-mqtt built without CONFIG_MQTT_PROTOCOL_5, using MQTT 3.1.1");
+#endif
 
     client = esp_mqtt_client_init(&mqtt_cfg);
 
+#if CONFIG_MQTT_PROTOCOL_5
+    if (_mqtt5) {
+        esp_mqtt5_connection_property_config_t props = {};
+        props.session_expiry_interval = session.session_expiry_s;
+        props.receive_maximum = session.receive_maximum;
+        props.maximum_packet_size = session.max_packet_size;
+        esp_mqtt5_client_set_connect_property(client, &props);
+    }
+#endif
+
 
     esp_mqtt_client_register_event(client, (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID, mqtt_event_handler, this);
     
     esp_mqtt_client_start(client);
 }
 
+size_t Mqtt_Connection::entry_cost(size_t topic_len, size_t payload_len) {
+    return topic_len + payload_len + sizeof(OutboxEntry);
+}
 
-void Mqtt_Connection::publish(const std::string& topic, const std::string& data) {
-    if (client) {
+// The esp-mqtt outbox may take len more bytes; an empty outbox always takes one message
+bool Mqtt_Connection::client_has_room(size_t len) {
+    if (!_connected) return false;
+    int used = esp_mqtt_client_get_outbox_size(client);
+    return used == 0 || (size_t) used + len <= _outbox_cfg.inflight_budget;
+}
 
-        int msg_id = esp_mqtt_client_publish(client, topic.c_str(), data.c_str(), 0, 1, 0);
-        
-        if (msg_id != -1) {
-            ESP_LOGI(TAG, "Data send successfully. Data ID %d", msg_id);
-        } else {
-            ESP_LOGE(TAG, "Error with sending the message!");
+// Hand the message to esp-mqtt straight from the caller's buffers
+esp_err_t Mqtt_Connection::enqueue_direct(std::string_view topic, std::string_view data, int qos, bool retain,
+                                          bool may_alias) {
+    char topic_buf[128];
+    pool_string long_topic;
+    const char* topic_cstr;
+    if (topic.size() < sizeof(topic_buf)) {
+        memcpy(topic_buf, topic.data(), topic.size());
+        topic_buf[topic.size()] = '\0';
+        topic_cstr = topic_buf;
+    } else {
+        long_topic.assign(topic);
+        topic_cstr = long_topic.c_str();
+    }
+
+    if (may_alias && qos == 0 && _mqtt5 && _session_cfg.topic_aliases > 0 &&
+        publish_aliased(topic_cstr, topic.size(), data, retain) == ESP_OK) {
+        return ESP_OK;
+    }
+
+    int msg_id = esp_mqtt_client_enqueue(client, topic_cstr, data.data(), (int) data.size(), qos, retain, true);
+    if (msg_id < 0) return ESP_FAIL;
+    _stats.published++;
+    return ESP_OK;
+}
+
+// A QoS 0 publish on a hot topic goes out under its alias, written to the
+// socket now rather than queued: esp-mqtt sends queued packets as they were
+// built, and one naming only an alias could go out on the next connection,
+// where the broker no longer knows it. ESP_ERR_NOT_FOUND means no alias (yet),
+// queue it as usual. Caller holds _lock.
+esp_err_t Mqtt_Connection::publish_aliased(const char* topic, size_t topic_len, std::string_view data, bool retain) {
+#if CONFIG_MQTT_PROTOCOL_5
+    uint32_t gen = _connection_gen;
+    if (gen != _alias_gen) {
+        _alias_gen = gen;
+        _aliases.reset(_connected ? _session_cfg.topic_aliases : 0, _session_cfg.alias_after);
+    }
+    bool with_topic = true;
+    uint16_t alias = _aliases.lookup(std::string_view(topic, topic_len), &with_topic);
+    if (alias == 0) return ESP_ERR_NOT_FOUND;
+
+    // Publish properties apply to the next publish only
+    esp_mqtt5_publish_property_config_t property = {};
+    property.topic_alias = alias;
+    esp_mqtt5_client_set_publish_property(client, &property);
+    if (esp_mqtt_client_publish(client, with_topic ? topic : "", data.data(), (int) data.size(), 0, retain) < 0) {
+        // Above the broker's Topic Alias Maximum (esp-mqtt checks the CONNACK
+        // value), or the connection just dropped: full topics until the next connect
+        DLOGW(TAG, "Topic alias %u refused, aliases off for this connection", (unsigned) alias);
+        _aliases.disable();
+        esp_mqtt5_publish_property_config_t none = {};
+        esp_mqtt5_client_set_publish_property(client, &none);
+        return ESP_FAIL;
+    }
+    _stats.published++;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t Mqtt_Connection::publish_locked(std::string_view topic, std::string_view data, int qos, bool retain, bool* queued) {
+    *queued = false;
+    bool store_busy = _store && !_store->empty();
+    if (_outbox.empty() && !store_busy && client_has_room(topic.size() + data.size())) {
+        if (enqueue_direct(topic, data, qos, retain, true) == ESP_OK) return ESP_OK;
+    }
+
+    // Offline, or older messages already wait in flash: keep them in order
+    if (_store && (!_connected || store_busy)) {
+        if (!store_offline(topic, data, qos, retain)) return ESP_FAIL;
+        *queued = true;
+        return ESP_OK;
+    }
+
+    size_t cost = entry_cost(topic.size(), data.size());
+    if (_outbox_bytes + cost > _outbox_cfg.memory_budget && _outbox_cfg.policy == MQTT_BACKPRESSURE_DROP_OLDEST) {
+        while (!_outbox.empty() && _outbox_bytes + cost > _outbox_cfg.memory_budget) {
+            const OutboxEntry& oldest = _outbox.front();
+            _outbox_bytes -= entry_cost(oldest.topic_len, oldest.data.size() - oldest.topic_len);
+            _outbox.pop_front();
+            _stats.dropped++;
         }
+    }
+    if (_outbox_bytes + cost > _outbox_cfg.memory_budget) {
+        if (!_store) return ESP_ERR_NO_MEM;
+        if (!store_offline(topic, data, qos, retain)) return ESP_FAIL;
+        *queued = true;
+        return ESP_OK;
+    }
+
+    pool_string buf;
+    buf.reserve(topic.size() + data.size());
+    buf.append(topic).append(data);
+    _outbox.push_back({std::move(buf), topic.size(), qos, retain});
+    _outbox_bytes += cost;
+    if (_outbox_bytes > _stats.peak_queued_bytes) _stats.peak_queued_bytes = _outbox_bytes;
+    *queued = true;
+    return ESP_OK;
+}
+
+bool Mqtt_Connection::on_mqtt_task() const {
+    return _mqtt_task.load(std::memory_order_relaxed) == xTaskGetCurrentTaskHandle();
+}
+
+// The MQTT task holds the esp-mqtt lock while it dispatches, and a task inside
+// publish() holds _lock while it waits for that lock: taking _lock here would
+// deadlock. The message is copied for the drain timer instead.
+esp_err_t Mqtt_Connection::publish_from_handler(std::string_view topic, std::string_view data, int qos, bool retain) {
+    size_t cost = entry_cost(topic.size(), data.size());
+    pool_string buf;
+    buf.reserve(topic.size() + data.size());
+    buf.append(topic).append(data);
+
+    xSemaphoreTake(_handoff_lock, portMAX_DELAY);
+    bool fits = _handoff_bytes + cost <= _outbox_cfg.memory_budget;
+    if (fits) {
+        _handoff.push_back({std::move(buf), topic.size(), qos, retain});
+        _handoff_bytes += cost;
     } else {
+        _handoff_rejected++;
+    }
+    xSemaphoreGive(_handoff_lock);
+
+    if (!fits) {
+        DLOGD(TAG, "Publish to %s from handler refused: %s", dlog_str(topic), esp_err_to_name(ESP_ERR_NO_MEM));
+        return ESP_ERR_NO_MEM;
+    }
+    esp_timer_start_periodic(_drain_timer, DRAIN_PERIOD_US);
+    return ESP_OK;
+}
+
+// Publish what handlers queued, in order, as if they had called publish() now.
+// Caller holds _lock; there is no one to block for, so BLOCK refuses.
+void Mqtt_Connection::take_handoff() {
+    std::deque<OutboxEntry, PoolAllocator<OutboxEntry>> pending;
+    xSemaphoreTake(_handoff_lock, portMAX_DELAY);
+    pending.swap(_handoff);
+    _handoff_bytes = 0;
+    _stats.rejected += _handoff_rejected;
+    _handoff_rejected = 0;
+    xSemaphoreGive(_handoff_lock);
+
+    bool queued;
+    for (const OutboxEntry& e : pending) {
+        if (publish_locked(e.topic(), e.payload(), e.qos, e.retain, &queued) == ESP_ERR_NO_MEM) _stats.rejected++;
+    }
+}
+
+esp_err_t Mqtt_Connection::publish(std::string_view topic, std::string_view data, int qos, bool retain) {
+    if (!client) {
         ESP_LOGE(TAG, "Attempted to publish before client initialization!");
+        return ESP_ERR_INVALID_STATE;
     }
+    if (on_mqtt_task()) return publish_from_handler(topic, data, qos, retain);
+
+    TickType_t start = xTaskGetTickCount();
+    bool queued = false;
+    esp_err_t err;
+    while (true) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        err = publish_locked(topic, data, qos, retain, &queued);
+        if (err == ESP_ERR_NO_MEM && _outbox_cfg.policy != MQTT_BACKPRESSURE_BLOCK) _stats.rejected++;
+        xSemaphoreGive(_lock);
+
+        if (err != ESP_ERR_NO_MEM || _outbox_cfg.policy != MQTT_BACKPRESSURE_BLOCK) break;
+
+        TickType_t waited = xTaskGetTickCount() - start;
+        if (waited >= _outbox_cfg.block_timeout ||
+            xSemaphoreTake(_space, _outbox_cfg.block_timeout - waited) != pdTRUE) {
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            _stats.rejected++;
+            xSemaphoreGive(_lock);
+            break;
+        }
+    }
+
+    if (queued) esp_timer_start_periodic(_drain_timer, DRAIN_PERIOD_US);
+    if (err != ESP_OK) DLOGD(TAG, "Publish to %s refused: %s", dlog_str(topic), esp_err_to_name(err));
+    return err;
+}
+
+size_t Mqtt_Connection::publish_batch(const MqttMessage* messages, size_t count) {
+    size_t accepted = 0;
+    while (accepted < count &&
+           publish(messages[accepted].topic, messages[accepted].payload,
+                   messages[accepted].qos, messages[accepted].retain) == ESP_OK) {
+        accepted++;
+    }
+    return accepted;
+}
+
+void Mqtt_Connection::set_offline_store(FlashLog* store) {
+    if (on_mqtt_task()) {
+        ESP_LOGE(TAG, "set_offline_store() called from a message handler");
+        return;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _store = store;
+    xSemaphoreGive(_lock);
+    if (store && !store->empty() && _drain_timer) esp_timer_start_periodic(_drain_timer, DRAIN_PERIOD_US);
+}
+
+// Record layout: [qos][retain][topic length, 2 bytes][topic][payload]
+bool Mqtt_Connection::store_offline(std::string_view topic, std::string_view data, int qos, bool retain) {
+    uint16_t topic_len = (uint16_t) topic.size();
+    uint8_t header[4] = {(uint8_t) qos, (uint8_t) retain, (uint8_t) (topic_len & 0xFF), (uint8_t) (topic_len >> 8)};
+    flash_log_part_t parts[] = {
+        {header, sizeof(header)},
+        {topic.data(), topic.size()},
+        {data.data(), data.size()},
+    };
+    if (topic.size() > UINT16_MAX || !_store->append(parts, 3)) {
+        DLOGW(TAG, "Offline store refused %u byte message", (unsigned) (topic.size() + data.size()));
+        return false;
+    }
+    _stats.stored++;
+    return true;
+}
+
+// Runs under _lock from drain(); returning false leaves the record in flash
+bool Mqtt_Connection::restore_cb(const uint8_t* record, size_t len, void* ctx) {
+    auto obj = static_cast<Mqtt_Connection*>(ctx);
+    if (len < 4) return true;   // Not ours, skip it
+    size_t topic_len = record[2] | (record[3] << 8);
+    if (4 + topic_len > len) return true;
+
+    std::string_view topic((const char*) record + 4, topic_len);
+    std::string_view payload((const char*) record + 4 + topic_len, len - 4 - topic_len);
+    if (!obj->client_has_room(topic.size() + payload.size())) return false;
+    if (obj->enqueue_direct(topic, payload, record[0], record[1]) != ESP_OK) return false;
+    obj->_stats.restored++;
+    return true;
+}
+
+// Move queued messages into esp-mqtt while its outbox has room: first the RAM
+// outbox, then the offline store, which only ever holds newer messages
+void Mqtt_Connection::drain() {
+    bool freed = false;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    take_handoff();
+    while (!_outbox.empty()) {
+        OutboxEntry& e = _outbox.front();
+        if (!client_has_room(e.data.size())) break;
+        if (enqueue_direct(e.topic(), e.payload(), e.qos, e.retain) != ESP_OK) break;
+        _outbox_bytes -= entry_cost(e.topic_len, e.data.size() - e.topic_len);
+        _outbox.pop_front();
+        freed = true;
+    }
+    bool store_empty = !_store || _store->empty();
+    if (_outbox.empty() && !store_empty && _connected) {
+        _store->replay(restore_cb, this);
+        store_empty = _store->empty();
+    }
+    // Offline there is nothing to do until MQTT_EVENT_CONNECTED restarts the timer.
+    // Decided under _handoff_lock: a handler that queues after this restarts it.
+    xSemaphoreTake(_handoff_lock, portMAX_DELAY);
+    if (_handoff.empty() && (!_connected || (_outbox.empty() && store_empty))) esp_timer_stop(_drain_timer);
+    xSemaphoreGive(_handoff_lock);
+    xSemaphoreGive(_lock);
+
+    if (freed) xSemaphoreGive(_space);
+}
+
+void Mqtt_Connection::drain_timer_cb(void* arg) {
+    static_cast<Mqtt_Connection*>(arg)->drain();
+}
+
+mqtt_outbox_stats_t Mqtt_Connection::outbox_stats() {
+    if (on_mqtt_task()) {
+        ESP_LOGE(TAG, "outbox_stats() called from a message handler");
+        return {};
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    mqtt_outbox_stats_t s = _stats;
+    xSemaphoreTake(_handoff_lock, portMAX_DELAY);
+    s.queued_messages = _outbox.size() + _handoff.size();
+    s.queued_bytes = _outbox_bytes + _handoff_bytes;
+    s.rejected += _handoff_rejected;
+    xSemaphoreGive(_handoff_lock);
+    s.esp_outbox_bytes = client ? esp_mqtt_client_get_outbox_size(client) : 0;
+    s.store_pending = _store ? _store->stats().pending : 0;
+    xSemaphoreGive(_lock);
+    return s;
+}
+
+mqtt_session_stats_t Mqtt_Connection::session_stats() {
+    if (on_mqtt_task()) {
+        ESP_LOGE(TAG, "session_stats() called from a message handler");
+        return {};
+    }
+    xSemaphoreTakeRecursive(_router_lock, portMAX_DELAY);
+    mqtt_session_stats_t s = _session_stats;
+    xSemaphoreGiveRecursive(_router_lock);
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    s.aliases = _aliases.stats();
+    xSemaphoreGive(_lock);
+    return s;
+}
+
+// A resumed session still holds the subscriptions, and the QoS > 0 messages
+// that arrived meanwhile; without one, subscribe to everything again. Runs on
+// the MQTT task, which may call esp-mqtt while dispatching.
+void Mqtt_Connection::on_connected(bool session_present) {
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTakeRecursive(_router_lock, portMAX_DELAY);
+    _session_stats.connects++;
+    _session_stats.last_connect_us = now - _connect_start_us;
+    _pending_subacks = 0;
+    if (session_present) {
+        _session_stats.sessions_resumed++;
+    } else {
+        for (const Subscription& sub : _subscriptions) {
+            if (esp_mqtt_client_subscribe(client, sub.topic.c_str(), sub.qos) < 0) continue;
+            _pending_subacks++;
+            _session_stats.resubscribed++;
+        }
+    }
+    if (_pending_subacks == 0) _session_stats.last_ready_us = _session_stats.last_connect_us;
+    xSemaphoreGiveRecursive(_router_lock);
+}
+
+void Mqtt_Connection::on_subscribed() {
+    xSemaphoreTakeRecursive(_router_lock, portMAX_DELAY);
+    if (_pending_subacks > 0 && --_pending_subacks == 0) {
+        _session_stats.last_ready_us = esp_timer_get_time() - _connect_start_us;
+    }
+    xSemaphoreGiveRecursive(_router_lock);
 }
 
 void Mqtt_Connection::subscribe(const std::string& topic, int qos) {
-    if (client) {
+    xSemaphoreTakeRecursive(_router_lock, portMAX_DELAY);
+    bool known = false;
+    for (Subscription& sub : _subscriptions) {
+        if (std::string_view(sub.topic) == topic) {
+            sub.qos = qos;
+            known = true;
+        }
+    }
+    if (!known) _subscriptions.push_back({pool_string(topic.data(), topic.size()), qos});
+    xSemaphoreGiveRecursive(_router_lock);
+
+    // Not under _router_lock: the MQTT task takes it while holding the esp-mqtt lock
+    if (client && _connected) {
         int msg_id = esp_mqtt_client_subscribe(client, topic.c_str(), qos);
         ESP_LOGI(TAG, "sent subscribe successful, msg_id=%d", msg_id);
     }
+}
+
+int Mqtt_Connection::subscribe(const std::string& topic, int qos, MqttMessageHandler handler) {
+    xSemaphoreTakeRecursive(_router_lock, portMAX_DELAY);
+    int id = _router.add(topic, std::move(handler));
+    xSemaphoreGiveRecursive(_router_lock);
+
+    if (id < 0) {
+        ESP_LOGE(TAG, "Invalid topic filter: %s", topic.c_str());
+        return -1;
+    }
+    subscribe(topic, qos);
+    return id;
+}
+
+bool Mqtt_Connection::remove_handler(int handler_id) {
+    xSemaphoreTakeRecursive(_router_lock, portMAX_DELAY);
+    bool removed = _router.remove(handler_id);
+    xSemaphoreGiveRecursive(_router_lock);
+    return removed;
+}
+
+// Single-fragment messages are routed straight from the event buffers. Larger ones
+// arrive as consecutive fragments (topic only on the first) and are stitched
+// together in a pool block, returned as soon as the message has been routed.
+void Mqtt_Connection::on_data(esp_mqtt_event_handle_t event) {
+    if (event->current_data_offset == 0 && event->data_len == event->total_data_len) {
+        route(std::string_view(event->topic, event->topic_len), std::string_view(event->data, event->data_len));
+        return;
+    }
+
+    if (event->current_data_offset == 0) {
+        _assembling = (size_t) event->total_data_len <= MAX_REASSEMBLED_SIZE;
+        if (!_assembling) {
+            DLOGW(TAG, "Dropping %d byte message on %s", event->total_data_len, dlog_str(event->topic, event->topic_len));
+            return;
+        }
+        _assembly_topic.assign(event->topic, event->topic_len);
+        _assembly.resize(event->total_data_len);
+    }
+    if (!_assembling) return;
+
+    size_t end = (size_t) event->current_data_offset + event->data_len;
+    if (end > _assembly.size()) {
+        _assembling = false;
+        pool_vector<char>().swap(_assembly);
+        return;
+    }
+    memcpy(_assembly.data() + event->current_data_offset, event->data, event->data_len);
+
+    if (end == _assembly.size()) {
+        _assembling = false;
+        route(_assembly_topic, std::string_view(_assembly.data(), _assembly.size()));
+        pool_vector<char>().swap(_assembly);
+    }
+}
+
+void Mqtt_Connection::route(std::string_view topic, std::string_view payload) {
+    xSemaphoreTakeRecursive(_router_lock, portMAX_DELAY);
+    size_t handled = _router.dispatch(topic, payload);
+    xSemaphoreGiveRecursive(_router_lock);
+
+    if (handled == 0) {
+        DLOGD(TAG, "No handler for %s (%u bytes)", dlog_str(topic), (unsigned) payload.size());
+    }
 }
\ No newline at end of file
@@ -3,7 +3,75 @@
 #ifdef __cplusplus
 #include <string>
 #endif     
+#include <string_view>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
 #include "esp_log.h" 
+#include "MqttTopicRouter.hpp"
+#include "MqttTopicAliases.hpp"
+#include "SizeClassPool.hpp"
+
+class FlashLog;
+
+// What publish() does when the outbox memory budget is exhausted
+typedef enum {
+    MQTT_BACKPRESSURE_REJECT = 0,   // Return ESP_ERR_NO_MEM, keep queued messages
+    MQTT_BACKPRESSURE_DROP_OLDEST,  // Evict the oldest queued messages to make room
+    MQTT_BACKPRESSURE_BLOCK,        // Wait up to block_timeout for room
+} mqtt_backpressure_t;
+
+struct MqttOutboxConfig {
+    size_t memory_budget = 16 * 1024;    // Bytes held in our queue while the client cannot take more
+    size_t inflight_budget = 8 * 1024;   // Bytes allowed in the esp-mqtt outbox (unsent / unacked)
+    mqtt_backpressure_t policy = MQTT_BACKPRESSURE_REJECT;
+    TickType_t block_timeout = pdMS_TO_TICKS(1000);
+};
+
+// MQTT 5 session settings. Needs esp-mqtt built with CONFIG_MQTT_PROTOCOL_5,
+// otherwise the connection stays MQTT 3.1.1. The session is tied to the client
+// id, which esp-mqtt derives from the MAC, so it survives reboots too.
+struct MqttSessionConfig {
+    bool mqtt5 = true;
+    uint32_t session_expiry_s = 3600;    // Broker keeps subscriptions and QoS > 0 messages this long after a drop; 0 = clean session
+    uint16_t receive_maximum = 8;        // QoS > 0 messages the broker may have unacknowledged towards us; 0 = broker default
+    uint32_t max_packet_size = 65 * 1024;  // Broker drops larger messages for us instead of sending them; 0 = no limit
+    uint16_t topic_aliases = 5;          // Outgoing aliases; no more than the broker's Topic Alias Maximum. 0 = off
+    uint8_t alias_after = 2;             // QoS 0 publishes to a topic before it gets an alias
+};
+
+struct MqttMessage {
+    std::string_view topic;
+    std::string_view payload;
+    int qos = 1;
+    bool retain = false;
+};
+
+typedef struct {
+    uint32_t queued_messages;
+    uint32_t queued_bytes;
+    uint32_t peak_queued_bytes;
+    int esp_outbox_bytes;
+    uint32_t published;      // Handed to esp-mqtt
+    uint32_t dropped;        // Evicted by MQTT_BACKPRESSURE_DROP_OLDEST
+    uint32_t rejected;       // Refused (budget exhausted or block timeout)
+    uint32_t stored;         // Written to the offline store
+    uint32_t restored;       // Replayed from the offline store into esp-mqtt
+    uint32_t store_pending;  // Waiting in the offline store
+} mqtt_outbox_stats_t;
+
+typedef struct {
+    uint32_t connects;
+    uint32_t sessions_resumed;   // Broker still had our session: nothing subscribed again
+    uint32_t resubscribed;       // Subscriptions sent at connect because there was no session
+    int64_t last_connect_us;     // Connection start to CONNACK, last connect
+    int64_t last_ready_us;       // Connection start to the last SUBACK of the resubscription (CONNACK if none)
+    mqtt_alias_stats_t aliases;  // QoS 0 publishes only
+} mqtt_session_stats_t;
 
 class Mqtt_Connection {
 private:
@@ -16,12 +84,129 @@ private:
 
     static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 
+    // Topic and payload share one BufferPool block
+    struct OutboxEntry {
+        pool_string data;
+        size_t topic_len;
+        int qos;
+        bool retain;
+
+        std::string_view topic() const { return std::string_view(data).substr(0, topic_len); }
+        std::string_view payload() const { return std::string_view(data).substr(topic_len); }
+    };
+
+    MqttOutboxConfig _outbox_cfg;
+    std::deque<OutboxEntry, PoolAllocator<OutboxEntry>> _outbox;
+    size_t _outbox_bytes = 0;
+    mqtt_outbox_stats_t _stats = {};
+    SemaphoreHandle_t _lock;
+    SemaphoreHandle_t _space;
+    esp_timer_handle_t _drain_timer = nullptr;
+    volatile bool _connected = false;
+    FlashLog* _store = nullptr;
+
+    // Publishes made on the MQTT task (from handlers) wait here for the drain
+    // timer: that task holds the esp-mqtt lock, so it must never wait for _lock.
+    // _handoff_lock is only ever taken last and held for a push or a swap.
+    std::atomic<TaskHandle_t> _mqtt_task{nullptr};
+    std::deque<OutboxEntry, PoolAllocator<OutboxEntry>> _handoff;
+    size_t _handoff_bytes = 0;
+    uint32_t _handoff_rejected = 0;
+    SemaphoreHandle_t _handoff_lock;
+
+    // Session state; subscriptions and session stats are guarded by _router_lock,
+    // aliases by _lock
+    struct Subscription {
+        pool_string topic;
+        int qos;
+    };
+
+    MqttSessionConfig _session_cfg;
+    bool _mqtt5 = false;
+    pool_vector<Subscription> _subscriptions;
+    mqtt_session_stats_t _session_stats = {};
+    int64_t _connect_start_us = 0;
+    int _pending_subacks = 0;
+    MqttTopicAliases _aliases;
+    std::atomic<uint32_t> _connection_gen{0};   // Bumped on every connect and disconnect
+    uint32_t _alias_gen = 0;                    // Connection the alias table belongs to
+
+    MqttTopicRouter _router;
+    SemaphoreHandle_t _router_lock;
+    pool_vector<char> _assembly;       // Fragmented message being stitched together
+    pool_string _assembly_topic;
+    bool _assembling = false;
+
+    static size_t entry_cost(size_t topic_len, size_t payload_len);
+    bool client_has_room(size_t len);
+    esp_err_t enqueue_direct(std::string_view topic, std::string_view data, int qos, bool retain,
+                             bool may_alias = false);
+    esp_err_t publish_aliased(const char* topic, size_t topic_len, std::string_view data, bool retain);
+    esp_err_t publish_locked(std::string_view topic, std::string_view data, int qos, bool retain, bool* queued);
+    bool on_mqtt_task() const;
+    esp_err_t publish_from_handler(std::string_view topic, std::string_view data, int qos, bool retain);
+    void take_handoff();
+    bool store_offline(std::string_view topic, std::string_view data, int qos, bool retain);
+    static bool restore_cb(const uint8_t* record, size_t len, void* ctx);
+    void drain();
+    static void drain_timer_cb(void* arg);
+
+    void on_connected(bool session_present);
+    void on_subscribed();
+    void on_data(esp_mqtt_event_handle_t event);
+    void route(std::string_view topic, std::string_view payload);
+
 public:
 
-    Mqtt_Connection() : client(nullptr) {}
+    Mqtt_Connection();
+    ~Mqtt_Connection();
+
+    Mqtt_Connection(const Mqtt_Connection&) = delete;
+    Mqtt_Connection& operator=(const Mqtt_Connection&) = delete;
 
     void begin(const std::string& broker_url);
+
+    void begin(const std::string& broker_url, const MqttOutboxConfig& outbox);
+
+    // MQTT 5: persistent session (reconnects skip resubscribing when the broker
+    // still has it), flow-control limits and topic aliases for hot QoS 0 topics
+    void begin(const std::string& broker_url, const MqttOutboxConfig& outbox, const MqttSessionConfig& session);
     
-    void publish(const std::string& topic, const std::string& data);
+    // Payload and topic are only read during the call; nothing is copied unless the
+    // client is busy and the message has to wait in the outbox queue. From a message
+    // handler the message is always copied and sent by the drain timer shortly after,
+    // in order with everything else; there the budget is memory_budget and the call
+    // never blocks (MQTT_BACKPRESSURE_BLOCK refuses instead).
+    esp_err_t publish(std::string_view topic, std::string_view data, int qos = 1, bool retain = false);
+
+    // Returns the number of messages accepted, in order; stops at the first refusal
+    size_t publish_batch(const MqttMessage* messages, size_t count);
+
+    // Not from a message handler: these wait for the outbox lock, which may be held by
+    // a task waiting for the MQTT task. There they log an error and return zeros.
+    mqtt_outbox_stats_t outbox_stats();
+
+    mqtt_session_stats_t session_stats();
+
+    // Persist publishes in store (already mounted) instead of RAM while the broker is
+    // unreachable or the outbox budget is exhausted. Once the store holds anything,
+    // later publishes go there too so order is kept; it drains behind the RAM outbox
+    // as soon as the client has room again. nullptr turns this off. Not from a
+    // message handler.
+    void set_offline_store(FlashLog* store);
+
+    // Remembered and sent again on every connect without a session; before the
+    // first connect it is only remembered
     void subscribe(const std::string& topic, int qos = 0);
-};
\ No newline at end of file
+
+    // Subscribe and route matching messages (filters may use '+' and '#') to handler.
+    // Handlers run on the MQTT task and get views valid only during the call; they
+    // may publish() and subscribe(), but not call outbox_stats() or session_stats().
+    // Returns a handler id for remove_handler, or -1 for a malformed filter.
+    int subscribe(const std::string& topic, int qos, MqttMessageHandler handler);
+
+    bool remove_handler(int handler_id);
+
+    // Fragmented messages larger than this are dropped instead of reassembled
+    static const size_t MAX_REASSEMBLED_SIZE = 64 * 1024;
+};
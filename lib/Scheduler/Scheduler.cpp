@@ -0,0 +1,150 @@
+#include "esp_log.h"
+#include "Scheduler.hpp"
+#include "Diagnostics.hpp"
+
+static const char* TAG = "Scheduler";
+
+// Job ids carry their worker in bit 31, which TimerWheel ids never use
+static const uint32_t CORE_BIT = 1u << 31;
+
+Scheduler::Scheduler(const SchedulerConfig& config)
+    : _config(config), _worker_count(config.dual_core && portNUM_PROCESSORS > 1 ? 2 : 1) {}
+
+Scheduler::~Scheduler() {
+    for (size_t i = 0; i < _worker_count; i++) {
+        Worker& w = _workers[i];
+        if (w.task) vTaskDelete(w.task);
+        if (w.timer) {
+            esp_timer_stop(w.timer);
+            esp_timer_delete(w.timer);
+        }
+        if (w.lock) vSemaphoreDelete(w.lock);
+        delete w.wheel;
+    }
+}
+
+esp_err_t Scheduler::begin() {
+    _late_hist = Diagnostics::instance().histogram("sched_late_us");
+
+    for (size_t i = 0; i < _worker_count; i++) {
+        Worker& w = _workers[i];
+        w.owner = this;
+        w.core = (int) i;
+        w.wheel = new TimerWheel(_config.max_jobs, _config.tick_us, esp_timer_get_time());
+        w.lock = xSemaphoreCreateMutex();
+
+        esp_timer_create_args_t timer_args = {};
+        timer_args.callback = wake_timer_cb;
+        timer_args.arg = &w;
+        timer_args.dispatch_method = ESP_TIMER_TASK;
+        timer_args.name = "sched_wake";
+        esp_err_t err = esp_timer_create(&timer_args, &w.timer);
+        if (err != ESP_OK) return err;
+
+        if (xTaskCreatePinnedToCore(worker_task, i ? "sched1" : "sched0", _config.stack_size, &w,
+                                    _config.priority, &w.task, w.core) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start worker on core %d", w.core);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+uint32_t Scheduler::every(uint32_t period_ms, TimerJobFn fn, int core) {
+    return schedule((uint64_t) period_ms * 1000, (uint64_t) period_ms * 1000, std::move(fn), core);
+}
+
+uint32_t Scheduler::after(uint32_t delay_ms, TimerJobFn fn, int core) {
+    return schedule((uint64_t) delay_ms * 1000, 0, std::move(fn), core);
+}
+
+uint32_t Scheduler::schedule(uint64_t delay_us, uint64_t period_us, TimerJobFn fn, int core) {
+    size_t index = core > 0 && _worker_count > 1 ? 1 : 0;
+    Worker& w = _workers[index];
+    if (!w.wheel) return 0;
+
+    xSemaphoreTake(w.lock, portMAX_DELAY);
+    uint32_t id = w.wheel->add(esp_timer_get_time(), delay_us, period_us, std::move(fn));
+    xSemaphoreGive(w.lock);
+
+    if (!id) {
+        ESP_LOGW(TAG, "Core %d worker full (%u jobs)", w.core, (unsigned) _config.max_jobs);
+        return 0;
+    }
+    // Let the worker re-arm its wake-up timer if this job is due earlier
+    if (xTaskGetCurrentTaskHandle() != w.task) xTaskNotifyGive(w.task);
+    return index ? id | CORE_BIT : id;
+}
+
+Scheduler::Worker* Scheduler::worker_for(uint32_t id) {
+    size_t index = (id & CORE_BIT) ? 1 : 0;
+    if (index >= _worker_count || !_workers[index].wheel) return nullptr;
+    return &_workers[index];
+}
+
+bool Scheduler::cancel(uint32_t id) {
+    Worker* w = worker_for(id);
+    if (!w) return false;
+    xSemaphoreTake(w->lock, portMAX_DELAY);
+    bool cancelled = w->wheel->cancel(id & ~CORE_BIT);
+    xSemaphoreGive(w->lock);
+    return cancelled;
+}
+
+bool Scheduler::job_stats(uint32_t id, timer_job_stats_t* out) {
+    Worker* w = worker_for(id);
+    if (!w) return false;
+    xSemaphoreTake(w->lock, portMAX_DELAY);
+    bool found = w->wheel->stats(id & ~CORE_BIT, out);
+    xSemaphoreGive(w->lock);
+    return found;
+}
+
+scheduler_stats_t Scheduler::stats(int core) {
+    Worker* w = worker_for(core > 0 ? CORE_BIT : 0);
+    if (!w) return {};
+    xSemaphoreTake(w->lock, portMAX_DELAY);
+    scheduler_stats_t s = w->stats;
+    s.jobs = w->wheel->size();
+    xSemaphoreGive(w->lock);
+    return s;
+}
+
+void Scheduler::wake_timer_cb(void* arg) {
+    xTaskNotifyGive(static_cast<Worker*>(arg)->task);
+}
+
+// Run everything due, unlocked so jobs can schedule and cancel, then sleep until
+// the wheel's next wake-up
+void Scheduler::worker_task(void* arg) {
+    Worker* w = static_cast<Worker*>(arg);
+    DiagHistogram* late_hist = w->owner->_late_hist;
+
+    while (true) {
+        xSemaphoreTake(w->lock, portMAX_DELAY);
+        w->stats.wakeups++;
+        uint32_t id;
+        TimerJobFn* fn;
+        while (w->wheel->pop_due(esp_timer_get_time(), &id, &fn)) {
+            uint32_t late = w->wheel->last_late_us();
+            w->stats.runs++;
+            if (late > w->stats.late_max_us) w->stats.late_max_us = late;
+            xSemaphoreGive(w->lock);
+
+            if (late_hist) late_hist->record(late);
+            (*fn)();
+
+            xSemaphoreTake(w->lock, portMAX_DELAY);
+            w->wheel->finish(id, esp_timer_get_time());
+        }
+        uint64_t wake_at = w->wheel->next_wakeup_us();
+        xSemaphoreGive(w->lock);
+
+        esp_timer_stop(w->timer);
+        if (wake_at != UINT64_MAX) {
+            int64_t now = esp_timer_get_time();
+            esp_timer_start_once(w->timer, wake_at > (uint64_t) now ? wake_at - now : 0);
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "TimerWheel.hpp"
+
+class DiagHistogram;
+
+struct SchedulerConfig {
+    size_t max_jobs = 32;          // Per worker
+    uint32_t tick_us = 1000;       // Timing resolution
+    uint32_t stack_size = 4096;    // Per worker; jobs run on this stack
+    UBaseType_t priority = 5;
+    bool dual_core = true;         // One worker per core; false runs everything on core 0
+};
+
+typedef struct {
+    uint32_t jobs;           // Scheduled right now
+    uint32_t runs;
+    uint32_t late_max_us;    // Worst start delay over all runs
+    uint32_t wakeups;        // Worker wake-ups (context switches into the worker)
+} scheduler_stats_t;
+
+// Runs many periodic and one-shot jobs on one worker task per core instead of a
+// task (and stack) per feature. Each worker sleeps until an esp_timer fires at
+// the next due time of its TimerWheel, runs what is due and goes back to sleep.
+// Jobs run one after another on the worker's stack: they must not block (no
+// vTaskDelay, no long waits); split them into steps or reschedule with after().
+// Start delays go to the "sched_late_us" Diagnostics histogram.
+class Scheduler {
+public:
+    explicit Scheduler(const SchedulerConfig& config = SchedulerConfig());
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    esp_err_t begin();
+
+    // First run one period from now. Returns a job id, or 0 if the worker is full.
+    uint32_t every(uint32_t period_ms, TimerJobFn fn, int core = 0);
+
+    uint32_t after(uint32_t delay_ms, TimerJobFn fn, int core = 0);
+
+    // period_us = 0 for a one-shot
+    uint32_t schedule(uint64_t delay_us, uint64_t period_us, TimerJobFn fn, int core = 0);
+
+    // Safe from any task and from inside a job, including the job itself
+    bool cancel(uint32_t id);
+
+    bool job_stats(uint32_t id, timer_job_stats_t* out);
+
+    scheduler_stats_t stats(int core = 0);
+
+private:
+    struct Worker {
+        Scheduler* owner = nullptr;
+        TimerWheel* wheel = nullptr;
+        SemaphoreHandle_t lock = nullptr;
+        TaskHandle_t task = nullptr;
+        esp_timer_handle_t timer = nullptr;
+        int core = 0;
+        scheduler_stats_t stats = {};
+    };
+
+    SchedulerConfig _config;
+    Worker _workers[2];
+    size_t _worker_count;
+    DiagHistogram* _late_hist = nullptr;
+
+    Worker* worker_for(uint32_t id);
+    static void worker_task(void* arg);
+    static void wake_timer_cb(void* arg);
+};
@@ -0,0 +1,308 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+typedef std::function<void()> TimerJobFn;
+
+typedef struct {
+    uint32_t runs;
+    uint32_t skipped;        // Periods dropped because a run started more than a period late
+    uint32_t late_max_us;    // Worst start delay past the due time
+    uint32_t late_avg_us;
+} timer_job_stats_t;
+
+// Hierarchical timer wheel: 4 levels of 64 slots, level 0 one tick per slot,
+// each higher level 64 times coarser. Adding, cancelling and firing a job are
+// O(1); a job far in the future moves down one level each time its slot comes
+// up. Driven entirely by the microsecond clock passed in, with no ESP-IDF calls,
+// so timing can be checked off-target against a simulated clock.
+//
+// Jobs never fire early: a job is due on the first tick at or after its due
+// time, so the resolution is tick_us. Periodic jobs are fixed-rate (due times
+// do not drift with run time); a run that starts more than a period late drops
+// the missed periods instead of running them back to back.
+//
+// Not thread-safe; Scheduler wraps one per worker task behind a mutex.
+class TimerWheel {
+public:
+    static const size_t MAX_CAPACITY = 4096;
+
+    TimerWheel(size_t max_jobs, uint32_t tick_us, uint64_t now_us)
+        : _tick_us(tick_us ? tick_us : 1), _tick(now_us / _tick_us) {
+        size_t n = max_jobs < MAX_CAPACITY ? max_jobs : MAX_CAPACITY;
+        _jobs.resize(n);
+        for (size_t i = 0; i < n; i++) _jobs[i].next = i + 1 < n ? (int32_t) (i + 1) : -1;
+        _free = n ? 0 : -1;
+        for (auto& head : _heads) head = -1;
+        for (auto& tail : _tails) tail = -1;
+    }
+
+    // period_us = 0 for a one-shot. Returns a job id (never 0, bit 31 always
+    // clear), or 0 when all max_jobs slots are in use.
+    uint32_t add(uint64_t now_us, uint64_t delay_us, uint64_t period_us, TimerJobFn fn) {
+        if (_free < 0) return 0;
+        int32_t idx = _free;
+        Entry& e = _jobs[idx];
+        _free = e.next;
+
+        e.fn = std::move(fn);
+        e.due_us = now_us + delay_us;
+        e.period_us = period_us;
+        e.cancelled = false;
+        e.runs = e.skipped = e.late_max_us = 0;
+        e.late_sum_us = 0;
+        _active++;
+        schedule(idx);
+        return id_of(idx);
+    }
+
+    // Remove a waiting job; a running one finishes but is not rescheduled
+    bool cancel(uint32_t id) {
+        int32_t idx = index_of(id);
+        if (idx < 0) return false;
+        Entry& e = _jobs[idx];
+        if (e.state == RUNNING) {
+            e.cancelled = true;
+        } else {
+            unlink(idx);
+            release(idx);
+        }
+        return true;
+    }
+
+    // Take the next job due at now_us. Its function stays valid (and the job
+    // cannot be reused) until finish(id) is called.
+    bool pop_due(uint64_t now_us, uint32_t* id, TimerJobFn** fn) {
+        uint64_t target = now_us / _tick_us;
+        while (_heads[DUE_LIST] < 0 && _tick < target) {
+            uint64_t next = next_wakeup_tick();
+            if (next > target) {
+                _tick = target;   // Nothing fires or cascades before target
+            } else {
+                _tick = next - 1;
+                step();
+            }
+        }
+
+        int32_t idx = _heads[DUE_LIST];
+        if (idx < 0) return false;
+        unlink(idx);
+
+        Entry& e = _jobs[idx];
+        e.state = RUNNING;
+        uint64_t late = now_us > e.due_us ? now_us - e.due_us : 0;
+        uint32_t late32 = late > UINT32_MAX ? UINT32_MAX : (uint32_t) late;
+        e.runs++;
+        e.late_sum_us += late32;
+        if (late32 > e.late_max_us) e.late_max_us = late32;
+        _last_late_us = late32;
+
+        *id = id_of(idx);
+        *fn = &e.fn;
+        return true;
+    }
+
+    // Start delay of the job last returned by pop_due
+    uint32_t last_late_us() const { return _last_late_us; }
+
+    void finish(uint32_t id, uint64_t now_us) {
+        int32_t idx = index_of(id);
+        if (idx < 0 || _jobs[idx].state != RUNNING) return;
+        Entry& e = _jobs[idx];
+        if (e.cancelled || e.period_us == 0) {
+            release(idx);
+            return;
+        }
+
+        e.due_us += e.period_us;
+        if (now_us > e.due_us) {
+            uint64_t missed = (now_us - e.due_us) / e.period_us;
+            e.skipped += (uint32_t) missed;
+            e.due_us += missed * e.period_us;
+        }
+        schedule(idx);
+    }
+
+    // Earliest time a job can become due (cascade points included), for sleeping
+    // until then; UINT64_MAX when nothing is waiting
+    uint64_t next_wakeup_us() const {
+        uint64_t tick = next_wakeup_tick();
+        return tick == UINT64_MAX ? UINT64_MAX : tick * _tick_us;
+    }
+
+    bool stats(uint32_t id, timer_job_stats_t* out) const {
+        int32_t idx = index_of(id);
+        if (idx < 0) return false;
+        const Entry& e = _jobs[idx];
+        out->runs = e.runs;
+        out->skipped = e.skipped;
+        out->late_max_us = e.late_max_us;
+        out->late_avg_us = e.runs ? (uint32_t) (e.late_sum_us / e.runs) : 0;
+        return true;
+    }
+
+    size_t size() const { return _active; }
+
+    size_t capacity() const { return _jobs.size(); }
+
+    uint32_t tick_us() const { return _tick_us; }
+
+private:
+    static const size_t LEVELS = 4;
+    static const size_t SLOT_BITS = 6;
+    static const size_t SLOTS = 1 << SLOT_BITS;
+    static const size_t DUE_LIST = LEVELS * SLOTS;
+    static const uint32_t INDEX_BITS = 12;
+    static const uint32_t GEN_MASK = (1u << (31 - INDEX_BITS)) - 1;
+
+    enum State : uint8_t { FREE, WAITING, RUNNING };
+
+    struct Entry {
+        TimerJobFn fn;
+        uint64_t due_us = 0;
+        uint64_t period_us = 0;
+        uint64_t expires = 0;        // Tick on which the job is due
+        uint64_t late_sum_us = 0;
+        int32_t prev = -1;
+        int32_t next = -1;
+        uint16_t list = 0;
+        uint32_t gen = 1;
+        uint32_t runs = 0;
+        uint32_t skipped = 0;
+        uint32_t late_max_us = 0;
+        State state = FREE;
+        bool cancelled = false;
+    };
+
+    std::vector<Entry> _jobs;
+    int32_t _heads[LEVELS * SLOTS + 1];
+    int32_t _tails[LEVELS * SLOTS + 1];
+    int32_t _free;
+    uint32_t _tick_us;
+    uint64_t _tick;                  // Last tick processed
+    size_t _active = 0;
+    uint32_t _last_late_us = 0;
+
+    uint32_t id_of(int32_t idx) const { return (_jobs[idx].gen << INDEX_BITS) | (uint32_t) idx; }
+
+    int32_t index_of(uint32_t id) const {
+        uint32_t idx = id & ((1u << INDEX_BITS) - 1);
+        if (idx >= _jobs.size()) return -1;
+        const Entry& e = _jobs[idx];
+        return e.state != FREE && e.gen == (id >> INDEX_BITS) ? (int32_t) idx : -1;
+    }
+
+    void release(int32_t idx) {
+        Entry& e = _jobs[idx];
+        e.fn = nullptr;   // Drop captures now, not when the slot is reused
+        e.state = FREE;
+        e.gen = (e.gen + 1) & GEN_MASK;
+        if (e.gen == 0) e.gen = 1;
+        e.next = _free;
+        _free = idx;
+        _active--;
+    }
+
+    void schedule(int32_t idx) {
+        Entry& e = _jobs[idx];
+        e.state = WAITING;
+        e.expires = (e.due_us + _tick_us - 1) / _tick_us;
+        place(idx);
+    }
+
+    // Slot for the job relative to the current tick; beyond the top level it is
+    // parked in the farthest top-level slot and re-placed when that cascades
+    void place(int32_t idx) {
+        Entry& e = _jobs[idx];
+        if (e.expires <= _tick) {
+            push_due(idx);
+            return;
+        }
+        uint64_t delta = e.expires - _tick;
+        uint64_t slot_tick = e.expires;
+        size_t level = 0;
+        while (level < LEVELS - 1 && delta >= (1ull << (SLOT_BITS * (level + 1)))) level++;
+        if (delta >= (1ull << (SLOT_BITS * LEVELS))) slot_tick = _tick + (1ull << (SLOT_BITS * LEVELS)) - 1;
+        size_t slot = (slot_tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+        push_back(level * SLOTS + slot, idx);
+    }
+
+    // Every list is FIFO, slots included, so jobs due on the same tick run in
+    // the order they were added or rescheduled, also after cascading
+    void push_back(size_t list, int32_t idx) {
+        Entry& e = _jobs[idx];
+        e.list = (uint16_t) list;
+        e.next = -1;
+        e.prev = _tails[list];
+        if (e.prev >= 0) _jobs[e.prev].next = idx;
+        else _heads[list] = idx;
+        _tails[list] = idx;
+    }
+
+    void push_due(int32_t idx) { push_back(DUE_LIST, idx); }
+
+    void unlink(int32_t idx) {
+        Entry& e = _jobs[idx];
+        if (e.prev >= 0) _jobs[e.prev].next = e.next;
+        else _heads[e.list] = e.next;
+        if (e.next >= 0) _jobs[e.next].prev = e.prev;
+        else _tails[e.list] = e.prev;
+        e.prev = e.next = -1;
+    }
+
+    // Detach a whole list, returning its first entry
+    int32_t take_list(size_t list) {
+        int32_t idx = _heads[list];
+        _heads[list] = _tails[list] = -1;
+        return idx;
+    }
+
+    // Re-place every job of a higher-level slot that has come up
+    void cascade(size_t level) {
+        size_t list = level * SLOTS + ((_tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+        int32_t idx = take_list(list);
+        while (idx >= 0) {
+            int32_t next = _jobs[idx].next;
+            place(idx);
+            idx = next;
+        }
+    }
+
+    // Advance one tick: cascade from the top down, then move level-0 jobs to the due list
+    void step() {
+        _tick++;
+        for (size_t level = LEVELS - 1; level > 0; level--) {
+            if ((_tick & ((1ull << (SLOT_BITS * level)) - 1)) == 0) cascade(level);
+        }
+        int32_t idx = take_list(_tick & (SLOTS - 1));
+        while (idx >= 0) {
+            int32_t next = _jobs[idx].next;
+            push_due(idx);
+            idx = next;
+        }
+    }
+
+    uint64_t next_wakeup_tick() const {
+        if (_heads[DUE_LIST] >= 0) return _tick;
+        uint64_t best = UINT64_MAX;
+        for (size_t k = 1; k < SLOTS; k++) {
+            if (_heads[(_tick + k) & (SLOTS - 1)] >= 0) {
+                best = _tick + k;
+                break;
+            }
+        }
+        for (size_t level = 1; level < LEVELS; level++) {
+            uint64_t block = _tick >> (SLOT_BITS * level);
+            for (size_t k = 1; k <= SLOTS; k++) {
+                if (_heads[level * SLOTS + ((block + k) & (SLOTS - 1))] >= 0) {
+                    uint64_t at = (block + k) << (SLOT_BITS * level);
+                    if (at < best) best = at;
+                    break;
+                }
+            }
+        }
+        return best;
+    }
+};
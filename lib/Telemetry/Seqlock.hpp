@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// Single-writer / multi-reader latest-value slot. The writer never waits; readers
+// retry if a store overlapped their copy. The payload is kept in relaxed atomic
+// words so a torn read is detected by the sequence check, not undefined behaviour.
+// The writer must not be preempted by a spinning reader on the same core
+// (TelemetryChannel wraps store() in a critical section for that reason).
+template <typename T>
+class Seqlock {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock requires a trivially copyable type");
+
+    Seqlock() {
+        for (auto& w : _data) w.store(0, std::memory_order_relaxed);
+    }
+
+    explicit Seqlock(const T& initial) : Seqlock() { store(initial); }
+
+    Seqlock(const Seqlock&) = delete;
+    Seqlock& operator=(const Seqlock&) = delete;
+
+    // Writer side; only one thread may call this
+    void store(const T& value) {
+        uint32_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) _data[i].store(words[i], std::memory_order_relaxed);
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // One read attempt; false if a store was in progress or overlapped the copy
+    bool try_load(T* out, uint32_t* version = nullptr) const {
+        uint32_t seq = _seq.load(std::memory_order_acquire);
+        if (seq & 1) return false;
+
+        uint32_t words[WORDS];
+        for (size_t i = 0; i < WORDS; i++) words[i] = _data[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_seq.load(std::memory_order_relaxed) != seq) return false;
+
+        memcpy(out, words, sizeof(T));
+        if (version) *version = seq / 2;
+        return true;
+    }
+
+    T load(uint32_t* version = nullptr) const {
+        T value;
+        while (!try_load(&value, version)) {
+        }
+        return value;
+    }
+
+    // Number of completed stores
+    uint32_t version() const { return _seq.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> _seq{0};
+    std::atomic<uint32_t> _data[WORDS];
+};
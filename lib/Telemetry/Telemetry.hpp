@@ -0,0 +1,464 @@
+#pragma once
+#include <limits>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include "JsonEscape.hpp"
+
+// Schema-driven telemetry serialization. A struct is described once by a constexpr
+// list of (name, member pointer) fields; encode_cbor / encode_json / decode_cbor walk
+// that list at compile time and work directly on a caller buffer, without heap use.
+// Supported members: bool, integers, float, double and char[N] strings.
+//
+//   constexpr auto sensor_schema = telemetry::schema<sensor_data_t>(
+//       telemetry::field("distance", &sensor_data_t::distance),
+//       telemetry::field("timestamp", &sensor_data_t::timestamp));
+//
+//   uint8_t buf[32];
+//   size_t n = telemetry::encode_cbor(sensor_schema, data, buf, sizeof(buf));
+
+namespace telemetry {
+
+static const char* const CBOR_CONTENT_TYPE = "application/cbor";
+static const char* const JSON_CONTENT_TYPE = "application/json";
+
+template <typename S, typename M>
+struct Field {
+    const char* name;
+    M S::*member;
+};
+
+template <typename S, typename M>
+constexpr Field<S, M> field(const char* name, M S::*member) {
+    return {name, member};
+}
+
+template <typename S, typename... Fields>
+struct Schema {
+    std::tuple<Fields...> fields;
+};
+
+template <typename S, typename... M>
+constexpr Schema<S, Field<S, M>...> schema(Field<S, M>... fields) {
+    return {{fields...}};
+}
+
+template <typename M>
+struct is_char_array : std::false_type {};
+
+template <size_t N>
+struct is_char_array<char[N]> : std::true_type {};
+
+// Binary payload as the string_view taken by Mqtt_Connection::publish
+inline std::string_view as_view(const uint8_t* buf, size_t len) {
+    return std::string_view((const char*) buf, len);
+}
+
+// IEEE 754 binary16 -> float (CBOR major type 7, additional info 25)
+inline float half_to_float(uint16_t h) {
+    int exp = (h >> 10) & 0x1F;
+    int mant = h & 0x3FF;
+    float f;
+    if (exp == 0) f = ldexpf((float) mant, -24);
+    else if (exp == 31) f = mant ? NAN : INFINITY;
+    else f = ldexpf((float) (mant + 1024), exp - 25);
+    return (h & 0x8000) ? -f : f;
+}
+
+// True when f survives a round trip through binary16 (normal halves, zero, inf, NaN)
+inline bool float_to_half_exact(float f, uint16_t* out) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint16_t sign = (uint16_t) ((bits >> 16) & 0x8000);
+    int exp = (int) ((bits >> 23) & 0xFF);
+    uint32_t mant = bits & 0x7FFFFF;
+
+    if (exp == 0xFF) {
+        *out = mant ? 0x7E00 : (uint16_t) (sign | 0x7C00);
+        return true;
+    }
+    if (exp == 0 && mant == 0) {
+        *out = sign;
+        return true;
+    }
+    int hexp = exp - 127 + 15;
+    if (hexp <= 0 || hexp >= 31 || (mant & 0x1FFF)) return false;
+    *out = (uint16_t) (sign | (hexp << 10) | (mant >> 13));
+    return true;
+}
+
+// Appends CBOR items (RFC 8949, preferred serialization) to a fixed buffer.
+// Floats use the shortest of half / single / double that is lossless.
+class CborWriter {
+public:
+    CborWriter(uint8_t* buf, size_t cap) : _buf(buf), _cap(cap) {}
+
+    void begin_map(size_t pairs) { head(5, pairs); }
+    void end_map() {}
+
+    template <typename M>
+    void member(const char* name, const M& value) {
+        text(name, strlen(name));
+        write(value);
+    }
+
+    template <typename M>
+    void write(const M& value) {
+        if constexpr (std::is_same_v<M, bool>) {
+            byte(value ? 0xF5 : 0xF4);
+        } else if constexpr (std::is_integral_v<M> && std::is_signed_v<M>) {
+            if (value < 0) head(1, (uint64_t) (-1 - (int64_t) value));
+            else head(0, (uint64_t) value);
+        } else if constexpr (std::is_integral_v<M>) {
+            head(0, (uint64_t) value);
+        } else if constexpr (std::is_same_v<M, float>) {
+            write_float(value);
+        } else if constexpr (std::is_same_v<M, double>) {
+            write_double(value);
+        } else if constexpr (is_char_array<M>::value) {
+            text(value, strnlen(value, sizeof(M)));
+        } else {
+            static_assert(sizeof(M) == 0, "unsupported telemetry field type");
+        }
+    }
+
+    void text(const char* s, size_t len) {
+        head(3, len);
+        put(s, len);
+    }
+
+    // Bytes written, or 0 if the buffer was too small
+    size_t size() const { return _overflow ? 0 : _len; }
+
+private:
+    uint8_t* _buf;
+    size_t _cap;
+    size_t _len = 0;
+    bool _overflow = false;
+
+    void byte(uint8_t b) {
+        if (_len < _cap) _buf[_len++] = b;
+        else _overflow = true;
+    }
+
+    void put(const void* data, size_t len) {
+        if (_cap - _len < len) {
+            _overflow = true;
+            return;
+        }
+        memcpy(_buf + _len, data, len);
+        _len += len;
+    }
+
+    void big_endian(uint64_t v, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--) byte((uint8_t) (v >> (8 * i)));
+    }
+
+    void head(uint8_t major, uint64_t arg) {
+        uint8_t m = (uint8_t) (major << 5);
+        if (arg < 24) {
+            byte((uint8_t) (m | arg));
+        } else if (arg <= 0xFF) {
+            byte(m | 24);
+            big_endian(arg, 1);
+        } else if (arg <= 0xFFFF) {
+            byte(m | 25);
+            big_endian(arg, 2);
+        } else if (arg <= 0xFFFFFFFFu) {
+            byte(m | 26);
+            big_endian(arg, 4);
+        } else {
+            byte(m | 27);
+            big_endian(arg, 8);
+        }
+    }
+
+    void write_float(float f) {
+        uint16_t half;
+        if (float_to_half_exact(f, &half)) {
+            byte(0xF9);
+            big_endian(half, 2);
+            return;
+        }
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        byte(0xFA);
+        big_endian(bits, 4);
+    }
+
+    void write_double(double d) {
+        if (d != d || (double) (float) d == d) {
+            write_float((float) d);
+            return;
+        }
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        byte(0xFB);
+        big_endian(bits, 8);
+    }
+};
+
+// Compact JSON with the same member interface, for consumers that cannot read CBOR.
+// NaN and infinities are written as null.
+class JsonWriter {
+public:
+    JsonWriter(char* buf, size_t cap) : _buf(buf), _cap(cap) {}
+
+    void begin_map(size_t) { put("{", 1); }
+    void end_map() { put("}", 1); }
+
+    template <typename M>
+    void member(const char* name, const M& value) {
+        if (_members++) put(",", 1);
+        quoted(name, strlen(name));
+        put(":", 1);
+        write(value);
+    }
+
+    template <typename M>
+    void write(const M& value) {
+        char num[32];
+        int n = 0;
+        if constexpr (std::is_same_v<M, bool>) {
+            if (value) put("true", 4);
+            else put("false", 5);
+        } else if constexpr (std::is_integral_v<M> && std::is_signed_v<M>) {
+            n = snprintf(num, sizeof(num), "%lld", (long long) value);
+        } else if constexpr (std::is_integral_v<M>) {
+            n = snprintf(num, sizeof(num), "%llu", (unsigned long long) value);
+        } else if constexpr (std::is_floating_point_v<M>) {
+            if (isfinite(value)) n = snprintf(num, sizeof(num), std::is_same_v<M, float> ? "%.7g" : "%.15g", (double) value);
+            else put("null", 4);
+        } else if constexpr (is_char_array<M>::value) {
+            quoted(value, strnlen(value, sizeof(M)));
+        } else {
+            static_assert(sizeof(M) == 0, "unsupported telemetry field type");
+        }
+        if (n > 0) put(num, (size_t) n);
+    }
+
+    // Bytes written (no terminator), or 0 if the buffer was too small
+    size_t size() const { return _overflow ? 0 : _len; }
+
+private:
+    char* _buf;
+    size_t _cap;
+    size_t _len = 0;
+    size_t _members = 0;
+    bool _overflow = false;
+
+    void put(const char* data, size_t len) {
+        if (_cap - _len < len) {
+            _overflow = true;
+            return;
+        }
+        memcpy(_buf + _len, data, len);
+        _len += len;
+    }
+
+    void quoted(const char* s, size_t len) {
+        put("\"", 1);
+        if (!_overflow) {
+            size_t n = json_escape(s, len, _buf + _len, _cap - _len);
+            if (n == SIZE_MAX) _overflow = true;
+            else _len += n;
+        }
+        put("\"", 1);
+    }
+};
+
+// Reads the definite-length CBOR subset produced by CborWriter, tolerating
+// integer/float width differences and skipping items it does not need.
+class CborReader {
+public:
+    CborReader(const uint8_t* buf, size_t len) : _buf(buf), _len(len) {}
+
+    bool map(uint64_t* pairs) {
+        uint8_t major;
+        return head(&major, pairs) && major == 5;
+    }
+
+    bool text(const char** s, size_t* len) {
+        uint8_t major;
+        uint64_t n;
+        if (!head(&major, &n) || major != 3 || n > _len - _pos) return false;
+        *s = (const char*) _buf + _pos;
+        *len = (size_t) n;
+        _pos += (size_t) n;
+        return true;
+    }
+
+    template <typename M>
+    bool read(M& out) {
+        if constexpr (std::is_same_v<M, bool>) {
+            if (_pos >= _len || (_buf[_pos] != 0xF4 && _buf[_pos] != 0xF5)) return false;
+            out = _buf[_pos++] == 0xF5;
+            return true;
+        } else if constexpr (std::is_integral_v<M>) {
+            uint8_t major;
+            uint64_t arg;
+            if (!head(&major, &arg)) return false;
+            if (major == 0) {
+                if (arg > (uint64_t) std::numeric_limits<M>::max()) return false;
+                out = (M) arg;
+                return true;
+            }
+            if constexpr (std::is_signed_v<M>) {
+                if (major == 1 && arg <= (uint64_t) -(std::numeric_limits<M>::min() + 1)) {
+                    out = (M) (-1 - (int64_t) arg);
+                    return true;
+                }
+            }
+            return false;
+        } else if constexpr (std::is_floating_point_v<M>) {
+            double d;
+            if (!number(&d)) return false;
+            out = (M) d;
+            return true;
+        } else if constexpr (is_char_array<M>::value) {
+            const char* s;
+            size_t n;
+            if (!text(&s, &n)) return false;
+            if (n >= sizeof(M)) n = sizeof(M) - 1;   // Truncate to fit the terminator
+            memcpy(out, s, n);
+            out[n] = '\0';
+            return true;
+        } else {
+            static_assert(sizeof(M) == 0, "unsupported telemetry field type");
+        }
+    }
+
+    // Skip one complete item, including nested arrays and maps
+    bool skip(int depth = 0) {
+        if (depth > MAX_DEPTH) return false;
+        uint8_t major;
+        uint64_t arg;
+        if (!head(&major, &arg)) return false;
+        switch (major) {
+            case 2:
+            case 3:
+                if (arg > _len - _pos) return false;
+                _pos += (size_t) arg;
+                return true;
+            case 4:
+            case 5:
+                for (uint64_t i = 0; i < (major == 5 ? arg * 2 : arg); i++) {
+                    if (!skip(depth + 1)) return false;
+                }
+                return true;
+            case 6:
+                return skip(depth + 1);
+            default:
+                return true;
+        }
+    }
+
+private:
+    static const int MAX_DEPTH = 8;
+
+    const uint8_t* _buf;
+    size_t _len;
+    size_t _pos = 0;
+
+    // Decode an initial byte and its argument; for floats the argument is the raw bits
+    bool head(uint8_t* major, uint64_t* arg) {
+        if (_pos >= _len) return false;
+        uint8_t ib = _buf[_pos++];
+        *major = ib >> 5;
+        uint8_t info = ib & 0x1F;
+        if (info < 24) {
+            *arg = info;
+            return true;
+        }
+        if (info > 27) return false;   // Indefinite lengths are not produced by CborWriter
+        size_t width = (size_t) 1 << (info - 24);
+        if (width > _len - _pos) return false;
+        uint64_t v = 0;
+        for (size_t i = 0; i < width; i++) v = (v << 8) | _buf[_pos++];
+        *arg = v;
+        return true;
+    }
+
+    bool number(double* out) {
+        if (_pos >= _len) return false;
+        uint8_t ib = _buf[_pos];
+        uint8_t major;
+        uint64_t arg;
+        if (!head(&major, &arg)) return false;
+        if (major == 0) {
+            *out = (double) arg;
+        } else if (major == 1) {
+            *out = -1.0 - (double) arg;
+        } else if (ib == 0xF9) {
+            *out = half_to_float((uint16_t) arg);
+        } else if (ib == 0xFA) {
+            uint32_t bits = (uint32_t) arg;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            *out = f;
+        } else if (ib == 0xFB) {
+            memcpy(out, &arg, sizeof(*out));
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+template <typename W, typename S, typename... F>
+size_t encode(const Schema<S, F...>& schema, const S& obj, W& writer) {
+    writer.begin_map(sizeof...(F));
+    std::apply([&](const auto&... f) { (writer.member(f.name, obj.*(f.member)), ...); }, schema.fields);
+    writer.end_map();
+    return writer.size();
+}
+
+// Returns the encoded length, or 0 if buf is too small
+template <typename S, typename... F>
+size_t encode_cbor(const Schema<S, F...>& schema, const S& obj, uint8_t* buf, size_t cap) {
+    CborWriter writer(buf, cap);
+    return encode(schema, obj, writer);
+}
+
+template <typename S, typename... F>
+size_t encode_json(const Schema<S, F...>& schema, const S& obj, char* buf, size_t cap) {
+    JsonWriter writer(buf, cap);
+    return encode(schema, obj, writer);
+}
+
+// Fill obj from a CBOR map. Unknown keys are skipped and missing ones leave the
+// member untouched; returns false on malformed input or a value that does not fit.
+template <typename S, typename... F>
+bool decode_cbor(const Schema<S, F...>& schema, const uint8_t* buf, size_t len, S& obj) {
+    CborReader reader(buf, len);
+    uint64_t pairs;
+    if (!reader.map(&pairs)) return false;
+
+    for (uint64_t i = 0; i < pairs; i++) {
+        const char* key;
+        size_t key_len;
+        if (!reader.text(&key, &key_len)) return false;
+
+        bool matched = false;
+        bool ok = true;
+        std::apply([&](const auto&... f) {
+            auto visit = [&](const auto& fd) {
+                if (matched || strncmp(fd.name, key, key_len) != 0 || fd.name[key_len] != '\0') return;
+                matched = true;
+                ok = reader.read(obj.*(fd.member));
+            };
+            (visit(f), ...);
+        }, schema.fields);
+
+        if (!matched) ok = reader.skip();
+        if (!ok) return false;
+    }
+    return true;
+}
+
+}  // namespace telemetry
@@ -0,0 +1,81 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+#include <atomic>
+#include "Seqlock.hpp"
+
+// Latest-value channel for sharing sensor state between tasks on either core.
+// One producer publishes; any number of readers poll read() without blocking the
+// producer or each other, so there is no mutex to time out on and no priority
+// inversion. Readers that want to sleep until a new value subscribe for a
+// wake-up bit (up to MAX_READERS per channel) and call wait().
+template <typename T>
+class TelemetryChannel {
+public:
+    static const int MAX_READERS = 24;   // Usable event group bits
+
+    TelemetryChannel() : _changed(xEventGroupCreate()) {}
+
+    explicit TelemetryChannel(const T& initial) : TelemetryChannel() { _slot.store(initial); }
+
+    ~TelemetryChannel() { vEventGroupDelete(_changed); }
+
+    TelemetryChannel(const TelemetryChannel&) = delete;
+    TelemetryChannel& operator=(const TelemetryChannel&) = delete;
+
+    // Producer side (single task). The store runs with interrupts off on this core,
+    // so a reader can never spin on a half-written value behind a preempted writer.
+    void publish(const T& value) {
+        portENTER_CRITICAL(&_mux);
+        _slot.store(value);
+        portEXIT_CRITICAL(&_mux);
+
+        EventBits_t readers = _readers.load(std::memory_order_acquire);
+        if (readers) xEventGroupSetBits(_changed, readers);
+    }
+
+    T read(uint32_t* version = nullptr) const { return _slot.load(version); }
+
+    uint32_t version() const { return _slot.version(); }
+
+    // Reserve a wake-up bit for one waiting task; returns 0 when all are taken
+    EventBits_t subscribe() {
+        EventBits_t readers = _readers.load(std::memory_order_relaxed);
+        while (true) {
+            int i = 0;
+            while (i < MAX_READERS && (readers & (1u << i))) i++;
+            if (i == MAX_READERS) return 0;
+            EventBits_t bit = 1u << i;
+            if (_readers.compare_exchange_weak(readers, readers | bit, std::memory_order_acq_rel)) {
+                xEventGroupClearBits(_changed, bit);
+                return bit;
+            }
+        }
+    }
+
+    void unsubscribe(EventBits_t reader) {
+        _readers.fetch_and(~reader, std::memory_order_acq_rel);
+    }
+
+    // Sleep until a value newer than *version is published, then read it and update
+    // *version. Returns false on timeout. A change that happened before the call
+    // returns immediately, so no update is missed between two waits.
+    bool wait(EventBits_t reader, T* out, uint32_t* version, TickType_t timeout) {
+        TickType_t start = xTaskGetTickCount();
+        while (_slot.version() == *version) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (timeout != portMAX_DELAY && elapsed >= timeout) return false;
+            TickType_t remaining = timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed;
+            xEventGroupWaitBits(_changed, reader, pdTRUE, pdTRUE, remaining);
+        }
+        *out = _slot.load(version);
+        return true;
+    }
+
+private:
+    Seqlock<T> _slot;
+    EventGroupHandle_t _changed;
+    std::atomic<EventBits_t> _readers{0};
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+};
@@ -0,0 +1,249 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "Ultrasonic.hpp"
+
+static const char* TAG = "Ultrasonic";
+
+// Echo rise arrives roughly 500 us after the trigger; leave headroom on top of the max pulse
+static const uint32_t ECHO_START_MARGIN_US = 2000;
+
+static const UBaseType_t COMPLETION_QUEUE_LEN = 8;
+
+// How long the timeout path waits for room in a full completion queue
+static const TickType_t COMPLETION_SEND_WAIT = pdMS_TO_TICKS(50);
+
+QueueHandle_t Ultrasonic::_completions = nullptr;
+rmt_encoder_handle_t Ultrasonic::_copy_encoder = nullptr;
+mcpwm_cap_timer_handle_t Ultrasonic::_cap_timers[2] = {};
+int Ultrasonic::_cap_timer_refs[2] = {};
+std::atomic<uint32_t> Ultrasonic::_dropped{0};
+
+// Created on first use under the C++ static-init guard, so sensors calling
+// begin() from different tasks share one queue, one dispatcher and one lock
+SemaphoreHandle_t Ultrasonic::shared_lock() {
+    static SemaphoreHandle_t lock = [] {
+        _completions = xQueueCreate(COMPLETION_QUEUE_LEN, sizeof(Completion));
+        xTaskCreate(dispatcher_task, "ultrasonic", 3072, nullptr, 5, nullptr);
+        return xSemaphoreCreateMutex();
+    }();
+    return lock;
+}
+
+Ultrasonic::Ultrasonic(gpio_num_t trig_pin, gpio_num_t echo_pin, float max_range_cm)
+    : _trig_pin(trig_pin), _echo_pin(echo_pin) {
+    _max_pulse_us = ultrasonic::max_pulse_us(max_range_cm);
+    _timeout_us = _max_pulse_us + ECHO_START_MARGIN_US;
+    _sync_done = xSemaphoreCreateBinary();
+}
+
+Ultrasonic::~Ultrasonic() {
+    if (_timeout_timer) {
+        esp_timer_stop(_timeout_timer);
+        esp_timer_delete(_timeout_timer);
+    }
+    if (_cap_chan) {
+        mcpwm_capture_channel_disable(_cap_chan);
+        xSemaphoreTake(shared_lock(), portMAX_DELAY);
+        mcpwm_del_capture_channel(_cap_chan);
+        if (--_cap_timer_refs[_cap_group] == 0) {
+            mcpwm_capture_timer_stop(_cap_timers[_cap_group]);
+            mcpwm_capture_timer_disable(_cap_timers[_cap_group]);
+            mcpwm_del_capture_timer(_cap_timers[_cap_group]);
+            _cap_timers[_cap_group] = nullptr;
+        }
+        xSemaphoreGive(shared_lock());
+    }
+    if (_trig_chan) {
+        rmt_disable(_trig_chan);
+        rmt_del_channel(_trig_chan);
+    }
+    vSemaphoreDelete(_sync_done);
+}
+
+// Allocate the RMT trigger, an MCPWM capture channel on any free group and the timeout timer
+esp_err_t Ultrasonic::begin() {
+    SemaphoreHandle_t lock = shared_lock();
+
+    rmt_tx_channel_config_t tx_cfg = {};
+    tx_cfg.gpio_num = _trig_pin;
+    tx_cfg.clk_src = RMT_CLK_SRC_DEFAULT;
+    tx_cfg.resolution_hz = 1000000;  // 1 tick = 1 us
+    tx_cfg.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+    tx_cfg.trans_queue_depth = 2;
+    esp_err_t err = rmt_new_tx_channel(&tx_cfg, &_trig_chan);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No RMT channel for trigger pin %d: %s", _trig_pin, esp_err_to_name(err));
+        return err;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (!_copy_encoder) {
+        rmt_copy_encoder_config_t enc_cfg = {};
+        ESP_ERROR_CHECK(rmt_new_copy_encoder(&enc_cfg, &_copy_encoder));
+    }
+    xSemaphoreGive(lock);
+    ESP_ERROR_CHECK(rmt_enable(_trig_chan));
+
+    _trig_symbol.level0 = 1;
+    _trig_symbol.duration0 = 10;
+    _trig_symbol.level1 = 0;
+    _trig_symbol.duration1 = 1;
+
+    mcpwm_capture_channel_config_t cap_ch_conf = {};
+    cap_ch_conf.gpio_num = _echo_pin;
+    cap_ch_conf.prescale = 1;
+    cap_ch_conf.flags.pos_edge = true;
+    cap_ch_conf.flags.neg_edge = true;
+    cap_ch_conf.flags.pull_up = true;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    err = attach_capture(&cap_ch_conf);
+    xSemaphoreGive(lock);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No MCPWM capture channel for echo pin %d", _echo_pin);
+        return err;
+    }
+    mcpwm_capture_timer_get_resolution(_cap_timers[_cap_group], &_cap_resolution_hz);
+
+    mcpwm_capture_event_callbacks_t cbs = {};
+    cbs.on_cap = on_capture;
+    ESP_ERROR_CHECK(mcpwm_capture_channel_register_event_callbacks(_cap_chan, &cbs, this));
+    ESP_ERROR_CHECK(mcpwm_capture_channel_enable(_cap_chan));
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = on_timeout;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "ultrasonic_to";
+    return esp_timer_create(&timer_args, &_timeout_timer);
+}
+
+// Capture channel on the first group with room, sharing that group's timer; caller holds shared_lock()
+esp_err_t Ultrasonic::attach_capture(const mcpwm_capture_channel_config_t* cap_ch_conf) {
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    for (int group = 0; group < 2 && err != ESP_OK; group++) {
+        bool new_timer = _cap_timers[group] == nullptr;
+        if (new_timer) {
+            mcpwm_capture_timer_config_t cap_conf = {};
+            cap_conf.clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT;
+            cap_conf.group_id = group;
+            if (mcpwm_new_capture_timer(&cap_conf, &_cap_timers[group]) != ESP_OK) continue;
+        }
+
+        err = mcpwm_new_capture_channel(_cap_timers[group], cap_ch_conf, &_cap_chan);
+        if (err == ESP_OK) {
+            _cap_group = group;
+            _cap_timer_refs[group]++;
+            if (new_timer) {
+                ESP_ERROR_CHECK(mcpwm_capture_timer_enable(_cap_timers[group]));
+                ESP_ERROR_CHECK(mcpwm_capture_timer_start(_cap_timers[group]));
+            }
+        } else if (new_timer) {
+            mcpwm_del_capture_timer(_cap_timers[group]);
+            _cap_timers[group] = nullptr;
+        }
+    }
+    return err;
+}
+
+esp_err_t Ultrasonic::measure_async(ultrasonic_callback_t callback, void* user_ctx) {
+    if (!_trig_chan || !_cap_chan) return ESP_ERR_INVALID_STATE;
+
+    uint8_t expected = IDLE;
+    if (!_state.compare_exchange_strong(expected, WAIT_RISE)) return ESP_ERR_INVALID_STATE;
+
+    _callback = callback;
+    _callback_ctx = user_ctx;
+    _trigger_us = esp_timer_get_time();
+    esp_timer_stop(_timeout_timer);
+    esp_timer_start_once(_timeout_timer, _timeout_us);
+
+    rmt_transmit_config_t tx_conf = {};
+    esp_err_t err = rmt_transmit(_trig_chan, _copy_encoder, &_trig_symbol, sizeof(_trig_symbol), &tx_conf);
+    if (err != ESP_OK) {
+        esp_timer_stop(_timeout_timer);
+        _state.store(IDLE);
+    }
+    return err;
+}
+
+esp_err_t Ultrasonic::measure(ultrasonic_result_t* result, TickType_t wait) {
+    xSemaphoreTake(_sync_done, 0);  // Drop a result left over from an earlier timed-out wait
+    esp_err_t err = measure_async(sync_callback, this);
+    if (err != ESP_OK) return err;
+    if (xSemaphoreTake(_sync_done, wait) != pdTRUE) return ESP_ERR_TIMEOUT;
+    *result = _sync_result;
+    return ESP_OK;
+}
+
+// Capture ISR: latch the rising edge, complete on the falling edge
+bool IRAM_ATTR Ultrasonic::on_capture(mcpwm_cap_channel_handle_t cap_chan,
+                                      const mcpwm_capture_event_data_t* edata, void* user_data) {
+    Ultrasonic* obj = (Ultrasonic*) user_data;
+
+    if (edata->cap_edge == MCPWM_CAP_EDGE_POS) {
+        obj->_rise_ticks = edata->cap_value;
+        uint8_t expected = WAIT_RISE;
+        obj->_state.compare_exchange_strong(expected, WAIT_FALL);
+        return false;
+    }
+
+    uint8_t expected = WAIT_FALL;
+    if (!obj->_state.compare_exchange_strong(expected, IDLE)) return false;
+
+    uint32_t ticks = ultrasonic::tick_delta(obj->_rise_ticks, edata->cap_value);
+    Completion c;
+    c.callback = obj->_callback;
+    c.user_ctx = obj->_callback_ctx;
+    c.result.pulse_us = ultrasonic::ticks_to_us(ticks, obj->_cap_resolution_hz);
+    c.result.status = ultrasonic::classify(c.result.pulse_us, obj->_max_pulse_us);
+    c.result.distance_cm = ultrasonic::pulse_us_to_cm(c.result.pulse_us);
+    c.result.timestamp_us = obj->_trigger_us;
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    if (xQueueSendFromISR(_completions, &c, &xHigherPriorityTaskWoken) != pdTRUE) {
+        // Queue full: keep the sensor busy and let the armed timeout report it
+        _dropped++;
+        obj->_state.store(LOST);
+    }
+    return xHigherPriorityTaskWoken == pdTRUE;
+}
+
+// Deadline expired without a falling edge
+void Ultrasonic::on_timeout(void* arg) {
+    Ultrasonic* obj = (Ultrasonic*) arg;
+    uint8_t state = obj->_state.load();
+    if (state == IDLE) return;
+    // A stale expiry from a previous measurement must not cut the current one short
+    if (esp_timer_get_time() - obj->_trigger_us < (int64_t) obj->_timeout_us) return;
+    if (!obj->_state.compare_exchange_strong(state, IDLE)) return;
+
+    Completion c;
+    c.callback = obj->_callback;
+    c.user_ctx = obj->_callback_ctx;
+    c.result.status = state == WAIT_FALL ? ULTRASONIC_OUT_OF_RANGE : ULTRASONIC_TIMEOUT;
+    c.result.pulse_us = 0;
+    c.result.distance_cm = 0.0f;
+    c.result.timestamp_us = obj->_trigger_us;
+    if (xQueueSend(_completions, &c, COMPLETION_SEND_WAIT) != pdTRUE) {
+        _dropped++;
+        ESP_LOGW(TAG, "Completion queue full, result for echo pin %d lost", obj->_echo_pin);
+    }
+}
+
+void Ultrasonic::sync_callback(const ultrasonic_result_t* result, void* user_ctx) {
+    Ultrasonic* obj = (Ultrasonic*) user_ctx;
+    obj->_sync_result = *result;
+    xSemaphoreGive(obj->_sync_done);
+}
+
+// Runs user callbacks for every sensor outside interrupt context
+void Ultrasonic::dispatcher_task(void* arg) {
+    Completion c;
+    while (true) {
+        if (xQueueReceive(_completions, &c, portMAX_DELAY) == pdTRUE && c.callback) {
+            c.callback(&c.result, c.user_ctx);
+        }
+    }
+}
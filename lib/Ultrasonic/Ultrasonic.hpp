@@ -0,0 +1,91 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "driver/rmt_tx.h"
+#include "driver/mcpwm_cap.h"
+#include "esp_timer.h"
+#include <atomic>
+#include "UltrasonicMath.hpp"
+
+typedef struct {
+    ultrasonic_status_t status;
+    float distance_cm;
+    uint32_t pulse_us;
+    int64_t timestamp_us;
+} ultrasonic_result_t;
+
+typedef void (*ultrasonic_callback_t)(const ultrasonic_result_t* result, void* user_ctx);
+
+// HC-SR04 ranging without busy-waiting. The 10 us trigger pulse is generated by
+// an RMT channel and both echo edges are timestamped by an MCPWM capture channel,
+// so the CPU is idle until the falling edge or the timeout arrives. Results are
+// delivered from a shared dispatcher task, never from ISR context.
+class Ultrasonic {
+public:
+    Ultrasonic(gpio_num_t trig_pin, gpio_num_t echo_pin, float max_range_cm = 400.0f);
+    ~Ultrasonic();
+
+    Ultrasonic(const Ultrasonic&) = delete;
+    Ultrasonic& operator=(const Ultrasonic&) = delete;
+
+    esp_err_t begin();
+
+    // Start a measurement; callback runs in the dispatcher task
+    esp_err_t measure_async(ultrasonic_callback_t callback, void* user_ctx);
+
+    // Start a measurement and block (not spin) until its result is ready
+    esp_err_t measure(ultrasonic_result_t* result, TickType_t wait);
+
+    // Echoes whose result did not fit in the dispatcher queue; each is reported
+    // as ULTRASONIC_TIMEOUT once the measurement deadline passes
+    static uint32_t dropped_completions() { return _dropped.load(); }
+
+private:
+    enum State : uint8_t { IDLE, WAIT_RISE, WAIT_FALL, LOST };   // LOST: result dropped, timeout reports it
+
+    struct Completion {
+        ultrasonic_callback_t callback;
+        void* user_ctx;
+        ultrasonic_result_t result;
+    };
+
+    gpio_num_t _trig_pin;
+    gpio_num_t _echo_pin;
+    uint32_t _max_pulse_us;
+    uint32_t _timeout_us;
+
+    rmt_channel_handle_t _trig_chan = nullptr;
+    rmt_symbol_word_t _trig_symbol;
+    mcpwm_cap_channel_handle_t _cap_chan = nullptr;
+    int _cap_group = -1;
+    uint32_t _cap_resolution_hz = 0;
+    esp_timer_handle_t _timeout_timer = nullptr;
+
+    std::atomic<uint8_t> _state{IDLE};
+    uint32_t _rise_ticks = 0;
+    int64_t _trigger_us = 0;
+
+    ultrasonic_callback_t _callback = nullptr;
+    void* _callback_ctx = nullptr;
+    SemaphoreHandle_t _sync_done;
+    ultrasonic_result_t _sync_result;
+
+    // Shared by all sensors. The queue and dispatcher are created once; the
+    // encoder and capture timers are guarded by shared_lock()
+    static QueueHandle_t _completions;
+    static rmt_encoder_handle_t _copy_encoder;
+    static mcpwm_cap_timer_handle_t _cap_timers[2];
+    static int _cap_timer_refs[2];
+    static std::atomic<uint32_t> _dropped;
+
+    static SemaphoreHandle_t shared_lock();
+    esp_err_t attach_capture(const mcpwm_capture_channel_config_t* cap_ch_conf);
+
+    static bool IRAM_ATTR on_capture(mcpwm_cap_channel_handle_t cap_chan,
+                                     const mcpwm_capture_event_data_t* edata, void* user_data);
+    static void on_timeout(void* arg);
+    static void sync_callback(const ultrasonic_result_t* result, void* user_ctx);
+    static void dispatcher_task(void* arg);
+};
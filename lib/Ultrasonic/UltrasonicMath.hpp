@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+
+typedef enum {
+    ULTRASONIC_OK = 0,
+    ULTRASONIC_TIMEOUT,       // No falling edge before the deadline
+    ULTRASONIC_OUT_OF_RANGE,  // Echo longer than the configured maximum range
+} ultrasonic_status_t;
+
+// Echo timing math shared by the driver; no hardware dependencies
+namespace ultrasonic {
+
+constexpr float SPEED_OF_SOUND_CM_PER_US = 0.0343f;
+
+// Capture timer delta with 32-bit wraparound
+inline uint32_t tick_delta(uint32_t start_ticks, uint32_t end_ticks) {
+    return end_ticks - start_ticks;
+}
+
+inline uint32_t ticks_to_us(uint32_t ticks, uint32_t resolution_hz) {
+    return (uint32_t) (((uint64_t) ticks * 1000000ULL) / resolution_hz);
+}
+
+// Round-trip echo pulse width to one-way distance
+inline float pulse_us_to_cm(uint32_t pulse_us) {
+    return (float) pulse_us * SPEED_OF_SOUND_CM_PER_US / 2.0f;
+}
+
+// Longest echo pulse expected for a target at max_range_cm
+inline uint32_t max_pulse_us(float max_range_cm) {
+    return (uint32_t) (max_range_cm * 2.0f / SPEED_OF_SOUND_CM_PER_US);
+}
+
+inline ultrasonic_status_t classify(uint32_t pulse_us, uint32_t max_pulse) {
+    return pulse_us > max_pulse ? ULTRASONIC_OUT_OF_RANGE : ULTRASONIC_OK;
+}
+
+}  // namespace ultrasonic
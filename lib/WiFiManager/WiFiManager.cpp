@@ -1,79 +1,260 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "esp_random.h"
 #include "WiFiManager.hpp"
 
 static const char* TAG = "WiFiManager";
 
+static const char* NVS_NAMESPACE = "wifi_mgr";
+static const char* NVS_CACHE_KEY = "ap";
+
+// Timer expiries are posted to the default event loop so that every policy
+// decision runs in the same task as the driver events
+ESP_EVENT_DEFINE_BASE(WIFI_MANAGER_EVENT);
+
+enum {
+    WIFI_MANAGER_BACKOFF_ELAPSED,
+    WIFI_MANAGER_ATTEMPT_TIMEOUT,
+};
+
 WiFiManager::WiFiManager(const std::string& ssid, const std::string& password)
-    : _ssid(ssid), _password(password) {}
+    : WiFiManager(ssid, password, WiFiOptions()) {}
+
+WiFiManager::WiFiManager(const std::string& ssid, const std::string& password, const WiFiOptions& options)
+    : _ssid(ssid), _password(password), _options(options),
+      _policy(options.min_backoff_ms, options.max_backoff_ms, esp_random, options.fast_reconnect) {}
+
+// Unregistering waits for a running handler, so none can touch us afterwards
+WiFiManager::~WiFiManager() {
+    if (_wifi_handler) esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, _wifi_handler);
+    if (_ip_handler) esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, _ip_handler);
+    if (_manager_handler) esp_event_handler_instance_unregister(WIFI_MANAGER_EVENT, ESP_EVENT_ANY_ID, _manager_handler);
+    if (_backoff_timer) {
+        esp_timer_stop(_backoff_timer);
+        esp_timer_delete(_backoff_timer);
+    }
+    if (_attempt_timer) {
+        esp_timer_stop(_attempt_timer);
+        esp_timer_delete(_attempt_timer);
+    }
+    if (_wifi_event_group) vEventGroupDelete(_wifi_event_group);
+}
 
 void WiFiManager::wifi_event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data) {
-    
+
     WiFiManager* obj = static_cast<WiFiManager*>(arg);
 
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-    } 
+        obj->run(obj->_policy.on_start(obj->_have_cache));
+    }
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (obj->_retry_count < obj->MAX_RETRY) {
-            esp_wifi_connect(); 
-            obj->_retry_count++;
-            ESP_LOGI(TAG, "Connection attempt... Attempt %d", obj->_retry_count);
-        } else {
-            xEventGroupSetBits(obj->_wifi_event_group, WIFI_FAIL_BIT);
-        }
-    } 
+        wifi_event_sta_disconnected_t* event = (wifi_event_sta_disconnected_t*) event_data;
+        esp_timer_stop(obj->_attempt_timer);
+        xEventGroupClearBits(obj->_wifi_event_group, WIFI_CONNECTED_BIT);
+        ESP_LOGI(TAG, "Disconnected, reason %d", event->reason);
+        obj->run(obj->_policy.on_disconnected());
+    }
     else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
+        esp_timer_stop(obj->_attempt_timer);
         ESP_LOGI(TAG, "IP received: " IPSTR, IP2STR(&event->ip_info.ip));
-        obj->_retry_count = 0; 
         xEventGroupSetBits(obj->_wifi_event_group, WIFI_CONNECTED_BIT);
+        obj->run(obj->_policy.on_got_ip());
+    }
+    else if (event_base == WIFI_MANAGER_EVENT && event_id == WIFI_MANAGER_BACKOFF_ELAPSED) {
+        obj->run(obj->_policy.on_backoff_elapsed());
+    }
+    else if (event_base == WIFI_MANAGER_EVENT && event_id == WIFI_MANAGER_ATTEMPT_TIMEOUT) {
+        // The resulting STA_DISCONNECTED event moves the policy on
+        ESP_LOGW(TAG, "Connection attempt timed out");
+        esp_wifi_disconnect();
     }
 }
 
+// Carry out one policy decision
+void WiFiManager::run(wifi_action_t action) {
+    switch (action) {
+        case WIFI_ACTION_CONNECT_FAST:
+            start_attempt(true);
+            break;
+        case WIFI_ACTION_CONNECT_SCAN:
+            start_attempt(false);
+            break;
+        case WIFI_ACTION_WAIT_BACKOFF:
+            ESP_LOGI(TAG, "Retry %lu in %lu ms", (unsigned long) _policy.attempts(),
+                     (unsigned long) _policy.backoff_ms());
+            esp_timer_start_once(_backoff_timer, (uint64_t) _policy.backoff_ms() * 1000);
+            break;
+        case WIFI_ACTION_SAVE_CACHE: {
+            esp_err_t err = save_cache();
+            if (err != ESP_OK) ESP_LOGW(TAG, "Access point not cached: %s", esp_err_to_name(err));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Fast attempts pin the cached BSSID and channel, skipping the all-channel scan
+void WiFiManager::start_attempt(bool fast) {
+    wifi_config_t wifi_config = {};
+    strncpy((char*)wifi_config.sta.ssid, _ssid.c_str(), sizeof(wifi_config.sta.ssid));
+    strncpy((char*)wifi_config.sta.password, _password.c_str(), sizeof(wifi_config.sta.password));
+    if (fast) {
+        memcpy(wifi_config.sta.bssid, _cache.bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.bssid_set = true;
+        wifi_config.sta.channel = _cache.channel;
+        ESP_LOGI(TAG, "Fast connect to " MACSTR " on channel %d", MAC2STR(_cache.bssid), _cache.channel);
+    }
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    apply_ip_config(fast);
+
+    esp_timer_stop(_attempt_timer);
+    esp_timer_start_once(_attempt_timer, (uint64_t) _options.attempt_timeout_ms * 1000);
+    esp_wifi_connect();
+}
+
+// Static IP if configured, the cached lease on fast attempts if allowed, DHCP otherwise
+void WiFiManager::apply_ip_config(bool fast) {
+    esp_netif_ip_info_t ip;
+    esp_ip4_addr_t dns;
+    if (_options.use_static_ip) {
+        ip = _options.static_ip;
+        dns = _options.static_dns;
+    } else if (fast && _options.reuse_lease) {
+        ip = _cache.ip;
+        dns = _cache.dns;
+    } else {
+        esp_netif_dhcpc_start(_netif);
+        return;
+    }
+
+    esp_netif_dhcpc_stop(_netif);
+    esp_netif_set_ip_info(_netif, &ip);
+    if (dns.addr) {
+        esp_netif_dns_info_t dns_info = {};
+        dns_info.ip.type = ESP_IPADDR_TYPE_V4;
+        dns_info.ip.u_addr.ip4 = dns;
+        esp_netif_set_dns_info(_netif, ESP_NETIF_DNS_MAIN, &dns_info);
+    }
+}
+
+bool WiFiManager::load_cache() {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) return false;
+    size_t len = sizeof(_cache);
+    esp_err_t err = nvs_get_blob(nvs, NVS_CACHE_KEY, &_cache, &len);
+    nvs_close(nvs);
+
+    return err == ESP_OK && len == sizeof(_cache) && _cache.channel != 0 &&
+           strncmp(_cache.ssid, _ssid.c_str(), sizeof(_cache.ssid)) == 0;
+}
+
+// Written only when the AP or lease changed, to spare the flash. The cache is
+// used for fast connects only once it is in NVS.
+esp_err_t WiFiManager::save_cache() {
+    wifi_ap_record_t ap;
+    esp_err_t err = esp_wifi_sta_get_ap_info(&ap);
+    if (err != ESP_OK) return err;
+
+    CachedAp fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    strncpy(fresh.ssid, _ssid.c_str(), sizeof(fresh.ssid) - 1);
+    memcpy(fresh.bssid, ap.bssid, sizeof(fresh.bssid));
+    fresh.channel = ap.primary;
+    esp_netif_get_ip_info(_netif, &fresh.ip);
+    esp_netif_dns_info_t dns_info;
+    if (esp_netif_get_dns_info(_netif, ESP_NETIF_DNS_MAIN, &dns_info) == ESP_OK) {
+        fresh.dns = dns_info.ip.u_addr.ip4;
+    }
+
+    if (_have_cache && memcmp(&fresh, &_cache, sizeof(fresh)) == 0) return ESP_OK;
+
+    nvs_handle_t nvs;
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(nvs, NVS_CACHE_KEY, &fresh, sizeof(fresh));
+    if (err == ESP_OK) err = nvs_commit(nvs);
+    nvs_close(nvs);
+    if (err != ESP_OK) return err;
+
+    _cache = fresh;
+    _have_cache = true;
+    return ESP_OK;
+}
+
+void WiFiManager::backoff_timer_cb(void* arg) {
+    esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_BACKOFF_ELAPSED, nullptr, 0, 0);
+}
+
+void WiFiManager::attempt_timer_cb(void* arg) {
+    esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_ATTEMPT_TIMEOUT, nullptr, 0, 0);
+}
+
 esp_err_t WiFiManager::connect() {
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase()); 
+        ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
 
     _wifi_event_group = xEventGroupCreate();
 
-    ESP_ERROR_CHECK(esp_netif_init());               
-    ESP_ERROR_CHECK(esp_event_loop_create_default()); 
-    esp_netif_create_default_wifi_sta();             
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    _netif = esp_netif_create_default_wifi_sta();
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
-    
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, 
-                    &WiFiManager::wifi_event_handler, this, nullptr));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, 
-                    &WiFiManager::wifi_event_handler, this, nullptr));
 
-    wifi_config_t wifi_config = {};
-    strncpy((char*)wifi_config.sta.ssid, _ssid.c_str(), sizeof(wifi_config.sta.ssid));
-    strncpy((char*)wifi_config.sta.password, _password.c_str(), sizeof(wifi_config.sta.password));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID,
+                    &WiFiManager::wifi_event_handler, this, &_wifi_handler));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
+                    &WiFiManager::wifi_event_handler, this, &_ip_handler));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_MANAGER_EVENT, ESP_EVENT_ANY_ID,
+                    &WiFiManager::wifi_event_handler, this, &_manager_handler));
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.arg = this;
+    timer_args.callback = backoff_timer_cb;
+    timer_args.name = "wifi_backoff";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &_backoff_timer));
+    timer_args.callback = attempt_timer_cb;
+    timer_args.name = "wifi_attempt";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &_attempt_timer));
+
+    _have_cache = _options.fast_reconnect && load_cache();
 
+    // Connection attempts (and their config) are started from STA_START by the policy
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start()); // Запуск Wi-Fi драйвера
 
+    return wait_connected(pdMS_TO_TICKS(_options.connect_timeout_ms));
+}
+
+esp_err_t WiFiManager::wait_connected(TickType_t timeout) {
     EventBits_t bits = xEventGroupWaitBits(_wifi_event_group,
-            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-            pdFALSE,  
-            pdFALSE,  
-            portMAX_DELAY);
+            WIFI_CONNECTED_BIT,
+            pdFALSE,
+            pdFALSE,
+            timeout);
 
     if (bits & WIFI_CONNECTED_BIT) {
         ESP_LOGI(TAG, "Successfully connected to %s", _ssid.c_str());
         return ESP_OK;
     } else {
-        ESP_LOGE(TAG, "Failed to connect to %s after maximum attempts", _ssid.c_str());
-        return ESP_FAIL;
+        ESP_LOGW(TAG, "Not connected to %s yet, retrying in the background", _ssid.c_str());
+        return ESP_ERR_TIMEOUT;
     }
-}
\ No newline at end of file
+}
+
+bool WiFiManager::is_connected() const {
+    return xEventGroupGetBits(_wifi_event_group) & WIFI_CONNECTED_BIT;
+}
+
+wifi_link_state_t WiFiManager::state() const {
+    return _policy.state();
+}
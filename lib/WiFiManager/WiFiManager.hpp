@@ -2,30 +2,85 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "nvs_flash.h"
-#include "esp_wifi.h"      
-#include "esp_event.h"     
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
 #ifdef __cplusplus
 #include <string>
 #endif
-#include "esp_log.h" 
+#include "esp_log.h"
+#include "WiFiReconnectPolicy.hpp"
+
+struct WiFiOptions {
+    bool fast_reconnect = true;          // Try the cached BSSID/channel before scanning
+    bool reuse_lease = false;            // Apply the cached DHCP lease as a static IP on fast connect
+    bool use_static_ip = false;
+    esp_netif_ip_info_t static_ip = {};  // ip / netmask / gw when use_static_ip is set
+    esp_ip4_addr_t static_dns = {};
+    uint32_t connect_timeout_ms = 30000; // How long connect() waits; retries continue afterwards
+    uint32_t attempt_timeout_ms = 10000; // Abort a single association/DHCP attempt after this
+    uint32_t min_backoff_ms = 500;
+    uint32_t max_backoff_ms = 60000;
+};
 
 class WiFiManager {
 public:
     WiFiManager(const std::string& ssid, const std::string& password);
 
+    WiFiManager(const std::string& ssid, const std::string& password, const WiFiOptions& options);
+
+    // Unregisters the event handlers and deletes the timers; the driver keeps running
+    ~WiFiManager();
+
+    WiFiManager(const WiFiManager&) = delete;
+    WiFiManager& operator=(const WiFiManager&) = delete;
+
+    // Start the driver and wait up to connect_timeout_ms for an IP. Returns ESP_ERR_TIMEOUT
+    // if not online yet; reconnection keeps running in the background either way.
     esp_err_t connect();
+
+    esp_err_t wait_connected(TickType_t timeout);
+
+    bool is_connected() const;
+
+    wifi_link_state_t state() const;
 private:
     std::string _ssid;
     std::string _password;
+    WiFiOptions _options;
 
-    EventGroupHandle_t _wifi_event_group;
+    EventGroupHandle_t _wifi_event_group = nullptr;
     static const int WIFI_CONNECTED_BIT = BIT0;
-    static const int WIFI_FAIL_BIT = BIT1;
 
     static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                    int32_t event_id, void* event_data);
-    
-    int _retry_count = 0;
-    const int MAX_RETRY = 5;
 
-};
\ No newline at end of file
+    // Last good access point and lease, kept in NVS between boots
+    struct CachedAp {
+        char ssid[33];
+        uint8_t bssid[6];
+        uint8_t channel;
+        esp_netif_ip_info_t ip;
+        esp_ip4_addr_t dns;
+    };
+
+    WiFiReconnectPolicy _policy;
+    esp_netif_t* _netif = nullptr;
+    esp_timer_handle_t _backoff_timer = nullptr;
+    esp_timer_handle_t _attempt_timer = nullptr;
+    esp_event_handler_instance_t _wifi_handler = nullptr;
+    esp_event_handler_instance_t _ip_handler = nullptr;
+    esp_event_handler_instance_t _manager_handler = nullptr;
+    CachedAp _cache = {};
+    bool _have_cache = false;
+
+    void run(wifi_action_t action);
+    void start_attempt(bool fast);
+    void apply_ip_config(bool fast);
+    bool load_cache();
+    esp_err_t save_cache();
+
+    static void backoff_timer_cb(void* arg);
+    static void attempt_timer_cb(void* arg);
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+
+typedef enum {
+    WIFI_LINK_IDLE = 0,
+    WIFI_LINK_FAST_CONNECT,   // Targeted connect to the cached BSSID/channel
+    WIFI_LINK_CONNECTING,     // Normal scan-and-associate
+    WIFI_LINK_ONLINE,         // Associated and holding an IP
+    WIFI_LINK_BACKOFF,        // Waiting before the next attempt
+} wifi_link_state_t;
+
+typedef enum {
+    WIFI_ACTION_NONE = 0,
+    WIFI_ACTION_CONNECT_FAST,
+    WIFI_ACTION_CONNECT_SCAN,
+    WIFI_ACTION_WAIT_BACKOFF,   // Arm the retry timer for backoff_ms()
+    WIFI_ACTION_SAVE_CACHE,     // Online: persist BSSID, channel and lease
+} wifi_action_t;
+
+// Reconnect decisions for WiFiManager, free of ESP-IDF calls so the sequence of
+// events can be scripted off-target. Each on_* call takes one driver event and
+// returns what the caller must do next. It never gives up: failed scans back off
+// exponentially (with jitter, so a room of devices does not retry in lockstep)
+// up to max_backoff_ms and keep retrying.
+class WiFiReconnectPolicy {
+public:
+    typedef uint32_t (*random_fn_t)();
+
+    // fast_reconnect = false never returns WIFI_ACTION_CONNECT_FAST
+    WiFiReconnectPolicy(uint32_t min_backoff_ms, uint32_t max_backoff_ms, random_fn_t random,
+                        bool fast_reconnect = true)
+        : _min_ms(min_backoff_ms ? min_backoff_ms : 1), _max_ms(max_backoff_ms), _random(random),
+          _fast_enabled(fast_reconnect) {}
+
+    // Driver started
+    wifi_action_t on_start(bool have_cache) {
+        _have_cache = have_cache && _fast_enabled;
+        _attempts = 0;
+        return begin_attempt(_have_cache);
+    }
+
+    wifi_action_t on_got_ip() {
+        _state = WIFI_LINK_ONLINE;
+        _attempts = 0;
+        _have_cache = _fast_enabled;
+        return WIFI_ACTION_SAVE_CACHE;
+    }
+
+    // Disconnect event, also the result of an attempt timing out
+    wifi_action_t on_disconnected() {
+        switch (_state) {
+            case WIFI_LINK_ONLINE:
+                // The AP we just lost is the most likely one to come back
+                _attempts = 0;
+                return begin_attempt(_have_cache);
+            case WIFI_LINK_FAST_CONNECT:
+                return begin_attempt(false);
+            case WIFI_LINK_CONNECTING:
+                _attempts++;
+                _backoff_ms = next_backoff();
+                _state = WIFI_LINK_BACKOFF;
+                return WIFI_ACTION_WAIT_BACKOFF;
+            default:
+                return WIFI_ACTION_NONE;
+        }
+    }
+
+    wifi_action_t on_backoff_elapsed() {
+        if (_state != WIFI_LINK_BACKOFF) return WIFI_ACTION_NONE;
+        return begin_attempt(false);
+    }
+
+    wifi_link_state_t state() const { return _state; }
+
+    // Delay chosen by the last WIFI_ACTION_WAIT_BACKOFF
+    uint32_t backoff_ms() const { return _backoff_ms; }
+
+    // Consecutive failed scan attempts since the last time online
+    uint32_t attempts() const { return _attempts; }
+
+private:
+    uint32_t _min_ms;
+    uint32_t _max_ms;
+    random_fn_t _random;
+    bool _fast_enabled;
+    wifi_link_state_t _state = WIFI_LINK_IDLE;
+    bool _have_cache = false;
+    uint32_t _attempts = 0;
+    uint32_t _backoff_ms = 0;
+
+    wifi_action_t begin_attempt(bool fast) {
+        _state = fast ? WIFI_LINK_FAST_CONNECT : WIFI_LINK_CONNECTING;
+        return fast ? WIFI_ACTION_CONNECT_FAST : WIFI_ACTION_CONNECT_SCAN;
+    }
+
+    // Exponential ceiling, then a random delay in [ceiling / 2, ceiling]
+    uint32_t next_backoff() const {
+        uint32_t shift = _attempts > 16 ? 16 : _attempts - 1;
+        uint64_t ceiling = (uint64_t) _min_ms << shift;
+        if (ceiling > _max_ms) ceiling = _max_ms;
+        uint32_t half = (uint32_t) (ceiling / 2);
+        return half + (_random ? _random() % (half + 1) : half);
+    }
+};
@@ -1,4 +1,10 @@
 #include "examples.hpp"
+#include "Ultrasonic.hpp"
+#include "TelemetryChannel.hpp"
+#include "DspFilter.hpp"
+#include "Scheduler.hpp"
+#include "DeferredLog.hpp"
+#include <atomic>
 
 #define BLINK_GPIO    GPIO_NUM_2 
 #define STATUS_GPIO   GPIO_NUM_18  
@@ -16,10 +22,10 @@ typedef struct {
     uint32_t timestamp;
 } sensor_data_t;
 
-sensor_data_t g_latest_sensor_data = { .distance = 100.0f, .timestamp = 0 };
-bool is_measuring = false;
+// Written by the ultrasonic task, read by the blink task without locking
+TelemetryChannel<sensor_data_t>* g_sensor_channel;
+std::atomic<bool> is_measuring{false};
 
-SemaphoreHandle_t xDistanceMutex;
 SemaphoreHandle_t xButtonSemaphore;
 EventGroupHandle_t xSystemEventGroup; 
 
@@ -31,89 +37,72 @@ void IRAM_ATTR button_isr_handler(void* arg) {
     }
 }
 
-void vTaskStatusLED(void *pvParameters) {
-    gpio_reset_pin(STATUS_GPIO);
-    gpio_set_direction(STATUS_GPIO, GPIO_MODE_OUTPUT);
-
-    while (1) {
-
-        EventBits_t bits = xEventGroupWaitBits(xSystemEventGroup, SENSOR_RUNNING_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
-
-        if (bits & SENSOR_RUNNING_BIT) {
-            gpio_set_level(STATUS_GPIO, 1);
-            ESP_LOGW(TAG, "Status ON");
-        } else {
-            gpio_set_level(STATUS_GPIO, 0);
-            ESP_LOGW(TAG, "Status OFF");
-        }
-        
-        vTaskDelay(pdMS_TO_TICKS(1000));
+// Blink and status LED are scheduler jobs sharing one worker stack instead of two tasks
+static Scheduler* g_scheduler;
+
+// Status LED follows the sensor-running bit, checked once a second
+static void status_led_job() {
+    static int shown = -1;
+    int running = (xEventGroupGetBits(xSystemEventGroup) & SENSOR_RUNNING_BIT) ? 1 : 0;
+    gpio_set_level(STATUS_GPIO, running);
+    if (running != shown) {
+        DLOGW(TAG, "Status %s", running ? "ON" : "OFF");
+        shown = running;
     }
 }
 
-void vTaskBlink(void *pvParameters) {
-    gpio_reset_pin(BLINK_GPIO);
-    gpio_set_direction(BLINK_GPIO, GPIO_MODE_OUTPUT);
-    int delay_ms = 500;
-
-    while (1) {
-        if (xSemaphoreTake(xDistanceMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-            float dist = g_latest_sensor_data.distance;
-            xSemaphoreGive(xDistanceMutex);
+// One LED toggle; re-arms itself with a delay that follows the measured distance
+static void blink_job() {
+    static bool led_on = false;
+    float dist = g_sensor_channel->read().distance;
 
-            if (dist < 10.0f)      delay_ms = 100;
-            else if (dist < 30.0f) delay_ms = 250;
-            else                   delay_ms = 800;
-        }
+    int delay_ms;
+    if (dist < 10.0f)      delay_ms = 100;
+    else if (dist < 30.0f) delay_ms = 250;
+    else                   delay_ms = 800;
 
-        int final_delay = is_measuring ? delay_ms : 1000;
-        gpio_set_level(BLINK_GPIO, 1);
-        vTaskDelay(pdMS_TO_TICKS(final_delay));
-        gpio_set_level(BLINK_GPIO, 0);
-        vTaskDelay(pdMS_TO_TICKS(final_delay));
-    }
+    int final_delay = is_measuring ? delay_ms : 1000;
+    led_on = !led_on;
+    gpio_set_level(BLINK_GPIO, led_on);
+    g_scheduler->after(final_delay, blink_job);
 }
 
-void vTaskUltrasonic(void *pvParameters) {
-    gpio_reset_pin(TRIG_GPIO);
-    gpio_set_direction(TRIG_GPIO, GPIO_MODE_OUTPUT);
-    gpio_reset_pin(ECHO_GPIO);
-    gpio_set_direction(ECHO_GPIO, GPIO_MODE_INPUT);
+// ESP_LOGE (vprintf) alone takes about 1.5 KB and begin() runs through the RMT
+// and MCPWM drivers. The high-water mark is logged after the first measurement:
+// size this from that figure plus headroom, not below it.
+static const uint32_t ULTRASONIC_TASK_STACK = 4096;
+
+static void ultrasonic_loop(Ultrasonic& sonar) {
+    // Median of 5 drops single bad echoes so the blink thresholds do not flicker
+    MedianFilter<float, 5> distance_filter;
+    bool stack_logged = false;
 
     while (1) {
         if (xSemaphoreTake(xButtonSemaphore, 0) == pdTRUE) {
-            is_measuring = !is_measuring;
+            bool measuring = !is_measuring.load();
+            is_measuring.store(measuring);
             
-            if (is_measuring) {
-                ESP_LOGW(TAG, "Sensor START");
+            if (measuring) {
+                DLOGW(TAG, "Sensor START");
                 xEventGroupSetBits(xSystemEventGroup, SENSOR_RUNNING_BIT);
             } else {
-                ESP_LOGW(TAG, "Sensor STOP");
+                DLOGW(TAG, "Sensor STOP");
                 xEventGroupClearBits(xSystemEventGroup, SENSOR_RUNNING_BIT);
             }
             vTaskDelay(pdMS_TO_TICKS(300));
         }
 
         if (is_measuring) {
-            gpio_set_level(TRIG_GPIO, 0);
-            esp_rom_delay_us(2);
-            gpio_set_level(TRIG_GPIO, 1);
-            esp_rom_delay_us(10);
-            gpio_set_level(TRIG_GPIO, 0);
-
-            uint32_t start = esp_timer_get_time();
-            while (gpio_get_level(ECHO_GPIO) == 0 && (esp_timer_get_time() - start < 100000));
-            uint32_t echo_start = esp_timer_get_time();
-            while (gpio_get_level(ECHO_GPIO) == 1 && (esp_timer_get_time() - echo_start < 100000));
-            uint32_t echo_end = esp_timer_get_time();
-
-            sensor_data_t newData;
-            newData.distance = ((float)(echo_end - echo_start) * 0.0343) / 2;
-            newData.timestamp = (uint32_t)(esp_timer_get_time() / 1000);
-
-            if (xSemaphoreTake(xDistanceMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-                g_latest_sensor_data = newData;
-                xSemaphoreGive(xDistanceMutex);
+            ultrasonic_result_t result;
+            if (sonar.measure(&result, pdMS_TO_TICKS(100)) == ESP_OK && result.status == ULTRASONIC_OK) {
+                sensor_data_t newData;
+                distance_filter.process(&result.distance_cm, &newData.distance, 1);
+                newData.timestamp = (uint32_t)(result.timestamp_us / 1000);
+                g_sensor_channel->publish(newData);
+            }
+            if (!stack_logged) {
+                DLOGI(TAG, "Ultrasonic task stack: %u bytes never used", (unsigned) uxTaskGetStackHighWaterMark(NULL));
+                stack_logged = true;
             }
             vTaskDelay(pdMS_TO_TICKS(200));
         } else {
@@ -122,10 +111,20 @@ void vTaskUltrasonic(void *pvParameters) {
     }
 }
 
+void vTaskUltrasonic(void *pvParameters) {
+    {
+        Ultrasonic sonar(TRIG_GPIO, ECHO_GPIO);
+        if (sonar.begin() == ESP_OK) ultrasonic_loop(sonar);
+        else ESP_LOGE(TAG, "Ultrasonic init failed");
+    }   // vTaskDelete does not return: release the RMT and capture channels first
+    vTaskDelete(NULL);
+}
+
 void GPIO_example(void) {
 
     xButtonSemaphore = xSemaphoreCreateBinary();
-    xDistanceMutex = xSemaphoreCreateMutex();
+    sensor_data_t initial = { .distance = 100.0f, .timestamp = 0 };
+    g_sensor_channel = new TelemetryChannel<sensor_data_t>(initial);
     xSystemEventGroup = xEventGroupCreate();
 
     gpio_config_t btn_conf = {
@@ -139,7 +138,21 @@ void GPIO_example(void) {
     gpio_install_isr_service(0);
     gpio_isr_handler_add(BUTTON_GPIO, button_isr_handler, NULL);
 
-    xTaskCreatePinnedToCore(vTaskBlink, "Blink", 2048, NULL, 1, NULL, 0);
-    xTaskCreatePinnedToCore(vTaskUltrasonic, "Ultra", 2048, NULL, 1, NULL, 1);
-    xTaskCreatePinnedToCore(vTaskStatusLED, "StatusLED", 2048, NULL, 1, NULL, 0);
+    gpio_reset_pin(BLINK_GPIO);
+    gpio_set_direction(BLINK_GPIO, GPIO_MODE_OUTPUT);
+    gpio_reset_pin(STATUS_GPIO);
+    gpio_set_direction(STATUS_GPIO, GPIO_MODE_OUTPUT);
+
+    SchedulerConfig sched_config;
+    sched_config.dual_core = false;
+    sched_config.stack_size = 3072;
+    g_scheduler = new Scheduler(sched_config);
+    g_scheduler->begin();
+    g_scheduler->after(0, blink_job);
+    g_scheduler->every(1000, status_led_job);
+
+    // The ultrasonic loop blocks on each echo, so it keeps a task of its own
+    if (xTaskCreatePinnedToCore(vTaskUltrasonic, "Ultra", ULTRASONIC_TASK_STACK, NULL, 1, NULL, 1) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create ultrasonic task");
+    }
 }
\ No newline at end of file
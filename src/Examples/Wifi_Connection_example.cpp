@@ -1,30 +1,88 @@
 #include "WiFiManager.hpp"
 #include "Mqtt_Connection.hpp"
+#include "FlashLog.hpp"
+#include "PartitionStorage.hpp"
+#include "Diagnostics.hpp"
 #include "GPIO.hpp"
+#include "Telemetry.hpp"
+#include "DspFilter.hpp"
+#include "DeferredLog.hpp"
 #include "examples.hpp"
 
+static const char *TAG = "WIFI_EXAMPLE";
+
+typedef struct {
+    int32_t x;
+    int32_t y;
+    bool pressed;
+    uint32_t timestamp;
+} joystick_data_t;
+
+static constexpr auto joystick_schema = telemetry::schema<joystick_data_t>(
+    telemetry::field("x", &joystick_data_t::x),
+    telemetry::field("y", &joystick_data_t::y),
+    telemetry::field("pressed", &joystick_data_t::pressed),
+    telemetry::field("timestamp", &joystick_data_t::timestamp));
+
 void Wi_Fi_connection_example(void) {
     GPIO joystick_button(GPIO_NUM_14, GPIO_MODE_INPUT);
     GPIO joystick_x(ADC_CHANNEL_6);
     GPIO joystick_y(ADC_CHANNEL_4);
 
+    // Smooth ADC noise on the axes instead of over-sampling
+    BlockFilterAdapter<MovingAverage<int16_t, 8>> x_filter;
+    BlockFilterAdapter<MovingAverage<int16_t, 8>> y_filter;
+    joystick_x.set_filter(&x_filter);
+    joystick_y.set_filter(&y_filter);
+
+    GPIO* const joystick_axes[] = {&joystick_x, &joystick_y};
+    int axes[2] = {};
+
     WiFiManager wifi("SSID", "PASSWORD");
 
     if (wifi.connect() == ESP_OK) {
         printf("We connected\n");
 
+        // Samples taken while the broker is unreachable are kept in flash and sent on reconnect
+        PartitionStorage flash("flashlog");
+        FlashLog offline_log(flash);
+
         Mqtt_Connection mqtt;
-        mqtt.begin("mqtt://broker.emqx.io");
+        MqttOutboxConfig outbox;
+        outbox.policy = MQTT_BACKPRESSURE_BLOCK;  // Throttle the loop below instead of exhausting heap
+        // MQTT 5: a WiFi drop resumes the broker session instead of resubscribing, and
+        // the joystick stream (QoS 0, a lost sample is replaced by the next) goes out
+        // under a 2-byte topic alias
+        MqttSessionConfig session;
+        mqtt.begin("mqtt://broker.emqx.io", outbox, session);
+        if (!flash.ok()) {
+            ESP_LOGW(TAG, "No 'flashlog' partition (see partitions.csv): running without the offline store");
+        } else if (!offline_log.mount()) {
+            ESP_LOGW(TAG, "Offline store could not be mounted: running without it");
+        } else {
+            mqtt.set_offline_store(&offline_log);
+        }
+
+        // Heap, task CPU/stack, outbox depth and latency histograms every 10 s
+        Diagnostics::instance().start(mqtt);
 
         vTaskDelay(pdMS_TO_TICKS(2000));
+        uint8_t payload[32];
         while (true) {
-             mqtt.publish("school/test/sensor", "{\"temp\": 25.4, \"status\": \"OK\"}");
-         }
+            int64_t now;
+            GPIO::read_many(joystick_axes, 2, axes, &now);
+            joystick_data_t data = {axes[0], axes[1], joystick_button.get_level() == 0, (uint32_t) (now / 1000)};
+
+            // CBOR is about a third smaller than the equivalent JSON and skips number formatting
+            size_t len = telemetry::encode_cbor(joystick_schema, data, payload, sizeof(payload));
+            mqtt.publish("school/test/sensor", telemetry::as_view(payload, len), 0);
+        }
     }
 
     while (true) {
         vTaskDelay(pdMS_TO_TICKS(5000));
-        printf("Joystick X: %d, Y: %d, Button: %d\n", joystick_x.get_level(), joystick_y.get_level(), joystick_button.get_level());
+        GPIO::read_many(joystick_axes, 2, axes, nullptr);
+        DLOGI(TAG, "Joystick X: %d, Y: %d, Button: %d", axes[0], axes[1], joystick_button.get_level());
     }
 
 }
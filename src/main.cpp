@@ -1,29 +1,53 @@
 #include "Examples/examples.hpp"
 #include "HttpClient.hpp"
+#include "HttpCache.hpp"
+#include "HttpRequestQueue.hpp"
 #include "WiFiManager.hpp"
-
-void telegram_task(void *pvParameters) {
-    HttpClient http;
-    std::string token = "Token";
-    std::string chat_id = "chat`id";
-    
-    http.sendTelegramMessage(token, chat_id, "ESP32!");
-    
-    vTaskDelete(NULL); 
-}
+#include "BufferPool.hpp"
+#include "DeferredLog.hpp"
 
 extern "C" void app_main(void) {
-    WiFiManager wifi("SSID", "Paaword");
+    // Payload buffers come from fixed pools from here on, before any traffic
+    buffer_pool_begin();
+    // Hot-path DLOGx calls only record arguments; a background task formats them
+    DeferredLog::instance().begin();
+    // Repeated GETs of unchanged URLs are answered from PSRAM or with a 304
+    HttpCache::instance().begin();
+    // Ask for gzip; compressed responses are decoded as they stream in
+    HttpClient::set_compression(HttpCompressionConfig());
+
+    // Its event handlers and timers refer to it after app_main returns
+    static WiFiManager wifi("SSID", "Paaword");
     
     if (wifi.connect() == ESP_OK) {
-        HttpClient http;
-        
-        std::string response = http.get("https://jsonplaceholder.typicode.com/posts/1");
-        printf("Response: %s\n", response.c_str());
+        // Two workers serve every request instead of one task per call
+        static HttpRequestQueue http_queue(2);
+
+        HttpRequest get_req;
+        get_req.url = "https://jsonplaceholder.typicode.com/posts/1";
+        get_req.on_complete = [](const HttpResponse& response) {
+            printf("Response: %s\n", response.body.c_str());
+        };
+        http_queue.submit(std::move(get_req));
+
+        HttpRequest post_req;
+        post_req.url = "https://jsonplaceholder.typicode.com/posts";
+        post_req.method = HTTP_METHOD_POST;
+        post_req.body = "{\"status\":\"ok\"}";
+        post_req.on_complete = [](const HttpResponse& response) {
+            printf("POST Response: %s\n", response.body.c_str());
+        };
+        http_queue.submit(std::move(post_req));
 
-        std::string result = http.post("https://jsonplaceholder.typicode.com/posts", "{\"status\":\"ok\"}");
+        std::string token = "Token";
+        std::string chat_id = "chat`id";
 
-        printf("POST Response: %s\n", result.c_str());
-        xTaskCreate(telegram_task, "telegram_task", 8192, NULL, 5, NULL);
+        HttpRequest telegram_req;
+        telegram_req.url = HttpClient::telegramUrl(token);
+        telegram_req.method = HTTP_METHOD_POST;
+        telegram_req.body = HttpClient::telegramPayload(chat_id, "ESP32!");
+        telegram_req.priority = HTTP_PRIORITY_HIGH;
+        telegram_req.timeout_ms = 15000;
+        http_queue.submit(std::move(telegram_req));
     }
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <vector>
+#include "esp_log.h"
+
+// Minimal benchmark harness for the host build. Include it from exactly one
+// source file per executable: it replaces the global operator new/delete to
+// count allocations, on every thread (a publish that allocates on the MQTT
+// task is charged to the publish).
+//
+// Each case runs the operation in batches, timing every batch, and prints
+// mean ns/op, p50/p99 of the per-batch ns/op, ops/s and allocations per op.
+// --quick cuts the iteration counts so ctest only checks that the paths run.
+namespace bench {
+
+inline std::atomic<uint64_t> g_allocs{0};
+inline bool g_quick = false;
+
+inline void init(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) g_quick = true;
+    }
+    // Info lines from the drivers would end up in the timings
+    esp_log_level_set("*", ESP_LOG_WARN);
+    printf("%-58s %10s %10s %10s %12s %9s\n", "case", "ns/op", "p50", "p99", "ops/s", "allocs/op");
+}
+
+inline uint64_t allocs() { return g_allocs.load(std::memory_order_relaxed); }
+
+// Keeps a value alive without the compiler removing the computation
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// ops operations in batches of batch; op(i) is called with the running index.
+// Returns the mean ns/op.
+template <typename Op>
+double run(const char* name, uint64_t ops, uint64_t batch, Op&& op) {
+    if (g_quick) ops = std::max<uint64_t>(batch, ops / 100);
+    if (batch == 0) batch = 1;
+    uint64_t batches = (ops + batch - 1) / batch;
+    std::vector<double> per_op;
+    per_op.reserve(batches);
+
+    // Warm-up: first-use allocations (lazy singletons, pools) are not counted
+    for (uint64_t i = 0; i < std::min<uint64_t>(batch, 64); i++) op(i);
+
+    using clock = std::chrono::steady_clock;
+    uint64_t allocs_before = allocs();
+    uint64_t index = 0;
+    auto start = clock::now();
+    for (uint64_t b = 0; b < batches; b++) {
+        auto t0 = clock::now();
+        for (uint64_t i = 0; i < batch; i++) op(index++);
+        auto t1 = clock::now();
+        per_op.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / batch);
+    }
+    double total_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    uint64_t alloc_count = allocs() - allocs_before;
+
+    std::sort(per_op.begin(), per_op.end());
+    double p50 = per_op[per_op.size() / 2];
+    double p99 = per_op[std::min(per_op.size() - 1, per_op.size() * 99 / 100)];
+    double mean = total_ns / index;
+    printf("%-58s %10.1f %10.1f %10.1f %12.0f %9.2f\n", name, mean, p50, p99, 1e9 / mean,
+           (double) alloc_count / index);
+    fflush(stdout);
+    return mean;
+}
+
+}  // namespace bench
+
+// The replacements forward to one new and one delete, both kept out of line:
+// inlined, the compiler sees malloc() paired with operator delete (or new with
+// free()) and warns about a mismatch that is not there
+__attribute__((noinline)) void* operator new(size_t size) {
+    bench::g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
@@ -0,0 +1,84 @@
+// BufferPool hot paths: SizeClassPool allocate/free against the heap it keeps
+// network buffers out of, and response bodies grown in a pool_string against
+// std::string. Pool blocks do not go through operator new, so allocs/op counts
+// heap allocations only; pool fallbacks are printed after each case.
+#include <mutex>
+#include <string>
+#include "bench.hpp"
+#include "SizeClassPool.hpp"
+
+static const size_t LIVE = 32;
+
+// 16 B-4 KB, spread like topics, headers and message payloads
+static size_t size_for(uint64_t i) {
+    uint32_t h = (uint32_t) (i * 2654435761u);
+    return 16 + (h >> 8) % 4081;
+}
+
+static const pool_class_config_t CLASSES[] = {
+    {64, 32, true}, {256, 32, true}, {1024, 32, false}, {4096, 32, false}, {16384, 4, false}};
+
+static void print_pool(const SizeClassPool& pool) {
+    pool_stats_t s = pool.stats();
+    printf("  pool allocs %lu, fallbacks %lu\n", (unsigned long) s.allocs, (unsigned long) s.fallback_allocs);
+}
+
+int main(int argc, char** argv) {
+    bench::init(argc, argv);
+
+    {
+        SizeClassPool pool;
+        pool.configure(CLASSES, sizeof(CLASSES) / sizeof(CLASSES[0]));
+        void* live[LIVE] = {};
+        bench::run("SizeClassPool allocate + deallocate, 32 live, 16 B-4 KB", 20000000, 1024, [&](uint64_t i) {
+            void*& slot = live[i % LIVE];
+            pool.deallocate(slot);
+            slot = pool.allocate(size_for(i));
+            *(volatile uint8_t*) slot = 1;
+        });
+        for (void* p : live) pool.deallocate(p);
+        print_pool(pool);
+    }
+    {
+        void* live[LIVE] = {};
+        bench::run("malloc + free, same pattern", 20000000, 1024, [&](uint64_t i) {
+            void*& slot = live[i % LIVE];
+            free(slot);
+            slot = malloc(size_for(i));
+            *(volatile uint8_t*) slot = 1;
+        });
+        for (void* p : live) free(p);
+    }
+    {
+        // The ESP-IDF heap takes a lock on every call
+        std::mutex lock;
+        void* live[LIVE] = {};
+        bench::run("malloc + free behind a mutex, same pattern", 20000000, 1024, [&](uint64_t i) {
+            void*& slot = live[i % LIVE];
+            std::lock_guard<std::mutex> guard(lock);
+            free(slot);
+            slot = malloc(size_for(i));
+            *(volatile uint8_t*) slot = 1;
+        });
+        for (void* p : live) free(p);
+    }
+
+    // A chunked response of unknown length, appended as it arrives
+    const std::string chunk(512, 'x');
+    {
+        SizeClassPool pool;
+        pool.configure(CLASSES, sizeof(CLASSES) / sizeof(CLASSES[0]));
+        bench::run("pool_string grown to 6 KB in 512 B appends", 2000000, 256, [&](uint64_t) {
+            pool_string body{PoolAllocator<char>(pool)};
+            for (int i = 0; i < 12; i++) body += chunk;
+            bench::keep(body.data()[100]);
+        });
+        print_pool(pool);
+    }
+    bench::run("std::string grown to 6 KB in 512 B appends", 2000000, 256, [&](uint64_t) {
+        std::string body;
+        for (int i = 0; i < 12; i++) body += chunk;
+        bench::keep(body.data()[100]);
+    });
+    return 0;
+}
@@ -0,0 +1,44 @@
+// Diagnostics hot paths: what an instrumented loop pays per sample
+// (DiagHistogram::record, DiagCounter::add) and what the publish task pays per
+// interval (snapshot + JSON, CPU share over a typical task list).
+#include "bench.hpp"
+#include "DiagHistogram.hpp"
+
+int main(int argc, char** argv) {
+    bench::init(argc, argv);
+
+    DiagHistogram hist;
+    // Loop times of 50-1000 us, so min and max rarely move after the first samples
+    bench::run("DiagHistogram::record, 50-1000 us values", 50000000, 1024, [&](uint64_t i) {
+        hist.record(50 + (uint32_t) ((i * 2654435761u) >> 8) % 951);
+    });
+    bench::run("DiagHistogram::record_us, int64 duration", 50000000, 1024, [&](uint64_t i) {
+        hist.record_us((int64_t) (i & 1023) - 8);
+    });
+
+    DiagCounter counter;
+    bench::run("DiagCounter::add", 100000000, 1024, [&](uint64_t) { counter.add(); });
+    bench::keep(counter.take());
+
+    char json[160];
+    bench::run("DiagHistogram::snapshot + diag_hist_json", 2000000, 256, [&](uint64_t i) {
+        hist.record((uint32_t) i);
+        diag_hist_snapshot_t s = hist.snapshot();
+        bench::keep(diag_hist_json(s, json, sizeof(json)));
+    });
+
+    // 20 tasks, as on the example firmware
+    DiagCpuShare share;
+    uint32_t ids[20], runtime[20];
+    uint8_t pct[20];
+    for (uint32_t t = 0; t < 20; t++) {
+        ids[t] = t + 1;
+        runtime[t] = 0;
+    }
+    bench::run("DiagCpuShare::update, 20 tasks", 2000000, 256, [&](uint64_t i) {
+        for (uint32_t t = 0; t < 20; t++) runtime[t] += 1000 * (t + 1);
+        share.update(ids, runtime, 20, (uint32_t) (i + 1) * 500000, 2, pct);
+        bench::keep(pct[19]);
+    });
+    return 0;
+}
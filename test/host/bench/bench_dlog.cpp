@@ -0,0 +1,68 @@
+// DeferredLog hot path: what a DLOGx call costs the task that makes it (a
+// record written to the ring and read back by the formatter) against formatting
+// the same line in place with snprintf or fprintf, as ESP_LOGx does. The
+// formatter's own rendering is timed separately.
+#include <stdio.h>
+#include "bench.hpp"
+#include "DlogFormat.hpp"
+#include "DlogRing.hpp"
+
+static const char* TAG = "HTTP_CLIENT";
+
+static constexpr dlog_site_t ONE_INT = {dlog_hash("HTTPS Status = %d"), DLOG_LEVEL_INFO, &TAG,
+                                        "HTTPS Status = %d"};
+static constexpr dlog_site_t THREE_INTS = {dlog_hash("queue %d/%d, retries %d"), DLOG_LEVEL_INFO, &TAG,
+                                           "queue %d/%d, retries %d"};
+static constexpr dlog_site_t TWO_STRINGS = {dlog_hash("POST to %s stored: %s"), DLOG_LEVEL_WARN, &TAG,
+                                            "POST to %s stored: %s"};
+
+int main(int argc, char** argv) {
+    bench::init(argc, argv);
+    DlogRing ring(1024);
+    dlog_record_t rec;
+
+    bench::run("DlogRing write + read, one int argument", 20000000, 1024, [&](uint64_t i) {
+        ring.write(&ONE_INT, (uint32_t) i, (int) i);
+        ring.read(&rec);
+        bench::keep(rec.words[0]);
+    });
+    bench::run("DlogRing write + read, three int arguments", 20000000, 1024, [&](uint64_t i) {
+        ring.write(&THREE_INTS, (uint32_t) i, (int) i & 7, 8, (int) (i >> 3) & 3);
+        ring.read(&rec);
+        bench::keep(rec.words[2]);
+    });
+    const char* url = "https://api.example.com/v1/devices/esp32-01/telemetry";
+    bench::run("DlogRing write + read, two string arguments", 10000000, 1024, [&](uint64_t i) {
+        ring.write(&TWO_STRINGS, (uint32_t) i, url, "offline");
+        ring.read(&rec);
+        bench::keep(rec.words[0]);
+    });
+    {
+        DlogRing full(128);
+        while (full.write(&ONE_INT, 0, 0)) {
+        }
+        bench::run("DlogRing write dropped on a full ring", 50000000, 1024, [&](uint64_t i) {
+            bench::keep(full.write(&ONE_INT, (uint32_t) i, (int) i));
+        });
+    }
+
+    // What the formatter task does with each record, off the caller's time
+    char line[256];
+    dlog_record(&rec, &ONE_INT, 0, 200);
+    bench::run("dlog_render of the one-int record", 10000000, 1024, [&](uint64_t) {
+        bench::keep(dlog_render(ONE_INT.fmt, rec.words, rec.nwords, rec.types, line, sizeof(line)));
+    });
+
+    // ESP_LOGx formats the whole line on the calling task
+    bench::run("snprintf of the same log line", 10000000, 1024, [&](uint64_t i) {
+        bench::keep(snprintf(line, sizeof(line), "I (%lu) %s: HTTPS Status = %d", (unsigned long) i, TAG, (int) i));
+    });
+    FILE* devnull = fopen("/dev/null", "w");
+    if (devnull) {
+        bench::run("fprintf of the same log line to /dev/null", 10000000, 1024, [&](uint64_t i) {
+            bench::keep(fprintf(devnull, "I (%lu) %s: HTTPS Status = %d\n", (unsigned long) i, TAG, (int) i));
+        });
+        fclose(devnull);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+// DspFilter throughput: each filter over 256-sample blocks of a noisy 12-bit
+// ADC-like signal, as GPIO::set_filter and AdcStream consumers feed them.
+// One op is one block; samples/s is printed under each case.
+#include "bench.hpp"
+#include "DspFilter.hpp"
+
+static const size_t BLOCK = 256;
+
+template <typename T>
+static void fill(T* out, size_t n) {
+    uint32_t state = 12345;
+    for (size_t i = 0; i < n; i++) {
+        state = state * 1664525u + 1013904223u;
+        float wave = 1500.0f * sinf((float) i * 0.05f);
+        out[i] = (T) (2048.0f + wave + (float) ((state >> 22) & 0x3F) - 32.0f);
+    }
+}
+
+template <typename T, typename F>
+static void block_case(const char* name, F& filter, uint64_t blocks) {
+    T in[BLOCK];
+    T out[BLOCK];
+    fill(in, BLOCK);
+    double ns = bench::run(name, blocks, 64, [&](uint64_t) {
+        bench::keep(filter.process(in, out, BLOCK));
+        bench::keep(out[BLOCK - 1]);
+    });
+    printf("  %.0f M samples/s\n", BLOCK * 1000.0 / ns);
+}
+
+int main(int argc, char** argv) {
+    bench::init(argc, argv);
+    const BiquadCoeffs lowpass = BiquadCoeffs::lowpass(50.0f, 1000.0f);
+
+    {
+        MovingAverage<int16_t, 16> f;
+        block_case<int16_t>("MovingAverage<int16_t, 16>, 256-sample block", f, 400000);
+    }
+    {
+        MovingAverage<float, 16> f;
+        block_case<float>("MovingAverage<float, 16>, 256-sample block", f, 400000);
+    }
+    {
+        MedianFilter<int16_t, 5> f;
+        block_case<int16_t>("MedianFilter<int16_t, 5>, 256-sample block", f, 100000);
+    }
+    {
+        MedianFilter<float, 15> f;
+        block_case<float>("MedianFilter<float, 15>, 256-sample block", f, 50000);
+    }
+    {
+        BiquadQ15 f(lowpass);
+        block_case<q15_t>("BiquadQ15 low-pass, 256-sample block", f, 400000);
+    }
+    {
+        BiquadQ31 f(lowpass);
+        block_case<q31_t>("BiquadQ31 low-pass, 256-sample block", f, 400000);
+    }
+    {
+        BiquadF32 f(lowpass);
+        block_case<float>("BiquadF32 low-pass, 256-sample block", f, 400000);
+    }
+    {
+        Decimator<int16_t, 4> f;
+        block_case<int16_t>("Decimator<int16_t, 4>, 256-sample block", f, 400000);
+    }
+    {
+        // The GPIO path: type-erased stages run in place
+        BlockFilterAdapter<MedianFilter<int16_t, 5>> median;
+        BlockFilterAdapter<BiquadQ15> biquad(lowpass);
+        FilterChain chain;
+        chain.add(&median);
+        chain.add(&biquad);
+        block_case<int16_t>("FilterChain median-of-5 + BiquadQ15, 256-sample block", chain, 100000);
+    }
+    return 0;
+}
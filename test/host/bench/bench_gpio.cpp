@@ -0,0 +1,101 @@
+// GPIO hot paths: the edge ISR (alone and through the driver dispatch), pin
+// access, register-level ports and the pulse counter.
+#include "bench.hpp"
+#include "host_fakes.hpp"
+#include "GPIO.hpp"
+#include "EspGpioRegisters.hpp"
+#include "PulseCounterMath.hpp"
+
+static const gpio_num_t EDGE_PIN = GPIO_NUM_4;
+static const gpio_num_t OUT_PIN = GPIO_NUM_5;
+static const gpio_num_t PULSE_PIN = GPIO_NUM_18;
+
+struct MemoryRegisters {
+    typedef gpio_mode_t mode_type;
+
+    static inline volatile uint64_t out = 0;
+
+    static void configure(uint64_t mask, gpio_mode_t mode) {}
+    static void set(uint64_t mask) { out = out | mask; }
+    static void clear(uint64_t mask) { out = out & ~mask; }
+    static uint64_t read() { return out; }
+};
+
+int main(int argc, char** argv) {
+    bench::init(argc, argv);
+
+    {
+        EdgeFilter filter(0);
+        SpscRing<gpio_edge_event_t> ring(1024);
+        gpio_edge_event_t drained[256];
+        bench::run("GPIO edge ISR body (EdgeFilter::accept + SpscRing::push)", 50000000, 256, [&](uint64_t i) {
+            gpio_edge_event_t ev;
+            if (filter.accept((int) (i & 1), (int64_t) i, &ev.coalesced)) {
+                ev.timestamp_us = (int64_t) i;
+                ev.pin = 4;
+                ev.level = (uint8_t) (i & 1);
+                ring.push(ev);
+            }
+            if ((i & 255) == 255) ring.pop(drained, 256);
+        });
+    }
+
+    {
+        GPIO pin(EDGE_PIN, GPIO_MODE_INPUT);
+        pin.enable_edge_capture(1024, 0, 64);
+        gpio_edge_event_t drained[256];
+        bench::run("GPIO edge ISR through gpio_input (shim dispatch included)", 5000000, 256, [&](uint64_t i) {
+            fake::gpio_input(EDGE_PIN, (int) (i & 1));
+            if ((i & 255) == 255) pin.read_edges(drained, 256, 0);
+        });
+        if (pin.edge_overflows()) printf("  edge ring overflowed %u times\n", (unsigned) pin.edge_overflows());
+    }
+
+    {
+        GPIO out(OUT_PIN, GPIO_MODE_OUTPUT);
+        bench::run("GPIO::set_level", 20000000, 1024, [&](uint64_t i) { out.set_level((uint32_t) (i & 1)); });
+        GPIO in(EDGE_PIN, GPIO_MODE_INPUT);
+        bench::run("GPIO::get_level", 20000000, 1024, [&](uint64_t i) { bench::keep(in.get_level()); });
+    }
+
+    {
+        fake::adc_set_raw(ADC_UNIT_1, ADC_CHANNEL_6, 2048);
+        GPIO analog(ADC_CHANNEL_6);
+        bench::run("GPIO::get_level, analog (shared unit lock + oneshot read)", 5000000, 256,
+                   [&](uint64_t i) { bench::keep(analog.get_level()); });
+    }
+
+    {
+        // Register writes land in plain memory: this is the port's own cost, the
+        // shim's per-pin simulation behind the real registers would swamp it
+        const uint64_t mask = (1ULL << 12) | (1ULL << 13) | (1ULL << 14) | (1ULL << 15) |
+                              (1ULL << 25) | (1ULL << 26) | (1ULL << 27) | (1ULL << 32);
+        GpioPortT<MemoryRegisters> port(mask, GPIO_MODE_OUTPUT);
+        bench::run("GpioPort::write, 8 pins over both banks", 50000000, 1024,
+                   [&](uint64_t i) { port.write((uint32_t) i); });
+        bench::run("GpioPort::read, same pins", 50000000, 1024, [&](uint64_t) { bench::keep(port.read()); });
+        StaticGpioPortT<MemoryRegisters, GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_15,
+                        GPIO_NUM_25, GPIO_NUM_26, GPIO_NUM_27, GPIO_NUM_32> fixed(GPIO_MODE_OUTPUT);
+        bench::run("StaticGpioPort::write, same pins", 50000000, 1024,
+                   [&](uint64_t i) { fixed.write((uint32_t) i); });
+    }
+
+    {
+        PulseExtender extender(32767);
+        int32_t raw = 0;
+        bench::run("PulseExtender::update", 50000000, 1024, [&](uint64_t i) {
+            raw = raw + 7 >= 32767 ? 0 : raw + 7;
+            bench::keep(extender.update(raw));
+        });
+    }
+
+    {
+        GPIO pulses(PULSE_PIN, GPIO_MODE_INPUT);
+        pulses.enable_pulse_counter();
+        bench::run("Edge into PCNT (no interrupt taken)", 5000000, 1024,
+                   [&](uint64_t i) { fake::gpio_input(PULSE_PIN, (int) (i & 1)); });
+        bench::run("GPIO::pulse_count", 5000000, 256, [&](uint64_t i) { bench::keep(pulses.pulse_count()); });
+    }
+
+    return 0;
+}
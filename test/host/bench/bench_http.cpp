@@ -0,0 +1,143 @@
+// HttpClient hot paths: payload building, a request on a pooled keep-alive
+// connection against the fake server, the response cache and request compression.
+#include <atomic>
+#include <string>
+#include <thread>
+#include "bench.hpp"
+#include "host_fakes.hpp"
+#include "HttpClient.hpp"
+#include "HttpCache.hpp"
+#include "HttpRequestQueue.hpp"
+#include "JsonEscape.hpp"
+#include "TokenBucket.hpp"
+
+static const char* TEXT = "Door opened at 21:04, battery 87%, \"front\" sensor";
+
+static std::string json_body(size_t bytes) {
+    std::string body = "[";
+    for (int i = 0; body.size() < bytes; i++) {
+        if (i) body += ",";
+        body += "{\"sensor\":\"temp_" + std::to_string(i % 8) + "\",\"value\":" + std::to_string(20 + i % 7) +
+                ".5,\"unit\":\"C\",\"ok\":true}";
+    }
+    return body + "]";
+}
+
+int main(int argc, char** argv) {
+    bench::init(argc, argv);
+
+    {
+        char out[128];
+        size_t len = strlen(TEXT);
+        bench::run("json_escape (48 bytes)", 20000000, 1024, [&](uint64_t) { bench::keep(json_escape(TEXT, len, out, sizeof(out))); });
+        bench::run("HttpClient::telegramPayload (48-byte text)", 5000000, 1024,
+                   [&](uint64_t) { bench::keep(HttpClient::telegramPayload("123456789", TEXT)); });
+    }
+
+    {
+        TokenBucket bucket(1.0f, 20.0f, 0);
+        bench::run("TokenBucket::try_take", 50000000, 1024, [&](uint64_t i) { bench::keep(bucket.try_take((int64_t) i * 1000)); });
+    }
+
+    {
+        std::string body(1024, 'x');
+        fake::http_set_responder([&body](const fake::HttpRequest&) {
+            fake::HttpResponse response;
+            response.body = body;
+            return response;
+        });
+        HttpClient client;
+        DiscardSink sink;
+        int status = 0;
+        bench::run("HttpClient GET, 1 KB body, pooled keep-alive connection", 500000, 64, [&](uint64_t) {
+            client.request(HTTP_METHOD_GET, "http://bench.local/status", (const char*) nullptr, 0, sink, &status);
+        });
+        std::string post = json_body(1400);
+        bench::run("HttpClient POST, 1.4 KB JSON, pooled keep-alive connection", 500000, 64, [&](uint64_t) {
+            client.request(HTTP_METHOD_POST, "http://bench.local/ingest", &post, sink, &status);
+        });
+        fake::HttpStats stats = fake::http_stats();
+        printf("  %u requests over %u connections\n", (unsigned) stats.requests, (unsigned) stats.connects);
+
+        HttpCompressionConfig compression;
+        compression.request_encoding = HTTP_ENCODING_GZIP;
+        HttpClient::set_compression(compression);
+        bench::run("HttpClient POST, 1.4 KB JSON, gzip request body", 200000, 64, [&](uint64_t) {
+            client.request(HTTP_METHOD_POST, "http://bench.local/ingest", &post, sink, &status);
+        });
+        compression.request_encoding = HTTP_ENCODING_NONE;
+        HttpClient::set_compression(compression);
+    }
+
+    {
+        // Queue overhead on top of the request itself: an empty 200 from the fake server
+        fake::http_set_responder([](const fake::HttpRequest&) { return fake::HttpResponse(); });
+        HttpRequestQueue queue(2);
+        std::atomic<uint64_t> done{0};
+        bench::run("HttpRequestQueue submit_future + get, 2 workers", 200000, 64, [&](uint64_t) {
+            HttpRequest request;
+            request.url = "http://bench.local/status";
+            bench::keep(queue.submit_future(std::move(request)).get().status);
+        });
+        // Up to 16 waiting: workers never starve while the caller keeps submitting
+        uint64_t submitted = 0;
+        bench::run("HttpRequestQueue submit, 16 pending, 2 workers", 500000, 64, [&](uint64_t) {
+            HttpRequest request;
+            request.url = "http://bench.local/status";
+            request.on_complete = [&done](const HttpResponse&) { done.fetch_add(1, std::memory_order_relaxed); };
+            // Only this thread submits, so a free slot stays free until submit()
+            while (queue.pending() >= 16) std::this_thread::yield();
+            if (queue.submit(std::move(request))) submitted++;
+        });
+        while (done.load() < submitted) std::this_thread::yield();
+        http_queue_stats_t stats = queue.stats();
+        printf("  peak pending %u, rejected %u; %zu bytes per queued HttpRequest, 2 x 6144 byte worker stacks\n",
+               (unsigned) stats.peak_pending, (unsigned) stats.rejected, sizeof(HttpRequest));
+    }
+
+    {
+        HttpCacheStore store(64 * 1024, 16 * 1024);
+        HttpCacheHeaders headers;
+        headers.etag = "\"v1\"";
+        headers.cache_control = "max-age=3600";
+        std::string body(512, 'c');
+        std::string urls[32];
+        for (int i = 0; i < 32; i++) {
+            urls[i] = "http://bench.local/config/" + std::to_string(i);
+            store.store(urls[i], headers, body.data(), body.size(), 0);
+        }
+        HttpCacheHit hit;
+        bench::run("HttpCacheStore::lookup, fresh hit, 32 entries", 10000000, 1024,
+                   [&](uint64_t i) { bench::keep(store.lookup(urls[i & 31], 1000, &hit)); });
+
+        fake::http_set_responder([&body](const fake::HttpRequest&) {
+            fake::HttpResponse response;
+            response.headers = {{"ETag", "\"v1\""}, {"Cache-Control", "max-age=3600"}};
+            response.body = body;
+            return response;
+        });
+        HttpCache::instance().begin();
+        HttpClient client;
+        DiscardSink sink;
+        bench::run("HttpClient GET served from HttpCache (fresh)", 1000000, 64, [&](uint64_t) {
+            client.get("http://bench.local/config/cached", sink);
+        });
+        HttpCache::instance().clear();
+    }
+
+    {
+        std::string json = json_body(1400);
+        std::vector<uint32_t> hash(HTTP_DEFLATE_HASH_SIZE);
+        std::vector<uint8_t> out(json.size());
+        size_t out_len = 0;
+        bench::run("HttpDeflater::compress, 1.4 KB JSON", 200000, 16, [&](uint64_t) {
+            std::fill(hash.begin(), hash.end(), 0);
+            bench::keep(HttpDeflater::compress((const uint8_t*) json.data(), json.size(), HTTP_ENCODING_GZIP,
+                                               out.data(), out.size(), &out_len, hash.data()));
+        });
+        printf("  %zu -> %zu bytes\n", json.size(), out_len);
+    }
+
+    fake::http_reset();
+    return 0;
+}
@@ -0,0 +1,213 @@
+// Mqtt_Connection hot paths: publishing into esp-mqtt, incoming dispatch
+// through the topic router and topic alias selection. Also what the MQTT 5
+// session saves: bytes on the wire per QoS 0 message with and without topic
+// aliases, and connect-to-ready time after a broker outage with a clean and a
+// resumed session.
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "host_fakes.hpp"
+#include "Mqtt_Connection.hpp"
+
+static const int ROUTER_FILTERS = 4096;
+
+static bool wait_connected(Mqtt_Connection& mqtt) {
+    for (int i = 0; i < 2000; i++) {
+        if (mqtt.session_stats().connects > 0) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+// Mean PUBLISH size over everything the fake broker recorded
+static double mean_wire_bytes() {
+    std::vector<fake::MqttMessage> published = fake::mqtt_published();
+    size_t total = 0;
+    for (const fake::MqttMessage& m : published) total += m.wire_bytes;
+    return published.empty() ? 0.0 : (double) total / published.size();
+}
+
+static void alias_case(const char* name, uint16_t topic_aliases, const std::string* topics, size_t count,
+                       int messages) {
+    fake::mqtt_reset();
+    MqttSessionConfig session;
+    session.topic_aliases = topic_aliases;
+    Mqtt_Connection mqtt;
+    mqtt.begin("mqtt://bench.local", MqttOutboxConfig(), session);
+    if (!wait_connected(mqtt)) {
+        printf("%s: MQTT client did not connect\n", name);
+        return;
+    }
+    // The size of a small CBOR reading
+    std::string payload(14, 'c');
+    for (int i = 0; i < messages; i++) {
+        mqtt.publish(topics[i % count], payload, 0);
+        if ((i & 31) == 31) fake::mqtt_flush();
+    }
+    fake::mqtt_flush();
+    mqtt_session_stats_t stats = mqtt.session_stats();
+    printf("%-64s %6.1f B/msg, %u aliases set up\n", name, mean_wire_bytes(), (unsigned) stats.aliases.established);
+}
+
+// Broker drops off and comes back `rounds` times; CONNACK and each SUBACK take
+// one 20 ms round trip
+static void reconnect_case(const char* name, uint32_t session_expiry_s, int rounds) {
+    fake::mqtt_reset();
+    fake::mqtt_set_connect_delay_ms(20);
+    fake::mqtt_set_ack_delay_ms(20);
+    MqttSessionConfig session;
+    session.session_expiry_s = session_expiry_s;
+    Mqtt_Connection mqtt;
+    for (const char* filter : {"cmd/esp32/+", "config/esp32/#", "ota/esp32/url", "home/+/presence"}) {
+        mqtt.subscribe(filter, 1);
+    }
+    mqtt.begin("mqtt://bench.local", MqttOutboxConfig(), session);
+    if (!wait_connected(mqtt)) {
+        printf("%s: MQTT client did not connect\n", name);
+        return;
+    }
+    fake::mqtt_flush();
+
+    double connect_ms = 0, ready_ms = 0;
+    for (int r = 0; r < rounds; r++) {
+        fake::mqtt_set_online(false);
+        fake::mqtt_flush();
+        fake::mqtt_set_online(true);
+        // Waits out the reconnect, CONNACK and any SUBACKs
+        fake::mqtt_flush();
+        mqtt_session_stats_t stats = mqtt.session_stats();
+        connect_ms += stats.last_connect_us / 1000.0;
+        ready_ms += stats.last_ready_us / 1000.0;
+    }
+    mqtt_session_stats_t stats = mqtt.session_stats();
+    printf("%-64s connect %.1f ms, ready %.1f ms (%u connects, %u resumed, %u resubscribed)\n", name,
+           connect_ms / rounds, ready_ms / rounds, (unsigned) stats.connects, (unsigned) stats.sessions_resumed,
+           (unsigned) stats.resubscribed);
+}
+
+int main(int argc, char** argv) {
+    bench::init(argc, argv);
+
+    {
+        // A fleet gateway's table: per-device metrics, command wildcards and
+        // site-wide '#' filters, in an order unrelated to the topics
+        MqttTopicRouter router;
+        uint64_t calls = 0;
+        auto count = [&calls](std::string_view, std::string_view) { calls++; };
+        static const char* METRICS[] = {"temperature", "humidity", "pressure", "battery", "rssi", "status"};
+        uint32_t state = 2463534242u;
+        for (int i = 0; i < ROUTER_FILTERS; i++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            std::string site = "site" + std::to_string(state % 16);
+            std::string dev = "dev" + std::to_string((state >> 4) % 256);
+            const char* metric = METRICS[(state >> 12) % 6];
+            switch ((state >> 16) % 10) {
+                case 6: router.add("fleet/" + site + "/" + dev + "/+", count); break;
+                case 7: router.add("fleet/" + site + "/+/" + metric, count); break;
+                case 8: router.add("fleet/+/" + dev + "/" + metric + "/#", count); break;
+                case 9: router.add("fleet/" + site + "/" + dev + "/#", count); break;
+                default: router.add("fleet/" + site + "/" + dev + "/" + metric, count); break;
+            }
+        }
+        router.add("$SYS/#", count);
+        char name[96];
+        calls = 0;
+        router.dispatch("fleet/site3/dev77/temperature", "21.5");
+        snprintf(name, sizeof(name), "MqttTopicRouter::dispatch, %d filters, %llu matches", ROUTER_FILTERS + 1,
+                 (unsigned long long) calls);
+        bench::run(name, 5000000, 1024,
+                   [&](uint64_t) { bench::keep(router.dispatch("fleet/site3/dev77/temperature", "21.5")); });
+        bench::run("MqttTopicRouter::dispatch, same filters, no match", 10000000, 1024,
+                   [&](uint64_t) { bench::keep(router.dispatch("office/desk/light", "on")); });
+        bench::run("MqttTopicRouter::dispatch, same filters, unknown device", 10000000, 1024,
+                   [&](uint64_t) { bench::keep(router.dispatch("fleet/site3/dev999/temperature", "0")); });
+    }
+
+    {
+        MqttTopicAliases aliases;
+        aliases.reset(5, 2);
+        std::string topics[8];
+        for (int i = 0; i < 8; i++) topics[i] = "sensors/esp32-a1b2c3/channel" + std::to_string(i);
+        bool with_topic = false;
+        bench::run("MqttTopicAliases::lookup, 8 topics, 5 aliases", 20000000, 1024,
+                   [&](uint64_t i) { bench::keep(aliases.lookup(topics[i & 7], &with_topic)); });
+    }
+
+    {
+        fake::mqtt_record_published(false);
+        Mqtt_Connection mqtt;
+        // Budgets large enough that publishes go straight to esp-mqtt; the client
+        // task is drained every 256 publishes, so the rate includes sending
+        MqttOutboxConfig outbox;
+        outbox.memory_budget = 1024 * 1024;
+        outbox.inflight_budget = 1024 * 1024;
+        mqtt.begin("mqtt://bench.local", outbox);
+        if (!wait_connected(mqtt)) {
+            printf("MQTT client did not connect\n");
+            return 1;
+        }
+
+        {
+            std::string payload = "{\"t\":21.5,\"h\":48,\"ok\":true}";
+            bench::run("Mqtt_Connection::publish, QoS 0, 28 B", 2000000, 256, [&](uint64_t i) {
+                mqtt.publish("sensors/esp32/climate", payload, 0);
+                if ((i & 255) == 255) fake::mqtt_flush();
+            });
+            bench::run("Mqtt_Connection::publish, QoS 1, 28 B", 1000000, 256, [&](uint64_t i) {
+                mqtt.publish("sensors/esp32/climate", payload, 1);
+                if ((i & 255) == 255) fake::mqtt_flush();
+            });
+            MqttMessage batch[8];
+            for (MqttMessage& m : batch) {
+                m.topic = "sensors/esp32/batch";
+                m.payload = payload;
+                m.qos = 0;
+            }
+            bench::run("Mqtt_Connection::publish_batch, 8 x QoS 0", 250000, 32, [&](uint64_t i) {
+                bench::keep(mqtt.publish_batch(batch, 8));
+                if ((i & 31) == 31) fake::mqtt_flush();
+            });
+            fake::mqtt_flush();
+            mqtt_outbox_stats_t stats = mqtt.outbox_stats();
+            printf("  published %u, queued peak %u B, dropped %u\n", (unsigned) stats.published,
+                   (unsigned) stats.peak_queued_bytes, (unsigned) stats.dropped);
+        }
+
+        {
+            uint64_t received = 0;
+            mqtt.subscribe("cmd/esp32/+", 0, [&received](std::string_view, std::string_view) { received++; });
+            fake::mqtt_flush();
+            std::string payload(64, 'p');
+            bench::run("Incoming message, broker to handler (MQTT task hop)", 200000, 64, [&](uint64_t i) {
+                fake::mqtt_deliver("cmd/esp32/relay", payload);
+                if ((i & 63) == 63) fake::mqtt_flush();
+            });
+            fake::mqtt_flush();
+            std::string big(16 * 1024, 'b');
+            bench::run("Incoming 16 KB message in 1 KB fragments (reassembly)", 20000, 16,
+                       [&](uint64_t) { fake::mqtt_deliver("cmd/esp32/firmware", big, 1024); });
+            fake::mqtt_flush();
+            printf("  handler calls: %llu\n", (unsigned long long) received);
+        }
+    }
+
+    // One client at a time from here: they share the default client id
+    const std::string single = "school/test/sensor";
+    alias_case("QoS 0, one topic, aliases off", 0, &single, 1, 1000);
+    alias_case("QoS 0, one topic, 5 aliases", 5, &single, 1, 1000);
+    std::string rotation[8];
+    for (int i = 0; i < 8; i++) rotation[i] = "sensors/esp32-a1b2c3/channel" + std::to_string(i);
+    alias_case("QoS 0, 8 topics in rotation, aliases off", 0, rotation, 8, 1000);
+    alias_case("QoS 0, 8 topics in rotation, 5 aliases", 5, rotation, 8, 1000);
+
+    int rounds = bench::g_quick ? 2 : 20;
+    reconnect_case("Reconnect, 4 subscriptions, 20 ms RTT, clean session", 0, rounds);
+    reconnect_case("Reconnect, 4 subscriptions, 20 ms RTT, resumed session", 3600, rounds);
+
+    fake::mqtt_reset();
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Telemetry hot paths: encoding the example structs to CBOR and JSON against
+// the snprintf JSON they replaced, decoding, and the seqlock handoff. Payload
+// sizes are printed for the value ranges the examples produce.
+#include "bench.hpp"
+#include "Seqlock.hpp"
+#include "Telemetry.hpp"
+
+typedef struct {
+    float distance;
+    uint32_t timestamp;
+} sensor_data_t;
+
+static constexpr auto sensor_schema = telemetry::schema<sensor_data_t>(
+    telemetry::field("distance", &sensor_data_t::distance),
+    telemetry::field("timestamp", &sensor_data_t::timestamp));
+
+// As published by the Wi-Fi example
+typedef struct {
+    int32_t x;
+    int32_t y;
+    bool pressed;
+    uint32_t timestamp;
+} joystick_data_t;
+
+static constexpr auto joystick_schema = telemetry::schema<joystick_data_t>(
+    telemetry::field("x", &joystick_data_t::x),
+    telemetry::field("y", &joystick_data_t::y),
+    telemetry::field("pressed", &joystick_data_t::pressed),
+    telemetry::field("timestamp", &joystick_data_t::timestamp));
+
+// 12-bit ADC axes, a millisecond timestamp a few minutes to a day into uptime
+static joystick_data_t joystick(uint64_t i) {
+    return {(int32_t) (i * 37 % 4096), (int32_t) (i * 91 % 4096), (i & 8) != 0,
+            (uint32_t) (100000 + i * 7919 % 86400000)};
+}
+
+// Ultrasonic distances in 0.5 cm steps up to 4 m
+static sensor_data_t sensor(uint64_t i) {
+    return {(float) (i % 800) * 0.5f, (uint32_t) (100000 + i * 7919 % 86400000)};
+}
+
+static int snprintf_joystick(const joystick_data_t& d, char* out, size_t cap) {
+    return snprintf(out, cap, "{\"x\": %ld, \"y\": %ld, \"pressed\": %s, \"timestamp\": %lu}", (long) d.x,
+                    (long) d.y, d.pressed ? "true" : "false", (unsigned long) d.timestamp);
+}
+
+static int snprintf_sensor(const sensor_data_t& d, char* out, size_t cap) {
+    return snprintf(out, cap, "{\"distance\": %.2f, \"timestamp\": %lu}", d.distance, (unsigned long) d.timestamp);
+}
+
+struct Sizes {
+    size_t min = SIZE_MAX;
+    size_t max = 0;
+    double total = 0;
+    size_t n = 0;
+
+    void add(size_t len) {
+        min = std::min(min, len);
+        max = std::max(max, len);
+        total += len;
+        n++;
+    }
+
+    void print(const char* name) const {
+        printf("  %-28s %zu-%zu bytes, mean %.1f\n", name, min, max, total / n);
+    }
+};
+
+int main(int argc, char** argv) {
+    bench::init(argc, argv);
+    uint8_t cbor[64];
+    char json[96];
+
+    bench::run("telemetry::encode_cbor (4 fields)", 20000000, 1024, [&](uint64_t i) {
+        bench::keep(telemetry::encode_cbor(joystick_schema, joystick(i), cbor, sizeof(cbor)));
+    });
+    bench::run("telemetry::encode_json (4 fields)", 5000000, 1024, [&](uint64_t i) {
+        bench::keep(telemetry::encode_json(joystick_schema, joystick(i), json, sizeof(json)));
+    });
+    bench::run("snprintf JSON (4 fields)", 5000000, 1024, [&](uint64_t i) {
+        bench::keep(snprintf_joystick(joystick(i), json, sizeof(json)));
+    });
+    {
+        size_t len = telemetry::encode_cbor(joystick_schema, joystick(12345), cbor, sizeof(cbor));
+        joystick_data_t out;
+        bench::run("telemetry::decode_cbor (4 fields)", 20000000, 1024, [&](uint64_t) {
+            bench::keep(telemetry::decode_cbor(joystick_schema, cbor, len, out));
+            bench::keep(out);
+        });
+    }
+
+    bench::run("telemetry::encode_cbor (sensor_data_t)", 20000000, 1024, [&](uint64_t i) {
+        bench::keep(telemetry::encode_cbor(sensor_schema, sensor(i), cbor, sizeof(cbor)));
+    });
+    bench::run("snprintf JSON (sensor_data_t)", 5000000, 1024, [&](uint64_t i) {
+        bench::keep(snprintf_sensor(sensor(i), json, sizeof(json)));
+    });
+
+    {
+        Seqlock<joystick_data_t> slot;
+        bench::run("Seqlock store / load (16 bytes)", 50000000, 1024, [&](uint64_t i) {
+            slot.store(joystick(i));
+            bench::keep(slot.load());
+        });
+    }
+
+    Sizes joystick_cbor, joystick_json, joystick_printf, sensor_cbor, sensor_json, sensor_printf;
+    for (uint64_t i = 0; i < 100000; i++) {
+        joystick_data_t j = joystick(i);
+        joystick_cbor.add(telemetry::encode_cbor(joystick_schema, j, cbor, sizeof(cbor)));
+        joystick_json.add(telemetry::encode_json(joystick_schema, j, json, sizeof(json)));
+        joystick_printf.add((size_t) snprintf_joystick(j, json, sizeof(json)));
+        sensor_data_t s = sensor(i);
+        sensor_cbor.add(telemetry::encode_cbor(sensor_schema, s, cbor, sizeof(cbor)));
+        sensor_json.add(telemetry::encode_json(sensor_schema, s, json, sizeof(json)));
+        sensor_printf.add((size_t) snprintf_sensor(s, json, sizeof(json)));
+    }
+    joystick_cbor.print("joystick CBOR");
+    joystick_json.print("joystick encode_json");
+    joystick_printf.print("joystick snprintf JSON");
+    sensor_cbor.print("sensor_data_t CBOR");
+    sensor_json.print("sensor_data_t encode_json");
+    sensor_printf.print("sensor_data_t snprintf JSON");
+    return 0;
+}
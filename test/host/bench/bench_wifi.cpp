@@ -0,0 +1,55 @@
+// WiFiManager hot paths: the reconnect policy decisions, and connect() from
+// driver start to IP with and without the cached access point. Connect times
+// follow the fake AP's scripted scan/association/DHCP delays, so they show
+// what the fast path skips rather than real radio timing.
+#include "bench.hpp"
+#include "host_fakes.hpp"
+#include "WiFiManager.hpp"
+
+static uint32_t fixed_random() { return 12345; }
+
+static void connect_case(const char* name, uint64_t connects, const WiFiOptions& options) {
+    fake::WifiAp ap;
+    fake::WifiStats total = {};
+    bench::run(name, connects, 1, [&](uint64_t) {
+        fake::wifi_reset();
+        WiFiManager wifi(ap.ssid, ap.password, options);
+        if (wifi.connect() != ESP_OK) printf("  connect timed out\n");
+        fake::WifiStats stats = fake::wifi_stats();
+        total.scans += stats.scans;
+        total.fast_connects += stats.fast_connects;
+    });
+    printf("  scans %u, fast connects %u\n", (unsigned) total.scans, (unsigned) total.fast_connects);
+}
+
+int main(int argc, char** argv) {
+    bench::init(argc, argv);
+
+    {
+        WiFiReconnectPolicy policy(500, 60000, fixed_random);
+        policy.on_start(false);
+        policy.on_got_ip();
+        bench::run("WiFiReconnectPolicy disconnect + retry", 50000000, 1024, [&](uint64_t) {
+            bench::keep(policy.on_disconnected());
+            bench::keep(policy.on_disconnected());
+            bench::keep(policy.on_backoff_elapsed());
+            bench::keep(policy.on_got_ip());
+        });
+    }
+
+    fake::wifi_set_ap(fake::WifiAp());
+    fake::nvs_erase_all();
+
+    WiFiOptions scan;
+    scan.fast_reconnect = false;
+    connect_case("WiFiManager::connect, scan + DHCP", 40, scan);
+
+    WiFiOptions fast;
+    connect_case("WiFiManager::connect, cached BSSID/channel + DHCP", 40, fast);
+
+    fast.reuse_lease = true;
+    connect_case("WiFiManager::connect, cached BSSID/channel + cached lease", 40, fast);
+
+    fake::wifi_reset();
+    return 0;
+}
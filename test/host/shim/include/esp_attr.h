@@ -0,0 +1,9 @@
+#pragma once
+
+// Placement attributes mean nothing off-target
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define EXT_RAM_BSS_ATTR
+#define NOINLINE_ATTR __attribute__((noinline))
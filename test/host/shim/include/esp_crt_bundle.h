@@ -0,0 +1,5 @@
+#pragma once
+#include "esp_err.h"
+
+// No TLS off-target; attaching the bundle always succeeds
+esp_err_t esp_crt_bundle_attach(void* conf);
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include <stdarg.h>
+#include "sdkconfig.h"
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+// Lines go to stderr. Tests and benchmarks silence them with esp_log_level_set("*", ESP_LOG_NONE).
+void esp_log_level_set(const char* tag, esp_log_level_t level);
+esp_log_level_t esp_log_level_get(const char* tag);
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+void esp_log_writev(esp_log_level_t level, const char* tag, const char* format, va_list args);
+uint32_t esp_log_timestamp(void);
+
+#ifndef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL CONFIG_LOG_MAXIMUM_LEVEL
+#endif
+
+// No colours off-target; the macros exist for code that builds its own lines
+#define LOG_COLOR_E ""
+#define LOG_COLOR_W ""
+#define LOG_COLOR_I ""
+#define LOG_COLOR_D ""
+#define LOG_COLOR_V ""
+#define LOG_RESET_COLOR ""
+
+#define LOG_FORMAT(letter, format) #letter " (%lu) %s: " format "\n"
+
+#define ESP_LOG_LEVEL_LOCAL(level, letter, tag, format, ...)                                        \
+    do {                                                                                           \
+        if (LOG_LOCAL_LEVEL >= (level)) {                                                          \
+            esp_log_write((level), (tag), LOG_FORMAT(letter, format), (unsigned long) esp_log_timestamp(), \
+                          (tag), ##__VA_ARGS__);                                                   \
+        }                                                                                          \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_ERROR, E, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_WARN, W, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_INFO, I, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_DEBUG, D, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_VERBOSE, V, tag, format, ##__VA_ARGS__)
+
+#define ESP_EARLY_LOGE ESP_LOGE
+#define ESP_EARLY_LOGW ESP_LOGW
+#define ESP_EARLY_LOGI ESP_LOGI
+#define ESP_DRAM_LOGE ESP_LOGE
+#define ESP_DRAM_LOGW ESP_LOGW
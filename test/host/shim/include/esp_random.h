@@ -0,0 +1,7 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Deterministic stream; reseed with fake::random_seed
+uint32_t esp_random(void);
+void esp_fill_random(void* buf, size_t len);
@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_random.h"
+
+// Runs the hook set with fake::set_restart_handler, then exits
+void esp_restart(void) __attribute__((noreturn));
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
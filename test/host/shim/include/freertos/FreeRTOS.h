@@ -0,0 +1,86 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "esp_bit_defs.h"
+
+// FreeRTOS on host threads. Tasks are pthreads, ticks are milliseconds, and
+// "ISR" code is whatever thread raises the fake interrupt (see host_fakes.hpp).
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+#define pdTRUE ((BaseType_t) 1)
+#define pdFALSE ((BaseType_t) 0)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_EMPTY ((BaseType_t) 0)
+#define errQUEUE_FULL ((BaseType_t) 0)
+
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES 25
+#define configMINIMAL_STACK_SIZE 768
+#define configMAX_TASK_NAME_LEN 16
+#define configUSE_TRACE_FACILITY CONFIG_FREERTOS_USE_TRACE_FACILITY
+#define configGENERATE_RUN_TIME_STATS CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+#define configASSERT(x) assert(x)
+
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define portNUM_PROCESSORS 2
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t) (((uint64_t) (xTimeInMs) * configTICK_RATE_HZ) / 1000U))
+#define pdTICKS_TO_MS(xTicks) ((uint32_t) (((uint64_t) (xTicks) * 1000U) / configTICK_RATE_HZ))
+
+#define tskNO_AFFINITY ((BaseType_t) 0x7FFFFFFF)
+#define tskIDLE_PRIORITY ((UBaseType_t) 0U)
+
+// Spinlock shared by tasks and fake ISRs; recursive per thread like the IDF one
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_FREE_VAL 0
+#define portMUX_INITIALIZER_UNLOCKED {portMUX_FREE_VAL, 0}
+#define portMUX_INITIALIZE(mux) \
+    do {                        \
+        (mux)->owner = 0;       \
+        (mux)->count = 0;       \
+    } while (0)
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+BaseType_t xPortGetCoreID(void);
+BaseType_t xPortInIsrContext(void);
+void vPortYield(void);
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_SAFE(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_SAFE(mux) vPortExitCritical(mux)
+#define taskENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define taskEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define taskENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define taskEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+
+#define portYIELD() vPortYield()
+#define portYIELD_FROM_ISR(...) \
+    do {                        \
+    } while (0)
+#define portEND_SWITCHING_ISR(x) portYIELD_FROM_ISR(x)
+
+struct tskTaskControlBlock;
+typedef struct tskTaskControlBlock* TaskHandle_t;
+
+struct QueueDefinition;
+typedef struct QueueDefinition* QueueHandle_t;
+
+struct EventGroupDef_t;
+typedef struct EventGroupDef_t* EventGroupHandle_t;
@@ -0,0 +1,164 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "esp_err.h"
+#include "esp_netif.h"
+#include "esp_partition.h"
+#include "esp_adc/adc_types.h"
+#include "driver/rmt_tx.h"
+
+// Control side of the host shim: tests and benches script the peripherals,
+// the access point, the HTTP server and the MQTT broker through these calls.
+// None of this exists on the target.
+namespace fake {
+
+// ---- System ----
+
+void heap_set_sizes(size_t free, size_t minimum_free, size_t largest_block);
+void random_seed(uint64_t seed);
+// Called by esp_restart before the process exits
+void set_restart_handler(std::function<void()> handler);
+// Waits until the default event loop has dispatched everything posted so far
+void event_loop_flush();
+
+// ---- GPIO / PCNT / RMT / MCPWM ----
+
+// Drives an input pin; an armed GPIO interrupt runs on the calling thread and
+// PCNT channels on the pin count the edge
+void gpio_input(int pin, int level);
+// Level of a pin, whoever drove it last
+int gpio_level(int pin);
+// GPIO interrupt handler calls since the last reset
+uint64_t gpio_interrupts();
+// All pins low, handlers and PCNT units left in place
+void gpio_reset();
+
+// Called after each rmt_transmit with the pin and the symbols sent
+using RmtTxHook = std::function<void(int pin, const rmt_symbol_word_t* symbols, size_t count)>;
+void rmt_set_tx_hook(RmtTxHook hook);
+
+// Raises a capture event on the enabled channel for pin; false if none
+bool mcpwm_capture(int pin, bool rising, uint32_t timer_value);
+
+// ---- ADC ----
+
+void adc_set_raw(adc_unit_t unit, adc_channel_t channel, int raw);
+// Feeds DMA result words to the started continuous driver, frame by frame;
+// returns the number of words that reached the pool. A trailing partial frame
+// is completed by the next feed.
+size_t adc_continuous_feed(const adc_digi_output_data_t* words, size_t count);
+
+// ---- Flash ----
+
+// Adds an erased data partition (replacing one with the same label)
+const esp_partition_t* partition_add(const char* label, uint32_t size, uint32_t erase_size = 4096);
+std::vector<uint8_t>& partition_image(const char* label);
+void nvs_erase_all();
+
+// ---- WiFi ----
+
+struct WifiAp {
+    std::string ssid = "host-ap";
+    std::string password = "password";
+    uint8_t bssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+    uint8_t channel = 6;
+    int8_t rssi = -50;
+    bool available = true;
+    uint32_t scan_ms = 30;    // Full channel scan
+    uint32_t assoc_ms = 5;    // Authentication + association + 4-way handshake
+    uint32_t dhcp_ms = 10;    // DISCOVER to ACK
+    esp_netif_ip_info_t lease = {{ESP_IP4TOADDR(192, 168, 1, 50)},
+                                 {ESP_IP4TOADDR(255, 255, 255, 0)},
+                                 {ESP_IP4TOADDR(192, 168, 1, 1)}};
+    esp_ip4_addr_t dns = {ESP_IP4TOADDR(192, 168, 1, 1)};
+};
+
+struct WifiStats {
+    uint32_t connects;
+    uint32_t scans;
+    uint32_t fast_connects;   // Connects with the BSSID and channel pinned
+};
+
+void wifi_set_ap(const WifiAp& ap);
+// The AP drops the station with reason
+void wifi_drop(uint8_t reason);
+WifiStats wifi_stats();
+// Driver and netif back to power-on state and the default event loop deleted,
+// so a WiFiManager can connect again; NVS is kept
+void wifi_reset();
+
+// ---- HTTP ----
+
+struct HttpRequest {
+    std::string method;
+    std::string url;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+
+    const char* header(const char* key) const;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    bool chunked = false;       // No Content-Length; fetch_headers returns 0
+    bool close = false;         // Server closes the connection after the response
+    bool drop = false;          // Server closes the connection instead of answering
+    uint32_t latency_us = 0;    // Spent in fetch_headers before the status arrives
+};
+
+struct HttpStats {
+    uint32_t connects;   // TCP/TLS handshakes
+    uint32_t requests;
+};
+
+using HttpResponder = std::function<HttpResponse(const HttpRequest& request)>;
+// The default responder answers 200 with an empty body
+void http_set_responder(HttpResponder responder);
+// The server closes every idle keep-alive connection
+void http_close_connections();
+HttpStats http_stats();
+void http_reset();
+
+// ---- MQTT ----
+
+struct MqttMessage {
+    std::string topic;   // Resolved from the topic alias when sent with one
+    std::string payload;
+    int qos;
+    bool retain;
+    uint16_t alias;
+    size_t wire_bytes;   // PUBLISH packet as sent: no topic when sent by alias alone, MQTT 5 properties included
+};
+
+struct MqttStats {
+    uint32_t connects;
+    uint32_t sessions_resumed;
+    uint32_t publishes;
+    uint32_t subscribes;
+};
+
+// Broker reachable or not; going offline disconnects every client
+void mqtt_set_online(bool online);
+// Delay before the broker acknowledges QoS 1/2 publishes and subscriptions
+void mqtt_set_ack_delay_ms(uint32_t ms);
+// Delay between a client connecting and its CONNACK; the client task is blocked through it
+void mqtt_set_connect_delay_ms(uint32_t ms);
+// Keep a copy of every publish (on by default; benches turn it off)
+void mqtt_record_published(bool record);
+std::vector<MqttMessage> mqtt_published();
+// Delivers to every client subscribed to a matching filter, in data events of
+// at most chunk bytes (0 = one event); returns the number of clients
+int mqtt_deliver(const std::string& topic, const std::string& payload, size_t chunk = 0);
+// Waits until every client task has delivered its pending events
+void mqtt_flush();
+MqttStats mqtt_stats();
+// Broker online, no stored sessions, records and stats cleared
+void mqtt_reset();
+
+}  // namespace fake
@@ -0,0 +1,80 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+// The ROM tinfl interface on top of zlib. zlib keeps its own history, so the
+// caller's wrapping output window only has to satisfy tinfl's contract, which
+// is still checked here: a power-of-two window unless the output is non-wrapping.
+
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+
+enum {
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8,
+};
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+// Same footprint as the ROM decompressor (about 11 KB)
+typedef struct {
+    int m_state;   // 0 = not started, 1 = inflating, 2 = done
+    z_stream z;
+    char pad[11000 - sizeof(z_stream)];
+} tinfl_decompressor;
+
+#define tinfl_init(r)     \
+    do {                  \
+        (r)->m_state = 0; \
+    } while (0)
+
+static inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* in, size_t* in_size,
+                                            mz_uint8* out_start, mz_uint8* out_next, size_t* out_size,
+                                            const mz_uint32 flags) {
+    size_t mask = (size_t) (out_next - out_start) + *out_size - 1;
+    if (!(flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) && (((mask + 1) & mask) || out_next < out_start)) {
+        *in_size = *out_size = 0;
+        return TINFL_STATUS_BAD_PARAM;
+    }
+    if (r->m_state == 0) {
+        memset(&r->z, 0, sizeof(r->z));
+        if (inflateInit2(&r->z, (flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15) != Z_OK) return TINFL_STATUS_FAILED;
+        r->m_state = 1;
+    }
+    if (r->m_state == 2) {
+        *in_size = *out_size = 0;
+        return TINFL_STATUS_DONE;
+    }
+
+    r->z.next_in = (Bytef*) in;
+    r->z.avail_in = (uInt) *in_size;
+    r->z.next_out = out_next;
+    r->z.avail_out = (uInt) *out_size;
+    int rc = inflate(&r->z, Z_NO_FLUSH);
+    *in_size -= r->z.avail_in;
+    *out_size -= r->z.avail_out;
+
+    if (rc == Z_STREAM_END) {
+        inflateEnd(&r->z);
+        r->m_state = 2;
+        return TINFL_STATUS_DONE;
+    }
+    if (rc == Z_DATA_ERROR && r->z.msg && strstr(r->z.msg, "data check")) return TINFL_STATUS_ADLER32_MISMATCH;
+    if (rc != Z_OK && rc != Z_BUF_ERROR) return TINFL_STATUS_FAILED;
+    if (r->z.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+    if (!(flags & TINFL_FLAG_HAS_MORE_INPUT)) return TINFL_STATUS_FAILED;
+    return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
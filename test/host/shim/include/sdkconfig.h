@@ -0,0 +1,13 @@
+#pragma once
+
+// Options the libraries test for, set as on an ESP32 build with FreeRTOS
+// run-time stats and esp-mqtt MQTT 5 support enabled
+#define CONFIG_IDF_TARGET "esp32"
+#define CONFIG_IDF_TARGET_ESP32 1
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_FREERTOS_USE_TRACE_FACILITY 1
+#define CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS 1
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+#define CONFIG_LOG_MAXIMUM_LEVEL 3
+#define CONFIG_MQTT_PROTOCOL_5 1
+#define CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS 1
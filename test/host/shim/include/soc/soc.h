@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+#define DR_REG_GPIO_BASE 0x3ff44000
+
+// Register accesses go to the fake register file; the GPIO block is wired to
+// the fake pins (see host_fakes.hpp)
+void host_reg_write(uint32_t addr, uint32_t value);
+uint32_t host_reg_read(uint32_t addr);
+
+#define REG_WRITE(_r, _v) host_reg_write((uint32_t) (_r), (uint32_t) (_v))
+#define REG_READ(_r) host_reg_read((uint32_t) (_r))
+#define REG_SET_BIT(_r, _b) REG_WRITE((_r), REG_READ(_r) | (_b))
+#define REG_CLR_BIT(_r, _b) REG_WRITE((_r), REG_READ(_r) & ~(_b))
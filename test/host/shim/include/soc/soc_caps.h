@@ -0,0 +1,15 @@
+#pragma once
+
+// ESP32 values
+#define SOC_GPIO_PIN_COUNT 40
+#define SOC_ADC_DIGI_RESULT_BYTES 2
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#define SOC_ADC_PATT_LEN_MAX 16
+#define SOC_RMT_MEM_WORDS_PER_CHANNEL 64
+#define SOC_RMT_TX_CANDIDATES_PER_GROUP 8
+#define SOC_PCNT_UNITS_PER_GROUP 8
+#define SOC_PCNT_CHANNELS_PER_UNIT 2
+#define SOC_MCPWM_GROUPS 2
+#define SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER 3
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW 20000
+#define SOC_ADC_SAMPLE_FREQ_THRES_HIGH 2000000
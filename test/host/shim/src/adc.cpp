@@ -0,0 +1,229 @@
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
+#include "soc/soc_caps.h"
+#include "host_fakes.hpp"
+#include "host_internal.hpp"
+
+// ---- One-shot ----
+
+struct adc_oneshot_unit_ctx_t {
+    adc_unit_t unit;
+};
+
+namespace {
+
+const int ADC_UNITS = 2;
+const int ADC_CHANNELS = 10;
+
+struct Oneshot {
+    std::mutex lock;
+    adc_oneshot_unit_ctx_t* units[ADC_UNITS] = {};
+    int raw[ADC_UNITS][ADC_CHANNELS] = {};
+};
+
+Oneshot& oneshot() {
+    static Oneshot* o = new Oneshot();
+    return *o;
+}
+
+}  // namespace
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t* init_config, adc_oneshot_unit_handle_t* ret_unit) {
+    if (!init_config || !ret_unit || init_config->unit_id >= ADC_UNITS) return ESP_ERR_INVALID_ARG;
+    Oneshot& o = oneshot();
+    std::lock_guard<std::mutex> guard(o.lock);
+    if (o.units[init_config->unit_id]) return ESP_ERR_NOT_FOUND;
+    adc_oneshot_unit_ctx_t* u = new adc_oneshot_unit_ctx_t{init_config->unit_id};
+    o.units[u->unit] = u;
+    *ret_unit = u;
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t handle, adc_channel_t channel,
+                                     const adc_oneshot_chan_cfg_t* config) {
+    if (!handle || !config || channel >= ADC_CHANNELS) return ESP_ERR_INVALID_ARG;
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t handle, adc_channel_t chan, int* out_raw) {
+    if (!handle || !out_raw || chan >= ADC_CHANNELS) return ESP_ERR_INVALID_ARG;
+    Oneshot& o = oneshot();
+    std::lock_guard<std::mutex> guard(o.lock);
+    *out_raw = o.raw[handle->unit][chan];
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_del_unit(adc_oneshot_unit_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_ARG;
+    Oneshot& o = oneshot();
+    std::lock_guard<std::mutex> guard(o.lock);
+    o.units[handle->unit] = nullptr;
+    delete handle;
+    return ESP_OK;
+}
+
+// ---- Continuous ----
+
+struct adc_continuous_ctx_t {
+    std::mutex lock;
+    std::condition_variable readable;
+    uint32_t pool_size;
+    uint32_t frame_size;
+    bool flush_pool;
+    bool configured = false;
+    bool started = false;
+    adc_continuous_evt_cbs_t cbs = {};
+    void* user_data = nullptr;
+    std::deque<uint8_t> pool;
+    std::vector<uint8_t> partial;   // Words fed short of a whole frame
+};
+
+namespace {
+
+// The ESP32 has one digital controller, so one continuous driver at a time
+std::mutex s_continuous_lock;
+adc_continuous_ctx_t* s_continuous = nullptr;
+
+}  // namespace
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t* hdl_config, adc_continuous_handle_t* ret_handle) {
+    if (!hdl_config || !ret_handle || hdl_config->conv_frame_size == 0 ||
+        hdl_config->conv_frame_size % SOC_ADC_DIGI_RESULT_BYTES ||
+        hdl_config->max_store_buf_size < hdl_config->conv_frame_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> guard(s_continuous_lock);
+    if (s_continuous) return ESP_ERR_INVALID_STATE;
+    adc_continuous_ctx_t* ctx = new adc_continuous_ctx_t();
+    ctx->pool_size = hdl_config->max_store_buf_size;
+    ctx->frame_size = hdl_config->conv_frame_size;
+    ctx->flush_pool = hdl_config->flags.flush_pool;
+    s_continuous = ctx;
+    *ret_handle = ctx;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle, const adc_continuous_config_t* config) {
+    if (!handle || !config || config->pattern_num == 0 || config->pattern_num > SOC_ADC_PATT_LEN_MAX ||
+        config->sample_freq_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW ||
+        config->sample_freq_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (handle->started) return ESP_ERR_INVALID_STATE;
+    handle->configured = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t handle, const adc_continuous_evt_cbs_t* cbs,
+                                                  void* user_data) {
+    if (!handle || !cbs) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (handle->started) return ESP_ERR_INVALID_STATE;
+    handle->cbs = *cbs;
+    handle->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle) {
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (handle->started || !handle->configured) return ESP_ERR_INVALID_STATE;
+    handle->started = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_stop(adc_continuous_handle_t handle) {
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (!handle->started) return ESP_ERR_INVALID_STATE;
+    handle->started = false;
+    handle->partial.clear();
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t* buf, uint32_t length_max, uint32_t* out_length,
+                              uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> guard(handle->lock);
+    if (!handle->started) return ESP_ERR_INVALID_STATE;
+    if (!handle->readable.wait_for(guard, std::chrono::milliseconds(timeout_ms),
+                                   [handle] { return !handle->pool.empty(); })) {
+        return ESP_ERR_TIMEOUT;
+    }
+    uint32_t n = std::min<uint32_t>(length_max, (uint32_t) handle->pool.size());
+    std::copy(handle->pool.begin(), handle->pool.begin() + n, buf);
+    handle->pool.erase(handle->pool.begin(), handle->pool.begin() + n);
+    *out_length = n;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_ARG;
+    {
+        std::lock_guard<std::mutex> guard(handle->lock);
+        if (handle->started) return ESP_ERR_INVALID_STATE;
+    }
+    std::lock_guard<std::mutex> guard(s_continuous_lock);
+    if (s_continuous == handle) s_continuous = nullptr;
+    delete handle;
+    return ESP_OK;
+}
+
+namespace fake {
+
+void adc_set_raw(adc_unit_t unit, adc_channel_t channel, int raw) {
+    Oneshot& o = oneshot();
+    std::lock_guard<std::mutex> guard(o.lock);
+    o.raw[unit][channel] = raw;
+}
+
+// Each whole frame goes to the pool and raises on_conv_done; a frame the pool
+// has no room for raises on_pool_ovf and is lost (or, with flush_pool, the
+// pool is emptied first). Callbacks run in ISR context on the calling thread.
+size_t adc_continuous_feed(const adc_digi_output_data_t* words, size_t count) {
+    std::lock_guard<std::mutex> driver(s_continuous_lock);
+    adc_continuous_ctx_t* ctx = s_continuous;
+    if (!ctx) return 0;
+
+    size_t taken = 0;
+    for (size_t i = 0; i < count; i++) {
+        std::vector<uint8_t> frame;
+        adc_continuous_evt_data_t edata = {};
+        bool overflow = false;
+        {
+            std::lock_guard<std::mutex> guard(ctx->lock);
+            if (!ctx->started) break;
+            const uint8_t* p = (const uint8_t*) &words[i];
+            ctx->partial.insert(ctx->partial.end(), p, p + SOC_ADC_DIGI_RESULT_BYTES);
+            if (ctx->partial.size() < ctx->frame_size) continue;
+            frame.swap(ctx->partial);
+            if (ctx->pool.size() + frame.size() > ctx->pool_size) {
+                if (ctx->flush_pool) {
+                    ctx->pool.clear();
+                } else {
+                    overflow = true;
+                }
+            }
+            if (!overflow) {
+                ctx->pool.insert(ctx->pool.end(), frame.begin(), frame.end());
+                taken += frame.size() / SOC_ADC_DIGI_RESULT_BYTES;
+            }
+        }
+        edata.conv_frame_buffer = frame.data();
+        edata.size = (uint32_t) frame.size();
+        host::IsrScope isr;
+        if (overflow) {
+            if (ctx->cbs.on_pool_ovf) ctx->cbs.on_pool_ovf(ctx, &edata, ctx->user_data);
+        } else {
+            ctx->readable.notify_all();
+            if (ctx->cbs.on_conv_done) ctx->cbs.on_conv_done(ctx, &edata, ctx->user_data);
+        }
+    }
+    return taken;
+}
+
+}  // namespace fake
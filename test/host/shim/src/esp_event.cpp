@@ -0,0 +1,189 @@
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "esp_event.h"
+#include "host_fakes.hpp"
+#include "host_internal.hpp"
+
+namespace {
+
+struct Handler {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t fn;
+    void* arg;
+    Handler* instance;   // Identity handed out as esp_event_handler_instance_t
+};
+
+struct Event {
+    esp_event_base_t base;
+    int32_t id;
+    std::vector<uint8_t> data;
+};
+
+// The default loop: one dispatch thread, started with the first loop creation
+// and kept for the life of the process (deleting the loop only drops handlers)
+struct EventLoop {
+    std::mutex lock;
+    std::condition_variable pending;
+    std::condition_variable drained;
+    std::condition_variable idle;
+    std::thread::id dispatch_thread;
+    std::deque<Event> queue;
+    std::vector<Handler*> handlers;
+    bool created = false;
+    bool dispatching = false;
+    bool thread_started = false;
+
+    void run() {
+        host::set_thread_name("sys_evt");
+        dispatch_thread = std::this_thread::get_id();
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            pending.wait(guard, [this] { return !queue.empty(); });
+            Event ev = std::move(queue.front());
+            queue.pop_front();
+            dispatching = true;
+            // Handlers may register or unregister others while running
+            std::vector<Handler*> targets;
+            for (Handler* h : handlers) {
+                if ((h->base == ESP_EVENT_ANY_BASE || h->base == ev.base) &&
+                    (h->id == ESP_EVENT_ANY_ID || h->id == ev.id)) {
+                    targets.push_back(h);
+                }
+            }
+            guard.unlock();
+            for (Handler* h : targets) {
+                h->fn(h->arg, ev.base, ev.id, ev.data.empty() ? nullptr : ev.data.data());
+            }
+            guard.lock();
+            dispatching = false;
+            idle.notify_all();
+            if (queue.empty()) drained.notify_all();
+        }
+    }
+};
+
+// Like the IDF loop mutex held across dispatch: once an unregister from another
+// task returns, the handler is not running and will not run again
+void wait_dispatch_idle(EventLoop& l, std::unique_lock<std::mutex>& guard) {
+    if (std::this_thread::get_id() == l.dispatch_thread) return;
+    l.idle.wait(guard, [&l] { return !l.dispatching; });
+}
+
+EventLoop& loop() {
+    static EventLoop* l = new EventLoop();
+    return *l;
+}
+
+esp_err_t add_handler(esp_event_base_t base, int32_t id, esp_event_handler_t fn, void* arg, Handler** out) {
+    if (!fn) return ESP_ERR_INVALID_ARG;
+    EventLoop& l = loop();
+    std::lock_guard<std::mutex> guard(l.lock);
+    if (!l.created) return ESP_ERR_INVALID_STATE;
+    Handler* h = new Handler{base, id, fn, arg, nullptr};
+    h->instance = h;
+    l.handlers.push_back(h);
+    if (out) *out = h;
+    return ESP_OK;
+}
+
+}  // namespace
+
+esp_err_t esp_event_loop_create_default(void) {
+    EventLoop& l = loop();
+    std::lock_guard<std::mutex> guard(l.lock);
+    if (l.created) return ESP_ERR_INVALID_STATE;
+    l.created = true;
+    if (!l.thread_started) {
+        std::thread([&l] { l.run(); }).detach();
+        l.thread_started = true;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_delete_default(void) {
+    EventLoop& l = loop();
+    std::lock_guard<std::mutex> guard(l.lock);
+    if (!l.created) return ESP_ERR_INVALID_STATE;
+    // Handlers are leaked: a dispatch in progress may still hold them
+    l.handlers.clear();
+    l.queue.clear();
+    l.created = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void* event_handler_arg) {
+    return add_handler(event_base, event_id, event_handler, event_handler_arg, nullptr);
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id,
+                                       esp_event_handler_t event_handler) {
+    EventLoop& l = loop();
+    std::unique_lock<std::mutex> guard(l.lock);
+    auto it = std::find_if(l.handlers.begin(), l.handlers.end(), [&](Handler* h) {
+        return h->base == event_base && h->id == event_id && h->fn == event_handler;
+    });
+    if (it == l.handlers.end()) return ESP_ERR_NOT_FOUND;
+    l.handlers.erase(it);
+    wait_dispatch_idle(l, guard);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id,
+                                              esp_event_handler_t event_handler, void* event_handler_arg,
+                                              esp_event_handler_instance_t* instance) {
+    Handler* h = nullptr;
+    esp_err_t err = add_handler(event_base, event_id, event_handler, event_handler_arg, &h);
+    if (err == ESP_OK && instance) *instance = h;
+    return err;
+}
+
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t event_base, int32_t event_id,
+                                                esp_event_handler_instance_t instance) {
+    EventLoop& l = loop();
+    std::unique_lock<std::mutex> guard(l.lock);
+    auto it = std::find(l.handlers.begin(), l.handlers.end(), (Handler*) instance);
+    if (it == l.handlers.end()) return ESP_ERR_NOT_FOUND;
+    l.handlers.erase(it);
+    wait_dispatch_idle(l, guard);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void* event_data,
+                         size_t event_data_size, TickType_t ticks_to_wait) {
+    EventLoop& l = loop();
+    {
+        std::lock_guard<std::mutex> guard(l.lock);
+        if (!l.created) return ESP_ERR_INVALID_STATE;
+        Event ev{event_base, event_id, {}};
+        if (event_data && event_data_size) {
+            const uint8_t* p = (const uint8_t*) event_data;
+            ev.data.assign(p, p + event_data_size);
+        }
+        l.queue.push_back(std::move(ev));
+    }
+    l.pending.notify_one();
+    return ESP_OK;
+}
+
+esp_err_t esp_event_isr_post(esp_event_base_t event_base, int32_t event_id, const void* event_data,
+                             size_t event_data_size, BaseType_t* task_unblocked) {
+    if (task_unblocked) *task_unblocked = pdTRUE;
+    return esp_event_post(event_base, event_id, event_data, event_data_size, 0);
+}
+
+namespace fake {
+
+void event_loop_flush() {
+    EventLoop& l = loop();
+    std::unique_lock<std::mutex> guard(l.lock);
+    l.drained.wait(guard, [&l] { return l.queue.empty() && !l.dispatching; });
+}
+
+}  // namespace fake
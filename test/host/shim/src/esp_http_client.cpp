@@ -0,0 +1,355 @@
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "esp_http_client.h"
+#include "host_fakes.hpp"
+
+namespace {
+
+// The in-process server: a responder, and a generation that closing every
+// connection bumps so handles opened before it find their socket gone
+struct Server {
+    std::mutex lock;
+    fake::HttpResponder responder;
+    fake::HttpStats stats = {};
+    uint64_t generation = 1;
+};
+
+Server& server() {
+    static Server* s = new Server();
+    return *s;
+}
+
+const char* method_name(esp_http_client_method_t method) {
+    static const char* const NAMES[] = {"GET", "POST", "PUT", "PATCH", "DELETE", "HEAD",
+                                        "NOTIFY", "SUBSCRIBE", "UNSUBSCRIBE", "OPTIONS"};
+    return method < HTTP_METHOD_MAX ? NAMES[method] : "GET";
+}
+
+std::vector<std::pair<std::string, std::string>>::iterator find_header(
+    std::vector<std::pair<std::string, std::string>>& headers, const char* key) {
+    return std::find_if(headers.begin(), headers.end(),
+                        [key](const std::pair<std::string, std::string>& h) { return strcasecmp(h.first.c_str(), key) == 0; });
+}
+
+// scheme://host[:port], the part that selects the connection
+std::string origin(const std::string& url) {
+    size_t host_start = url.find("://");
+    host_start = host_start == std::string::npos ? 0 : host_start + 3;
+    return url.substr(0, url.find_first_of("/?#", host_start));
+}
+
+}  // namespace
+
+struct esp_http_client {
+    std::string url;
+    esp_http_client_method_t method;
+    int timeout_ms;
+    int max_redirects;
+    bool auto_redirect;
+    http_event_handle_cb handler;
+    void* user_data;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string post_field;
+
+    bool connected = false;
+    bool server_closed = false;   // Peer closed after its last response
+    uint64_t generation = 0;
+    std::string request_body;
+    bool have_response = false;
+    fake::HttpResponse response;
+    size_t body_pos = 0;
+
+    void emit(esp_http_client_event_id_t id, void* data = nullptr, int data_len = 0, char* key = nullptr,
+              char* value = nullptr) {
+        if (!handler) return;
+        esp_http_client_event_t evt = {};
+        evt.event_id = id;
+        evt.client = this;
+        evt.data = data;
+        evt.data_len = data_len;
+        evt.user_data = user_data;
+        evt.header_key = key;
+        evt.header_value = value;
+        handler(&evt);
+    }
+
+    bool socket_alive() {
+        Server& s = server();
+        std::lock_guard<std::mutex> guard(s.lock);
+        return connected && !server_closed && generation == s.generation;
+    }
+};
+
+const char* fake::HttpRequest::header(const char* key) const {
+    for (const auto& h : headers) {
+        if (strcasecmp(h.first.c_str(), key) == 0) return h.second.c_str();
+    }
+    return nullptr;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t* config) {
+    if (!config || !config->url) return nullptr;
+    esp_http_client* client = new esp_http_client();
+    client->url = config->url;
+    client->method = config->method;
+    client->timeout_ms = config->timeout_ms ? config->timeout_ms : 5000;
+    client->max_redirects = config->max_redirection_count ? config->max_redirection_count : 10;
+    client->auto_redirect = !config->disable_auto_redirect;
+    client->handler = config->event_handler;
+    client->user_data = config->user_data;
+    client->headers.emplace_back("User-Agent", "ESP32 HTTP Client/1.0");
+    return client;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+    if (!client) return ESP_FAIL;
+    esp_http_client_close(client);
+    delete client;
+    return ESP_OK;
+}
+
+// A URL on another origin drops the connection, as the IDF client does
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char* url) {
+    if (!client || !url) return ESP_ERR_INVALID_ARG;
+    if (origin(url) != origin(client->url)) esp_http_client_close(client);
+    client->url = url;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method) {
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms) {
+    client->timeout_ms = timeout_ms;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char* key, const char* value) {
+    auto it = find_header(client->headers, key);
+    if (it != client->headers.end()) it->second = value;
+    else client->headers.emplace_back(key, value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_get_header(esp_http_client_handle_t client, const char* key, char** value) {
+    auto it = find_header(client->headers, key);
+    *value = it != client->headers.end() ? &it->second[0] : nullptr;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char* key) {
+    auto it = find_header(client->headers, key);
+    if (it == client->headers.end()) return ESP_ERR_NOT_FOUND;
+    client->headers.erase(it);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char* data, int len) {
+    client->post_field.assign(data ? data : "", data ? len : 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void* data) {
+    client->user_data = data;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_get_user_data(esp_http_client_handle_t client, void** data) {
+    *data = client->user_data;
+    return ESP_OK;
+}
+
+// Connects unless the handle still holds a live connection. Sending on a
+// connection the server has closed fails, as the socket write does on the target.
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len) {
+    if (client->url.compare(0, 7, "http://") != 0 && client->url.compare(0, 8, "https://") != 0) {
+        return ESP_ERR_HTTP_INVALID_TRANSPORT;
+    }
+    if (client->connected && !client->socket_alive()) return ESP_ERR_HTTP_WRITE_DATA;
+    if (!client->connected) {
+        Server& s = server();
+        {
+            std::lock_guard<std::mutex> guard(s.lock);
+            s.stats.connects++;
+            client->generation = s.generation;
+        }
+        client->connected = true;
+        client->server_closed = false;
+        client->emit(HTTP_EVENT_ON_CONNECTED);
+    }
+    client->request_body.clear();
+    client->have_response = false;
+    client->response = fake::HttpResponse();
+    client->body_pos = 0;
+    client->emit(HTTP_EVENT_HEADERS_SENT);
+    return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char* buffer, int len) {
+    if (!client->connected) return -1;
+    client->request_body.append(buffer, len);
+    return len;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client) {
+    if (!client->socket_alive()) return ESP_FAIL;
+
+    fake::HttpRequest request;
+    request.method = method_name(client->method);
+    request.url = client->url;
+    request.headers = client->headers;
+    request.body = client->request_body;
+
+    fake::HttpResponder responder;
+    Server& s = server();
+    {
+        std::lock_guard<std::mutex> guard(s.lock);
+        s.stats.requests++;
+        responder = s.responder;
+    }
+    client->response = responder ? responder(request) : fake::HttpResponse();
+    if (client->response.drop) {
+        client->server_closed = true;
+        client->have_response = false;
+        return ESP_FAIL;
+    }
+    client->have_response = true;
+    client->body_pos = 0;
+    if (client->response.latency_us) {
+        std::this_thread::sleep_for(std::chrono::microseconds(client->response.latency_us));
+    }
+
+    for (auto& h : client->response.headers) {
+        client->emit(HTTP_EVENT_ON_HEADER, nullptr, 0, &h.first[0], &h.second[0]);
+    }
+    if (client->response.chunked) return 0;
+    return (int64_t) client->response.body.size();
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char* buffer, int len) {
+    if (!client->have_response) return -1;
+    const std::string& body = client->response.body;
+    size_t n = std::min((size_t) len, body.size() - client->body_pos);
+    memcpy(buffer, body.data() + client->body_pos, n);
+    client->body_pos += n;
+    if (n > 0) client->emit(HTTP_EVENT_ON_DATA, buffer, (int) n);
+    if (client->body_pos == body.size() && client->response.close) client->server_closed = true;
+    return (int) n;
+}
+
+int esp_http_client_read_response(esp_http_client_handle_t client, char* buffer, int len) {
+    int total = 0;
+    while (total < len) {
+        int n = esp_http_client_read(client, buffer + total, len - total);
+        if (n <= 0) break;
+        total += n;
+    }
+    return total;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+    return client->have_response ? client->response.status : 0;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client) {
+    if (!client->have_response || client->response.chunked) return -1;
+    return (int64_t) client->response.body.size();
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client) {
+    return client->have_response && client->response.chunked;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client) {
+    return client->have_response && client->body_pos == client->response.body.size();
+}
+
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t client, int* len) {
+    char scratch[256];
+    int total = 0;
+    int n;
+    while ((n = esp_http_client_read(client, scratch, sizeof(scratch))) > 0) total += n;
+    if (len) *len = total;
+    return n < 0 ? ESP_FAIL : ESP_OK;
+}
+
+// Follows the Location header, relative to the current origin when it is a path
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client) {
+    if (!client->have_response) return ESP_ERR_INVALID_ARG;
+    auto it = find_header(client->response.headers, "Location");
+    if (it == client->response.headers.end()) return ESP_ERR_INVALID_ARG;
+    const std::string& location = it->second;
+    std::string url = location.find("://") != std::string::npos ? location : origin(client->url) + location;
+    client->emit(HTTP_EVENT_REDIRECT);
+    return esp_http_client_set_url(client, url.c_str());
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client) {
+    if (!client->connected) return ESP_OK;
+    client->connected = false;
+    client->emit(HTTP_EVENT_DISCONNECTED);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client) {
+    for (int redirects = 0; ; redirects++) {
+        esp_err_t err = esp_http_client_open(client, (int) client->post_field.size());
+        if (err == ESP_ERR_HTTP_WRITE_DATA) {
+            esp_http_client_close(client);
+            err = esp_http_client_open(client, (int) client->post_field.size());
+        }
+        if (err != ESP_OK) return err;
+        if (!client->post_field.empty()) {
+            esp_http_client_write(client, client->post_field.data(), (int) client->post_field.size());
+        }
+        if (esp_http_client_fetch_headers(client) < 0) return ESP_ERR_HTTP_FETCH_HEADER;
+
+        int status = client->response.status;
+        bool redirect = status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+        if (!redirect || !client->auto_redirect) break;
+        if (redirects >= client->max_redirects) return ESP_ERR_HTTP_MAX_REDIRECT;
+        esp_http_client_flush_response(client, nullptr);
+        esp_http_client_set_redirection(client);
+    }
+    esp_http_client_flush_response(client, nullptr);
+    client->emit(HTTP_EVENT_ON_FINISH);
+    return ESP_OK;
+}
+
+namespace fake {
+
+void http_set_responder(HttpResponder responder) {
+    Server& s = server();
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.responder = std::move(responder);
+}
+
+void http_close_connections() {
+    Server& s = server();
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.generation++;
+}
+
+HttpStats http_stats() {
+    Server& s = server();
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.stats;
+}
+
+void http_reset() {
+    Server& s = server();
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.responder = nullptr;
+    s.stats = {};
+    s.generation++;
+}
+
+}  // namespace fake
@@ -0,0 +1,112 @@
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "esp_partition.h"
+#include "host_fakes.hpp"
+
+namespace {
+
+struct Partition {
+    esp_partition_t info;
+    std::vector<uint8_t> image;
+};
+
+struct Table {
+    std::mutex lock;
+    std::map<std::string, Partition*> by_label;
+    uint32_t next_address = 0x110000;
+};
+
+Table& table() {
+    static Table* t = new Table();
+    return *t;
+}
+
+// Caller holds the table lock
+Partition* find(const esp_partition_t* partition) {
+    for (auto& entry : table().by_label) {
+        if (&entry.second->info == partition) return entry.second;
+    }
+    return nullptr;
+}
+
+bool in_range(const Partition* p, size_t offset, size_t size) {
+    return offset <= p->image.size() && size <= p->image.size() - offset;
+}
+
+}  // namespace
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+    Table& t = table();
+    std::lock_guard<std::mutex> guard(t.lock);
+    for (auto& entry : t.by_label) {
+        const esp_partition_t& info = entry.second->info;
+        if (type != ESP_PARTITION_TYPE_ANY && info.type != type) continue;
+        if (subtype != ESP_PARTITION_SUBTYPE_ANY && info.subtype != subtype) continue;
+        if (label && strcmp(label, info.label) != 0) continue;
+        return &entry.second->info;
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+    std::lock_guard<std::mutex> guard(table().lock);
+    Partition* p = find(partition);
+    if (!p || !dst) return ESP_ERR_INVALID_ARG;
+    if (!in_range(p, src_offset, size)) return ESP_ERR_INVALID_SIZE;
+    memcpy(dst, &p->image[src_offset], size);
+    return ESP_OK;
+}
+
+// NOR flash: programming can only clear bits
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+    std::lock_guard<std::mutex> guard(table().lock);
+    Partition* p = find(partition);
+    if (!p || !src) return ESP_ERR_INVALID_ARG;
+    if (p->info.readonly) return ESP_ERR_NOT_ALLOWED;
+    if (!in_range(p, dst_offset, size)) return ESP_ERR_INVALID_SIZE;
+    const uint8_t* in = (const uint8_t*) src;
+    for (size_t i = 0; i < size; i++) p->image[dst_offset + i] &= in[i];
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    std::lock_guard<std::mutex> guard(table().lock);
+    Partition* p = find(partition);
+    if (!p) return ESP_ERR_INVALID_ARG;
+    if (p->info.readonly) return ESP_ERR_NOT_ALLOWED;
+    if (offset % p->info.erase_size || size % p->info.erase_size) return ESP_ERR_INVALID_SIZE;
+    if (!in_range(p, offset, size)) return ESP_ERR_INVALID_SIZE;
+    memset(&p->image[offset], 0xFF, size);
+    return ESP_OK;
+}
+
+namespace fake {
+
+const esp_partition_t* partition_add(const char* label, uint32_t size, uint32_t erase_size) {
+    Table& t = table();
+    std::lock_guard<std::mutex> guard(t.lock);
+    Partition*& p = t.by_label[label];
+    // A replaced partition is leaked; lookups through its old pointer fail
+    p = new Partition();
+    p->info.type = ESP_PARTITION_TYPE_DATA;
+    p->info.subtype = (esp_partition_subtype_t) 0x40;
+    p->info.address = t.next_address;
+    p->info.size = size;
+    p->info.erase_size = erase_size;
+    strncpy(p->info.label, label, sizeof(p->info.label) - 1);
+    p->image.assign(size, 0xFF);
+    t.next_address += (size + 0xFFFF) & ~0xFFFFu;
+    return &p->info;
+}
+
+std::vector<uint8_t>& partition_image(const char* label) {
+    Table& t = table();
+    std::lock_guard<std::mutex> guard(t.lock);
+    return t.by_label.at(label)->image;
+}
+
+}  // namespace fake
@@ -0,0 +1,225 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_crt_bundle.h"
+#include "esp_http_client.h"
+#include "esp_wifi.h"
+#include "esp_partition.h"
+#include "nvs.h"
+#include "host_fakes.hpp"
+#include "host_internal.hpp"
+
+// ---- Errors ----
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_INVALID_MAC: return "ESP_ERR_INVALID_MAC";
+        case ESP_ERR_NOT_FINISHED: return "ESP_ERR_NOT_FINISHED";
+        case ESP_ERR_NOT_ALLOWED: return "ESP_ERR_NOT_ALLOWED";
+        case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_WIFI_NOT_INIT: return "ESP_ERR_WIFI_NOT_INIT";
+        case ESP_ERR_WIFI_NOT_STARTED: return "ESP_ERR_WIFI_NOT_STARTED";
+        case ESP_ERR_WIFI_NOT_CONNECT: return "ESP_ERR_WIFI_NOT_CONNECT";
+        case ESP_ERR_FLASH_OP_FAIL: return "ESP_ERR_FLASH_OP_FAIL";
+        case ESP_ERR_HTTP_CONNECT: return "ESP_ERR_HTTP_CONNECT";
+        case ESP_ERR_HTTP_WRITE_DATA: return "ESP_ERR_HTTP_WRITE_DATA";
+        case ESP_ERR_HTTP_FETCH_HEADER: return "ESP_ERR_HTTP_FETCH_HEADER";
+        case ESP_ERR_HTTP_CONNECTION_CLOSED: return "ESP_ERR_HTTP_CONNECTION_CLOSED";
+        case ESP_ERR_HTTP_INCOMPLETE_DATA: return "ESP_ERR_HTTP_INCOMPLETE_DATA";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+// ---- Logging ----
+
+namespace {
+
+struct LogLevels {
+    std::mutex lock;
+    esp_log_level_t all = (esp_log_level_t) CONFIG_LOG_DEFAULT_LEVEL;
+    std::map<std::string, esp_log_level_t> tags;
+};
+
+LogLevels& log_levels() {
+    static LogLevels* levels = new LogLevels();
+    return *levels;
+}
+
+const auto s_boot = std::chrono::steady_clock::now();
+
+}  // namespace
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    LogLevels& l = log_levels();
+    std::lock_guard<std::mutex> guard(l.lock);
+    if (strcmp(tag, "*") == 0) {
+        l.all = level;
+        l.tags.clear();
+    } else {
+        l.tags[tag] = level;
+    }
+}
+
+esp_log_level_t esp_log_level_get(const char* tag) {
+    LogLevels& l = log_levels();
+    std::lock_guard<std::mutex> guard(l.lock);
+    auto it = l.tags.find(tag);
+    return it == l.tags.end() ? l.all : it->second;
+}
+
+void esp_log_writev(esp_log_level_t level, const char* tag, const char* format, va_list args) {
+    if (level > esp_log_level_get(tag)) return;
+    vfprintf(stderr, format, args);
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    esp_log_writev(level, tag, format, args);
+    va_end(args);
+}
+
+uint32_t esp_log_timestamp(void) {
+    return (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - s_boot)
+        .count();
+}
+
+// ---- Heap ----
+
+namespace {
+
+struct HeapSizes {
+    size_t free = 180 * 1024;
+    size_t minimum_free = 150 * 1024;
+    size_t largest_block = 110 * 1024;
+};
+
+HeapSizes s_heap;
+
+}  // namespace
+
+void* heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) { return calloc(n, size); }
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) { return realloc(ptr, size); }
+
+void* heap_caps_malloc_prefer(size_t size, size_t num, ...) { return malloc(size); }
+
+void heap_caps_free(void* ptr) { free(ptr); }
+
+size_t heap_caps_get_free_size(uint32_t caps) { return s_heap.free; }
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return s_heap.minimum_free; }
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return s_heap.largest_block; }
+
+size_t heap_caps_get_total_size(uint32_t caps) { return 320 * 1024; }
+
+uint32_t esp_get_free_heap_size(void) { return (uint32_t) s_heap.free; }
+
+uint32_t esp_get_minimum_free_heap_size(void) { return (uint32_t) s_heap.minimum_free; }
+
+// ---- Random ----
+
+namespace {
+
+std::mutex s_random_lock;
+uint64_t s_random_state = 0x9e3779b97f4a7c15ULL;
+
+}  // namespace
+
+// splitmix64: reproducible across runs, which matters more here than quality
+uint32_t esp_random(void) {
+    std::lock_guard<std::mutex> guard(s_random_lock);
+    uint64_t z = (s_random_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (uint32_t) ((z ^ (z >> 31)) >> 32);
+}
+
+void esp_fill_random(void* buf, size_t len) {
+    uint8_t* out = (uint8_t*) buf;
+    for (size_t i = 0; i < len; i++) out[i] = (uint8_t) esp_random();
+}
+
+// ---- System ----
+
+namespace {
+
+std::function<void()> s_restart_handler;
+
+}  // namespace
+
+void esp_restart(void) {
+    if (s_restart_handler) s_restart_handler();
+    fprintf(stderr, "esp_restart() called\n");
+    exit(0);
+}
+
+esp_err_t esp_crt_bundle_attach(void* conf) { return ESP_OK; }
+
+// ---- Thread names ----
+
+namespace host {
+
+namespace {
+thread_local char t_name[16] = "";
+}
+
+const char* thread_name() {
+    if (!t_name[0]) pthread_getname_np(pthread_self(), t_name, sizeof(t_name));
+    return t_name;
+}
+
+void set_thread_name(const char* name) {
+    strncpy(t_name, name, sizeof(t_name) - 1);
+    pthread_setname_np(pthread_self(), t_name);
+}
+
+}  // namespace host
+
+// ---- Control ----
+
+namespace fake {
+
+void heap_set_sizes(size_t free, size_t minimum_free, size_t largest_block) {
+    s_heap.free = free;
+    s_heap.minimum_free = minimum_free;
+    s_heap.largest_block = largest_block;
+}
+
+void random_seed(uint64_t seed) {
+    std::lock_guard<std::mutex> guard(s_random_lock);
+    s_random_state = seed;
+}
+
+void set_restart_handler(std::function<void()> handler) { s_restart_handler = std::move(handler); }
+
+}  // namespace fake
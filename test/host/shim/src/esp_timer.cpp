@@ -0,0 +1,171 @@
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "esp_timer.h"
+#include "host_internal.hpp"
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    std::string name;
+    bool skip_unhandled_events;
+    uint64_t period_us = 0;   // 0 = one-shot
+    bool armed = false;
+    std::multimap<int64_t, esp_timer*>::iterator slot;
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point s_boot = Clock::now();
+
+// One service thread fires every timer in deadline order, like the esp_timer task
+struct TimerService {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::condition_variable idle;
+    std::multimap<int64_t, esp_timer*> schedule;
+    esp_timer* running = nullptr;
+    std::thread::id thread_id;
+
+    TimerService() {
+        std::thread worker([this] { run(); });
+        thread_id = worker.get_id();
+        worker.detach();
+    }
+
+    void arm(esp_timer* t, int64_t when) {
+        t->slot = schedule.emplace(when, t);
+        t->armed = true;
+    }
+
+    void disarm(esp_timer* t) {
+        if (!t->armed) return;
+        schedule.erase(t->slot);
+        t->armed = false;
+    }
+
+    void run() {
+        host::set_thread_name("esp_timer");
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            if (schedule.empty()) {
+                changed.wait(guard);
+                continue;
+            }
+            int64_t when = schedule.begin()->first;
+            int64_t now = esp_timer_get_time();
+            if (when > now) {
+                changed.wait_for(guard, std::chrono::microseconds(when - now));
+                continue;
+            }
+            esp_timer* t = schedule.begin()->second;
+            disarm(t);
+            if (t->period_us) {
+                int64_t next = when + (int64_t) t->period_us;
+                if (t->skip_unhandled_events && next <= now) next = now + (int64_t) t->period_us;
+                arm(t, next);
+            }
+            running = t;
+            guard.unlock();
+            t->callback(t->arg);
+            guard.lock();
+            running = nullptr;
+            idle.notify_all();
+        }
+    }
+};
+
+TimerService& service() {
+    static TimerService* s = new TimerService();
+    return *s;
+}
+
+}  // namespace
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+    if (!create_args || !create_args->callback || !out_handle) return ESP_ERR_INVALID_ARG;
+    esp_timer* t = new esp_timer();
+    t->callback = create_args->callback;
+    t->arg = create_args->arg;
+    t->name = create_args->name ? create_args->name : "";
+    t->skip_unhandled_events = create_args->skip_unhandled_events;
+    *out_handle = t;
+    service();
+    return ESP_OK;
+}
+
+static esp_err_t start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us, bool restart) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    TimerService& s = service();
+    {
+        std::lock_guard<std::mutex> guard(s.lock);
+        if (timer->armed && !restart) return ESP_ERR_INVALID_STATE;
+        if (!timer->armed && restart) return ESP_ERR_INVALID_STATE;
+        s.disarm(timer);
+        timer->period_us = period_us;
+        s.arm(timer, esp_timer_get_time() + (int64_t) timeout_us);
+    }
+    s.changed.notify_one();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return start(timer, timeout_us, 0, false);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return start(timer, period, period, false);
+}
+
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    uint64_t period;
+    {
+        std::lock_guard<std::mutex> guard(service().lock);
+        period = timer->period_us ? timeout_us : 0;
+    }
+    return start(timer, timeout_us, period, true);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    TimerService& s = service();
+    std::lock_guard<std::mutex> guard(s.lock);
+    if (!timer->armed) return ESP_ERR_INVALID_STATE;
+    s.disarm(timer);
+    return ESP_OK;
+}
+
+// Waits for a callback in progress on another thread, so the callback's
+// argument can be freed right after
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    TimerService& s = service();
+    std::unique_lock<std::mutex> guard(s.lock);
+    if (timer->armed) return ESP_ERR_INVALID_STATE;
+    if (std::this_thread::get_id() != s.thread_id) {
+        s.idle.wait(guard, [&] { return s.running != timer; });
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> guard(service().lock);
+    return timer->armed;
+}
+
+int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - s_boot).count();
+}
+
+int64_t esp_timer_get_next_alarm(void) {
+    TimerService& s = service();
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.schedule.empty() ? INT64_MAX : s.schedule.begin()->first;
+}
@@ -0,0 +1,358 @@
+#include <string.h>
+#include <mutex>
+#include <string>
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "host_fakes.hpp"
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+struct esp_netif_obj {
+    esp_netif_ip_info_t ip_info = {};
+    esp_ip4_addr_t dns = {};
+    bool dhcpc_running = true;
+};
+
+namespace {
+
+// The station driver: esp_wifi_connect runs a small state machine on an
+// esp_timer, with the delays and the outcome taken from the scripted AP
+struct WifiDriver {
+    enum State { IDLE, ASSOCIATING, WAIT_IP, CONNECTED };
+    enum Step { STEP_NONE, STEP_ASSOCIATED, STEP_GOT_IP, STEP_FAILED };
+
+    std::mutex lock;
+    fake::WifiAp ap;
+    fake::WifiStats stats = {};
+    bool initialized = false;
+    bool started = false;
+    wifi_config_t config = {};
+    esp_netif_obj* netif = nullptr;
+    State state = IDLE;
+    Step next = STEP_NONE;
+    uint8_t fail_reason = 0;
+    esp_timer_handle_t timer = nullptr;
+
+    void schedule(Step step, uint32_t delay_ms) {
+        next = step;
+        esp_timer_stop(timer);
+        esp_timer_start_once(timer, (uint64_t) delay_ms * 1000);
+    }
+
+    void cancel() {
+        esp_timer_stop(timer);
+        next = STEP_NONE;
+    }
+
+    static void step_cb(void* arg);
+};
+
+WifiDriver& driver() {
+    static WifiDriver* d = [] {
+        WifiDriver* w = new WifiDriver();
+        esp_timer_create_args_t args = {};
+        args.callback = WifiDriver::step_cb;
+        args.arg = w;
+        args.name = "fake_wifi";
+        esp_timer_create(&args, &w->timer);
+        return w;
+    }();
+    return *d;
+}
+
+void post_disconnected(const fake::WifiAp& ap, uint8_t reason) {
+    wifi_event_sta_disconnected_t ev = {};
+    size_t len = std::min(ap.ssid.size(), sizeof(ev.ssid));
+    memcpy(ev.ssid, ap.ssid.data(), len);
+    ev.ssid_len = (uint8_t) len;
+    memcpy(ev.bssid, ap.bssid, sizeof(ev.bssid));
+    ev.reason = reason;
+    ev.rssi = ap.rssi;
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &ev, sizeof(ev), 0);
+}
+
+void WifiDriver::step_cb(void* arg) {
+    WifiDriver* d = static_cast<WifiDriver*>(arg);
+    std::unique_lock<std::mutex> guard(d->lock);
+    Step step = d->next;
+    d->next = STEP_NONE;
+    fake::WifiAp ap = d->ap;
+
+    switch (step) {
+        case STEP_ASSOCIATED: {
+            wifi_event_sta_connected_t ev = {};
+            size_t len = std::min(ap.ssid.size(), sizeof(ev.ssid));
+            memcpy(ev.ssid, ap.ssid.data(), len);
+            ev.ssid_len = (uint8_t) len;
+            memcpy(ev.bssid, ap.bssid, sizeof(ev.bssid));
+            ev.channel = ap.channel;
+            d->state = WAIT_IP;
+            bool dhcp = !d->netif || d->netif->dhcpc_running;
+            d->schedule(STEP_GOT_IP, dhcp ? ap.dhcp_ms : 0);
+            guard.unlock();
+            esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &ev, sizeof(ev), 0);
+            break;
+        }
+        case STEP_GOT_IP: {
+            ip_event_got_ip_t ev = {};
+            if (d->netif) {
+                if (d->netif->dhcpc_running) {
+                    ev.ip_changed = d->netif->ip_info.ip.addr != ap.lease.ip.addr;
+                    d->netif->ip_info = ap.lease;
+                    d->netif->dns = ap.dns;
+                }
+                ev.esp_netif = d->netif;
+                ev.ip_info = d->netif->ip_info;
+            } else {
+                ev.ip_info = ap.lease;
+            }
+            d->state = CONNECTED;
+            guard.unlock();
+            esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &ev, sizeof(ev), 0);
+            break;
+        }
+        case STEP_FAILED: {
+            d->state = IDLE;
+            uint8_t reason = d->fail_reason;
+            guard.unlock();
+            post_disconnected(ap, reason);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+}  // namespace
+
+// ---- esp_netif ----
+
+esp_err_t esp_netif_init(void) { return ESP_OK; }
+
+esp_netif_t* esp_netif_create_default_wifi_sta(void) {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    if (!d.netif) d.netif = new esp_netif_obj();
+    return d.netif;
+}
+
+void esp_netif_destroy(esp_netif_t* esp_netif) {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    if (d.netif == esp_netif) d.netif = nullptr;
+    delete esp_netif;
+}
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t* esp_netif) {
+    std::lock_guard<std::mutex> guard(driver().lock);
+    esp_netif->dhcpc_running = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t* esp_netif) {
+    std::lock_guard<std::mutex> guard(driver().lock);
+    esp_netif->dhcpc_running = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t* esp_netif, const esp_netif_ip_info_t* ip_info) {
+    std::lock_guard<std::mutex> guard(driver().lock);
+    if (esp_netif->dhcpc_running) return ESP_ERR_INVALID_STATE;
+    esp_netif->ip_info = *ip_info;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t* esp_netif, esp_netif_ip_info_t* ip_info) {
+    std::lock_guard<std::mutex> guard(driver().lock);
+    *ip_info = esp_netif->ip_info;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_dns_info(esp_netif_t* esp_netif, esp_netif_dns_type_t type, esp_netif_dns_info_t* dns) {
+    if (type != ESP_NETIF_DNS_MAIN) return ESP_ERR_NOT_SUPPORTED;
+    std::lock_guard<std::mutex> guard(driver().lock);
+    esp_netif->dns = dns->ip.u_addr.ip4;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_get_dns_info(esp_netif_t* esp_netif, esp_netif_dns_type_t type, esp_netif_dns_info_t* dns) {
+    if (type != ESP_NETIF_DNS_MAIN) return ESP_ERR_NOT_SUPPORTED;
+    std::lock_guard<std::mutex> guard(driver().lock);
+    memset(dns, 0, sizeof(*dns));
+    dns->ip.type = ESP_IPADDR_TYPE_V4;
+    dns->ip.u_addr.ip4 = esp_netif->dns;
+    return ESP_OK;
+}
+
+// ---- esp_wifi ----
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config) {
+    if (!config || config->magic != WIFI_INIT_CONFIG_MAGIC) return ESP_ERR_INVALID_ARG;
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    d.initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_deinit(void) {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    d.cancel();
+    d.initialized = d.started = false;
+    d.state = WifiDriver::IDLE;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    if (!d.initialized) return ESP_ERR_WIFI_NOT_INIT;
+    return mode == WIFI_MODE_STA ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* conf) {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    if (!d.initialized) return ESP_ERR_WIFI_NOT_INIT;
+    if (interface != WIFI_IF_STA) return ESP_ERR_NOT_SUPPORTED;
+    d.config = *conf;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t* conf) {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    *conf = d.config;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void) {
+    WifiDriver& d = driver();
+    {
+        std::lock_guard<std::mutex> guard(d.lock);
+        if (!d.initialized) return ESP_ERR_WIFI_NOT_INIT;
+        if (d.started) return ESP_OK;
+        d.started = true;
+    }
+    return esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_START, nullptr, 0, 0);
+}
+
+esp_err_t esp_wifi_stop(void) {
+    WifiDriver& d = driver();
+    {
+        std::lock_guard<std::mutex> guard(d.lock);
+        if (!d.started) return ESP_OK;
+        d.cancel();
+        d.started = false;
+        d.state = WifiDriver::IDLE;
+    }
+    return esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_STOP, nullptr, 0, 0);
+}
+
+// Succeeds after scan + association (or association only when the config pins
+// the AP's BSSID and channel) plus DHCP; fails with NO_AP_FOUND or AUTH_FAIL
+esp_err_t esp_wifi_connect(void) {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    if (!d.initialized) return ESP_ERR_WIFI_NOT_INIT;
+    if (!d.started) return ESP_ERR_WIFI_NOT_STARTED;
+    if (d.state != WifiDriver::IDLE) return ESP_ERR_WIFI_CONN;
+
+    const fake::WifiAp& ap = d.ap;
+    const wifi_sta_config_t& sta = d.config.sta;
+    d.stats.connects++;
+    d.state = WifiDriver::ASSOCIATING;
+
+    bool pinned = sta.bssid_set && sta.channel != 0;
+    bool pinned_right = pinned && memcmp(sta.bssid, ap.bssid, sizeof(ap.bssid)) == 0 && sta.channel == ap.channel;
+    uint32_t search_ms = pinned ? 0 : ap.scan_ms;
+    if (pinned) d.stats.fast_connects++;
+    else d.stats.scans++;
+
+    bool ssid_ok = strncmp((const char*) sta.ssid, ap.ssid.c_str(), sizeof(sta.ssid)) == 0;
+    bool found = ap.available && ssid_ok && (!pinned || pinned_right);
+    if (!found) {
+        d.fail_reason = WIFI_REASON_NO_AP_FOUND;
+        // A pinned AP that is not there is given up after one channel's probe
+        d.schedule(WifiDriver::STEP_FAILED, pinned ? ap.assoc_ms : ap.scan_ms);
+    } else if (strncmp((const char*) sta.password, ap.password.c_str(), sizeof(sta.password)) != 0) {
+        d.fail_reason = WIFI_REASON_AUTH_FAIL;
+        d.schedule(WifiDriver::STEP_FAILED, search_ms + ap.assoc_ms);
+    } else {
+        d.schedule(WifiDriver::STEP_ASSOCIATED, search_ms + ap.assoc_ms);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect(void) {
+    WifiDriver& d = driver();
+    fake::WifiAp ap;
+    {
+        std::lock_guard<std::mutex> guard(d.lock);
+        if (!d.started) return ESP_ERR_WIFI_NOT_STARTED;
+        if (d.state == WifiDriver::IDLE) return ESP_OK;
+        d.cancel();
+        d.state = WifiDriver::IDLE;
+        ap = d.ap;
+    }
+    post_disconnected(ap, WIFI_REASON_ASSOC_LEAVE);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* ap_info) {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    if (d.state != WifiDriver::WAIT_IP && d.state != WifiDriver::CONNECTED) return ESP_ERR_WIFI_NOT_CONNECT;
+    memset(ap_info, 0, sizeof(*ap_info));
+    memcpy(ap_info->bssid, d.ap.bssid, sizeof(ap_info->bssid));
+    strncpy((char*) ap_info->ssid, d.ap.ssid.c_str(), sizeof(ap_info->ssid) - 1);
+    ap_info->primary = d.ap.channel;
+    ap_info->rssi = d.ap.rssi;
+    return ESP_OK;
+}
+
+namespace fake {
+
+void wifi_set_ap(const WifiAp& ap) {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    d.ap = ap;
+}
+
+void wifi_drop(uint8_t reason) {
+    WifiDriver& d = driver();
+    WifiAp ap;
+    {
+        std::lock_guard<std::mutex> guard(d.lock);
+        if (d.state == WifiDriver::IDLE) return;
+        d.cancel();
+        d.state = WifiDriver::IDLE;
+        ap = d.ap;
+    }
+    post_disconnected(ap, reason);
+}
+
+WifiStats wifi_stats() {
+    WifiDriver& d = driver();
+    std::lock_guard<std::mutex> guard(d.lock);
+    return d.stats;
+}
+
+void wifi_reset() {
+    WifiDriver& d = driver();
+    {
+        std::lock_guard<std::mutex> guard(d.lock);
+        d.cancel();
+        d.initialized = d.started = false;
+        d.state = WifiDriver::IDLE;
+        d.config = {};
+        d.stats = {};
+        if (d.netif) *d.netif = esp_netif_obj();
+    }
+    event_loop_flush();
+    esp_event_loop_delete_default();
+}
+
+}  // namespace fake
@@ -0,0 +1,613 @@
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "host_internal.hpp"
+
+// Blocking calls wake up this often to notice vTaskDelete from another task
+static const auto DELETE_POLL = std::chrono::milliseconds(10);
+
+struct tskTaskControlBlock {
+    std::string name;
+    UBaseType_t priority = 0;
+    BaseType_t core = tskNO_AFFINITY;
+    uint32_t stack_depth = 0;
+    UBaseType_t number = 0;
+    TaskFunction_t fn = nullptr;
+    void* arg = nullptr;
+    pthread_t thread;
+    bool created = false;              // false for adopted threads (main, timer service, ...)
+    std::atomic<bool> deleted{false};
+
+    std::mutex notify_lock;
+    std::condition_variable notify_cv;
+    uint32_t notify_value = 0;
+};
+
+namespace {
+
+struct Registry {
+    std::mutex lock;
+    std::vector<tskTaskControlBlock*> live;
+    UBaseType_t next_number = 1;
+};
+
+// Never destroyed: detached tasks may still run while the process exits
+Registry& registry() {
+    static Registry* r = new Registry();
+    return *r;
+}
+
+thread_local tskTaskControlBlock* t_current = nullptr;
+
+void register_task(tskTaskControlBlock* tcb) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    tcb->number = r.next_number++;
+    r.live.push_back(tcb);
+}
+
+void unregister_task(tskTaskControlBlock* tcb) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.live.erase(std::remove(r.live.begin(), r.live.end(), tcb), r.live.end());
+}
+
+tskTaskControlBlock* current() {
+    if (!t_current) {
+        // A thread FreeRTOS did not start (main, a test thread): give it a TCB on first use
+        tskTaskControlBlock* tcb = new tskTaskControlBlock();
+        tcb->name = host::thread_name();
+        tcb->priority = 1;
+        tcb->thread = pthread_self();
+        register_task(tcb);
+        t_current = tcb;
+    }
+    return t_current;
+}
+
+[[noreturn]] void exit_current() {
+    tskTaskControlBlock* tcb = current();
+    unregister_task(tcb);
+    // The TCB is leaked on purpose: other tasks may still hold the handle
+    pthread_exit(nullptr);
+}
+
+void check_deleted() {
+    if (t_current && t_current->deleted.load(std::memory_order_relaxed)) exit_current();
+}
+
+void* task_entry(void* p) {
+    tskTaskControlBlock* tcb = static_cast<tskTaskControlBlock*>(p);
+    t_current = tcb;
+    host::set_thread_name(tcb->name.c_str());
+    tcb->fn(tcb->arg);
+    // Returning from a task function is an error on FreeRTOS; end the thread quietly here
+    exit_current();
+}
+
+using Clock = std::chrono::steady_clock;
+
+Clock::time_point deadline_after(TickType_t ticks) {
+    return Clock::now() + std::chrono::milliseconds(pdTICKS_TO_MS(ticks));
+}
+
+// Wait until pred() holds or ticks pass; portMAX_DELAY waits forever.
+// Wakes periodically so a task deleted while blocked exits.
+template <typename Pred>
+bool wait_for(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, TickType_t ticks, Pred pred) {
+    if (pred()) return true;
+    if (ticks == 0) return false;
+    check_deleted();
+    bool forever = ticks == portMAX_DELAY;
+    Clock::time_point deadline = forever ? Clock::time_point::max() : deadline_after(ticks);
+    while (!pred()) {
+        Clock::time_point now = Clock::now();
+        if (!forever && now >= deadline) return false;
+        Clock::time_point wake = forever ? now + DELETE_POLL : std::min(deadline, now + DELETE_POLL);
+        cv.wait_until(lock, wake);
+        if (t_current && t_current->deleted.load(std::memory_order_relaxed)) {
+            lock.unlock();
+            exit_current();
+        }
+    }
+    return true;
+}
+
+const Clock::time_point s_boot = Clock::now();
+
+thread_local bool t_in_isr = false;
+std::atomic<uint32_t> s_next_mux_owner{1};
+thread_local uint32_t t_mux_owner = 0;
+
+uint32_t mux_owner_id() {
+    if (!t_mux_owner) t_mux_owner = s_next_mux_owner.fetch_add(1);
+    return t_mux_owner;
+}
+
+uint32_t cpu_time_us(pthread_t thread) {
+    clockid_t clock;
+    struct timespec ts;
+    if (pthread_getcpuclockid(thread, &clock) != 0 || clock_gettime(clock, &ts) != 0) return 0;
+    return (uint32_t) ((uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+}  // namespace
+
+namespace host {
+
+IsrScope::IsrScope() : _outer(t_in_isr) { t_in_isr = true; }
+
+IsrScope::~IsrScope() { t_in_isr = _outer; }
+
+}  // namespace host
+
+// ---- Port ----
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    uint32_t me = mux_owner_id();
+    if (__atomic_load_n(&mux->owner, __ATOMIC_ACQUIRE) == me) {
+        mux->count++;
+        return;
+    }
+    uint32_t expected = portMUX_FREE_VAL;
+    while (!__atomic_compare_exchange_n(&mux->owner, &expected, me, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = portMUX_FREE_VAL;
+        sched_yield();
+    }
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    configASSERT(__atomic_load_n(&mux->owner, __ATOMIC_RELAXED) == mux_owner_id());
+    if (--mux->count == 0) __atomic_store_n(&mux->owner, portMUX_FREE_VAL, __ATOMIC_RELEASE);
+}
+
+BaseType_t xPortGetCoreID(void) {
+    tskTaskControlBlock* tcb = current();
+    if (tcb->core == 0 || tcb->core == 1) return tcb->core;
+    return (BaseType_t) (tcb->number & 1);
+}
+
+BaseType_t xPortInIsrContext(void) { return t_in_isr ? pdTRUE : pdFALSE; }
+
+void vPortYield(void) {
+    check_deleted();
+    sched_yield();
+}
+
+// ---- Tasks ----
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char* pcName, uint32_t usStackDepth,
+                                   void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pxCreatedTask,
+                                   BaseType_t xCoreID) {
+    tskTaskControlBlock* tcb = new tskTaskControlBlock();
+    tcb->name = pcName ? pcName : "";
+    tcb->name.resize(std::min(tcb->name.size(), (size_t) configMAX_TASK_NAME_LEN - 1));
+    tcb->priority = uxPriority;
+    tcb->core = xCoreID;
+    tcb->stack_depth = usStackDepth;
+    tcb->fn = pxTaskCode;
+    tcb->arg = pvParameters;
+    tcb->created = true;
+    register_task(tcb);
+    if (pxCreatedTask) *pxCreatedTask = tcb;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    // Host frames are larger than Xtensa ones; never go below a workable size
+    pthread_attr_setstacksize(&attr, std::max<size_t>((size_t) usStackDepth * 4, 256 * 1024));
+    int rc = pthread_create(&tcb->thread, &attr, task_entry, tcb);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        unregister_task(tcb);
+        if (pxCreatedTask) *pxCreatedTask = nullptr;
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char* pcName, uint32_t usStackDepth, void* pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t* pxCreatedTask) {
+    return xTaskCreatePinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask,
+                                   tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+    if (!xTaskToDelete || xTaskToDelete == t_current) exit_current();
+    xTaskToDelete->deleted.store(true);
+    unregister_task(xTaskToDelete);
+    xTaskToDelete->notify_cv.notify_all();
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+    check_deleted();
+    Clock::time_point deadline = deadline_after(xTicksToDelay);
+    while (true) {
+        Clock::time_point now = Clock::now();
+        if (now >= deadline) break;
+        std::this_thread::sleep_for(std::min<Clock::duration>(deadline - now, DELETE_POLL));
+        check_deleted();
+    }
+    if (xTicksToDelay == 0) sched_yield();
+}
+
+BaseType_t xTaskDelayUntil(TickType_t* pxPreviousWakeTime, TickType_t xTimeIncrement) {
+    TickType_t wake = *pxPreviousWakeTime + xTimeIncrement;
+    TickType_t now = xTaskGetTickCount();
+    *pxPreviousWakeTime = wake;
+    if ((int32_t) (wake - now) <= 0) {
+        check_deleted();
+        return pdFALSE;
+    }
+    vTaskDelay(wake - now);
+    return pdTRUE;
+}
+
+void vTaskDelayUntil(TickType_t* pxPreviousWakeTime, TickType_t xTimeIncrement) {
+    xTaskDelayUntil(pxPreviousWakeTime, xTimeIncrement);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - s_boot).count();
+    return (TickType_t) ((uint64_t) ms * configTICK_RATE_HZ / 1000);
+}
+
+TickType_t xTaskGetTickCountFromISR(void) { return xTaskGetTickCount(); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return current(); }
+
+const char* pcTaskGetName(TaskHandle_t xTaskToQuery) {
+    return (xTaskToQuery ? xTaskToQuery : current())->name.c_str();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask) { return (xTask ? xTask : current())->priority; }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask) { return (xTask ? xTask : current())->stack_depth; }
+
+UBaseType_t uxTaskGetNumberOfTasks(void) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    return (UBaseType_t) r.live.size();
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* pxTaskStatusArray, UBaseType_t uxArraySize,
+                                 configRUN_TIME_COUNTER_TYPE* pulTotalRunTime) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    if (r.live.size() > uxArraySize) return 0;
+    UBaseType_t n = 0;
+    for (tskTaskControlBlock* tcb : r.live) {
+        TaskStatus_t& s = pxTaskStatusArray[n++];
+        memset(&s, 0, sizeof(s));
+        s.xHandle = tcb;
+        s.pcTaskName = tcb->name.c_str();
+        s.xTaskNumber = tcb->number;
+        s.eCurrentState = tcb == t_current ? eRunning : eBlocked;
+        s.uxCurrentPriority = tcb->priority;
+        s.uxBasePriority = tcb->priority;
+        s.ulRunTimeCounter = cpu_time_us(tcb->thread);
+        s.usStackHighWaterMark = tcb->stack_depth;
+        s.xCoreID = tcb->core;
+    }
+    if (pulTotalRunTime) {
+        *pulTotalRunTime = (configRUN_TIME_COUNTER_TYPE) std::chrono::duration_cast<std::chrono::microseconds>(
+                               Clock::now() - s_boot)
+                               .count();
+    }
+    return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+    {
+        std::lock_guard<std::mutex> guard(xTaskToNotify->notify_lock);
+        xTaskToNotify->notify_value++;
+    }
+    xTaskToNotify->notify_cv.notify_all();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken) {
+    xTaskNotifyGive(xTaskToNotify);
+    if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+    tskTaskControlBlock* tcb = current();
+    std::unique_lock<std::mutex> lock(tcb->notify_lock);
+    wait_for(lock, tcb->notify_cv, xTicksToWait, [tcb] { return tcb->notify_value != 0; });
+    uint32_t value = tcb->notify_value;
+    if (value) tcb->notify_value = xClearCountOnExit ? 0 : value - 1;
+    return value;
+}
+
+// ---- Queues and semaphores ----
+
+struct QueueDefinition {
+    enum Kind { QUEUE, BINARY, COUNTING, MUTEX, RECURSIVE_MUTEX };
+
+    Kind kind = QUEUE;
+    std::mutex lock;
+    std::condition_variable readable;
+    std::condition_variable writable;
+
+    // Queues: ring of length * item_size bytes. Semaphores: count only.
+    size_t length = 0;
+    size_t item_size = 0;
+    std::vector<uint8_t> storage;
+    size_t head = 0;
+    size_t count = 0;
+
+    tskTaskControlBlock* holder = nullptr;
+    UBaseType_t recursion = 0;
+};
+
+static QueueHandle_t new_semaphore(QueueDefinition::Kind kind, size_t max_count, size_t initial) {
+    QueueDefinition* q = new QueueDefinition();
+    q->kind = kind;
+    q->length = max_count;
+    q->count = initial;
+    return q;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize) {
+    if (uxQueueLength == 0) return nullptr;
+    QueueDefinition* q = new QueueDefinition();
+    q->length = uxQueueLength;
+    q->item_size = uxItemSize;
+    q->storage.resize((size_t) uxQueueLength * uxItemSize);
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t xQueue) { delete xQueue; }
+
+static void copy_in(QueueHandle_t q, size_t slot, const void* item) {
+    if (q->item_size) memcpy(&q->storage[slot * q->item_size], item, q->item_size);
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void* item, TickType_t ticks, bool front, bool overwrite) {
+    std::unique_lock<std::mutex> lock(q->lock);
+    if (overwrite && q->count == q->length) {
+        copy_in(q, (q->head + q->count - 1) % q->length, item);
+    } else {
+        if (!wait_for(lock, q->writable, ticks, [q] { return q->count < q->length; })) return errQUEUE_FULL;
+        if (front) {
+            q->head = (q->head + q->length - 1) % q->length;
+            copy_in(q, q->head, item);
+        } else {
+            copy_in(q, (q->head + q->count) % q->length, item);
+        }
+        q->count++;
+    }
+    lock.unlock();
+    q->readable.notify_one();
+    return pdPASS;
+}
+
+static BaseType_t queue_receive(QueueHandle_t q, void* buffer, TickType_t ticks, bool peek) {
+    std::unique_lock<std::mutex> lock(q->lock);
+    if (!wait_for(lock, q->readable, ticks, [q] { return q->count > 0; })) return errQUEUE_EMPTY;
+    if (q->item_size) memcpy(buffer, &q->storage[q->head * q->item_size], q->item_size);
+    if (!peek) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+    }
+    lock.unlock();
+    if (peek) q->readable.notify_one();
+    else q->writable.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait) {
+    return queue_send(xQueue, pvItemToQueue, xTicksToWait, false, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait) {
+    return queue_send(xQueue, pvItemToQueue, xTicksToWait, false, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait) {
+    return queue_send(xQueue, pvItemToQueue, xTicksToWait, true, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void* pvItemToQueue) {
+    return queue_send(xQueue, pvItemToQueue, 0, false, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void* pvItemToQueue, BaseType_t* pxHigherPriorityTaskWoken) {
+    BaseType_t ok = queue_send(xQueue, pvItemToQueue, 0, false, false);
+    if (ok && pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdTRUE;
+    return ok;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait) {
+    return queue_receive(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void* pvBuffer, BaseType_t* pxHigherPriorityTaskWoken) {
+    BaseType_t ok = queue_receive(xQueue, pvBuffer, 0, false);
+    if (ok && pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdTRUE;
+    return ok;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait) {
+    return queue_receive(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue) {
+    {
+        std::lock_guard<std::mutex> guard(xQueue->lock);
+        xQueue->head = 0;
+        xQueue->count = 0;
+    }
+    xQueue->writable.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue) {
+    std::lock_guard<std::mutex> guard(xQueue->lock);
+    return (UBaseType_t) xQueue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue) {
+    std::lock_guard<std::mutex> guard(xQueue->lock);
+    return (UBaseType_t) (xQueue->length - xQueue->count);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return new_semaphore(QueueDefinition::BINARY, 1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount) {
+    return new_semaphore(QueueDefinition::COUNTING, uxMaxCount, uxInitialCount);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return new_semaphore(QueueDefinition::MUTEX, 1, 1); }
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+    return new_semaphore(QueueDefinition::RECURSIVE_MUTEX, 1, 1);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore) { delete xSemaphore; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime) {
+    SemaphoreHandle_t s = xSemaphore;
+    std::unique_lock<std::mutex> lock(s->lock);
+    if (!wait_for(lock, s->readable, xBlockTime, [s] { return s->count > 0; })) return pdFALSE;
+    s->count--;
+    if (s->kind == QueueDefinition::MUTEX || s->kind == QueueDefinition::RECURSIVE_MUTEX) s->holder = current();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore) {
+    SemaphoreHandle_t s = xSemaphore;
+    {
+        std::lock_guard<std::mutex> guard(s->lock);
+        if (s->kind == QueueDefinition::MUTEX || s->kind == QueueDefinition::RECURSIVE_MUTEX) {
+            // Only the holder may give a mutex back
+            if (s->holder != current()) return pdFALSE;
+            s->holder = nullptr;
+        }
+        if (s->count >= s->length) return pdFALSE;
+        s->count++;
+    }
+    s->readable.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t xMutex, TickType_t xBlockTime) {
+    {
+        std::lock_guard<std::mutex> guard(xMutex->lock);
+        if (xMutex->holder && xMutex->holder == current()) {
+            xMutex->recursion++;
+            return pdTRUE;
+        }
+    }
+    if (!xSemaphoreTake(xMutex, xBlockTime)) return pdFALSE;
+    std::lock_guard<std::mutex> guard(xMutex->lock);
+    xMutex->recursion = 1;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t xMutex) {
+    {
+        std::lock_guard<std::mutex> guard(xMutex->lock);
+        if (xMutex->holder != current()) return pdFALSE;
+        if (--xMutex->recursion > 0) return pdTRUE;
+    }
+    return xSemaphoreGive(xMutex);
+}
+
+BaseType_t xSemaphoreTakeFromISR(SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken) {
+    if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdFALSE;
+    return xSemaphoreTake(xSemaphore, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken) {
+    BaseType_t ok = xSemaphoreGive(xSemaphore);
+    if (ok && pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdTRUE;
+    return ok;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore) {
+    std::lock_guard<std::mutex> guard(xSemaphore->lock);
+    return (UBaseType_t) xSemaphore->count;
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t xMutex) {
+    std::lock_guard<std::mutex> guard(xMutex->lock);
+    return xMutex->holder;
+}
+
+// ---- Event groups ----
+
+struct EventGroupDef_t {
+    std::mutex lock;
+    std::condition_variable changed;
+    EventBits_t bits = 0;
+};
+
+// The top byte is reserved for the kernel, as on FreeRTOS
+static const EventBits_t EVENT_BITS_MASK = 0x00ffffff;
+
+EventGroupHandle_t xEventGroupCreate(void) { return new EventGroupDef_t(); }
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup) { delete xEventGroup; }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet) {
+    EventBits_t bits;
+    {
+        std::lock_guard<std::mutex> guard(xEventGroup->lock);
+        xEventGroup->bits |= uxBitsToSet & EVENT_BITS_MASK;
+        bits = xEventGroup->bits;
+    }
+    xEventGroup->changed.notify_all();
+    return bits;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet,
+                                     BaseType_t* pxHigherPriorityTaskWoken) {
+    xEventGroupSetBits(xEventGroup, uxBitsToSet);
+    if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdTRUE;
+    return pdPASS;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear) {
+    std::lock_guard<std::mutex> guard(xEventGroup->lock);
+    EventBits_t before = xEventGroup->bits;
+    xEventGroup->bits &= ~uxBitsToClear;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup) {
+    std::lock_guard<std::mutex> guard(xEventGroup->lock);
+    return xEventGroup->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait) {
+    EventGroupHandle_t g = xEventGroup;
+    std::unique_lock<std::mutex> lock(g->lock);
+    auto satisfied = [&] {
+        EventBits_t hit = g->bits & uxBitsToWaitFor;
+        return xWaitForAllBits ? hit == uxBitsToWaitFor : hit != 0;
+    };
+    bool ok = wait_for(lock, g->changed, xTicksToWait, satisfied);
+    EventBits_t bits = g->bits;
+    if (ok && xClearOnExit) g->bits &= ~uxBitsToWaitFor;
+    return bits;
+}
@@ -0,0 +1,738 @@
+#include <string.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+#include "driver/rmt_tx.h"
+#include "driver/mcpwm_cap.h"
+#include "soc/gpio_reg.h"
+#include "host_fakes.hpp"
+#include "host_internal.hpp"
+
+// ---- Pins and the GPIO block ----
+
+namespace {
+
+struct Pin {
+    gpio_mode_t mode = GPIO_MODE_DISABLE;
+    gpio_int_type_t intr_type = GPIO_INTR_DISABLE;
+    bool intr_enabled = false;
+    gpio_isr_t handler = nullptr;
+    void* arg = nullptr;
+};
+
+// Levels are atomics so gpio_get_level from an ISR takes no lock
+struct GpioBlock {
+    std::mutex lock;
+    std::atomic<int> levels[GPIO_PIN_COUNT] = {};
+    Pin pins[GPIO_PIN_COUNT];
+    bool isr_service = false;
+    std::map<uint32_t, uint32_t> other_regs;
+    std::atomic<uint64_t> interrupts{0};
+};
+
+GpioBlock& block() {
+    static GpioBlock* b = new GpioBlock();
+    return *b;
+}
+
+bool valid(int pin) {
+    return pin >= 0 && pin < GPIO_PIN_COUNT;
+}
+
+bool intr_fires(gpio_int_type_t type, int level) {
+    switch (type) {
+        case GPIO_INTR_POSEDGE: return level == 1;
+        case GPIO_INTR_NEGEDGE: return level == 0;
+        case GPIO_INTR_ANYEDGE: return true;
+        case GPIO_INTR_LOW_LEVEL: return level == 0;
+        case GPIO_INTR_HIGH_LEVEL: return level == 1;
+        default: return false;
+    }
+}
+
+// A level change on a pin, from outside or from an output driver: the pin's
+// interrupt runs on the calling thread, then any PCNT channel sees the edge
+void drive(int pin, int level) {
+    GpioBlock& b = block();
+    level = level ? 1 : 0;
+    if (b.levels[pin].exchange(level) == level) return;
+
+    gpio_isr_t handler = nullptr;
+    void* arg = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(b.lock);
+        const Pin& p = b.pins[pin];
+        if (b.isr_service && p.intr_enabled && p.handler && intr_fires(p.intr_type, level)) {
+            handler = p.handler;
+            arg = p.arg;
+        }
+    }
+    if (handler) {
+        b.interrupts++;
+        host::IsrScope isr;
+        handler(arg);
+    }
+    host::pcnt_on_edge(pin, level);
+}
+
+void drive_mask(uint32_t mask, int first_pin, int level) {
+    for (int bit = 0; bit < 32 && mask; bit++, mask >>= 1) {
+        if ((mask & 1) && valid(first_pin + bit)) drive(first_pin + bit, level);
+    }
+}
+
+uint32_t levels_from(int first_pin) {
+    GpioBlock& b = block();
+    uint32_t value = 0;
+    for (int bit = 0; bit < 32 && valid(first_pin + bit); bit++) {
+        if (b.levels[first_pin + bit].load(std::memory_order_relaxed)) value |= 1u << bit;
+    }
+    return value;
+}
+
+}  // namespace
+
+// The output set/clear and input registers act on the fake pins; every other
+// register is plain memory
+void host_reg_write(uint32_t addr, uint32_t value) {
+    switch (addr) {
+        case GPIO_OUT_W1TS_REG: drive_mask(value, 0, 1); break;
+        case GPIO_OUT_W1TC_REG: drive_mask(value, 0, 0); break;
+        case GPIO_OUT1_W1TS_REG: drive_mask(value, 32, 1); break;
+        case GPIO_OUT1_W1TC_REG: drive_mask(value, 32, 0); break;
+        case GPIO_OUT_REG:
+            drive_mask(value, 0, 1);
+            drive_mask(~value, 0, 0);
+            break;
+        case GPIO_OUT1_REG:
+            drive_mask(value, 32, 1);
+            drive_mask(~value, 32, 0);
+            break;
+        default: {
+            GpioBlock& b = block();
+            std::lock_guard<std::mutex> guard(b.lock);
+            b.other_regs[addr] = value;
+            break;
+        }
+    }
+}
+
+uint32_t host_reg_read(uint32_t addr) {
+    switch (addr) {
+        case GPIO_IN_REG:
+        case GPIO_OUT_REG:
+            return levels_from(0);
+        case GPIO_IN1_REG:
+        case GPIO_OUT1_REG:
+            return levels_from(32);
+        default: {
+            GpioBlock& b = block();
+            std::lock_guard<std::mutex> guard(b.lock);
+            auto it = b.other_regs.find(addr);
+            return it == b.other_regs.end() ? 0 : it->second;
+        }
+    }
+}
+
+esp_err_t gpio_config(const gpio_config_t* pGPIOConfig) {
+    if (!pGPIOConfig || (pGPIOConfig->pin_bit_mask >> GPIO_PIN_COUNT)) return ESP_ERR_INVALID_ARG;
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    for (int pin = 0; pin < GPIO_PIN_COUNT; pin++) {
+        if (!(pGPIOConfig->pin_bit_mask & (1ULL << pin))) continue;
+        Pin& p = b.pins[pin];
+        p.mode = pGPIOConfig->mode;
+        p.intr_type = pGPIOConfig->intr_type;
+        p.intr_enabled = pGPIOConfig->intr_type != GPIO_INTR_DISABLE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num) {
+    if (!valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.pins[gpio_num] = Pin();
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+    if (!valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.pins[gpio_num].mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (!valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    drive(gpio_num, level);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    if (!valid(gpio_num)) return 0;
+    return block().levels[gpio_num].load(std::memory_order_relaxed);
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+    if (!valid(gpio_num) || intr_type >= GPIO_INTR_MAX) return ESP_ERR_INVALID_ARG;
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.pins[gpio_num].intr_type = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
+    if (!valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.pins[gpio_num].intr_enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num) {
+    if (!valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.pins[gpio_num].intr_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    if (b.isr_service) return ESP_ERR_INVALID_STATE;
+    b.isr_service = true;
+    return ESP_OK;
+}
+
+void gpio_uninstall_isr_service(void) {
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.isr_service = false;
+    for (Pin& p : b.pins) p.handler = nullptr;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void* args) {
+    if (!valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    if (!b.isr_service) return ESP_ERR_INVALID_STATE;
+    b.pins[gpio_num].handler = isr_handler;
+    b.pins[gpio_num].arg = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num) {
+    if (!valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    GpioBlock& b = block();
+    std::lock_guard<std::mutex> guard(b.lock);
+    if (!b.isr_service) return ESP_ERR_INVALID_STATE;
+    b.pins[gpio_num].handler = nullptr;
+    b.pins[gpio_num].arg = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, int pull) {
+    return valid(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// ---- PCNT ----
+
+struct pcnt_chan_t {
+    pcnt_unit_t* unit;
+    int edge_pin;
+    int level_pin;
+    bool invert_edge;
+    bool invert_level;
+    int virt_level;
+    pcnt_channel_edge_action_t pos_act = PCNT_CHANNEL_EDGE_ACTION_HOLD;
+    pcnt_channel_edge_action_t neg_act = PCNT_CHANNEL_EDGE_ACTION_HOLD;
+    pcnt_channel_level_action_t high_act = PCNT_CHANNEL_LEVEL_ACTION_KEEP;
+    pcnt_channel_level_action_t low_act = PCNT_CHANNEL_LEVEL_ACTION_KEEP;
+};
+
+struct pcnt_unit_t {
+    int low_limit;
+    int high_limit;
+    int count = 0;
+    bool enabled = false;
+    bool running = false;
+    pcnt_chan_t* channels[2] = {};
+};
+
+namespace {
+
+const int PCNT_UNITS = 8;
+
+struct PcntBlock {
+    std::mutex lock;
+    pcnt_unit_t* units[PCNT_UNITS] = {};
+};
+
+PcntBlock& pcnt() {
+    static PcntBlock* p = new PcntBlock();
+    return *p;
+}
+
+// One step of the channel's action table for an edge on its edge input
+int pcnt_step(const pcnt_chan_t* chan, int edge_level) {
+    bool rising = (edge_level != 0) != chan->invert_edge;
+    pcnt_channel_edge_action_t act = rising ? chan->pos_act : chan->neg_act;
+
+    int control = chan->level_pin >= 0 ? gpio_get_level((gpio_num_t) chan->level_pin) : chan->virt_level;
+    if (chan->invert_level) control = !control;
+    pcnt_channel_level_action_t mod = control ? chan->high_act : chan->low_act;
+
+    if (mod == PCNT_CHANNEL_LEVEL_ACTION_HOLD) return 0;
+    int step = act == PCNT_CHANNEL_EDGE_ACTION_INCREASE ? 1 : act == PCNT_CHANNEL_EDGE_ACTION_DECREASE ? -1 : 0;
+    return mod == PCNT_CHANNEL_LEVEL_ACTION_INVERSE ? -step : step;
+}
+
+}  // namespace
+
+namespace host {
+
+void pcnt_on_edge(int pin, int level) {
+    PcntBlock& p = pcnt();
+    std::lock_guard<std::mutex> guard(p.lock);
+    for (pcnt_unit_t* unit : p.units) {
+        if (!unit || !unit->running) continue;
+        for (pcnt_chan_t* chan : unit->channels) {
+            if (!chan || chan->edge_pin != pin) continue;
+            unit->count += pcnt_step(chan, level);
+            // The hardware clears the counter when it reaches either limit
+            if (unit->count >= unit->high_limit || unit->count <= unit->low_limit) unit->count = 0;
+        }
+    }
+}
+
+}  // namespace host
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t* config, pcnt_unit_handle_t* ret_unit) {
+    if (!config || !ret_unit || config->low_limit >= 0 || config->high_limit <= 0 ||
+        config->low_limit < -32768 || config->high_limit > 32767) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    PcntBlock& p = pcnt();
+    std::lock_guard<std::mutex> guard(p.lock);
+    for (pcnt_unit_t*& slot : p.units) {
+        if (slot) continue;
+        slot = new pcnt_unit_t();
+        slot->low_limit = config->low_limit;
+        slot->high_limit = config->high_limit;
+        *ret_unit = slot;
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t pcnt_del_unit(pcnt_unit_handle_t unit) {
+    PcntBlock& p = pcnt();
+    std::lock_guard<std::mutex> guard(p.lock);
+    if (unit->enabled || unit->channels[0] || unit->channels[1]) return ESP_ERR_INVALID_STATE;
+    for (pcnt_unit_t*& slot : p.units) {
+        if (slot == unit) slot = nullptr;
+    }
+    delete unit;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unit, const pcnt_glitch_filter_config_t* config) {
+    // 1023 APB cycles at 80 MHz
+    if (config && config->max_glitch_ns > 12787) return ESP_ERR_INVALID_ARG;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit) {
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    if (unit->enabled) return ESP_ERR_INVALID_STATE;
+    unit->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_disable(pcnt_unit_handle_t unit) {
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    if (!unit->enabled) return ESP_ERR_INVALID_STATE;
+    unit->enabled = unit->running = false;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit) {
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    if (!unit->enabled) return ESP_ERR_INVALID_STATE;
+    unit->running = true;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_stop(pcnt_unit_handle_t unit) {
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    if (!unit->enabled) return ESP_ERR_INVALID_STATE;
+    unit->running = false;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit) {
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    unit->count = 0;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int* value) {
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    *value = unit->count;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t* config,
+                           pcnt_channel_handle_t* ret_chan) {
+    if (!unit || !config || !ret_chan) return ESP_ERR_INVALID_ARG;
+    if (config->edge_gpio_num >= GPIO_PIN_COUNT || config->level_gpio_num >= GPIO_PIN_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    if (unit->enabled) return ESP_ERR_INVALID_STATE;
+    for (pcnt_chan_t*& slot : unit->channels) {
+        if (slot) continue;
+        slot = new pcnt_chan_t();
+        slot->unit = unit;
+        slot->edge_pin = config->edge_gpio_num;
+        slot->level_pin = config->level_gpio_num;
+        slot->invert_edge = config->flags.invert_edge_input;
+        slot->invert_level = config->flags.invert_level_input;
+        slot->virt_level = config->flags.virt_level_io_level;
+        *ret_chan = slot;
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t pcnt_del_channel(pcnt_channel_handle_t chan) {
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    for (pcnt_chan_t*& slot : chan->unit->channels) {
+        if (slot == chan) slot = nullptr;
+    }
+    delete chan;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t chan, pcnt_channel_edge_action_t pos_act,
+                                       pcnt_channel_edge_action_t neg_act) {
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    chan->pos_act = pos_act;
+    chan->neg_act = neg_act;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t chan, pcnt_channel_level_action_t high_act,
+                                        pcnt_channel_level_action_t low_act) {
+    std::lock_guard<std::mutex> guard(pcnt().lock);
+    chan->high_act = high_act;
+    chan->low_act = low_act;
+    return ESP_OK;
+}
+
+// ---- RMT ----
+
+struct rmt_channel_t {
+    int pin;
+    bool enabled = false;
+};
+
+struct rmt_encoder_t {};
+
+namespace {
+
+const int RMT_TX_CHANNELS = 8;
+
+struct RmtBlock {
+    std::mutex lock;
+    rmt_channel_t* channels[RMT_TX_CHANNELS] = {};
+    fake::RmtTxHook hook;
+};
+
+RmtBlock& rmt() {
+    static RmtBlock* r = new RmtBlock();
+    return *r;
+}
+
+}  // namespace
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t* config, rmt_channel_handle_t* ret_chan) {
+    if (!config || !ret_chan || !valid(config->gpio_num) || config->resolution_hz == 0) return ESP_ERR_INVALID_ARG;
+    RmtBlock& r = rmt();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (rmt_channel_t*& slot : r.channels) {
+        if (slot) continue;
+        slot = new rmt_channel_t();
+        slot->pin = config->gpio_num;
+        *ret_chan = slot;
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel) {
+    RmtBlock& r = rmt();
+    std::lock_guard<std::mutex> guard(r.lock);
+    if (channel->enabled) return ESP_ERR_INVALID_STATE;
+    for (rmt_channel_t*& slot : r.channels) {
+        if (slot == channel) slot = nullptr;
+    }
+    delete channel;
+    return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel) {
+    std::lock_guard<std::mutex> guard(rmt().lock);
+    if (channel->enabled) return ESP_ERR_INVALID_STATE;
+    channel->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel) {
+    std::lock_guard<std::mutex> guard(rmt().lock);
+    if (!channel->enabled) return ESP_ERR_INVALID_STATE;
+    channel->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t* config, rmt_encoder_handle_t* ret_encoder) {
+    if (!config || !ret_encoder) return ESP_ERR_INVALID_ARG;
+    *ret_encoder = new rmt_encoder_t();
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder) {
+    delete encoder;
+    return ESP_OK;
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel, rmt_encoder_handle_t encoder, const void* payload,
+                       size_t payload_bytes, const rmt_transmit_config_t* config) {
+    if (!tx_channel || !encoder || !payload || !config || payload_bytes % sizeof(rmt_symbol_word_t)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    RmtBlock& r = rmt();
+    fake::RmtTxHook hook;
+    {
+        std::lock_guard<std::mutex> guard(r.lock);
+        if (!tx_channel->enabled) return ESP_ERR_INVALID_STATE;
+        hook = r.hook;
+    }
+    const rmt_symbol_word_t* symbols = (const rmt_symbol_word_t*) payload;
+    size_t count = payload_bytes / sizeof(rmt_symbol_word_t);
+    for (size_t i = 0; i < count; i++) {
+        drive(tx_channel->pin, symbols[i].level0);
+        drive(tx_channel->pin, symbols[i].level1);
+    }
+    drive(tx_channel->pin, config->flags.eot_level);
+    if (hook) hook(tx_channel->pin, symbols, count);
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel, int timeout_ms) {
+    return ESP_OK;
+}
+
+// ---- MCPWM capture ----
+
+struct mcpwm_cap_timer_t {
+    int group;
+    uint32_t resolution_hz;
+    bool enabled = false;
+    bool running = false;
+    int channels = 0;
+};
+
+struct mcpwm_cap_channel_t {
+    mcpwm_cap_timer_t* timer;
+    int pin;
+    bool pos_edge;
+    bool neg_edge;
+    bool enabled = false;
+    mcpwm_capture_event_cb_t on_cap = nullptr;
+    void* user_ctx = nullptr;
+};
+
+namespace {
+
+const int MCPWM_GROUPS = 2;
+const int MCPWM_CAPTURE_CHANNELS = 3;
+const uint32_t MCPWM_APB_HZ = 80000000;
+
+struct McpwmBlock {
+    std::mutex lock;
+    mcpwm_cap_timer_t* timers[MCPWM_GROUPS] = {};
+    std::vector<mcpwm_cap_channel_t*> channels;
+};
+
+McpwmBlock& mcpwm() {
+    static McpwmBlock* m = new McpwmBlock();
+    return *m;
+}
+
+}  // namespace
+
+esp_err_t mcpwm_new_capture_timer(const mcpwm_capture_timer_config_t* config, mcpwm_cap_timer_handle_t* ret_cap_timer) {
+    if (!config || !ret_cap_timer || config->group_id < 0 || config->group_id >= MCPWM_GROUPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    McpwmBlock& m = mcpwm();
+    std::lock_guard<std::mutex> guard(m.lock);
+    if (m.timers[config->group_id]) return ESP_ERR_NOT_FOUND;
+    mcpwm_cap_timer_t* t = new mcpwm_cap_timer_t();
+    t->group = config->group_id;
+    t->resolution_hz = MCPWM_APB_HZ;
+    m.timers[t->group] = t;
+    *ret_cap_timer = t;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_capture_timer(mcpwm_cap_timer_handle_t cap_timer) {
+    McpwmBlock& m = mcpwm();
+    std::lock_guard<std::mutex> guard(m.lock);
+    if (cap_timer->enabled || cap_timer->channels) return ESP_ERR_INVALID_STATE;
+    m.timers[cap_timer->group] = nullptr;
+    delete cap_timer;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_enable(mcpwm_cap_timer_handle_t cap_timer) {
+    std::lock_guard<std::mutex> guard(mcpwm().lock);
+    if (cap_timer->enabled) return ESP_ERR_INVALID_STATE;
+    cap_timer->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_disable(mcpwm_cap_timer_handle_t cap_timer) {
+    std::lock_guard<std::mutex> guard(mcpwm().lock);
+    if (!cap_timer->enabled) return ESP_ERR_INVALID_STATE;
+    cap_timer->enabled = cap_timer->running = false;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_start(mcpwm_cap_timer_handle_t cap_timer) {
+    std::lock_guard<std::mutex> guard(mcpwm().lock);
+    if (!cap_timer->enabled) return ESP_ERR_INVALID_STATE;
+    cap_timer->running = true;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_stop(mcpwm_cap_timer_handle_t cap_timer) {
+    std::lock_guard<std::mutex> guard(mcpwm().lock);
+    if (!cap_timer->enabled) return ESP_ERR_INVALID_STATE;
+    cap_timer->running = false;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_get_resolution(mcpwm_cap_timer_handle_t cap_timer, uint32_t* out_resolution) {
+    *out_resolution = cap_timer->resolution_hz;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_capture_channel(mcpwm_cap_timer_handle_t cap_timer, const mcpwm_capture_channel_config_t* config,
+                                    mcpwm_cap_channel_handle_t* ret_cap_channel) {
+    if (!cap_timer || !config || !ret_cap_channel || !valid(config->gpio_num)) return ESP_ERR_INVALID_ARG;
+    McpwmBlock& m = mcpwm();
+    std::lock_guard<std::mutex> guard(m.lock);
+    if (cap_timer->channels >= MCPWM_CAPTURE_CHANNELS) return ESP_ERR_NOT_FOUND;
+    mcpwm_cap_channel_t* c = new mcpwm_cap_channel_t();
+    c->timer = cap_timer;
+    c->pin = config->gpio_num;
+    c->pos_edge = config->flags.pos_edge;
+    c->neg_edge = config->flags.neg_edge;
+    cap_timer->channels++;
+    m.channels.push_back(c);
+    *ret_cap_channel = c;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_capture_channel(mcpwm_cap_channel_handle_t cap_channel) {
+    McpwmBlock& m = mcpwm();
+    std::lock_guard<std::mutex> guard(m.lock);
+    if (cap_channel->enabled) return ESP_ERR_INVALID_STATE;
+    for (size_t i = 0; i < m.channels.size(); i++) {
+        if (m.channels[i] == cap_channel) m.channels.erase(m.channels.begin() + i);
+    }
+    cap_channel->timer->channels--;
+    delete cap_channel;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_channel_enable(mcpwm_cap_channel_handle_t cap_channel) {
+    std::lock_guard<std::mutex> guard(mcpwm().lock);
+    if (cap_channel->enabled) return ESP_ERR_INVALID_STATE;
+    cap_channel->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_channel_disable(mcpwm_cap_channel_handle_t cap_channel) {
+    std::lock_guard<std::mutex> guard(mcpwm().lock);
+    if (!cap_channel->enabled) return ESP_ERR_INVALID_STATE;
+    cap_channel->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_channel_register_event_callbacks(mcpwm_cap_channel_handle_t cap_channel,
+                                                         const mcpwm_capture_event_callbacks_t* cbs,
+                                                         void* user_data) {
+    std::lock_guard<std::mutex> guard(mcpwm().lock);
+    if (cap_channel->enabled) return ESP_ERR_INVALID_STATE;
+    cap_channel->on_cap = cbs->on_cap;
+    cap_channel->user_ctx = user_data;
+    return ESP_OK;
+}
+
+// ---- Control ----
+
+namespace fake {
+
+void gpio_input(int pin, int level) {
+    if (valid(pin)) drive(pin, level);
+}
+
+int gpio_level(int pin) {
+    return valid(pin) ? block().levels[pin].load() : 0;
+}
+
+uint64_t gpio_interrupts() {
+    return block().interrupts.load();
+}
+
+void gpio_reset() {
+    GpioBlock& b = block();
+    for (auto& level : b.levels) level = 0;
+    b.interrupts = 0;
+}
+
+void rmt_set_tx_hook(RmtTxHook hook) {
+    RmtBlock& r = rmt();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.hook = std::move(hook);
+}
+
+bool mcpwm_capture(int pin, bool rising, uint32_t timer_value) {
+    McpwmBlock& m = mcpwm();
+    mcpwm_cap_channel_t* target = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(m.lock);
+        for (mcpwm_cap_channel_t* c : m.channels) {
+            if (c->pin == pin && c->enabled && c->timer->running && c->on_cap && (rising ? c->pos_edge : c->neg_edge)) {
+                target = c;
+                break;
+            }
+        }
+    }
+    if (!target) return false;
+    mcpwm_capture_event_data_t edata = {timer_value, rising ? MCPWM_CAP_EDGE_POS : MCPWM_CAP_EDGE_NEG};
+    host::IsrScope isr;
+    target->on_cap(target, &edata, target->user_ctx);
+    return true;
+}
+
+}  // namespace fake
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+// Shared between the fake implementations; not part of the shim's interface
+namespace host {
+
+const char* thread_name();
+void set_thread_name(const char* name);
+
+// Marks the calling thread as running an ISR for xPortInIsrContext
+class IsrScope {
+public:
+    IsrScope();
+    ~IsrScope();
+
+private:
+    bool _outer;
+};
+
+// Pin level changes, from whatever drove them, are seen by these peripherals
+void pcnt_on_edge(int pin, int level);
+
+}  // namespace host
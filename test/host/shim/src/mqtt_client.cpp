@@ -0,0 +1,663 @@
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mqtt_client.h"
+#include "host_fakes.hpp"
+#include "host_internal.hpp"
+
+ESP_EVENT_DEFINE_BASE(MQTT_EVENTS);
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// esp-mqtt's default reconnect delay
+const int DEFAULT_RECONNECT_MS = 10000;
+// Topic Alias Maximum the broker announces in CONNACK
+const uint16_t BROKER_TOPIC_ALIAS_MAX = 10;
+// Fixed header and packet id of a queued PUBLISH
+const size_t OUTBOX_OVERHEAD = 4;
+
+// '+' matches one level, a trailing '#' the rest
+bool topic_matches(const std::string& filter, const std::string& topic) {
+    size_t f = 0, t = 0;
+    while (f < filter.size()) {
+        size_t f_end = filter.find('/', f);
+        if (f_end == std::string::npos) f_end = filter.size();
+        std::string level = filter.substr(f, f_end - f);
+        if (level == "#") return true;
+        if (t > topic.size()) return false;
+        size_t t_end = topic.find('/', t);
+        if (t_end == std::string::npos) t_end = topic.size();
+        if (level != "+" && level != topic.substr(t, t_end - t)) return false;
+        f = f_end + 1;
+        t = t_end + 1;
+    }
+    return t > topic.size();
+}
+
+struct Handler {
+    int32_t event_id;
+    esp_event_handler_t fn;
+    void* arg;
+};
+
+struct OutboxEntry {
+    int msg_id;
+    std::string topic;
+    std::string payload;
+    int qos;
+    bool retain;
+    uint16_t alias;
+    bool sent;
+};
+
+struct Action {
+    std::function<void()> run;
+    bool counts;   // Pending work for mqtt_flush (reconnect timers are not)
+};
+
+}  // namespace
+
+// One client: its task thread runs timed actions in order, holding the API
+// lock while it dispatches, like the esp-mqtt task
+struct esp_mqtt_client {
+    std::string uri;
+    std::string client_id;
+    bool clean_session;
+    esp_mqtt_protocol_ver_t protocol_ver;
+    int reconnect_ms;
+    bool auto_reconnect;
+
+    std::recursive_mutex api;
+    std::vector<Handler> handlers;
+    std::atomic<bool> connected{false};   // Also read by the broker
+    bool reconnect_pending = false;
+    int next_msg_id = 1;
+    std::vector<OutboxEntry> outbox;
+    std::map<uint16_t, std::string> aliases;   // This connection's, broker side
+    uint16_t publish_alias = 0;                 // From esp_mqtt5_client_set_publish_property
+
+    std::mutex queue_lock;
+    std::condition_variable queue_changed;
+    std::condition_variable queue_idle;
+    std::multimap<Clock::time_point, Action> queue;
+    int pending = 0;
+    bool running_action = false;
+    bool started = false;
+    bool stopping = false;
+    std::thread task;
+
+    void schedule(uint32_t delay_ms, std::function<void()> run, bool counts = true) {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        queue.emplace(Clock::now() + std::chrono::milliseconds(delay_ms), Action{std::move(run), counts});
+        if (counts) pending++;
+        queue_changed.notify_one();
+    }
+
+    void run_task() {
+        host::set_thread_name("mqtt_task");
+        std::unique_lock<std::mutex> guard(queue_lock);
+        while (!stopping) {
+            if (queue.empty()) {
+                queue_changed.wait(guard);
+                continue;
+            }
+            auto first = queue.begin();
+            if (first->first > Clock::now()) {
+                queue_changed.wait_until(guard, first->first);
+                continue;
+            }
+            Action action = std::move(first->second);
+            queue.erase(first);
+            running_action = true;
+            guard.unlock();
+            {
+                std::lock_guard<std::recursive_mutex> api_guard(api);
+                action.run();
+            }
+            guard.lock();
+            running_action = false;
+            if (action.counts) pending--;
+            if (pending == 0) queue_idle.notify_all();
+        }
+    }
+
+    void dispatch(esp_mqtt_event_t& event) {
+        event.client = this;
+        event.protocol_ver = protocol_ver;
+        for (const Handler& h : handlers) {
+            if (h.event_id == ESP_EVENT_ANY_ID || h.event_id == event.event_id) {
+                h.fn(h.arg, MQTT_EVENTS, event.event_id, &event);
+            }
+        }
+    }
+
+    void dispatch(esp_mqtt_event_id_t id, int msg_id = 0) {
+        esp_mqtt_event_t event = {};
+        event.event_id = id;
+        event.msg_id = msg_id;
+        dispatch(event);
+    }
+
+    int outbox_bytes() {
+        size_t total = 0;
+        for (const OutboxEntry& e : outbox) total += e.topic.size() + e.payload.size() + OUTBOX_OVERHEAD;
+        return (int) total;
+    }
+
+    void connect();
+    void lose_connection(bool reconnect);
+    void send(OutboxEntry& entry);
+    size_t publish_size(const OutboxEntry& entry) const;
+    void acked(int msg_id);
+    void send_queued();
+};
+
+namespace {
+
+struct Session {
+    std::vector<std::string> filters;
+};
+
+struct Broker {
+    std::mutex lock;
+    bool online = true;
+    uint32_t ack_delay_ms = 0;
+    uint32_t connect_delay_ms = 0;
+    bool record = true;
+    std::vector<fake::MqttMessage> published;
+    fake::MqttStats stats = {};
+    std::map<std::string, Session> sessions;
+    std::set<esp_mqtt_client*> clients;
+};
+
+Broker& broker() {
+    static Broker* b = new Broker();
+    return *b;
+}
+
+}  // namespace
+
+// Runs on the client task with the API lock held
+void esp_mqtt_client::connect() {
+    reconnect_pending = false;
+    dispatch(MQTT_EVENT_BEFORE_CONNECT);
+
+    Broker& b = broker();
+    uint32_t delay_ms;
+    {
+        std::lock_guard<std::mutex> guard(b.lock);
+        delay_ms = b.connect_delay_ms;
+    }
+    // Handshake and CONNECT/CONNACK round trip: esp-mqtt's task blocks through them too
+    if (delay_ms) std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+
+    bool online;
+    bool session_present = false;
+    {
+        std::lock_guard<std::mutex> guard(b.lock);
+        online = b.online;
+        if (online) {
+            auto it = b.sessions.find(client_id);
+            session_present = !clean_session && it != b.sessions.end();
+            if (clean_session || it == b.sessions.end()) b.sessions[client_id] = Session();
+            b.stats.connects++;
+            if (session_present) b.stats.sessions_resumed++;
+        }
+    }
+    if (!online) {
+        esp_mqtt_error_codes_t error = {};
+        error.error_type = MQTT_ERROR_TYPE_TCP_TRANSPORT;
+        error.esp_tls_last_esp_err = ESP_FAIL;
+        esp_mqtt_event_t event = {};
+        event.event_id = MQTT_EVENT_ERROR;
+        event.error_handle = &error;
+        dispatch(event);
+        lose_connection(true);
+        return;
+    }
+
+    connected = true;
+    aliases.clear();
+    esp_mqtt_event_t event = {};
+    event.event_id = MQTT_EVENT_CONNECTED;
+    event.session_present = session_present;
+    dispatch(event);
+
+    // Unacknowledged and queued messages go out again on the new connection
+    for (OutboxEntry& e : outbox) e.sent = false;
+    send_queued();
+}
+
+void esp_mqtt_client::lose_connection(bool reconnect) {
+    bool was_connected = connected;
+    connected = false;
+    // A persistent session outlives the connection
+    if (clean_session) {
+        Broker& b = broker();
+        std::lock_guard<std::mutex> guard(b.lock);
+        b.sessions.erase(client_id);
+    }
+    if (was_connected || reconnect) dispatch(MQTT_EVENT_DISCONNECTED);
+    if (reconnect && auto_reconnect && !reconnect_pending) {
+        reconnect_pending = true;
+        schedule(reconnect_ms, [this] { if (!connected) connect(); }, false);
+    }
+}
+
+// Fixed header, topic (empty when sent by alias alone), packet id, properties and payload
+size_t esp_mqtt_client::publish_size(const OutboxEntry& entry) const {
+    auto varint_len = [](size_t n) { return n < 128 ? 1 : n < 16384 ? 2 : n < 2097152 ? 3 : 4; };
+    size_t remaining = 2 + entry.topic.size() + (entry.qos > 0 ? 2 : 0) + entry.payload.size();
+    if (protocol_ver == MQTT_PROTOCOL_V_5) {
+        size_t properties = entry.alias ? 3 : 0;
+        remaining += varint_len(properties) + properties;
+    }
+    return 1 + varint_len(remaining) + remaining;
+}
+
+// Publishes one entry to the broker; caller holds the API lock
+void esp_mqtt_client::send(OutboxEntry& entry) {
+    std::string topic = entry.topic;
+    if (entry.alias) {
+        if (topic.empty()) {
+            auto it = aliases.find(entry.alias);
+            if (it != aliases.end()) topic = it->second;
+        } else {
+            aliases[entry.alias] = topic;
+        }
+    }
+    entry.sent = true;
+
+    Broker& b = broker();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.stats.publishes++;
+    if (b.record) {
+        b.published.push_back({topic, entry.payload, entry.qos, entry.retain, entry.alias, publish_size(entry)});
+    }
+    for (esp_mqtt_client* sub : b.clients) {
+        if (!sub->connected) continue;
+        const Session& session = b.sessions[sub->client_id];
+        for (const std::string& filter : session.filters) {
+            if (!topic_matches(filter, topic)) continue;
+            std::string payload = entry.payload;
+            int qos = entry.qos;
+            sub->schedule(0, [sub, topic, payload, qos] {
+                if (!sub->connected) return;
+                esp_mqtt_event_t event = {};
+                event.event_id = MQTT_EVENT_DATA;
+                event.topic = (char*) topic.data();
+                event.topic_len = (int) topic.size();
+                event.data = (char*) payload.data();
+                event.data_len = event.total_data_len = (int) payload.size();
+                event.qos = qos;
+                sub->dispatch(event);
+            });
+            break;
+        }
+    }
+    if (entry.qos > 0) {
+        int msg_id = entry.msg_id;
+        schedule(b.ack_delay_ms, [this, msg_id] { acked(msg_id); });
+    }
+}
+
+void esp_mqtt_client::acked(int msg_id) {
+    for (size_t i = 0; i < outbox.size(); i++) {
+        if (outbox[i].msg_id != msg_id || !outbox[i].sent) continue;
+        outbox.erase(outbox.begin() + i);
+        if (connected) dispatch(MQTT_EVENT_PUBLISHED, msg_id);
+        return;
+    }
+}
+
+void esp_mqtt_client::send_queued() {
+    for (size_t i = 0; i < outbox.size() && connected;) {
+        if (outbox[i].sent) {
+            i++;
+            continue;
+        }
+        send(outbox[i]);
+        if (outbox[i].qos == 0) outbox.erase(outbox.begin() + i);
+        else i++;
+    }
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t* config) {
+    if (!config) return nullptr;
+    esp_mqtt_client* client = new esp_mqtt_client();
+    client->uri = config->broker.address.uri ? config->broker.address.uri : "";
+    // esp-mqtt's default id is derived from the MAC, so it is stable across restarts
+    client->client_id = config->credentials.client_id ? config->credentials.client_id : "ESP32_host";
+    client->clean_session = !config->session.disable_clean_session;
+    client->protocol_ver = config->session.protocol_ver ? config->session.protocol_ver : MQTT_PROTOCOL_V_3_1_1;
+    client->reconnect_ms = config->network.reconnect_timeout_ms ? config->network.reconnect_timeout_ms
+                                                                 : DEFAULT_RECONNECT_MS;
+    client->auto_reconnect = !config->network.disable_auto_reconnect;
+    Broker& b = broker();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.clients.insert(client);
+    return client;
+}
+
+esp_err_t esp_mqtt_client_set_uri(esp_mqtt_client_handle_t client, const char* uri) {
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    client->uri = uri;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t event_handler, void* event_handler_arg) {
+    if (!client || !event_handler) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    client->handlers.push_back({(int32_t) event, event_handler, event_handler_arg});
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client) {
+    if (!client) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    if (client->started) return ESP_FAIL;
+    if (client->uri.compare(0, 7, "mqtt://") != 0 && client->uri.compare(0, 8, "mqtts://") != 0 &&
+        client->uri.compare(0, 5, "ws://") != 0 && client->uri.compare(0, 6, "wss://") != 0) {
+        return ESP_FAIL;
+    }
+    client->started = true;
+    client->stopping = false;
+    client->task = std::thread([client] { client->run_task(); });
+    client->schedule(0, [client] { client->connect(); });
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client) {
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    if (!client->started || client->connected) return ESP_FAIL;
+    client->schedule(0, [client] { if (!client->connected) client->connect(); });
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client) {
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    if (!client->started) return ESP_FAIL;
+    client->schedule(0, [client] { if (client->connected) client->lose_connection(false); });
+    return ESP_OK;
+}
+
+// Must not be called from the client's own event handler, as on the target
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client) {
+    {
+        std::lock_guard<std::recursive_mutex> guard(client->api);
+        if (!client->started) return ESP_FAIL;
+        if (client->connected) client->lose_connection(false);
+    }
+    {
+        std::lock_guard<std::mutex> guard(client->queue_lock);
+        client->stopping = true;
+        client->queue.clear();
+        client->pending = 0;
+        client->queue_changed.notify_one();
+        client->queue_idle.notify_all();
+    }
+    client->task.join();
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    client->started = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client) {
+    if (!client) return ESP_ERR_INVALID_ARG;
+    if (client->started) esp_mqtt_client_stop(client);
+    {
+        Broker& b = broker();
+        std::lock_guard<std::mutex> guard(b.lock);
+        b.clients.erase(client);
+    }
+    delete client;
+    return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char* topic, int qos) {
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    if (!client->connected) return -1;
+    int msg_id = client->next_msg_id++;
+    Broker& b = broker();
+    {
+        std::lock_guard<std::mutex> broker_guard(b.lock);
+        std::vector<std::string>& filters = b.sessions[client->client_id].filters;
+        if (std::find(filters.begin(), filters.end(), topic) == filters.end()) filters.push_back(topic);
+        b.stats.subscribes++;
+    }
+    client->schedule(b.ack_delay_ms, [client, msg_id] {
+        if (client->connected) client->dispatch(MQTT_EVENT_SUBSCRIBED, msg_id);
+    });
+    return msg_id;
+}
+
+int esp_mqtt_client_unsubscribe(esp_mqtt_client_handle_t client, const char* topic) {
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    if (!client->connected) return -1;
+    int msg_id = client->next_msg_id++;
+    Broker& b = broker();
+    {
+        std::lock_guard<std::mutex> broker_guard(b.lock);
+        std::vector<std::string>& filters = b.sessions[client->client_id].filters;
+        filters.erase(std::remove(filters.begin(), filters.end(), topic), filters.end());
+    }
+    client->schedule(b.ack_delay_ms, [client, msg_id] {
+        if (client->connected) client->dispatch(MQTT_EVENT_UNSUBSCRIBED, msg_id);
+    });
+    return msg_id;
+}
+
+namespace {
+
+// Common part of publish and enqueue: takes the pending publish property,
+// which applies to one message only
+bool make_entry(esp_mqtt_client_handle_t client, const char* topic, const char* data, int len, int qos, int retain,
+                OutboxEntry* entry) {
+    uint16_t alias = client->publish_alias;
+    client->publish_alias = 0;
+    if (alias > BROKER_TOPIC_ALIAS_MAX) return false;
+    if (len <= 0) len = data ? (int) strlen(data) : 0;
+    entry->msg_id = qos > 0 ? client->next_msg_id++ : 0;
+    entry->topic = topic ? topic : "";
+    entry->payload.assign(data ? data : "", len);
+    entry->qos = qos;
+    entry->retain = retain != 0;
+    entry->alias = alias;
+    entry->sent = false;
+    return true;
+}
+
+}  // namespace
+
+// Sent right away on the caller's thread; QoS 1/2 messages stay in the outbox
+// until acknowledged, and are queued there while disconnected
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char* topic, const char* data, int len, int qos,
+                            int retain) {
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    if (!client->connected && qos == 0) {
+        client->publish_alias = 0;
+        return -1;
+    }
+    OutboxEntry entry;
+    if (!make_entry(client, topic, data, len, qos, retain, &entry)) return -1;
+    if (!client->connected) {
+        client->outbox.push_back(std::move(entry));
+        return client->outbox.back().msg_id;
+    }
+    if (qos == 0) {
+        client->send(entry);
+        return 0;
+    }
+    client->outbox.push_back(std::move(entry));
+    client->send(client->outbox.back());
+    return client->outbox.back().msg_id;
+}
+
+// Queued for the client task to send
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client, const char* topic, const char* data, int len, int qos,
+                            int retain, bool store) {
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    if (qos == 0 && !store) {
+        client->publish_alias = 0;
+        return -1;
+    }
+    OutboxEntry entry;
+    if (!make_entry(client, topic, data, len, qos, retain, &entry)) return -1;
+    client->outbox.push_back(std::move(entry));
+    int msg_id = client->outbox.back().msg_id;
+    if (client->connected) client->schedule(0, [client] { client->send_queued(); });
+    return msg_id;
+}
+
+int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t client) {
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    return client->outbox_bytes();
+}
+
+#if CONFIG_MQTT_PROTOCOL_5
+esp_err_t esp_mqtt5_client_set_connect_property(esp_mqtt_client_handle_t client,
+                                                const esp_mqtt5_connection_property_config_t* connect_property) {
+    if (!client || !connect_property) return ESP_ERR_INVALID_ARG;
+    return client->protocol_ver == MQTT_PROTOCOL_V_5 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_mqtt5_client_set_publish_property(esp_mqtt_client_handle_t client,
+                                                const esp_mqtt5_publish_property_config_t* property) {
+    if (!client || !property) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::recursive_mutex> guard(client->api);
+    if (client->protocol_ver != MQTT_PROTOCOL_V_5) return ESP_FAIL;
+    client->publish_alias = property->topic_alias;
+    return ESP_OK;
+}
+#endif
+
+namespace fake {
+
+// Coming back online retries clients waiting out their reconnect delay now
+void mqtt_set_online(bool online) {
+    Broker& b = broker();
+    std::vector<esp_mqtt_client*> clients;
+    {
+        std::lock_guard<std::mutex> guard(b.lock);
+        if (b.online == online) return;
+        b.online = online;
+        clients.assign(b.clients.begin(), b.clients.end());
+    }
+    for (esp_mqtt_client* client : clients) {
+        if (online) {
+            client->schedule(0, [client] { if (!client->connected && client->reconnect_pending) client->connect(); });
+        } else {
+            client->schedule(0, [client] { if (client->connected) client->lose_connection(true); });
+        }
+    }
+}
+
+void mqtt_set_ack_delay_ms(uint32_t ms) {
+    Broker& b = broker();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.ack_delay_ms = ms;
+}
+
+void mqtt_set_connect_delay_ms(uint32_t ms) {
+    Broker& b = broker();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.connect_delay_ms = ms;
+}
+
+void mqtt_record_published(bool record) {
+    Broker& b = broker();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.record = record;
+}
+
+std::vector<MqttMessage> mqtt_published() {
+    Broker& b = broker();
+    std::lock_guard<std::mutex> guard(b.lock);
+    return b.published;
+}
+
+int mqtt_deliver(const std::string& topic, const std::string& payload, size_t chunk) {
+    Broker& b = broker();
+    std::lock_guard<std::mutex> guard(b.lock);
+    int delivered = 0;
+    for (esp_mqtt_client* client : b.clients) {
+        if (!client->connected) continue;
+        const Session& session = b.sessions[client->client_id];
+        bool match = false;
+        for (const std::string& filter : session.filters) match = match || topic_matches(filter, topic);
+        if (!match) continue;
+        delivered++;
+        size_t step = chunk ? chunk : std::max<size_t>(payload.size(), 1);
+        for (size_t offset = 0; offset == 0 || offset < payload.size(); offset += step) {
+            std::string part = payload.substr(offset, step);
+            client->schedule(0, [client, topic, part, offset, total = payload.size()] {
+                if (!client->connected) return;
+                esp_mqtt_event_t event = {};
+                event.event_id = MQTT_EVENT_DATA;
+                // Only the first fragment carries the topic
+                if (offset == 0) {
+                    event.topic = (char*) topic.data();
+                    event.topic_len = (int) topic.size();
+                }
+                event.data = (char*) part.data();
+                event.data_len = (int) part.size();
+                event.total_data_len = (int) total;
+                event.current_data_offset = (int) offset;
+                client->dispatch(event);
+            });
+        }
+    }
+    return delivered;
+}
+
+void mqtt_flush() {
+    Broker& b = broker();
+    std::vector<esp_mqtt_client*> clients;
+    {
+        std::lock_guard<std::mutex> guard(b.lock);
+        clients.assign(b.clients.begin(), b.clients.end());
+    }
+    // An action can schedule more, on any client: repeat until all are idle
+    bool busy = true;
+    while (busy) {
+        busy = false;
+        for (esp_mqtt_client* client : clients) {
+            std::unique_lock<std::mutex> guard(client->queue_lock);
+            if (client->pending == 0 || client->stopping) continue;
+            busy = true;
+            client->queue_idle.wait(guard, [client] { return client->pending == 0 || client->stopping; });
+        }
+    }
+}
+
+MqttStats mqtt_stats() {
+    Broker& b = broker();
+    std::lock_guard<std::mutex> guard(b.lock);
+    return b.stats;
+}
+
+void mqtt_reset() {
+    Broker& b = broker();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.online = true;
+    b.ack_delay_ms = 0;
+    b.connect_delay_ms = 0;
+    b.record = true;
+    b.published.clear();
+    b.stats = {};
+    b.sessions.clear();
+}
+
+}  // namespace fake
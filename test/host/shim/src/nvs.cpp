@@ -0,0 +1,176 @@
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "host_fakes.hpp"
+
+namespace {
+
+enum class Type { BLOB, STR, U32 };
+
+struct Value {
+    Type type;
+    std::vector<uint8_t> bytes;
+};
+
+struct Handle {
+    std::string ns;
+    nvs_open_mode_t mode;
+};
+
+// Committed and uncommitted writes are the same thing here: a power cut is not simulated
+struct Store {
+    std::mutex lock;
+    bool initialized = false;
+    std::map<std::string, std::map<std::string, Value>> spaces;
+    std::map<nvs_handle_t, Handle> handles;
+    nvs_handle_t next_handle = 1;
+};
+
+Store& store() {
+    static Store* s = new Store();
+    return *s;
+}
+
+esp_err_t set(nvs_handle_t handle, const char* key, Type type, const void* data, size_t len) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    auto h = s.handles.find(handle);
+    if (h == s.handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->second.mode == NVS_READONLY) return ESP_ERR_NVS_READ_ONLY;
+    if (!key || strlen(key) > 15) return ESP_ERR_INVALID_ARG;
+    const uint8_t* p = (const uint8_t*) data;
+    s.spaces[h->second.ns][key] = Value{type, std::vector<uint8_t>(p, p + len)};
+    return ESP_OK;
+}
+
+esp_err_t get(nvs_handle_t handle, const char* key, Type type, std::vector<uint8_t>* out) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    auto h = s.handles.find(handle);
+    if (h == s.handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    auto& space = s.spaces[h->second.ns];
+    auto it = space.find(key);
+    if (it == space.end()) return ESP_ERR_NVS_NOT_FOUND;
+    if (it->second.type != type) return ESP_ERR_NVS_TYPE_MISMATCH;
+    *out = it->second.bytes;
+    return ESP_OK;
+}
+
+// Length query when out_value is null, like the IDF getters
+esp_err_t get_sized(nvs_handle_t handle, const char* key, Type type, void* out_value, size_t* length) {
+    std::vector<uint8_t> bytes;
+    esp_err_t err = get(handle, key, type, &bytes);
+    if (err != ESP_OK) return err;
+    if (!out_value) {
+        *length = bytes.size();
+        return ESP_OK;
+    }
+    if (*length < bytes.size()) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(out_value, bytes.data(), bytes.size());
+    *length = bytes.size();
+    return ESP_OK;
+}
+
+}  // namespace
+
+esp_err_t nvs_flash_init(void) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.spaces.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_deinit(void) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.initialized = false;
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    if (!s.initialized) return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (!name || strlen(name) > 15) return ESP_ERR_INVALID_ARG;
+    // Opening a namespace that was never written fails read-only, as on the target
+    if (open_mode == NVS_READONLY && !s.spaces.count(name)) return ESP_ERR_NVS_NOT_FOUND;
+    nvs_handle_t handle = s.next_handle++;
+    s.handles[handle] = Handle{name, open_mode};
+    *out_handle = handle;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.handles.count(handle) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    auto h = s.handles.find(handle);
+    if (h == s.handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->second.mode == NVS_READONLY) return ESP_ERR_NVS_READ_ONLY;
+    return s.spaces[h->second.ns].erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    Store& s = store();
+    std::lock_guard<std::mutex> guard(s.lock);
+    auto h = s.handles.find(handle);
+    if (h == s.handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->second.mode == NVS_READONLY) return ESP_ERR_NVS_READ_ONLY;
+    s.spaces[h->second.ns].clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    return set(handle, key, Type::BLOB, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    return get_sized(handle, key, Type::BLOB, out_value, length);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    return set(handle, key, Type::STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    return get_sized(handle, key, Type::STR, out_value, length);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+    return set(handle, key, Type::U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value) {
+    size_t len = sizeof(*out_value);
+    return get_sized(handle, key, Type::U32, out_value, &len);
+}
+
+namespace fake {
+
+void nvs_erase_all() {
+    nvs_flash_erase();
+}
+
+}  // namespace fake
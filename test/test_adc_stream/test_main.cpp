@@ -0,0 +1,167 @@
+#include <unity.h>
+#ifndef ESP_PLATFORM
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "host_fakes.hpp"
+#include "esp_timer.h"
+#include "AdcStream.hpp"
+
+static const adc_channel_t CHANNELS[] = {ADC_CHANNEL_6, ADC_CHANNEL_7};
+static const uint32_t RATE_HZ = 20000;
+static const size_t FRAME = 64;   // Samples per DMA frame in AdcStream
+
+static bool wait_for(const std::function<bool()>& condition, int timeout_ms = 2000) {
+    for (int i = 0; i < timeout_ms; i++) {
+        if (condition()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+
+// count result words alternating over CHANNELS, values first, first + 1, ...
+static std::vector<adc_digi_output_data_t> words(size_t count, uint16_t first = 0) {
+    std::vector<adc_digi_output_data_t> out(count);
+    for (size_t i = 0; i < count; i++) {
+        out[i].val = 0;
+        out[i].type1.channel = CHANNELS[i % 2];
+        out[i].type1.data = (uint16_t) ((first + i) & 0xFFF);
+    }
+    return out;
+}
+
+static size_t feed(size_t count, uint16_t first = 0) {
+    std::vector<adc_digi_output_data_t> w = words(count, first);
+    return fake::adc_continuous_feed(w.data(), w.size());
+}
+
+static size_t read_exactly(AdcStream& stream, adc_sample_t* out, size_t count) {
+    size_t got = 0;
+    for (int tries = 0; got < count && tries < 200; tries++) {
+        got += stream.read(out + got, count - got, pdMS_TO_TICKS(10));
+    }
+    return got;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// One frame is one block: samples keep channel and value, and are stamped one
+// sample period apart, ending at the time the worker read the frame
+void test_block_timestamps_step_by_sample_period() {
+    AdcStream stream(CHANNELS, 2, RATE_HZ);
+    TEST_ASSERT_EQUAL(ESP_OK, stream.start());
+
+    int64_t before = esp_timer_get_time();
+    TEST_ASSERT_EQUAL_size_t(FRAME, feed(FRAME, 100));
+    adc_sample_t samples[FRAME];
+    TEST_ASSERT_EQUAL_size_t(FRAME, read_exactly(stream, samples, FRAME));
+    int64_t after = esp_timer_get_time();
+
+    const int64_t period_us = 1000000 / RATE_HZ;
+    for (size_t i = 0; i < FRAME; i++) {
+        TEST_ASSERT_EQUAL_UINT8(CHANNELS[i % 2], samples[i].channel);
+        TEST_ASSERT_EQUAL_UINT16(100 + i, samples[i].value);
+        if (i > 0) TEST_ASSERT_EQUAL_INT64(period_us, samples[i].timestamp_us - samples[i - 1].timestamp_us);
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(before, samples[FRAME - 1].timestamp_us);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(after, samples[FRAME - 1].timestamp_us);
+    TEST_ASSERT_EQUAL_UINT32(0, stream.ring_overruns());
+    TEST_ASSERT_EQUAL_UINT32(0, stream.driver_overruns());
+}
+
+// Nobody reads: the ring keeps the oldest samples and counts each one it refuses
+void test_full_ring_counts_refused_samples() {
+    AdcStream stream(CHANNELS, 2, RATE_HZ, FRAME);
+    TEST_ASSERT_EQUAL(ESP_OK, stream.start());
+
+    for (size_t f = 0; f < 4; f++) {
+        TEST_ASSERT_EQUAL_size_t(FRAME, feed(FRAME, (uint16_t) (f * FRAME)));
+        // One frame at a time, so the driver pool never overflows
+        TEST_ASSERT_TRUE(wait_for([&] { return stream.available() + stream.ring_overruns() == (f + 1) * FRAME; }));
+    }
+    TEST_ASSERT_EQUAL_UINT32(3 * FRAME, stream.ring_overruns());
+    TEST_ASSERT_EQUAL_UINT32(0, stream.driver_overruns());
+
+    adc_sample_t samples[FRAME];
+    TEST_ASSERT_EQUAL_size_t(FRAME, stream.read(samples, FRAME, 0));
+    for (size_t i = 0; i < FRAME; i++) TEST_ASSERT_EQUAL_UINT16(i, samples[i].value);
+}
+
+// Frames arriving faster than the worker drains them overflow the driver pool:
+// every fed sample is then read, refused by the ring, or counted as lost in a frame
+void test_driver_overflow_accounts_for_every_sample() {
+    const size_t FRAMES = 2000;
+    AdcStream stream(CHANNELS, 2, RATE_HZ, FRAMES * FRAME);
+    TEST_ASSERT_EQUAL(ESP_OK, stream.start());
+
+    size_t taken = feed(FRAMES * FRAME);
+    TEST_ASSERT_TRUE(wait_for([&] { return stream.available() == taken; }));
+
+    TEST_ASSERT_GREATER_THAN_UINT32(0, stream.driver_overruns());
+    TEST_ASSERT_EQUAL_size_t(FRAMES * FRAME - taken, stream.driver_overruns() * FRAME);
+    TEST_ASSERT_EQUAL_UINT32(0, stream.ring_overruns());
+
+    // Lost frames leave gaps, never partial frames or reordering
+    std::vector<adc_sample_t> samples(taken);
+    TEST_ASSERT_EQUAL_size_t(taken, stream.read(samples.data(), taken, 0));
+    for (size_t i = 1; i < taken; i++) {
+        uint16_t step = (uint16_t) ((samples[i].value - samples[i - 1].value) & 0xFFF);
+        if (i % FRAME) TEST_ASSERT_EQUAL_UINT16(1, step);
+        else TEST_ASSERT_EQUAL_UINT16(0, (samples[i].value) % FRAME);
+    }
+}
+
+// Stopped, the driver takes nothing; started again, the same worker carries on
+void test_stop_and_restart() {
+    AdcStream stream(CHANNELS, 2, RATE_HZ);
+    adc_sample_t samples[FRAME];
+    TEST_ASSERT_EQUAL(ESP_OK, stream.start());
+    TEST_ASSERT_EQUAL(ESP_OK, stream.start());
+    TEST_ASSERT_EQUAL_size_t(FRAME, feed(FRAME));
+    TEST_ASSERT_EQUAL_size_t(FRAME, read_exactly(stream, samples, FRAME));
+
+    TEST_ASSERT_EQUAL(ESP_OK, stream.stop());
+    TEST_ASSERT_EQUAL(ESP_OK, stream.stop());
+    TEST_ASSERT_EQUAL_size_t(0, feed(FRAME));
+    TEST_ASSERT_EQUAL_size_t(0, stream.read(samples, FRAME, pdMS_TO_TICKS(20)));
+
+    TEST_ASSERT_EQUAL(ESP_OK, stream.start());
+    TEST_ASSERT_EQUAL_size_t(FRAME, feed(FRAME, 500));
+    TEST_ASSERT_EQUAL_size_t(FRAME, read_exactly(stream, samples, FRAME));
+    TEST_ASSERT_EQUAL_UINT16(500, samples[0].value);
+    TEST_ASSERT_EQUAL_UINT16(500 + FRAME - 1, samples[FRAME - 1].value);
+}
+
+// Destroying a stream mid-flow joins the worker and frees the driver, so the
+// next stream can take the (single) continuous unit
+void test_destroy_while_streaming() {
+    for (int i = 0; i < 50; i++) {
+        AdcStream stream(CHANNELS, 2, RATE_HZ);
+        TEST_ASSERT_EQUAL(ESP_OK, stream.start());
+        feed(8 * FRAME);
+    }
+    AdcStream last(CHANNELS, 2, RATE_HZ);
+    TEST_ASSERT_EQUAL(ESP_OK, last.start());
+    TEST_ASSERT_EQUAL_size_t(FRAME, feed(FRAME));
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_block_timestamps_step_by_sample_period);
+    RUN_TEST(test_full_ring_counts_refused_samples);
+    RUN_TEST(test_driver_overflow_accounts_for_every_sample);
+    RUN_TEST(test_stop_and_restart);
+    RUN_TEST(test_destroy_while_streaming);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,285 @@
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DlogFormat.hpp"
+#include "DlogRing.hpp"
+
+static const char* TAG = "TEST";
+static const char* OTHER_TAG = "MQTT";
+
+static constexpr dlog_site_t SEQ_SITE = {dlog_hash("w%d #%u"), DLOG_LEVEL_INFO, &TAG, "w%d #%u"};
+static constexpr dlog_site_t STR_SITE = {dlog_hash("%s -> %s (%d)"), DLOG_LEVEL_WARN, &OTHER_TAG,
+                                         "%s -> %s (%d)"};
+
+static std::string render(const dlog_record_t& rec) {
+    char out[256];
+    size_t n = dlog_render(rec.site->fmt, rec.words, rec.nwords, rec.types, out, sizeof(out));
+    return std::string(out, n);
+}
+
+// Records a call through the same encoding a ring uses, then renders it
+template <typename... Args>
+static std::string via_record(const char* fmt, const Args&... args) {
+    dlog_site_t site = {0, DLOG_LEVEL_INFO, &TAG, fmt};
+    dlog_record_t rec;
+    TEST_ASSERT_TRUE(dlog_record(&rec, &site, 0, args...));
+    char out[256];
+    size_t n = dlog_render(fmt, rec.words, rec.nwords, rec.types, out, sizeof(out));
+    return std::string(out, n);
+}
+
+template <typename... Args>
+static void check_like_snprintf(const char* fmt, const Args&... args) {
+    char expected[256];
+    snprintf(expected, sizeof(expected), fmt, args...);
+    TEST_ASSERT_EQUAL_STRING(expected, via_record(fmt, args...).c_str());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ---- Ring ----
+
+void test_write_read_one_record() {
+    DlogRing ring(256);
+    TEST_ASSERT_TRUE(ring.write(&STR_SITE, 1234, "broker", dlog_str(std::string_view("topic/abcdef", 5)), -7));
+    dlog_record_t rec;
+    TEST_ASSERT_TRUE(ring.read(&rec));
+    TEST_ASSERT_TRUE(rec.site == &STR_SITE);
+    TEST_ASSERT_EQUAL_UINT32(1234, rec.time_us);
+    TEST_ASSERT_EQUAL_STRING("broker -> topic (-7)", render(rec).c_str());
+    TEST_ASSERT_FALSE(ring.read(&rec));
+    TEST_ASSERT_EQUAL_UINT32(1, ring.stats().read);
+}
+
+// A full ring refuses and counts; the space comes back once the reader catches up.
+// A record with more argument words than DLOG_MAX_RECORD_WORDS is refused outright.
+void test_full_ring_and_oversized_records_dropped() {
+    DlogRing ring(128);
+    TEST_ASSERT_EQUAL_UINT32(128, ring.stats().capacity_words);
+    int written = 0;
+    while (ring.write(&SEQ_SITE, 0, written, (unsigned) written)) written++;
+    TEST_ASSERT_EQUAL_INT(128 / (DLOG_HEADER_WORDS + 2), written);
+    TEST_ASSERT_EQUAL_UINT32(1, ring.stats().dropped);
+
+    dlog_record_t rec;
+    TEST_ASSERT_TRUE(ring.read(&rec));
+    TEST_ASSERT_EQUAL_STRING("w0 #0", render(rec).c_str());
+    TEST_ASSERT_TRUE(ring.write(&SEQ_SITE, 0, 99, 99u));
+    for (int i = 1; i < written; i++) TEST_ASSERT_TRUE(ring.read(&rec));
+    TEST_ASSERT_TRUE(ring.read(&rec));
+    TEST_ASSERT_EQUAL_STRING("w99 #99", render(rec).c_str());
+    TEST_ASSERT_EQUAL_UINT32(written, ring.stats().peak_words / (DLOG_HEADER_WORDS + 2));
+
+    // Eight 64-byte strings are 8 x 17 words
+    DlogRing big(4096);
+    const char* s = "0123456789012345678901234567890123456789012345678901234567890123";
+    TEST_ASSERT_FALSE(big.write(&STR_SITE, 0, s, s, s, s, s, s, s, s));
+    TEST_ASSERT_EQUAL_UINT32(1, big.stats().dropped);
+    TEST_ASSERT_FALSE(big.read(&rec));
+}
+
+// Four writers and a concurrent reader: every record is read or counted as
+// dropped, arrives intact, and each writer's records stay in its own order
+void test_multi_producer() {
+    static const int WRITERS = 4;
+    static const int RECORDS = 50000;
+    DlogRing ring(1024);
+    std::atomic<int> done{0};
+    std::atomic<uint32_t> refused{0};
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < WRITERS; w++) {
+        writers.emplace_back([&, w] {
+            for (int i = 0; i < RECORDS; i++) {
+                bool ok = (i % 3 == 0) ? ring.write(&STR_SITE, (uint32_t) i, "writer", "x", w * RECORDS + i)
+                                       : ring.write(&SEQ_SITE, (uint32_t) i, w, (unsigned) i);
+                if (!ok) refused++;
+                if (i % 64 == 0) std::this_thread::yield();
+            }
+            done++;
+        });
+    }
+
+    int last[WRITERS];
+    for (int& l : last) l = -1;
+    uint32_t read = 0;
+    int bad = 0;
+    dlog_record_t rec;
+    while (true) {
+        bool finished = done.load() == WRITERS;
+        if (!ring.read(&rec)) {
+            if (finished) break;
+            std::this_thread::yield();
+            continue;
+        }
+        read++;
+        int w, i;
+        if (rec.site == &SEQ_SITE) {
+            unsigned u;
+            char tail;
+            if (sscanf(render(rec).c_str(), "w%d #%u%c", &w, &u, &tail) != 2) {
+                bad++;
+                continue;
+            }
+            i = (int) u;
+        } else if (rec.site == &STR_SITE) {
+            int v;
+            if (sscanf(render(rec).c_str(), "writer -> x (%d)", &v) != 1) {
+                bad++;
+                continue;
+            }
+            w = v / RECORDS;
+            i = v % RECORDS;
+        } else {
+            bad++;
+            continue;
+        }
+        if (w < 0 || w >= WRITERS || i <= last[w] || rec.time_us != (uint32_t) i) bad++;
+        else last[w] = i;
+    }
+    for (auto& t : writers) t.join();
+
+    TEST_ASSERT_EQUAL_INT(0, bad);
+    dlog_ring_stats_t s = ring.stats();
+    TEST_ASSERT_EQUAL_UINT32(read, s.read);
+    TEST_ASSERT_EQUAL_UINT32(refused.load(), s.dropped);
+    TEST_ASSERT_EQUAL_UINT32(WRITERS * RECORDS, read + s.dropped);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(s.capacity_words, s.peak_words);
+}
+
+// ---- Rendering ----
+
+void test_render_matches_snprintf() {
+    check_like_snprintf("plain text, no conversions");
+    check_like_snprintf("%d %i %u", -42, 17, 4000000000u);
+    check_like_snprintf("[%5d|%-5d|%05d|%+d|% d]", 42, 42, 42, 42, 42);
+    check_like_snprintf("%x %X %#x %o %08lx", 0xbeefu, 0xbeefu, 255u, 8u, (unsigned long) 0xabcdef);
+    check_like_snprintf("%lld %llu", (long long) -9000000000LL, (unsigned long long) 18000000000ULL);
+    check_like_snprintf("%f %.2f %10.3f %e %g %G", 3.14159, 2.5, -1.0 / 3, 12345.678, 0.0001, 1e20);
+    check_like_snprintf("%s|%10s|%-10s|%.3s", "abc", "right", "left", "truncated");
+    check_like_snprintf("%c%c%c", 'o', 'k', '!');
+    check_like_snprintf("%*d|%-*d|%.*f", 6, 7, 4, 8, 2, 1.23456);
+    check_like_snprintf("100%% %s", "done");
+    check_like_snprintf("%p", (void*) 0x1234);
+}
+
+// Where printf would misread an argument, the recorded type wins
+void test_render_uses_recorded_types() {
+    TEST_ASSERT_EQUAL_STRING("2", via_record("%d", 2.7).c_str());
+    TEST_ASSERT_EQUAL_STRING("5.000000", via_record("%f", 5).c_str());
+    TEST_ASSERT_EQUAL_STRING("-1", via_record("%ld", (int8_t) -1).c_str());
+    TEST_ASSERT_EQUAL_STRING("x=(?)", via_record("x=%d").c_str());
+    TEST_ASSERT_EQUAL_STRING("(null)", via_record("%s", (const char*) nullptr).c_str());
+
+    std::string longer(100, 'z');
+    TEST_ASSERT_EQUAL_STRING(std::string(DLOG_MAX_STR, 'z').c_str(), via_record("%s", longer.c_str()).c_str());
+
+    // Output is cut to the buffer, always terminated
+    dlog_site_t site = {0, DLOG_LEVEL_INFO, &TAG, "%s and more"};
+    dlog_record_t rec;
+    dlog_record(&rec, &site, 0, "0123456789");
+    char out[8];
+    TEST_ASSERT_EQUAL_size_t(7, dlog_render(site.fmt, rec.words, rec.nwords, rec.types, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("0123456", out);
+}
+
+// ---- Binary export and decoding ----
+
+struct Lines {
+    std::vector<std::string> lines;
+
+    static void add(const char* line, size_t len, void* ctx) {
+        ((Lines*) ctx)->lines.push_back(std::string(line, len));
+    }
+};
+
+static void frame(const dlog_site_t* site, uint32_t time_ms, std::vector<uint8_t>& out, bool dict,
+                    const dlog_record_t& rec) {
+    uint8_t buf[512];
+    size_t n = 0;
+    if (dict) n = dlog_encode_dict(site, buf, sizeof(buf));
+    n += dlog_encode_record(rec, time_ms, buf + n, sizeof(buf) - n);
+    out.insert(out.end(), buf, buf + n);
+}
+
+// Frames from a ring decode to the lines the device would have printed, even
+// when the stream is fed in pieces that split frames
+void test_decoder_round_trip() {
+    DlogRing ring(512);
+    ring.write(&SEQ_SITE, 0, 3, 4u);
+    ring.write(&STR_SITE, 0, "a", "b", 1);
+    ring.write(&SEQ_SITE, 0, -1, 0u);
+
+    std::vector<uint8_t> stream;
+    dlog_record_t rec;
+    uint32_t time_ms = 1000;
+    bool announced_seq = false, announced_str = false;
+    while (ring.read(&rec)) {
+        bool& announced = rec.site == &SEQ_SITE ? announced_seq : announced_str;
+        frame(rec.site, time_ms++, stream, !announced, rec);
+        announced = true;
+    }
+
+    std::vector<std::string> expected = {"I (1000) TEST: w3 #4", "W (1001) MQTT: a -> b (1)",
+                                         "I (1002) TEST: w-1 #0"};
+    for (size_t step : {stream.size(), (size_t) 1, (size_t) 5, (size_t) 13}) {
+        DlogDecoder decoder;
+        Lines out;
+        std::vector<uint8_t> pending;
+        for (size_t off = 0; off < stream.size(); off += step) {
+            pending.insert(pending.end(), stream.begin() + off, stream.begin() + std::min(off + step, stream.size()));
+            size_t used = decoder.decode(pending.data(), pending.size(), Lines::add, &out);
+            pending.erase(pending.begin(), pending.begin() + used);
+        }
+        TEST_ASSERT_EQUAL_size_t(0, pending.size());
+        TEST_ASSERT_EQUAL_size_t(expected.size(), out.lines.size());
+        for (size_t i = 0; i < expected.size(); i++) TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), out.lines[i].c_str());
+        TEST_ASSERT_EQUAL_size_t(0, decoder.unknown());
+    }
+}
+
+// A record whose dictionary frame was missed is skipped and counted; a frame
+// the decoder does not know stops it without being consumed
+void test_decoder_missing_dictionary_and_garbage() {
+    dlog_record_t rec;
+    dlog_record(&rec, &SEQ_SITE, 0, 1, 2u);
+    std::vector<uint8_t> stream;
+    frame(&SEQ_SITE, 5, stream, false, rec);
+    frame(&SEQ_SITE, 6, stream, true, rec);
+    stream.push_back('X');
+
+    DlogDecoder decoder;
+    Lines out;
+    TEST_ASSERT_EQUAL_size_t(stream.size() - 1, decoder.decode(stream.data(), stream.size(), Lines::add, &out));
+    TEST_ASSERT_EQUAL_size_t(1, decoder.unknown());
+    TEST_ASSERT_EQUAL_size_t(1, out.lines.size());
+    TEST_ASSERT_EQUAL_STRING("I (6) TEST: w1 #2", out.lines[0].c_str());
+
+    // A frame that does not fit the caller's buffer is refused
+    uint8_t buf[16];
+    TEST_ASSERT_EQUAL_size_t(0, dlog_encode_record(rec, 0, buf, sizeof(buf)));
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_write_read_one_record);
+    RUN_TEST(test_full_ring_and_oversized_records_dropped);
+    RUN_TEST(test_multi_producer);
+    RUN_TEST(test_render_matches_snprintf);
+    RUN_TEST(test_render_uses_recorded_types);
+    RUN_TEST(test_decoder_round_trip);
+    RUN_TEST(test_decoder_missing_dictionary_and_garbage);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,212 @@
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "DiagHistogram.hpp"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bucket_boundaries() {
+    TEST_ASSERT_EQUAL_size_t(0, diag_hist_bucket(0));
+    TEST_ASSERT_EQUAL_size_t(1, diag_hist_bucket(1));
+    TEST_ASSERT_EQUAL_size_t(2, diag_hist_bucket(2));
+    TEST_ASSERT_EQUAL_size_t(2, diag_hist_bucket(3));
+    TEST_ASSERT_EQUAL_size_t(10, diag_hist_bucket(1023));
+    TEST_ASSERT_EQUAL_size_t(11, diag_hist_bucket(1024));
+    TEST_ASSERT_EQUAL_size_t(32, diag_hist_bucket(UINT32_MAX));
+}
+
+// Percentiles are the upper bound of the bucket holding the rank, clamped to
+// the observed min and max
+void test_percentiles() {
+    DiagHistogram h;
+    diag_hist_snapshot_t empty = h.snapshot();
+    TEST_ASSERT_EQUAL_UINT32(0, empty.count);
+    TEST_ASSERT_EQUAL_UINT32(0, diag_hist_percentile(empty, 0.5f));
+
+    for (uint32_t v = 1; v <= 1000; v++) h.record(v);
+    diag_hist_snapshot_t s = h.snapshot();
+    TEST_ASSERT_EQUAL_UINT32(1000, s.count);
+    TEST_ASSERT_EQUAL_UINT32(500500, s.sum);
+    TEST_ASSERT_EQUAL_UINT32(1, s.min);
+    TEST_ASSERT_EQUAL_UINT32(1000, s.max);
+    TEST_ASSERT_EQUAL_UINT32(1, diag_hist_percentile(s, 0.001f));
+    TEST_ASSERT_EQUAL_UINT32(511, diag_hist_percentile(s, 0.5f));
+    TEST_ASSERT_EQUAL_UINT32(1000, diag_hist_percentile(s, 0.9f));
+    TEST_ASSERT_EQUAL_UINT32(1000, diag_hist_percentile(s, 1.0f));
+
+    // A tail: 990 fast samples and 10 slow ones
+    for (int i = 0; i < 990; i++) h.record(40);
+    for (int i = 0; i < 10; i++) h.record(5000);
+    s = h.snapshot();
+    TEST_ASSERT_EQUAL_UINT32(63, diag_hist_percentile(s, 0.5f));
+    TEST_ASSERT_EQUAL_UINT32(63, diag_hist_percentile(s, 0.99f));
+    TEST_ASSERT_EQUAL_UINT32(5000, diag_hist_percentile(s, 0.995f));
+
+    // One value: every percentile is that value
+    h.record(700);
+    s = h.snapshot();
+    TEST_ASSERT_EQUAL_UINT32(700, diag_hist_percentile(s, 0.01f));
+    TEST_ASSERT_EQUAL_UINT32(700, diag_hist_percentile(s, 0.99f));
+
+    h.record(0);
+    h.record(0);
+    h.record(UINT32_MAX);
+    s = h.snapshot();
+    TEST_ASSERT_EQUAL_UINT32(0, diag_hist_percentile(s, 0.5f));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, diag_hist_percentile(s, 1.0f));
+}
+
+void test_snapshot_reset_and_json() {
+    DiagHistogram h;
+    h.record_us(-5);
+    h.record_us(10);
+    h.record_us(20);
+    h.record_us(30);
+    h.record_us((int64_t) UINT32_MAX + 100);
+
+    diag_hist_snapshot_t kept = h.snapshot(false);
+    TEST_ASSERT_EQUAL_UINT32(5, kept.count);
+    TEST_ASSERT_EQUAL_UINT32(0, kept.min);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, kept.max);
+    TEST_ASSERT_EQUAL_UINT32(5, h.snapshot(true).count);
+
+    diag_hist_snapshot_t next = h.snapshot();
+    TEST_ASSERT_EQUAL_UINT32(0, next.count);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, next.min);
+    TEST_ASSERT_EQUAL_UINT32(0, next.max);
+
+    h.record(10);
+    h.record(20);
+    h.record(30);
+    diag_hist_snapshot_t s = h.snapshot();
+    char buf[128];
+    size_t n = diag_hist_json(s, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("{\"n\":3,\"mean\":20,\"min\":10,\"p50\":30,\"p90\":30,\"p99\":30,\"max\":30}", buf);
+    TEST_ASSERT_EQUAL_size_t(strlen(buf), n);
+    TEST_ASSERT_EQUAL_size_t(0, diag_hist_json(s, buf, 20));
+
+    diag_hist_json(next, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("{\"n\":0,\"mean\":0,\"min\":0,\"p50\":0,\"p90\":0,\"p99\":0,\"max\":0}", buf);
+}
+
+// Four tasks record while a fifth takes interval snapshots: no sample is lost
+// or counted twice, and the intervals' buckets add up to their counts
+void test_concurrent_record() {
+    static const int THREADS = 4;
+    static const uint32_t SAMPLES = 100000;
+    DiagHistogram h;
+    std::atomic<int> done{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t] {
+            for (uint32_t i = 0; i < SAMPLES; i++) {
+                h.record((i % 1000) + (uint32_t) t);
+                if (i % 256 == 0) std::this_thread::yield();
+            }
+            done++;
+        });
+    }
+
+    uint64_t count = 0;
+    uint64_t bucket_total = 0;
+    uint32_t min = UINT32_MAX, max = 0;
+    auto take = [&] {
+        diag_hist_snapshot_t s = h.snapshot();
+        count += s.count;
+        for (uint32_t b : s.buckets) bucket_total += b;
+        if (s.min < min) min = s.min;
+        if (s.max > max) max = s.max;
+    };
+    while (done.load() < THREADS) {
+        take();
+        std::this_thread::yield();
+    }
+    for (auto& t : threads) t.join();
+    take();
+
+    TEST_ASSERT_EQUAL_UINT32(THREADS * SAMPLES, (uint32_t) count);
+    TEST_ASSERT_EQUAL_UINT32(THREADS * SAMPLES, (uint32_t) bucket_total);
+    TEST_ASSERT_EQUAL_UINT32(0, min);
+    TEST_ASSERT_EQUAL_UINT32(999 + THREADS - 1, max);
+
+    // Without interval resets the sum is exact too
+    DiagHistogram whole;
+    threads.clear();
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&] {
+            for (uint32_t i = 0; i < SAMPLES; i++) whole.record(i % 100);
+        });
+    }
+    for (auto& t : threads) t.join();
+    diag_hist_snapshot_t s = whole.snapshot();
+    TEST_ASSERT_EQUAL_UINT32(THREADS * SAMPLES, s.count);
+    TEST_ASSERT_EQUAL_UINT32(THREADS * (SAMPLES / 100) * 4950, s.sum);
+    TEST_ASSERT_EQUAL_UINT32(THREADS * (SAMPLES / 100), s.buckets[0]);
+}
+
+void test_counter() {
+    DiagCounter c;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 50000; i++) c.add();
+        });
+    }
+    for (auto& t : threads) t.join();
+    TEST_ASSERT_EQUAL_UINT32(200000, c.value());
+    TEST_ASSERT_EQUAL_UINT32(200000, c.take());
+    TEST_ASSERT_EQUAL_UINT32(0, c.take());
+}
+
+// Tasks are matched by id across samples; a new task counts from 0 and a
+// deleted one simply disappears
+void test_cpu_share() {
+    DiagCpuShare share;
+    uint8_t pct[3];
+    const uint32_t ids1[] = {1, 2};
+    const uint32_t run1[] = {100, 300};
+    share.update(ids1, run1, 2, 1000, 1, pct);
+    TEST_ASSERT_EQUAL_UINT8(10, pct[0]);
+    TEST_ASSERT_EQUAL_UINT8(30, pct[1]);
+
+    const uint32_t ids2[] = {2, 3, 1};
+    const uint32_t run2[] = {800, 250, 100};
+    share.update(ids2, run2, 3, 2000, 2, pct);
+    TEST_ASSERT_EQUAL_UINT8(25, pct[0]);
+    TEST_ASSERT_EQUAL_UINT8(13, pct[1]);
+    TEST_ASSERT_EQUAL_UINT8(0, pct[2]);
+
+    const uint32_t ids3[] = {2};
+    const uint32_t run3[] = {1300};
+    share.update(ids3, run3, 1, 2000 + 1000, 1, pct);
+    TEST_ASSERT_EQUAL_UINT8(50, pct[0]);
+
+    // Counters wrapping between samples still give the delta
+    DiagCpuShare wrapping;
+    const uint32_t before[] = {0xFFFFFF80u};
+    wrapping.update(ids3, before, 1, 0xFFFFFF00u, 1, pct);
+    const uint32_t after[] = {0xFFFFFF80u + 500};
+    wrapping.update(ids3, after, 1, 0xFFFFFF00u + 1000, 1, pct);
+    TEST_ASSERT_EQUAL_UINT8(50, pct[0]);
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_boundaries);
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_snapshot_reset_and_json);
+    RUN_TEST(test_concurrent_record);
+    RUN_TEST(test_counter);
+    RUN_TEST(test_cpu_share);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
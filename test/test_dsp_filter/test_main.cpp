@@ -0,0 +1,142 @@
+#include <unity.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "DspFilter.hpp"
+
+static const size_t SIGNAL = 2000;
+
+// Noisy ramp and sine with occasional spikes and a few full-scale excursions,
+// so saturation and the median's spike rejection are exercised too
+template <typename T>
+static std::vector<T> make_signal() {
+    std::vector<T> s(SIGNAL);
+    uint32_t state = 2463534242u;
+    for (size_t i = 0; i < SIGNAL; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        double v = 2000.0 * sin((double) i * 0.03) + (double) (i % 400) + (double) (state % 64) - 32.0;
+        if (i % 97 == 0) v += 9000.0;
+        if (i >= 1500 && i < 1520) v = (i & 1) ? 32767.0 : -32768.0;
+        if constexpr (std::is_same_v<T, q31_t>) v *= 30000.0;
+        s[i] = (T) v;
+    }
+    return s;
+}
+
+// Block sizes to split the signal into: single samples, empty calls, odd and
+// large blocks, cycled until the signal is used up
+static const size_t SPLITS[] = {1, 0, 7, 1, 64, 3, 255, 0, 16, 500, 2, 31};
+
+// Feeds the whole signal in one call to one filter and in uneven blocks to an
+// identical one; the outputs must match sample for sample
+template <typename T, typename F>
+static void check_split(F whole, F split) {
+    std::vector<T> in = make_signal<T>();
+    std::vector<T> expected(SIGNAL);
+    size_t expected_n = whole.process(in.data(), expected.data(), SIGNAL);
+
+    std::vector<T> got(SIGNAL);
+    size_t pos = 0;
+    size_t got_n = 0;
+    for (size_t k = 0; pos < SIGNAL; k++) {
+        size_t n = SPLITS[k % (sizeof(SPLITS) / sizeof(SPLITS[0]))];
+        if (n > SIGNAL - pos) n = SIGNAL - pos;
+        got_n += split.process(in.data() + pos, got.data() + got_n, n);
+        pos += n;
+    }
+
+    TEST_ASSERT_EQUAL_size_t(expected_n, got_n);
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), got.data(), expected_n * sizeof(T));
+
+    // After reset() the filter starts over exactly like a new one
+    split.reset();
+    F fresh = split;
+    std::vector<T> again(SIGNAL);
+    TEST_ASSERT_EQUAL_size_t(expected_n, fresh.process(in.data(), again.data(), SIGNAL));
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), again.data(), expected_n * sizeof(T));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_moving_average_split() {
+    check_split<int16_t>(MovingAverage<int16_t, 16>(), MovingAverage<int16_t, 16>());
+    check_split<int32_t>(MovingAverage<int32_t, 5>(), MovingAverage<int32_t, 5>());
+    check_split<float>(MovingAverage<float, 8>(), MovingAverage<float, 8>());
+}
+
+void test_median_split() {
+    check_split<int16_t>(MedianFilter<int16_t, 5>(), MedianFilter<int16_t, 5>());
+    check_split<int16_t>(MedianFilter<int16_t, 31>(), MedianFilter<int16_t, 31>());
+    check_split<float>(MedianFilter<float, 3>(), MedianFilter<float, 3>());
+}
+
+void test_biquad_split() {
+    BiquadCoeffs lowpass = BiquadCoeffs::lowpass(20.0f, 1000.0f);
+    BiquadCoeffs highpass = BiquadCoeffs::highpass(5.0f, 1000.0f, 2.0f);
+    check_split<q15_t>(BiquadQ15(lowpass), BiquadQ15(lowpass));
+    check_split<q15_t>(BiquadQ15(highpass), BiquadQ15(highpass));
+    check_split<q31_t>(BiquadQ31(lowpass), BiquadQ31(lowpass));
+    check_split<float>(BiquadF32(lowpass), BiquadF32(lowpass));
+}
+
+void test_decimator_split() {
+    check_split<int16_t>(Decimator<int16_t, 4>(), Decimator<int16_t, 4>());
+    check_split<int16_t>(Decimator<int16_t, 7>(), Decimator<int16_t, 7>());
+    check_split<float>(Decimator<float, 3>(), Decimator<float, 3>());
+}
+
+// The GPIO path: adapters in a chain, in place, with a decimating last stage
+void test_chain_split() {
+    BiquadCoeffs lowpass = BiquadCoeffs::lowpass(50.0f, 1000.0f);
+    BlockFilterAdapter<MedianFilter<int16_t, 5>> median_a, median_b;
+    BlockFilterAdapter<BiquadQ15> biquad_a(lowpass), biquad_b(lowpass);
+    BlockFilterAdapter<Decimator<int16_t, 4>> decimate_a, decimate_b;
+    FilterChain whole, split;
+    TEST_ASSERT_TRUE(whole.add(&median_a));
+    TEST_ASSERT_TRUE(whole.add(&biquad_a));
+    TEST_ASSERT_TRUE(whole.add(&decimate_a));
+    split.add(&median_b);
+    split.add(&biquad_b);
+    split.add(&decimate_b);
+
+    std::vector<int16_t> in = make_signal<int16_t>();
+    std::vector<int16_t> expected(in);
+    size_t expected_n = whole.process(expected.data(), expected.data(), SIGNAL);
+    TEST_ASSERT_EQUAL_size_t(SIGNAL / 4, expected_n);
+
+    std::vector<int16_t> got(SIGNAL);
+    size_t pos = 0;
+    size_t got_n = 0;
+    for (size_t k = 0; pos < SIGNAL; k++) {
+        size_t n = SPLITS[k % (sizeof(SPLITS) / sizeof(SPLITS[0]))];
+        if (n > SIGNAL - pos) n = SIGNAL - pos;
+        int16_t block[500];
+        memcpy(block, in.data() + pos, n * sizeof(int16_t));
+        size_t produced = split.process(block, block, n);
+        memcpy(got.data() + got_n, block, produced * sizeof(int16_t));
+        got_n += produced;
+        pos += n;
+    }
+    TEST_ASSERT_EQUAL_size_t(expected_n, got_n);
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), got.data(), expected_n * sizeof(int16_t));
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_moving_average_split);
+    RUN_TEST(test_median_split);
+    RUN_TEST(test_biquad_split);
+    RUN_TEST(test_decimator_split);
+    RUN_TEST(test_chain_split);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
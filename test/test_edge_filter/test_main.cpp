@@ -0,0 +1,171 @@
+#include <unity.h>
+#include <stdint.h>
+#include <random>
+#include "EdgeFilter.hpp"
+#ifndef ESP_PLATFORM
+#include <chrono>
+#include <thread>
+#include "host_fakes.hpp"
+#include "GPIO.hpp"
+#endif
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bounce_inside_window_is_dropped() {
+    EdgeFilter filter(200);
+    uint16_t coalesced = 0;
+    TEST_ASSERT_TRUE(filter.accept(1, 1000, &coalesced));
+    TEST_ASSERT_FALSE(filter.accept(0, 1050, &coalesced));
+    TEST_ASSERT_FALSE(filter.accept(1, 1100, &coalesced));
+    // Settled where it was recorded: nothing more to say
+    int64_t due = 0;
+    TEST_ASSERT_TRUE(filter.settle_due(&due));
+    TEST_ASSERT_EQUAL_INT64(1200, due);
+    TEST_ASSERT_FALSE(filter.settle(1, 1200, &coalesced));
+    TEST_ASSERT_FALSE(filter.settle_due(&due));
+    TEST_ASSERT_TRUE(filter.accept(0, 5000, &coalesced));
+    TEST_ASSERT_EQUAL_UINT16(2, coalesced);
+}
+
+void test_return_edge_inside_window_is_recorded_on_settle() {
+    EdgeFilter filter(200);
+    uint16_t coalesced = 0;
+    TEST_ASSERT_TRUE(filter.accept(1, 1000, &coalesced));
+    // Glitch: the pin goes back low inside the window and stays there
+    TEST_ASSERT_FALSE(filter.accept(0, 1020, &coalesced));
+    TEST_ASSERT_FALSE(filter.settle(0, 1150, &coalesced));   // Window still open
+    TEST_ASSERT_TRUE(filter.settle(0, 1200, &coalesced));
+    TEST_ASSERT_EQUAL(0, filter.last_level());
+    TEST_ASSERT_EQUAL_UINT16(1, coalesced);
+    // The settle record starts a new window
+    TEST_ASSERT_FALSE(filter.accept(1, 1300, &coalesced));
+}
+
+void test_repeat_level_is_coalesced() {
+    EdgeFilter filter(0);
+    uint16_t coalesced = 0;
+    TEST_ASSERT_TRUE(filter.accept(1, 10, &coalesced));
+    TEST_ASSERT_FALSE(filter.accept(1, 20, &coalesced));
+    TEST_ASSERT_FALSE(filter.accept(1, 30, &coalesced));
+    TEST_ASSERT_TRUE(filter.accept(0, 40, &coalesced));
+    TEST_ASSERT_EQUAL_UINT16(2, coalesced);
+    int64_t due = 0;
+    TEST_ASSERT_FALSE(filter.settle_due(&due));
+}
+
+// Replays GPIO's use of the filter on a simulated clock: the ISR calls accept()
+// for every edge and arms the settle timer after a dropped bounce; the timer
+// fires up to 50 us late and re-arms while a newer window is still open.
+// Bursts of 1-8 edges with gaps shorter and longer than the window; once the
+// pin has been quiet past the window, the last recorded level must be the pin's.
+void test_stress_recorded_level_tracks_pin() {
+    const uint32_t WINDOW = 200;
+    const int64_t EDGES = 4000000;
+    EdgeFilter filter(WINDOW);
+    std::mt19937_64 rng(0xED6E);
+    std::uniform_int_distribution<int> burst_len(1, 8);
+    std::uniform_int_distribution<int> bounce_gap(1, WINDOW / 3);
+    std::uniform_int_distribution<int> quiet_gap(1, 3 * WINDOW);
+    std::uniform_int_distribution<int> late(0, 50);
+
+    int pin = 0;
+    int recorded = -1;
+    int64_t now = 0;
+    int64_t timer_at = -1;
+    int64_t edges = 0, records = 0, settles = 0;
+    uint16_t coalesced = 0;
+
+    auto fire_timers_until = [&](int64_t t) {
+        while (timer_at >= 0 && timer_at <= t) {
+            int64_t at = timer_at;
+            timer_at = -1;
+            if (filter.settle(pin, at, &coalesced)) {
+                TEST_ASSERT_NOT_EQUAL(recorded, pin);
+                recorded = pin;
+                records++;
+                settles++;
+            } else {
+                int64_t due = 0;
+                if (filter.settle_due(&due)) timer_at = (due > at ? due : at + 1) + late(rng);
+            }
+        }
+    };
+
+    while (edges < EDGES) {
+        int n = burst_len(rng);
+        for (int i = 0; i < n; i++) {
+            now += i == 0 ? quiet_gap(rng) : bounce_gap(rng);
+            fire_timers_until(now);
+            pin ^= 1;
+            edges++;
+            if (filter.accept(pin, now, &coalesced)) {
+                TEST_ASSERT_NOT_EQUAL(recorded, pin);
+                recorded = pin;
+                records++;
+            } else {
+                int64_t due = 0;
+                if (timer_at < 0 && filter.settle_due(&due)) timer_at = due + late(rng);
+            }
+        }
+        // Quiet past the window and the latest timer: the record must match
+        fire_timers_until(now + 2 * WINDOW + 100);
+        now += 2 * WINDOW + 100;
+        TEST_ASSERT_EQUAL_INT_MESSAGE(pin, recorded, "recorded level diverged from the pin");
+    }
+    TEST_ASSERT_GREATER_THAN_INT64(0, settles);
+    TEST_ASSERT_LESS_THAN_INT64(edges, records);
+}
+
+#ifndef ESP_PLATFORM
+// The same through GPIO::enable_edge_capture on the host pins and esp_timer
+void test_edge_capture_reports_settled_level() {
+    const gpio_num_t PIN = GPIO_NUM_4;
+    fake::gpio_reset();
+    GPIO input(PIN, GPIO_MODE_INPUT);
+    TEST_ASSERT_EQUAL(ESP_OK, input.enable_edge_capture(1024, 300, 1));
+
+    std::mt19937 rng(42);
+    int pin = 0;
+    int recorded = 0;
+    gpio_edge_event_t events[64];
+    for (int burst = 0; burst < 300; burst++) {
+        // Edges back to back are well inside the 300 us window
+        int n = 1 + (int) (rng() % 6);
+        for (int i = 0; i < n; i++) {
+            pin ^= 1;
+            fake::gpio_input(PIN, pin);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(700));
+        // The settle timer may run late on a loaded host: wait for it, not a fixed time
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (recorded != pin && std::chrono::steady_clock::now() < deadline) {
+            size_t got = input.read_edges(events, 64, pdMS_TO_TICKS(5));
+            for (size_t i = 0; i < got; i++) {
+                TEST_ASSERT_NOT_EQUAL(recorded, events[i].level);
+                recorded = events[i].level;
+            }
+        }
+        TEST_ASSERT_EQUAL_INT(pin, recorded);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, input.edge_overflows());
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bounce_inside_window_is_dropped);
+    RUN_TEST(test_return_edge_inside_window_is_recorded_on_settle);
+    RUN_TEST(test_repeat_level_is_coalesced);
+    RUN_TEST(test_stress_recorded_level_tracks_pin);
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_edge_capture_reports_settled_level);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,291 @@
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include <random>
+#include <set>
+#include <vector>
+#include "FlashLog.hpp"
+
+// NOR flash in RAM: writes can only clear bits, erase sets a sector to 0xFF.
+// cut_after(n) simulates power loss once n more bytes have been programmed:
+// the write in progress stops partway, the byte being programmed keeps some of
+// its bits, and every access fails until power_on(). An erase caught by the cut
+// has only cleared a prefix of the sector.
+class RamFlash : public FlashStorage {
+public:
+    RamFlash(size_t sectors, size_t sector_size)
+        : _sector_size(sector_size), _data(sectors * sector_size, 0xFF), _rng(1) {}
+
+    size_t size() const override { return _data.size(); }
+
+    size_t sector_size() const override { return _sector_size; }
+
+    bool read(size_t offset, void* dst, size_t len) override {
+        if (_off || offset + len > _data.size()) return false;
+        memcpy(dst, &_data[offset], len);
+        return true;
+    }
+
+    bool write(size_t offset, const void* src, size_t len) override {
+        if (_off || offset + len > _data.size()) return false;
+        const uint8_t* p = (const uint8_t*) src;
+        for (size_t i = 0; i < len; i++) {
+            if (_budget == 0) {
+                // Torn byte: only some of the bits it should clear are cleared
+                _data[offset + i] &= p[i] | (uint8_t) _rng();
+                _off = true;
+                return false;
+            }
+            _budget--;
+            _data[offset + i] &= p[i];
+        }
+        return true;
+    }
+
+    bool erase_sector(size_t offset) override {
+        if (_off || offset % _sector_size || offset >= _data.size()) return false;
+        if (_budget < _sector_size / 16) {
+            memset(&_data[offset], 0xFF, _rng() % _sector_size);
+            _off = true;
+            _torn_erases++;
+            return false;
+        }
+        _budget -= _sector_size / 16;
+        memset(&_data[offset], 0xFF, _sector_size);
+        return true;
+    }
+
+    void cut_after(size_t bytes) { _budget = bytes; }
+
+    void power_on() {
+        _off = false;
+        _budget = SIZE_MAX;
+    }
+
+    bool off() const { return _off; }
+
+    uint32_t torn_erases() const { return _torn_erases; }
+
+private:
+    size_t _sector_size;
+    std::vector<uint8_t> _data;
+    std::minstd_rand _rng;
+    size_t _budget = SIZE_MAX;
+    bool _off = false;
+    uint32_t _torn_erases = 0;
+};
+
+// Record payload: id, length, then bytes derived from the id, so a replayed
+// record can be checked on its own
+static std::vector<uint8_t> make_record(uint32_t id, size_t len) {
+    std::vector<uint8_t> r(len);
+    memcpy(&r[0], &id, 4);
+    uint32_t l = (uint32_t) len;
+    memcpy(&r[4], &l, 4);
+    for (size_t i = 8; i < len; i++) r[i] = (uint8_t) (id * 31 + i);
+    return r;
+}
+
+struct Replayed {
+    std::vector<uint32_t> ids;
+    uint32_t malformed = 0;
+    size_t stop_after = SIZE_MAX;
+};
+
+static bool collect(const uint8_t* data, size_t len, void* ctx) {
+    Replayed* out = (Replayed*) ctx;
+    if (out->ids.size() >= out->stop_after) return false;
+    uint32_t id = 0, l = 0;
+    if (len >= 8) {
+        memcpy(&id, data, 4);
+        memcpy(&l, data + 4, 4);
+    }
+    if (len < 8 || l != len || make_record(id, len) != std::vector<uint8_t>(data, data + len)) {
+        out->malformed++;
+        return true;
+    }
+    out->ids.push_back(id);
+    return true;
+}
+
+static bool append_id(FlashLog& log, uint32_t id, size_t len) {
+    std::vector<uint8_t> r = make_record(id, len);
+    return log.append(r.data(), r.size());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_remount_resumes_after_consumed_records() {
+    RamFlash flash(4, 4096);
+    {
+        FlashLog log(flash);
+        TEST_ASSERT_TRUE(log.format());
+        for (uint32_t id = 0; id < 200; id++) TEST_ASSERT_TRUE(append_id(log, id, 40));
+        Replayed first;
+        TEST_ASSERT_EQUAL_size_t(120, log.replay(collect, &first, 120));
+    }
+    FlashLog log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    TEST_ASSERT_EQUAL_UINT32(80, log.stats().pending);
+    Replayed rest;
+    TEST_ASSERT_EQUAL_size_t(80, log.replay(collect, &rest));
+    TEST_ASSERT_EQUAL_UINT32(0, rest.malformed);
+    for (uint32_t i = 0; i < 80; i++) TEST_ASSERT_EQUAL_UINT32(120 + i, rest.ids[i]);
+    TEST_ASSERT_TRUE(log.empty());
+}
+
+void test_callback_refusal_keeps_records() {
+    RamFlash flash(4, 4096);
+    FlashLog log(flash);
+    TEST_ASSERT_TRUE(log.format());
+    for (uint32_t id = 0; id < 10; id++) TEST_ASSERT_TRUE(append_id(log, id, 100));
+    Replayed some;
+    some.stop_after = 4;
+    TEST_ASSERT_EQUAL_size_t(4, log.replay(collect, &some));
+
+    FlashLog again(flash);
+    TEST_ASSERT_TRUE(again.mount());
+    Replayed rest;
+    TEST_ASSERT_EQUAL_size_t(6, again.replay(collect, &rest));
+    TEST_ASSERT_EQUAL_UINT32(4, rest.ids.front());
+    TEST_ASSERT_EQUAL_UINT32(9, rest.ids.back());
+}
+
+void test_torn_payload_loses_only_that_record() {
+    RamFlash flash(4, 4096);
+    {
+        FlashLog log(flash);
+        TEST_ASSERT_TRUE(log.format());
+        for (uint32_t id = 0; id < 5; id++) TEST_ASSERT_TRUE(append_id(log, id, 64));
+        // Header and 20 payload bytes reach the flash
+        flash.cut_after(8 + 20);
+        TEST_ASSERT_FALSE(append_id(log, 5, 64));
+    }
+    flash.power_on();
+    FlashLog log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    // Appends resume past the torn record
+    TEST_ASSERT_TRUE(append_id(log, 6, 64));
+    Replayed got;
+    log.replay(collect, &got);
+    TEST_ASSERT_EQUAL_UINT32(0, got.malformed);
+    const uint32_t expected[] = {0, 1, 2, 3, 4, 6};
+    TEST_ASSERT_EQUAL_size_t(6, got.ids.size());
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, got.ids.data(), 6);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, log.stats().corrupt);
+}
+
+void test_torn_sector_header_leaves_sector_free() {
+    // 19 records of 200 + 8 bytes fill a 4 KB sector after its 12-byte header
+    RamFlash flash(4, 4096);
+    {
+        FlashLog log(flash);
+        TEST_ASSERT_TRUE(log.format());
+        for (uint32_t id = 0; id < 38; id++) TEST_ASSERT_TRUE(append_id(log, id, 200));
+        // The next append opens sector 2: the erase completes, its header is cut short
+        flash.cut_after(4096 / 16 + 5);
+        TEST_ASSERT_FALSE(append_id(log, 38, 200));
+    }
+    flash.power_on();
+    FlashLog log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    TEST_ASSERT_TRUE(append_id(log, 39, 200));
+    Replayed got;
+    TEST_ASSERT_EQUAL_size_t(39, log.replay(collect, &got));
+    TEST_ASSERT_EQUAL_UINT32(0, got.malformed);
+    for (uint32_t i = 0; i < 38; i++) TEST_ASSERT_EQUAL_UINT32(i, got.ids[i]);
+    TEST_ASSERT_EQUAL_UINT32(39, got.ids[38]);
+}
+
+// Random appends and partial replays, with a power cut at a random byte of
+// the programming (record headers, payloads, consume markers, sector headers
+// and erases alike), then a remount. Every acknowledged record that was not
+// yet delivered must come back, in order; delivered ones may repeat
+// (at-least-once), nothing unacknowledged but the torn append may appear, and
+// nothing may come back damaged.
+void test_random_power_cuts_recover_acknowledged_records() {
+    const int CYCLES = 2000;
+    RamFlash flash(4, 4096);
+    std::mt19937 rng(0xF1A5);
+    FlashLog* log = new FlashLog(flash);
+    TEST_ASSERT_TRUE(log->format());
+
+    uint32_t next_id = 0;
+    uint64_t recovered = 0;
+    for (int cycle = 0; cycle < CYCLES; cycle++) {
+        std::set<uint32_t> acked, undelivered;
+        uint32_t torn_id = UINT32_MAX;
+        uint32_t last_delivered = 0;
+        bool any_delivered = false;
+
+        // Stays under two sectors of data, so nothing is dropped for space
+        size_t written = 0;
+        flash.cut_after(rng() % 6000);
+        while (!flash.off() && written < 6000) {
+            if (rng() % 4) {
+                size_t len = 8 + rng() % 300;
+                uint32_t id = next_id++;
+                if (append_id(*log, id, len)) {
+                    acked.insert(id);
+                    undelivered.insert(id);
+                } else {
+                    torn_id = id;
+                }
+                written += len + 8;
+            } else {
+                Replayed got;
+                got.stop_after = rng() % 8;
+                log->replay(collect, &got);
+                TEST_ASSERT_EQUAL_UINT32(0, got.malformed);
+                for (uint32_t id : got.ids) {
+                    TEST_ASSERT_TRUE(!any_delivered || id > last_delivered);
+                    last_delivered = id;
+                    any_delivered = true;
+                    undelivered.erase(id);
+                }
+            }
+        }
+
+        // Reboot
+        delete log;
+        flash.power_on();
+        log = new FlashLog(flash);
+        TEST_ASSERT_TRUE(log->mount());
+        Replayed got;
+        log->replay(collect, &got);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, got.malformed, "damaged record replayed");
+        for (size_t i = 1; i < got.ids.size(); i++) {
+            TEST_ASSERT_TRUE_MESSAGE(got.ids[i] > got.ids[i - 1], "replay out of order");
+        }
+        std::set<uint32_t> seen(got.ids.begin(), got.ids.end());
+        for (uint32_t id : seen) {
+            TEST_ASSERT_TRUE_MESSAGE(acked.count(id) || id == torn_id, "unknown record replayed");
+        }
+        for (uint32_t id : undelivered) {
+            TEST_ASSERT_TRUE_MESSAGE(seen.count(id), "acknowledged record lost");
+        }
+        TEST_ASSERT_EQUAL_UINT32(0, log->stats().dropped);
+        TEST_ASSERT_TRUE(log->empty());
+        recovered += undelivered.size();
+    }
+    delete log;
+    TEST_ASSERT_GREATER_THAN_UINT64(1000, recovered);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, flash.torn_erases());
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_remount_resumes_after_consumed_records);
+    RUN_TEST(test_callback_refusal_keeps_records);
+    RUN_TEST(test_torn_payload_loses_only_that_record);
+    RUN_TEST(test_torn_sector_header_leaves_sector_free);
+    RUN_TEST(test_random_power_cuts_recover_acknowledged_records);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,183 @@
+#include <unity.h>
+#include <stdint.h>
+#include <random>
+#include "GpioPort.hpp"
+
+// Register file standing in for the ESP32 set/clear/input registers: one
+// output latch per bank, with the write count per bank and per call
+struct FakeRegisters {
+    typedef int mode_type;
+
+    static inline uint64_t out = 0;
+    static inline uint64_t in = 0;
+    static inline uint64_t configured_mask = 0;
+    static inline int configured_mode = -1;
+    static inline int configures = 0;
+    static inline int bank_writes[2] = {};
+
+    static void reset() {
+        out = in = configured_mask = 0;
+        configured_mode = -1;
+        configures = 0;
+        bank_writes[0] = bank_writes[1] = 0;
+    }
+
+    static void configure(uint64_t mask, int mode) {
+        configured_mask = mask;
+        configured_mode = mode;
+        configures++;
+    }
+
+    static void set(uint64_t mask) {
+        count(mask);
+        out |= mask;
+    }
+
+    static void clear(uint64_t mask) {
+        count(mask);
+        out &= ~mask;
+    }
+
+    static uint64_t read() { return in; }
+
+    static void count(uint64_t mask) {
+        if ((uint32_t) mask) bank_writes[0]++;
+        if (mask >> 32) bank_writes[1]++;
+    }
+};
+
+typedef GpioPortT<FakeRegisters> Port;
+
+static const uint64_t PINS_8 = (1ULL << 12) | (1ULL << 13) | (1ULL << 14) | (1ULL << 15) |
+                               (1ULL << 25) | (1ULL << 26) | (1ULL << 27) | (1ULL << 32);
+
+void setUp(void) { FakeRegisters::reset(); }
+void tearDown(void) {}
+
+void test_constructor_configures_mask() {
+    Port port(PINS_8, 3);
+    TEST_ASSERT_EQUAL(1, FakeRegisters::configures);
+    TEST_ASSERT_EQUAL_UINT64(PINS_8, FakeRegisters::configured_mask);
+    TEST_ASSERT_EQUAL(3, FakeRegisters::configured_mode);
+    TEST_ASSERT_EQUAL_UINT64(PINS_8, port.mask());
+    TEST_ASSERT_EQUAL_size_t(8, port.width());
+}
+
+void test_write_spreads_bits_to_pins_in_order() {
+    Port port(PINS_8, 0);
+    port.write(0x01);
+    TEST_ASSERT_EQUAL_UINT64(1ULL << 12, FakeRegisters::out);
+    port.write(0x80);
+    TEST_ASSERT_EQUAL_UINT64(1ULL << 32, FakeRegisters::out);
+    port.write(0xA5);
+    TEST_ASSERT_EQUAL_UINT64((1ULL << 12) | (1ULL << 14) | (1ULL << 26) | (1ULL << 32), FakeRegisters::out);
+    // Bits past the width are ignored
+    port.write(0xFFFFFF00u);
+    TEST_ASSERT_EQUAL_UINT64(0, FakeRegisters::out);
+}
+
+void test_read_gathers_pins_in_order() {
+    Port port(PINS_8, 0);
+    FakeRegisters::in = ~PINS_8;
+    TEST_ASSERT_EQUAL_UINT32(0, port.read());
+    TEST_ASSERT_EQUAL_UINT64(0, port.read_pins());
+    FakeRegisters::in = (1ULL << 13) | (1ULL << 27) | (1ULL << 40);
+    TEST_ASSERT_EQUAL_UINT32(0x42, port.read());
+    TEST_ASSERT_EQUAL_UINT64((1ULL << 13) | (1ULL << 27), port.read_pins());
+}
+
+void test_pins_outside_mask_are_untouched() {
+    Port port(PINS_8, 0);
+    FakeRegisters::out = (1ULL << 2) | (1ULL << 40);
+    port.write_pins(~0ULL);
+    TEST_ASSERT_EQUAL_UINT64(PINS_8 | (1ULL << 2) | (1ULL << 40), FakeRegisters::out);
+    port.write_pins(0);
+    TEST_ASSERT_EQUAL_UINT64((1ULL << 2) | (1ULL << 40), FakeRegisters::out);
+    port.set(1ULL << 3);
+    port.clear(1ULL << 2);
+    TEST_ASSERT_EQUAL_UINT64((1ULL << 2) | (1ULL << 40), FakeRegisters::out);
+}
+
+void test_write_is_one_register_write_per_bank() {
+    Port low((1ULL << 4) | (1ULL << 5) | (1ULL << 6), 0);
+    low.write(0x5);
+    // One set and one clear, both in bank 0
+    TEST_ASSERT_EQUAL(2, FakeRegisters::bank_writes[0]);
+    TEST_ASSERT_EQUAL(0, FakeRegisters::bank_writes[1]);
+
+    FakeRegisters::bank_writes[0] = 0;
+    Port both(PINS_8, 0);
+    both.write(0x0F);   // Bank 0 set and clear, bank 1 (pin 32) clear only
+    TEST_ASSERT_EQUAL(2, FakeRegisters::bank_writes[0]);
+    TEST_ASSERT_EQUAL(1, FakeRegisters::bank_writes[1]);
+}
+
+void test_full_width_port_spans_banks() {
+    uint64_t mask = 0;
+    for (int pin = 16; pin < 48; pin++) mask |= 1ULL << pin;
+    Port port(mask, 0);
+    TEST_ASSERT_EQUAL_size_t(Port::MAX_PINS, port.width());
+    port.write(0xFFFFFFFFu);
+    TEST_ASSERT_EQUAL_UINT64(mask, FakeRegisters::out);
+    port.write(0x0000FFFFu);
+    TEST_ASSERT_EQUAL_UINT64(0x0000FFFF0000ULL, FakeRegisters::out);
+    FakeRegisters::in = 0x0000FFFF0000ULL << 16;
+    TEST_ASSERT_EQUAL_UINT32(0xFFFF0000u, port.read());
+}
+
+void test_mask_wider_than_max_pins_is_rejected() {
+    uint64_t mask = 0;
+    for (int pin = 0; pin < 33; pin++) mask |= 1ULL << pin;
+    Port port(mask, 0);
+    TEST_ASSERT_EQUAL(0, FakeRegisters::configures);
+    TEST_ASSERT_EQUAL_size_t(0, port.width());
+    TEST_ASSERT_EQUAL_UINT64(0, port.mask());
+    // An empty port writes nothing and reads nothing
+    port.write(0xFFFFFFFFu);
+    port.write_pins(~0ULL);
+    TEST_ASSERT_EQUAL_UINT64(0, FakeRegisters::out);
+    FakeRegisters::in = ~0ULL;
+    TEST_ASSERT_EQUAL_UINT32(0, port.read());
+    TEST_ASSERT_EQUAL_UINT64(0, port.read_pins());
+}
+
+void test_static_port_matches_runtime_port() {
+    typedef StaticGpioPortT<FakeRegisters, 12, 13, 14, 15, 25, 26, 27, 32> Fixed;
+    TEST_ASSERT_EQUAL_UINT64(PINS_8, Fixed::MASK);
+    TEST_ASSERT_EQUAL_size_t(8, Fixed::WIDTH);
+    Fixed fixed(1);
+    TEST_ASSERT_EQUAL_UINT64(PINS_8, FakeRegisters::configured_mask);
+    Port port(PINS_8, 1);
+
+    std::mt19937 rng(3);
+    for (int i = 0; i < 1000; i++) {
+        uint32_t value = rng();
+        FakeRegisters::out = rng();
+        fixed.write(value);
+        uint64_t from_static = FakeRegisters::out;
+        port.write(value);
+        TEST_ASSERT_EQUAL_UINT64(FakeRegisters::out, from_static);
+
+        FakeRegisters::in = ((uint64_t) rng() << 32) | rng();
+        TEST_ASSERT_EQUAL_UINT32(port.read(), fixed.read());
+    }
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_constructor_configures_mask);
+    RUN_TEST(test_write_spreads_bits_to_pins_in_order);
+    RUN_TEST(test_read_gathers_pins_in_order);
+    RUN_TEST(test_pins_outside_mask_are_untouched);
+    RUN_TEST(test_write_is_one_register_write_per_bank);
+    RUN_TEST(test_full_width_port_spans_banks);
+    RUN_TEST(test_mask_wider_than_max_pins_is_rejected);
+    RUN_TEST(test_static_port_matches_runtime_port);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,304 @@
+#include <unity.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include "HttpCacheStore.hpp"
+#ifndef ESP_PLATFORM
+#include "host_fakes.hpp"
+#include "HttpClient.hpp"
+#include "HttpCache.hpp"
+#endif
+
+static const int64_t SECOND = 1000000;
+
+static HttpCacheHeaders make_headers(const char* etag, const char* cache_control, uint32_t age_s = 0) {
+    HttpCacheHeaders h;
+    if (etag) h.capture("ETag", etag);
+    if (cache_control) h.capture("Cache-Control", cache_control);
+    h.age_s = age_s;
+    return h;
+}
+
+// url + etag + body; every entry in the LRU tests costs exactly 100 bytes
+static std::string url_of(int i) { return "http://h/" + std::to_string(i); }
+
+static bool store_100(HttpCacheStore& store, int i, int64_t now_us) {
+    std::string url = url_of(i);
+    std::string body(100 - url.size() - 4, (char) ('a' + i));
+    return store.store(url, make_headers("\"v1\"", "max-age=60"), body.data(), body.size(), now_us);
+}
+
+// Spill tier in RAM, standing in for NVS
+class RamSpill : public HttpCacheSpill {
+public:
+    std::map<uint32_t, std::string> records;
+    uint32_t saves = 0;
+
+    bool save(uint32_t key, const void* data, size_t len) override {
+        records[key].assign((const char*) data, len);
+        saves++;
+        return true;
+    }
+
+    bool load(uint32_t key, std::string* out) override {
+        auto it = records.find(key);
+        if (it == records.end()) return false;
+        *out = it->second;
+        return true;
+    }
+
+    void erase(uint32_t key) override { records.erase(key); }
+};
+
+static int s_live_bodies = 0;
+
+static void* counting_alloc(size_t bytes) {
+    s_live_bodies++;
+    return malloc(bytes);
+}
+
+static void counting_free(void* p) {
+    s_live_bodies--;
+    free(p);
+}
+
+void setUp(void) { s_live_bodies = 0; }
+void tearDown(void) {}
+
+void test_least_recently_used_is_evicted_first() {
+    HttpCacheStore store(300, 1000);
+    for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(store_100(store, i, 0));
+    TEST_ASSERT_EQUAL_UINT32(300, store.stats().bytes_used);
+
+    // Touch 0, so 1 is now the oldest
+    HttpCacheHit hit;
+    TEST_ASSERT_EQUAL(HTTP_CACHE_FRESH, store.lookup(url_of(0), 0, &hit));
+    TEST_ASSERT_TRUE(store_100(store, 3, 0));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_MISS, store.lookup(url_of(1), 0, &hit));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_FRESH, store.lookup(url_of(0), 0, &hit));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_FRESH, store.lookup(url_of(2), 0, &hit));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_FRESH, store.lookup(url_of(3), 0, &hit));
+
+    // Order is now 3, 2, 0 (most recent first): two more push out 0 and 2
+    TEST_ASSERT_TRUE(store_100(store, 4, 0));
+    TEST_ASSERT_TRUE(store_100(store, 5, 0));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_MISS, store.lookup(url_of(0), 0, &hit));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_MISS, store.lookup(url_of(2), 0, &hit));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_FRESH, store.lookup(url_of(3), 0, &hit));
+
+    http_cache_stats_t s = store.stats();
+    TEST_ASSERT_EQUAL_UINT32(3, s.evicted);
+    TEST_ASSERT_EQUAL_UINT32(3, s.entries);
+    TEST_ASSERT_EQUAL_UINT32(300, s.bytes_used);
+}
+
+void test_budget_counts_bytes_not_entries() {
+    HttpCacheStore store(1000, 1000);
+    for (int i = 0; i < 8; i++) TEST_ASSERT_TRUE(store_100(store, i, 0));
+    // One large entry pushes out the five oldest small ones
+    std::string big(600, 'z');
+    TEST_ASSERT_TRUE(store.store("http://h/big", make_headers("\"b\"", nullptr), big.data(), big.size(), 0));
+    http_cache_stats_t s = store.stats();
+    TEST_ASSERT_EQUAL_UINT32(5, s.evicted);
+    TEST_ASSERT_EQUAL_UINT32(4, s.entries);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(1000, s.bytes_used);
+
+    // Over max_entry_bytes: not kept, nothing evicted
+    std::string huge(1001, 'h');
+    TEST_ASSERT_FALSE(store.store("http://h/huge", make_headers("\"h\"", nullptr), huge.data(), huge.size(), 0));
+    TEST_ASSERT_EQUAL_UINT32(5, store.stats().evicted);
+}
+
+void test_freshness_follows_max_age_minus_age() {
+    HttpCacheStore store(4096, 1024);
+    TEST_ASSERT_TRUE(store.store("http://h/a", make_headers("\"1\"", "public, max-age=60", 10), "x", 1, 0));
+    HttpCacheHit hit;
+    TEST_ASSERT_EQUAL(HTTP_CACHE_FRESH, store.lookup("http://h/a", 50 * SECOND - 1, &hit));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_STALE, store.lookup("http://h/a", 50 * SECOND, &hit));
+    TEST_ASSERT_EQUAL_STRING("\"1\"", hit.etag.c_str());
+
+    // no-cache keeps the entry but always revalidates it
+    TEST_ASSERT_TRUE(store.store("http://h/b", make_headers("\"2\"", "no-cache, max-age=60"), "y", 1, 0));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_STALE, store.lookup("http://h/b", 0, &hit));
+
+    // Validators without max-age: kept, revalidated every time
+    HttpCacheHeaders lm;
+    lm.capture("last-modified", "Wed, 21 Oct 2015 07:28:00 GMT");
+    TEST_ASSERT_TRUE(store.store("http://h/c", lm, "z", 1, 0));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_STALE, store.lookup("http://h/c", 0, &hit));
+    TEST_ASSERT_EQUAL_STRING("Wed, 21 Oct 2015 07:28:00 GMT", hit.last_modified.c_str());
+}
+
+void test_uncacheable_responses_are_not_kept() {
+    HttpCacheStore store(4096, 1024);
+    HttpCacheHit hit;
+    TEST_ASSERT_FALSE(store.store("http://h/a", make_headers("\"1\"", "no-store"), "x", 1, 0));
+    TEST_ASSERT_FALSE(store.store("http://h/b", make_headers(nullptr, nullptr), "x", 1, 0));
+    TEST_ASSERT_FALSE(store.store("http://h/c", make_headers(nullptr, "max-age=0"), "x", 1, 0));
+    // max-age alone is enough
+    TEST_ASSERT_TRUE(store.store("http://h/d", make_headers(nullptr, "max-age=5"), "x", 1, 0));
+
+    // A no-store response drops the copy kept from an earlier one
+    TEST_ASSERT_TRUE(store.store("http://h/a", make_headers("\"1\"", "max-age=60"), "x", 1, 0));
+    TEST_ASSERT_FALSE(store.store("http://h/a", make_headers("\"2\"", "no-store"), "x", 1, 0));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_MISS, store.lookup("http://h/a", 0, &hit));
+    TEST_ASSERT_EQUAL_UINT32(1, store.stats().entries);
+}
+
+void test_revalidation_renews_and_updates_validators() {
+    HttpCacheStore store(4096, 1024);
+    TEST_ASSERT_TRUE(store.store("http://h/a", make_headers("\"1\"", "max-age=10"), "body", 4, 0));
+    HttpCacheHit hit;
+    TEST_ASSERT_EQUAL(HTTP_CACHE_STALE, store.lookup("http://h/a", 20 * SECOND, &hit));
+
+    // 304 with a new max-age: fresh again from now, same body
+    TEST_ASSERT_TRUE(store.revalidated("http://h/a", make_headers(nullptr, "max-age=30"), 20 * SECOND, &hit));
+    TEST_ASSERT_EQUAL_STRING_LEN("body", hit.body->data, 4);
+    TEST_ASSERT_EQUAL(HTTP_CACHE_FRESH, store.lookup("http://h/a", 49 * SECOND, &hit));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_STALE, store.lookup("http://h/a", 50 * SECOND, &hit));
+
+    // A 304 without Cache-Control leaves the freshness alone; a changed ETag replaces the old one
+    TEST_ASSERT_TRUE(store.revalidated("http://h/a", make_headers("\"longer-etag\"", nullptr), 50 * SECOND, &hit));
+    TEST_ASSERT_EQUAL(HTTP_CACHE_STALE, store.lookup("http://h/a", 50 * SECOND, &hit));
+    TEST_ASSERT_EQUAL_STRING("\"longer-etag\"", hit.etag.c_str());
+    TEST_ASSERT_EQUAL_UINT32(strlen("http://h/a") + strlen("\"longer-etag\"") + 4, store.stats().bytes_used);
+
+    // A 304 for an entry that is gone cannot be served
+    store.remove("http://h/a");
+    TEST_ASSERT_FALSE(store.revalidated("http://h/a", make_headers(nullptr, nullptr), 50 * SECOND, &hit));
+
+    // Lookups: 1 fresh, 3 stale of which 2 revalidated and 1 downloaded again
+    http_cache_stats_t s = store.stats();
+    TEST_ASSERT_EQUAL_UINT32(1, s.fresh_hits);
+    TEST_ASSERT_EQUAL_UINT32(2, s.revalidated);
+    TEST_ASSERT_EQUAL_UINT32(1, s.misses);
+    TEST_ASSERT_EQUAL_UINT64(12, s.bytes_saved);
+}
+
+void test_evicted_body_stays_valid_for_its_reader() {
+    http_cache_memory_t memory = {counting_alloc, counting_free};
+    {
+        HttpCacheStore store(300, 1000, &memory);
+        for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(store_100(store, i, 0));
+        TEST_ASSERT_EQUAL_INT(3, s_live_bodies);
+        HttpCacheHit first, third;
+        TEST_ASSERT_EQUAL(HTTP_CACHE_FRESH, store.lookup(url_of(0), 0, &first));
+        TEST_ASSERT_EQUAL(HTTP_CACHE_FRESH, store.lookup(url_of(2), 0, &third));
+        // Order is 2, 0, 1: two more stores evict 1 and 0
+        TEST_ASSERT_TRUE(store_100(store, 3, 0));
+        TEST_ASSERT_TRUE(store_100(store, 4, 0));
+        HttpCacheHit probe;
+        TEST_ASSERT_EQUAL(HTTP_CACHE_MISS, store.lookup(url_of(0), 0, &probe));
+        store.clear();
+        // Only the bodies still held by a hit survive, and they are intact
+        TEST_ASSERT_EQUAL_INT(2, s_live_bodies);
+        TEST_ASSERT_EQUAL_CHAR('a', first.body->data[0]);
+        TEST_ASSERT_EQUAL_CHAR('c', third.body->data[0]);
+    }
+    TEST_ASSERT_EQUAL_INT(0, s_live_bodies);
+}
+
+void test_evicted_entries_spill_and_come_back_stale() {
+    RamSpill spill;
+    HttpCacheStore store(300, 1000);
+    store.set_spill(&spill);
+    for (int i = 0; i < 4; i++) TEST_ASSERT_TRUE(store_100(store, i, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, spill.saves);
+
+    // Still within max-age, but its age is unknown after the spill: revalidate
+    HttpCacheHit hit;
+    TEST_ASSERT_EQUAL(HTTP_CACHE_STALE, store.lookup(url_of(0), 0, &hit));
+    TEST_ASSERT_EQUAL_STRING("\"v1\"", hit.etag.c_str());
+    TEST_ASSERT_EQUAL_CHAR('a', hit.body->data[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, store.stats().spill_loads);
+    // Loading it back evicted 1, which spilled in turn
+    TEST_ASSERT_EQUAL_UINT32(2, spill.saves);
+
+    // An entry unchanged since it was spilled is not written again
+    TEST_ASSERT_TRUE(store_100(store, 4, 0));
+    TEST_ASSERT_TRUE(store_100(store, 5, 0));
+    TEST_ASSERT_TRUE(store_100(store, 6, 0));
+    TEST_ASSERT_EQUAL_UINT32(4, spill.saves);
+
+    // A new 200 response replaces the spilled copy
+    TEST_ASSERT_TRUE(store_100(store, 1, 0));
+    TEST_ASSERT_EQUAL_size_t(0, spill.records.count(HttpCacheStore::key(url_of(1))));
+}
+
+void test_spill_skips_entries_without_validators_and_foreign_records() {
+    RamSpill spill;
+    HttpCacheStore store(300, 1000);
+    store.set_spill(&spill);
+    std::string body(80, 'x');
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(store.store(url_of(i), make_headers(nullptr, "max-age=60"), body.data(), body.size(), 0));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, spill.saves);
+
+    // A record stored under this URL's key but for another URL (hash collision) is a miss
+    HttpCacheHit hit;
+    spill.records[HttpCacheStore::key("http://h/collide")] = std::string("\x0A\x00\x00\x00" "http://h/x" "body", 18);
+    TEST_ASSERT_EQUAL(HTTP_CACHE_MISS, store.lookup("http://h/collide", 0, &hit));
+    // A truncated record is a miss too
+    spill.records[HttpCacheStore::key("http://h/short")] = std::string("\x40\x00", 2);
+    TEST_ASSERT_EQUAL(HTTP_CACHE_MISS, store.lookup("http://h/short", 0, &hit));
+}
+
+#ifndef ESP_PLATFORM
+// The same through HttpClient and the fake server: the second GET carries
+// If-None-Match, and the 304 is answered with the cached body
+void test_client_revalidates_with_if_none_match() {
+    int full = 0, not_modified = 0;
+    fake::http_set_responder([&](const fake::HttpRequest& request) {
+        fake::HttpResponse response;
+        const char* inm = request.header("If-None-Match");
+        if (inm && strcmp(inm, "\"r1\"") == 0) {
+            response.status = 304;
+            not_modified++;
+        } else {
+            response.headers = {{"ETag", "\"r1\""}, {"Cache-Control", "no-cache"}};
+            response.body = "cached body";
+            full++;
+        }
+        return response;
+    });
+    TEST_ASSERT_EQUAL(ESP_OK, HttpCache::instance().begin());
+    HttpClient client;
+    for (int i = 0; i < 3; i++) {
+        std::string out;
+        StringSink sink(out);
+        TEST_ASSERT_EQUAL(ESP_OK, client.get("http://cache.local/config", sink));
+        TEST_ASSERT_EQUAL_STRING("cached body", out.c_str());
+    }
+    TEST_ASSERT_EQUAL_INT(1, full);
+    TEST_ASSERT_EQUAL_INT(2, not_modified);
+    http_cache_stats_t s = HttpCache::instance().stats();
+    TEST_ASSERT_EQUAL_UINT32(2, s.revalidated);
+    TEST_ASSERT_EQUAL_UINT64(22, s.bytes_saved);
+    HttpCache::instance().clear();
+    fake::http_reset();
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_least_recently_used_is_evicted_first);
+    RUN_TEST(test_budget_counts_bytes_not_entries);
+    RUN_TEST(test_freshness_follows_max_age_minus_age);
+    RUN_TEST(test_uncacheable_responses_are_not_kept);
+    RUN_TEST(test_revalidation_renews_and_updates_validators);
+    RUN_TEST(test_evicted_body_stays_valid_for_its_reader);
+    RUN_TEST(test_evicted_entries_spill_and_come_back_stale);
+    RUN_TEST(test_spill_skips_entries_without_validators_and_foreign_records);
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_client_revalidates_with_if_none_match);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
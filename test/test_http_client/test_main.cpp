@@ -0,0 +1,101 @@
+#include <unity.h>
+#include "HttpClient.hpp"
+#ifndef ESP_PLATFORM
+#include <map>
+#include <string>
+#include "host_fakes.hpp"
+
+// Counts the requests that reached the server by method, and closes the
+// connection instead of answering the next drop requests
+class Server {
+public:
+    std::map<std::string, int> seen;
+    int drop = 0;
+
+    Server() {
+        fake::http_set_responder([this](const fake::HttpRequest& request) {
+            seen[request.method]++;
+            fake::HttpResponse response;
+            response.body = "ok";
+            if (drop > 0) {
+                drop--;
+                response.drop = true;
+            }
+            return response;
+        });
+    }
+
+    ~Server() { fake::http_reset(); }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// A keep-alive connection the server closed while idle fails before the
+// request goes out, so any method is retried on a fresh one
+void test_stale_connection_retried() {
+    Server server;
+    HttpClient client;
+    DiscardSink sink;
+    TEST_ASSERT_EQUAL(ESP_OK, client.get("http://api.local/warm", sink));
+
+    fake::http_close_connections();
+    TEST_ASSERT_EQUAL(ESP_OK, client.post("http://api.local/reading", "{\"t\":21}", sink));
+    TEST_ASSERT_EQUAL_INT(1, server.seen["POST"]);
+
+    fake::http_close_connections();
+    TEST_ASSERT_EQUAL(ESP_OK, client.get("http://api.local/config", sink));
+    TEST_ASSERT_EQUAL_INT(2, server.seen["GET"]);
+    TEST_ASSERT_EQUAL_UINT32(3, fake::http_stats().connects);
+}
+
+// A reused connection dropped after the request went out: the server may have
+// acted on it, so a GET or HEAD is sent again and a POST is not
+void test_dropped_request_retried_only_when_idempotent() {
+    Server server;
+    HttpClient client;
+    DiscardSink sink;
+    int status = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, client.get("http://api.local/warm", sink));
+
+    server.drop = 1;
+    TEST_ASSERT_EQUAL(ESP_OK, client.get("http://api.local/config", sink));
+    TEST_ASSERT_EQUAL_INT(3, server.seen["GET"]);
+
+    server.drop = 1;
+    TEST_ASSERT_EQUAL(ESP_OK, client.request(HTTP_METHOD_HEAD, "http://api.local/config", nullptr, 0, sink,
+                                             &status));
+    TEST_ASSERT_EQUAL_INT(2, server.seen["HEAD"]);
+
+    server.drop = 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_HTTP_FETCH_HEADER, client.post("http://api.local/reading", "{\"t\":21}", sink));
+    TEST_ASSERT_EQUAL_INT(1, server.seen["POST"]);
+    TEST_ASSERT_EQUAL_INT(0, server.drop);
+
+    // The failed handle reconnects for the next request
+    TEST_ASSERT_EQUAL(ESP_OK, client.post("http://api.local/reading", "{\"t\":22}", sink));
+    TEST_ASSERT_EQUAL_INT(2, server.seen["POST"]);
+
+    // A fresh connection is never retried, whatever the method
+    fake::http_reset();
+    Server fresh;
+    fresh.drop = 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_HTTP_FETCH_HEADER, client.get("http://other.local/config", sink));
+    TEST_ASSERT_EQUAL_INT(1, fresh.seen["GET"]);
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_stale_connection_retried);
+    RUN_TEST(test_dropped_request_retried_only_when_idempotent);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,266 @@
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "HttpDeflate.hpp"
+#include "HttpInflateSink.hpp"
+#include "esp_http_client.h"
+
+// Inner sink: collects the decoded body and checks the fragments it is given
+class RecordingSink : public HttpSink {
+public:
+    std::string body;
+    int64_t content_length = 0;
+    size_t largest = 0;
+    size_t fail_after = SIZE_MAX;   // Abort once this many bytes have arrived
+    bool ended = false;
+    esp_err_t result = ESP_FAIL;
+
+    esp_err_t begin(int status, int64_t length) override {
+        content_length = length;
+        return ESP_OK;
+    }
+
+    esp_err_t write(const char* data, size_t len) override {
+        if (len > largest) largest = len;
+        body.append(data, len);
+        return body.size() >= fail_after ? ESP_ERR_NO_MEM : ESP_OK;
+    }
+
+    void end(esp_err_t r) override {
+        ended = true;
+        result = r;
+    }
+};
+
+static std::vector<uint8_t> compress(const std::string& body, http_encoding_t encoding) {
+    std::vector<uint32_t> hash(HTTP_DEFLATE_HASH_SIZE, 0);
+    std::vector<uint8_t> out(body.size() + body.size() / 4 + 64);
+    size_t out_len = 0;
+    TEST_ASSERT_TRUE(HttpDeflater::compress((const uint8_t*) body.data(), body.size(), encoding, out.data(),
+                                            out.size(), &out_len, hash.data()));
+    out.resize(out_len);
+    return out;
+}
+
+// Feeds encoded through an inflate sink in pieces of the given sizes, cycled;
+// returns the first error from write(), or finish() once everything is in
+static esp_err_t feed(HttpInflateSink& sink, const std::vector<uint8_t>& encoded, const std::vector<size_t>& steps) {
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sink.begin(200, (int64_t) encoded.size()));
+    size_t off = 0;
+    for (size_t k = 0; off < encoded.size(); k++) {
+        size_t n = steps[k % steps.size()];
+        if (n > encoded.size() - off) n = encoded.size() - off;
+        esp_err_t err = sink.write((const char*) encoded.data() + off, n);
+        if (err != ESP_OK) return err;
+        off += n;
+    }
+    return sink.finish();
+}
+
+static esp_err_t decode(const std::vector<uint8_t>& encoded, http_encoding_t encoding, RecordingSink& inner,
+                        const std::vector<size_t>& steps = {SIZE_MAX}) {
+    HttpInflateSink sink(&inner, encoding);
+    esp_err_t err = feed(sink, encoded, steps);
+    sink.end(err);
+    return err;
+}
+
+// Bodies: a JSON reading batch, text longer than the 32 KB window with repeats
+// near and far, a long run, incompressible bytes, one byte and nothing
+static std::vector<std::string> bodies() {
+    std::vector<std::string> out;
+    std::string json = "[";
+    for (int i = 0; i < 24; i++) {
+        json += "{\"id\":" + std::to_string(i) + ",\"t\":" + std::to_string(200 + i * 3 % 17) +
+                ",\"h\":" + std::to_string(40 + i % 9) + ",\"ok\":true,\"site\":\"greenhouse\"},";
+    }
+    json.back() = ']';
+    out.push_back(json);
+
+    std::string text;
+    uint32_t state = 2463534242u;
+    while (text.size() < 100000) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        text += "line " + std::to_string(state % 5000) + ": sensor " + std::to_string(state % 37) + " reads " +
+                std::to_string(state % 1000) + "\n";
+    }
+    out.push_back(text);
+
+    out.push_back(std::string(5000, 'a'));
+
+    std::string noise(3000, '\0');
+    for (char& c : noise) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        c = (char) state;
+    }
+    out.push_back(noise);
+    out.push_back("x");
+    out.push_back("");
+    return out;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_round_trip_in_fragments() {
+    const std::vector<std::vector<size_t>> splits = {{SIZE_MAX}, {1}, {7, 1, 300, 2, 64}, {4096, 3}};
+    for (http_encoding_t encoding : {HTTP_ENCODING_GZIP, HTTP_ENCODING_DEFLATE}) {
+        for (const std::string& body : bodies()) {
+            std::vector<uint8_t> encoded = compress(body, encoding);
+            for (const std::vector<size_t>& steps : splits) {
+                if (steps[0] == 1 && body.size() > 10000) continue;   // Byte at a time: small bodies only
+                RecordingSink inner;
+                HttpInflateSink sink(&inner, encoding);
+                TEST_ASSERT_EQUAL_INT(ESP_OK, feed(sink, encoded, steps));
+                TEST_ASSERT_EQUAL_size_t(body.size(), inner.body.size());
+                TEST_ASSERT_TRUE(inner.body == body);
+                TEST_ASSERT_EQUAL_INT64(-1, inner.content_length);
+                TEST_ASSERT_LESS_OR_EQUAL_size_t(HttpInflateSink::FRAGMENT, inner.largest);
+                TEST_ASSERT_EQUAL_size_t(encoded.size(), sink.encoded_bytes());
+                TEST_ASSERT_EQUAL_size_t(body.size(), sink.decoded_bytes());
+                sink.end(ESP_OK);
+                TEST_ASSERT_TRUE(inner.ended);
+            }
+        }
+    }
+}
+
+// Compressing only pays when the output fits in out_cap; the repetitive
+// bodies must actually shrink
+void test_compression_ratio_and_overflow() {
+    std::vector<std::string> b = bodies();
+    TEST_ASSERT_LESS_THAN_size_t(b[0].size() / 2, compress(b[0], HTTP_ENCODING_GZIP).size());
+    TEST_ASSERT_LESS_THAN_size_t(b[1].size() / 2, compress(b[1], HTTP_ENCODING_GZIP).size());
+    TEST_ASSERT_LESS_THAN_size_t(100, compress(b[2], HTTP_ENCODING_DEFLATE).size());
+
+    std::vector<uint32_t> hash(HTTP_DEFLATE_HASH_SIZE, 0);
+    std::vector<uint8_t> out(b[3].size());
+    size_t out_len = 0;
+    TEST_ASSERT_FALSE(HttpDeflater::compress((const uint8_t*) b[3].data(), b[3].size(), HTTP_ENCODING_GZIP,
+                                             out.data(), out.size(), &out_len, hash.data()));
+    TEST_ASSERT_FALSE(HttpDeflater::compress((const uint8_t*) b[0].data(), b[0].size(), HTTP_ENCODING_NONE,
+                                             out.data(), out.size(), &out_len, hash.data()));
+}
+
+// Servers may set the optional gzip header fields; they arrive split anywhere
+void test_gzip_optional_header_fields() {
+    std::string body = bodies()[0];
+    std::vector<uint8_t> plain = compress(body, HTTP_ENCODING_GZIP);
+    std::vector<uint8_t> encoded(plain.begin(), plain.begin() + 10);
+    encoded[3] = 0x02 | 0x04 | 0x08 | 0x10;   // FHCRC, FEXTRA, FNAME, FCOMMENT
+    const uint8_t extra[] = {6, 0, 'A', 'P', 2, 0, 1, 2};
+    encoded.insert(encoded.end(), extra, extra + sizeof(extra));
+    const char* name = "readings.json";
+    encoded.insert(encoded.end(), name, name + strlen(name) + 1);
+    const char* comment = "nightly";
+    encoded.insert(encoded.end(), comment, comment + strlen(comment) + 1);
+    encoded.push_back(0x12);
+    encoded.push_back(0x34);
+    encoded.insert(encoded.end(), plain.begin() + 10, plain.end());
+
+    for (size_t step : {(size_t) 1, (size_t) 5, SIZE_MAX}) {
+        RecordingSink inner;
+        TEST_ASSERT_EQUAL_INT(ESP_OK, decode(encoded, HTTP_ENCODING_GZIP, inner, {step}));
+        TEST_ASSERT_TRUE(inner.body == body);
+    }
+}
+
+// "deflate" without the zlib wrapper, as some servers send it
+void test_raw_deflate_accepted() {
+    std::string body = bodies()[0];
+    std::vector<uint8_t> zlib = compress(body, HTTP_ENCODING_DEFLATE);
+    std::vector<uint8_t> raw(zlib.begin() + 2, zlib.end() - 4);
+    RecordingSink inner;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, decode(raw, HTTP_ENCODING_DEFLATE, inner, {3}));
+    TEST_ASSERT_TRUE(inner.body == body);
+}
+
+void test_checksum_errors() {
+    std::string body = bodies()[1];
+
+    std::vector<uint8_t> gzip = compress(body, HTTP_ENCODING_GZIP);
+    std::vector<uint8_t> bad_crc = gzip;
+    bad_crc[bad_crc.size() - 8] ^= 0x01;
+    RecordingSink a;
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_CRC, decode(bad_crc, HTTP_ENCODING_GZIP, a, {1000}));
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_CRC, a.result);
+
+    std::vector<uint8_t> bad_size = gzip;
+    bad_size[bad_size.size() - 4] ^= 0x01;
+    RecordingSink b;
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_SIZE, decode(bad_size, HTTP_ENCODING_GZIP, b, {1000}));
+
+    std::vector<uint8_t> zlib = compress(body, HTTP_ENCODING_DEFLATE);
+    zlib[zlib.size() - 1] ^= 0x01;
+    RecordingSink c;
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_CRC, decode(zlib, HTTP_ENCODING_DEFLATE, c, {1000}));
+
+    std::vector<uint8_t> bad_magic = gzip;
+    bad_magic[1] = 0x8C;
+    RecordingSink d;
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_RESPONSE, decode(bad_magic, HTTP_ENCODING_GZIP, d));
+    TEST_ASSERT_EQUAL_size_t(0, d.body.size());
+}
+
+// A body cut short anywhere (header, deflate data, trailer) decodes what it
+// can and finish() reports it incomplete; bytes after the stream are ignored
+void test_truncation() {
+    std::string body = bodies()[0];
+    for (http_encoding_t encoding : {HTTP_ENCODING_GZIP, HTTP_ENCODING_DEFLATE}) {
+        std::vector<uint8_t> encoded = compress(body, encoding);
+        for (size_t keep : {(size_t) 1, (size_t) 5, encoded.size() / 2, encoded.size() - 5, encoded.size() - 1}) {
+            std::vector<uint8_t> cut(encoded.begin(), encoded.begin() + keep);
+            RecordingSink inner;
+            TEST_ASSERT_EQUAL_INT(ESP_ERR_HTTP_INCOMPLETE_DATA, decode(cut, encoding, inner, {13}));
+            TEST_ASSERT_TRUE(body.compare(0, inner.body.size(), inner.body) == 0);
+        }
+
+        std::vector<uint8_t> padded = encoded;
+        padded.insert(padded.end(), 16, 0xEE);
+        RecordingSink inner;
+        TEST_ASSERT_EQUAL_INT(ESP_OK, decode(padded, encoding, inner, {13}));
+        TEST_ASSERT_TRUE(inner.body == body);
+    }
+
+    // No body at all is complete
+    RecordingSink inner;
+    HttpInflateSink sink(&inner, HTTP_ENCODING_GZIP);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sink.begin(204, 0));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, sink.finish());
+    sink.end(ESP_OK);
+}
+
+// An error from the inner sink stops decoding and is returned unchanged
+void test_inner_sink_abort() {
+    std::string body = bodies()[1];
+    std::vector<uint8_t> encoded = compress(body, HTTP_ENCODING_GZIP);
+    RecordingSink inner;
+    inner.fail_after = 4000;
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_NO_MEM, decode(encoded, HTTP_ENCODING_GZIP, inner, {2048}));
+    TEST_ASSERT_LESS_THAN_size_t(4000 + HttpInflateSink::FRAGMENT, inner.body.size());
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_NO_MEM, inner.result);
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_in_fragments);
+    RUN_TEST(test_compression_ratio_and_overflow);
+    RUN_TEST(test_gzip_optional_header_fields);
+    RUN_TEST(test_raw_deflate_accepted);
+    RUN_TEST(test_checksum_errors);
+    RUN_TEST(test_truncation);
+    RUN_TEST(test_inner_sink_abort);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,251 @@
+#include <unity.h>
+#include "HttpRequestQueue.hpp"
+#ifndef ESP_PLATFORM
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "host_fakes.hpp"
+
+static bool wait_for(const std::function<bool()>& condition, int timeout_ms = 5000) {
+    for (int i = 0; i < timeout_ms; i++) {
+        if (condition()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+
+// Fake server that holds requests for /block until released, and records the
+// order in which requests reached it
+class Server {
+public:
+    Server() {
+        fake::http_set_responder([this](const fake::HttpRequest& request) {
+            std::unique_lock<std::mutex> guard(_lock);
+            _seen.push_back(request.url.substr(request.url.rfind('/') + 1));
+            if (request.url.find("/block") != std::string::npos) {
+                _blocked++;
+                _cv.wait(guard, [this] { return _released; });
+            }
+            fake::HttpResponse response;
+            response.body = "ok";
+            return response;
+        });
+    }
+
+    ~Server() {
+        release();
+        fake::http_reset();
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _released = true;
+        }
+        _cv.notify_all();
+    }
+
+    bool wait_blocked(int n) {
+        return wait_for([&] {
+            std::lock_guard<std::mutex> guard(_lock);
+            return _blocked >= n;
+        });
+    }
+
+    std::vector<std::string> seen() {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _seen;
+    }
+
+private:
+    std::mutex _lock;
+    std::condition_variable _cv;
+    std::vector<std::string> _seen;
+    int _blocked = 0;
+    bool _released = false;
+};
+
+struct Results {
+    std::mutex lock;
+    std::vector<std::pair<std::string, esp_err_t>> done;
+
+    HttpCompletion record(const std::string& name) {
+        return [this, name](const HttpResponse& response) {
+            std::lock_guard<std::mutex> guard(lock);
+            done.push_back({name, response.err});
+        };
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> guard(lock);
+        return done.size();
+    }
+
+    esp_err_t err(const std::string& name) {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto& d : done) {
+            if (d.first == name) return d.second;
+        }
+        return ESP_FAIL;
+    }
+};
+
+static HttpRequest make(const std::string& name, http_priority_t priority, Results& results,
+                        uint32_t timeout_ms = 0) {
+    HttpRequest request;
+    request.url = "http://queue.local/" + name;
+    request.priority = priority;
+    request.timeout_ms = timeout_ms;
+    request.on_complete = results.record(name);
+    return request;
+}
+#endif
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_cancelled_has_its_own_code() {
+    TEST_ASSERT_NOT_EQUAL(ESP_ERR_INVALID_STATE, HTTP_REQUEST_CANCELLED);
+    TEST_ASSERT_NOT_EQUAL(ESP_ERR_TIMEOUT, HTTP_REQUEST_CANCELLED);
+    TEST_ASSERT_NOT_EQUAL(ESP_ERR_HTTP_CONNECTION_CLOSED, HTTP_REQUEST_CANCELLED);
+}
+
+#ifndef ESP_PLATFORM
+// With the only worker busy, waiting requests go out highest priority first,
+// in submission order within a priority
+void test_priority_then_fifo() {
+    Server server;
+    Results results;
+    HttpRequestQueue queue(1);
+    TEST_ASSERT_NOT_EQUAL(0, queue.submit(make("block", HTTP_PRIORITY_NORMAL, results)));
+    TEST_ASSERT_TRUE(server.wait_blocked(1));
+
+    queue.submit(make("low1", HTTP_PRIORITY_LOW, results));
+    queue.submit(make("normal1", HTTP_PRIORITY_NORMAL, results));
+    queue.submit(make("high1", HTTP_PRIORITY_HIGH, results));
+    queue.submit(make("normal2", HTTP_PRIORITY_NORMAL, results));
+    queue.submit(make("low2", HTTP_PRIORITY_LOW, results));
+    queue.submit(make("high2", HTTP_PRIORITY_HIGH, results));
+    TEST_ASSERT_EQUAL_size_t(6, queue.pending());
+
+    server.release();
+    TEST_ASSERT_TRUE(wait_for([&] { return results.size() == 7; }));
+    std::vector<std::string> expected = {"block", "high1", "high2", "normal1", "normal2", "low1", "low2"};
+    std::vector<std::string> seen = server.seen();
+    TEST_ASSERT_EQUAL_size_t(expected.size(), seen.size());
+    for (size_t i = 0; i < expected.size(); i++) TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), seen[i].c_str());
+    TEST_ASSERT_EQUAL_UINT32(7, queue.stats().completed);
+    TEST_ASSERT_EQUAL_UINT32(6, queue.stats().peak_pending);
+}
+
+// A request whose deadline passes while it waits fails with ESP_ERR_TIMEOUT and
+// never reaches the server
+void test_deadline_expires_while_pending() {
+    Server server;
+    Results results;
+    HttpRequestQueue queue(1);
+    queue.submit(make("block", HTTP_PRIORITY_NORMAL, results));
+    TEST_ASSERT_TRUE(server.wait_blocked(1));
+    queue.submit(make("late", HTTP_PRIORITY_HIGH, results, 20));
+    queue.submit(make("patient", HTTP_PRIORITY_NORMAL, results, 10000));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    server.release();
+    TEST_ASSERT_TRUE(wait_for([&] { return results.size() == 3; }));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, results.err("late"));
+    TEST_ASSERT_EQUAL(ESP_OK, results.err("patient"));
+    for (const std::string& url : server.seen()) TEST_ASSERT_NOT_EQUAL(0, url.compare("late"));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats().timed_out);
+}
+
+void test_cancel_pending_request() {
+    Server server;
+    Results results;
+    HttpRequestQueue queue(1);
+    queue.submit(make("block", HTTP_PRIORITY_NORMAL, results));
+    TEST_ASSERT_TRUE(server.wait_blocked(1));
+    uint32_t id = queue.submit(make("doomed", HTTP_PRIORITY_NORMAL, results));
+    queue.submit(make("kept", HTTP_PRIORITY_NORMAL, results));
+
+    TEST_ASSERT_TRUE(queue.cancel(id));
+    TEST_ASSERT_FALSE(queue.cancel(12345));
+    server.release();
+    TEST_ASSERT_TRUE(wait_for([&] { return results.size() == 3; }));
+    TEST_ASSERT_EQUAL(HTTP_REQUEST_CANCELLED, results.err("doomed"));
+    TEST_ASSERT_EQUAL(ESP_OK, results.err("kept"));
+    for (const std::string& url : server.seen()) TEST_ASSERT_NOT_EQUAL(0, url.compare("doomed"));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats().cancelled);
+    TEST_ASSERT_FALSE(queue.cancel(id));   // Already completed
+}
+
+// Cancelling a request the server is answering aborts it before the body is delivered
+void test_cancel_running_request() {
+    Server server;
+    Results results;
+    HttpRequestQueue queue(1);
+    uint32_t id = queue.submit(make("block", HTTP_PRIORITY_NORMAL, results));
+    TEST_ASSERT_TRUE(server.wait_blocked(1));
+    TEST_ASSERT_EQUAL_size_t(0, queue.pending());
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats().in_flight);
+
+    TEST_ASSERT_TRUE(queue.cancel(id));
+    server.release();
+    TEST_ASSERT_TRUE(wait_for([&] { return results.size() == 1; }));
+    TEST_ASSERT_EQUAL(HTTP_REQUEST_CANCELLED, results.err("block"));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats().cancelled);
+    // Counted out after the completion callback has run
+    TEST_ASSERT_TRUE(wait_for([&] { return queue.stats().in_flight == 0; }));
+
+    // The worker carries on with the next request
+    queue.submit(make("next", HTTP_PRIORITY_NORMAL, results));
+    TEST_ASSERT_TRUE(wait_for([&] { return results.size() == 2; }));
+    TEST_ASSERT_EQUAL(ESP_OK, results.err("next"));
+}
+
+// Requests still waiting when the queue goes away complete as cancelled
+void test_destruction_cancels_pending() {
+    Server server;
+    Results results;
+    std::unique_ptr<HttpRequestQueue> queue(new HttpRequestQueue(1));
+    queue->submit(make("block", HTTP_PRIORITY_NORMAL, results));
+    TEST_ASSERT_TRUE(server.wait_blocked(1));
+    queue->submit(make("left1", HTTP_PRIORITY_NORMAL, results));
+    queue->submit(make("left2", HTTP_PRIORITY_LOW, results));
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        server.release();
+    });
+    // Waits for the running request, which is cancelled as well
+    queue.reset();
+    releaser.join();
+    TEST_ASSERT_EQUAL_size_t(3, results.size());
+    TEST_ASSERT_EQUAL(HTTP_REQUEST_CANCELLED, results.err("left1"));
+    TEST_ASSERT_EQUAL(HTTP_REQUEST_CANCELLED, results.err("left2"));
+    TEST_ASSERT_EQUAL(HTTP_REQUEST_CANCELLED, results.err("block"));
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_cancelled_has_its_own_code);
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_priority_then_fifo);
+    RUN_TEST(test_deadline_expires_while_pending);
+    RUN_TEST(test_cancel_pending_request);
+    RUN_TEST(test_cancel_running_request);
+    RUN_TEST(test_destruction_cancels_pending);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
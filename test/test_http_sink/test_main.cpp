@@ -0,0 +1,165 @@
+#include <unity.h>
+#include <stdint.h>
+#include <string>
+#include "HttpSink.hpp"
+#ifndef ESP_PLATFORM
+#include "HttpClient.hpp"
+#include "host_fakes.hpp"
+#endif
+
+// Collects what a sink saw, and fails the write that takes it past fail_after
+class RecordingSink : public HttpSink {
+public:
+    std::string body;
+    size_t fail_after = SIZE_MAX;
+    int begins = 0;
+    int ends = 0;
+    esp_err_t result = ESP_OK;
+
+    esp_err_t begin(int status, int64_t content_length) override {
+        begins++;
+        body.clear();
+        return ESP_OK;
+    }
+
+    esp_err_t write(const char* data, size_t len) override {
+        if (body.size() + len > fail_after) return ESP_FAIL;
+        body.append(data, len);
+        return ESP_OK;
+    }
+
+    void end(esp_err_t err) override {
+        ends++;
+        result = err;
+    }
+};
+
+// HttpClient reads the body 512 bytes at a time
+static const size_t READ_WINDOW = 512;
+
+static std::string pattern(size_t n) {
+    std::string s(n, 0);
+    for (size_t i = 0; i < n; i++) s[i] = (char) ('a' + i % 26);
+    return s;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// An announced length over the cap is refused before anything is reserved
+void test_content_length_over_cap() {
+    std::string out;
+    StringSink sink(out, 1024);
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, sink.begin(200, 1025));
+    TEST_ASSERT_LESS_THAN_size_t(1024, out.capacity());
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, sink.begin(200, INT64_MAX));
+    TEST_ASSERT_LESS_THAN_size_t(1024, out.capacity());
+
+    TEST_ASSERT_EQUAL(ESP_OK, sink.begin(200, 1024));
+    TEST_ASSERT_GREATER_OR_EQUAL_size_t(1024, out.capacity());
+
+    // The default cap applies when none is given
+    std::string big;
+    StringSink fallback(big);
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, fallback.begin(200, StringSink::DEFAULT_MAX_SIZE + 1));
+    TEST_ASSERT_EQUAL(ESP_OK, fallback.begin(200, StringSink::DEFAULT_MAX_SIZE));
+}
+
+// Without a length the body grows up to the cap and the write past it fails,
+// leaving what was collected
+void test_chunked_body_stops_at_cap() {
+    pool_string out;
+    PoolStringSink sink(out, 100);
+    std::string data = pattern(40);
+    TEST_ASSERT_EQUAL(ESP_OK, sink.begin(200, -1));
+    TEST_ASSERT_EQUAL(ESP_OK, sink.write(data.data(), 40));
+    TEST_ASSERT_EQUAL(ESP_OK, sink.write(data.data(), 40));
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, sink.write(data.data(), 21));
+    TEST_ASSERT_EQUAL_size_t(80, out.size());
+    TEST_ASSERT_EQUAL(ESP_OK, sink.write(data.data(), 20));
+    TEST_ASSERT_EQUAL_size_t(100, out.size());
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, sink.write(data.data(), 1));
+
+    // begin() starts over
+    TEST_ASSERT_EQUAL(ESP_OK, sink.begin(200, 0));
+    TEST_ASSERT_EQUAL_size_t(0, out.size());
+}
+
+#ifndef ESP_PLATFORM
+// Chunked responses arrive over several read windows; one over the cap aborts
+// the transfer and the client stays usable
+void test_client_chunked_response() {
+    std::string served = pattern(3000);
+    fake::http_set_responder([&](const fake::HttpRequest& request) {
+        fake::HttpResponse response;
+        response.body = served;
+        response.chunked = request.url.find("/chunked") != std::string::npos;
+        return response;
+    });
+    HttpClient client;
+
+    pool_string out;
+    PoolStringSink sink(out, 4096);
+    TEST_ASSERT_EQUAL(ESP_OK, client.get("http://sink.local/chunked", sink));
+    TEST_ASSERT_EQUAL_size_t(served.size(), out.size());
+    TEST_ASSERT_TRUE(served == std::string(out.data(), out.size()));
+
+    PoolStringSink small(out, 1000);
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, client.get("http://sink.local/chunked", small));
+    // Whole read windows up to the cap were kept
+    TEST_ASSERT_EQUAL_size_t(1000 / READ_WINDOW * READ_WINDOW, out.size());
+    TEST_ASSERT_TRUE(served.compare(0, out.size(), out.data(), out.size()) == 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, client.get("http://sink.local/length", small));
+    TEST_ASSERT_EQUAL_size_t(0, out.size());
+
+    TEST_ASSERT_EQUAL(ESP_OK, client.get("http://sink.local/length", sink));
+    TEST_ASSERT_TRUE(served == std::string(out.data(), out.size()));
+    fake::http_reset();
+}
+
+// An error from write() stops the transfer: it is what perform returns, end()
+// sees it once, and the next request on the client gets a whole body
+void test_client_abort_from_sink() {
+    std::string served = pattern(5000);
+    fake::http_set_responder([&](const fake::HttpRequest&) {
+        fake::HttpResponse response;
+        response.body = served;
+        return response;
+    });
+    HttpClient client;
+
+    RecordingSink sink;
+    sink.fail_after = 2 * READ_WINDOW;
+    TEST_ASSERT_EQUAL(ESP_FAIL, client.get("http://sink.local/a", sink));
+    TEST_ASSERT_EQUAL_INT(1, sink.begins);
+    TEST_ASSERT_EQUAL_INT(1, sink.ends);
+    TEST_ASSERT_EQUAL(ESP_FAIL, sink.result);
+    TEST_ASSERT_EQUAL_size_t(2 * READ_WINDOW, sink.body.size());
+
+    sink.fail_after = SIZE_MAX;
+    TEST_ASSERT_EQUAL(ESP_OK, client.get("http://sink.local/a", sink));
+    TEST_ASSERT_EQUAL_INT(2, sink.ends);
+    TEST_ASSERT_EQUAL(ESP_OK, sink.result);
+    TEST_ASSERT_TRUE(served == sink.body);
+    // The aborted connection had unread body left, so it was not reused
+    TEST_ASSERT_EQUAL_UINT32(2, fake::http_stats().connects);
+    fake::http_reset();
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_content_length_over_cap);
+    RUN_TEST(test_chunked_body_stops_at_cap);
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_client_chunked_response);
+    RUN_TEST(test_client_abort_from_sink);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,136 @@
+#include <unity.h>
+#ifndef ESP_PLATFORM
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "host_fakes.hpp"
+#include "Mqtt_Connection.hpp"
+
+// Ends the process if a test hangs: a deadlocked test never returns to Unity
+class Watchdog {
+public:
+    explicit Watchdog(int seconds) {
+        _thread = std::thread([this, seconds] {
+            std::unique_lock<std::mutex> guard(_lock);
+            if (!_done.wait_for(guard, std::chrono::seconds(seconds), [this] { return _stop; })) {
+                fprintf(stderr, "Watchdog: test still running after %d s, deadlocked\n", seconds);
+                fflush(stderr);
+                _exit(1);
+            }
+        });
+    }
+
+    ~Watchdog() {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _stop = true;
+        }
+        _done.notify_one();
+        _thread.join();
+    }
+
+private:
+    std::mutex _lock;
+    std::condition_variable _done;
+    bool _stop = false;
+    std::thread _thread;
+};
+
+static bool wait_for(const std::function<bool()>& condition, int timeout_ms = 5000) {
+    for (int i = 0; i < timeout_ms; i++) {
+        if (condition()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+
+// Messages on topic, in the order the broker received them
+static std::vector<std::string> published_on(const std::string& topic) {
+    std::vector<std::string> out;
+    for (const fake::MqttMessage& m : fake::mqtt_published()) {
+        if (m.topic == topic) out.push_back(m.payload);
+    }
+    return out;
+}
+
+void setUp(void) { fake::mqtt_reset(); }
+void tearDown(void) {}
+
+// A handler runs on the MQTT task, which holds the esp-mqtt API lock while it
+// dispatches. Publishing from it while an application thread publishes (and
+// the drain timer moves the backlog) must neither deadlock nor lose or
+// reorder messages.
+void test_handler_publishes_while_another_thread_publishes() {
+    const int N = 2000;
+    Watchdog watchdog(30);
+
+    MqttOutboxConfig outbox;
+    outbox.inflight_budget = 1024;         // Small: publishes often queue and drain
+    outbox.memory_budget = 1024 * 1024;
+    Mqtt_Connection mqtt;
+    mqtt.begin("mqtt://test.local", outbox);
+    TEST_ASSERT_TRUE(wait_for([&] { return mqtt.session_stats().connects > 0; }));
+
+    std::atomic<int> handled{0}, refused{0};
+    TEST_ASSERT_GREATER_OR_EQUAL_INT(0, mqtt.subscribe("cmd/#", 1, [&](std::string_view, std::string_view payload) {
+        // Some work first, so the application thread is inside publish() by then
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        if (mqtt.publish("reply", payload, 1) != ESP_OK) refused++;
+        handled++;
+    }));
+    fake::mqtt_flush();
+
+    // The application keeps publishing until every command has been handled
+    std::atomic<bool> stop{false};
+    int sent = 0;
+    std::thread app([&] {
+        while (!stop) {
+            if (mqtt.publish("telemetry", std::to_string(sent), 1) != ESP_OK) refused++;
+            sent++;
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    });
+    for (int i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL_INT(1, fake::mqtt_deliver("cmd/run", std::to_string(i)));
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    bool all_handled = wait_for([&] { return handled.load() == N; }, 20000);
+    stop = true;
+    app.join();
+    TEST_ASSERT_TRUE(all_handled);
+    TEST_ASSERT_TRUE(wait_for([&] {
+        fake::mqtt_flush();
+        mqtt_outbox_stats_t s = mqtt.outbox_stats();
+        return s.queued_messages == 0 && s.esp_outbox_bytes == 0;
+    }));
+    TEST_ASSERT_EQUAL_INT(0, refused.load());
+
+    std::vector<std::string> replies = published_on("reply");
+    std::vector<std::string> telemetry = published_on("telemetry");
+    TEST_ASSERT_EQUAL_size_t(N, replies.size());
+    TEST_ASSERT_EQUAL_size_t(sent, telemetry.size());
+    for (int i = 0; i < N; i++) TEST_ASSERT_EQUAL_STRING(std::to_string(i).c_str(), replies[i].c_str());
+    for (int i = 0; i < sent; i++) TEST_ASSERT_EQUAL_STRING(std::to_string(i).c_str(), telemetry[i].c_str());
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_handler_publishes_while_another_thread_publishes);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,146 @@
+#include <unity.h>
+#include <stdint.h>
+#include <string>
+#include "MqttTopicAliases.hpp"
+
+static std::string topic(int i) {
+    return "sensors/esp32-a1b2c3/channel" + std::to_string(i);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// A topic is sent plainly until its hot_after-th publish, which sets up the
+// alias with the topic; after that only the alias goes out
+void test_alias_after_hot_after_publishes() {
+    MqttTopicAliases aliases;
+    aliases.reset(4, 3);
+    bool with_topic = false;
+    std::string t = topic(0);
+
+    TEST_ASSERT_EQUAL_UINT16(0, aliases.lookup(t, &with_topic));
+    TEST_ASSERT_TRUE(with_topic);
+    TEST_ASSERT_EQUAL_UINT16(0, aliases.lookup(t, &with_topic));
+    TEST_ASSERT_EQUAL_UINT16(1, aliases.lookup(t, &with_topic));
+    TEST_ASSERT_TRUE(with_topic);
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL_UINT16(1, aliases.lookup(t, &with_topic));
+        TEST_ASSERT_FALSE(with_topic);
+    }
+
+    mqtt_alias_stats_t s = aliases.stats();
+    TEST_ASSERT_EQUAL_UINT32(2, s.plain);
+    TEST_ASSERT_EQUAL_UINT32(1, s.established);
+    TEST_ASSERT_EQUAL_UINT32(10, s.aliased);
+    TEST_ASSERT_EQUAL_INT64(10 * ((int64_t) t.size() - 3) - 3, s.bytes_saved);
+
+    // A second topic gets the next alias, and reset() forgets both
+    std::string u = topic(1);
+    aliases.lookup(u, &with_topic);
+    aliases.lookup(u, &with_topic);
+    TEST_ASSERT_EQUAL_UINT16(2, aliases.lookup(u, &with_topic));
+    aliases.reset(4, 1);
+    TEST_ASSERT_EQUAL_UINT16(1, aliases.lookup(u, &with_topic));
+    TEST_ASSERT_TRUE(with_topic);
+}
+
+void test_disabled() {
+    MqttTopicAliases aliases;
+    bool with_topic = false;
+    TEST_ASSERT_FALSE(aliases.enabled());
+    TEST_ASSERT_EQUAL_UINT16(0, aliases.lookup(topic(0), &with_topic));
+
+    aliases.reset(0, 1);
+    TEST_ASSERT_EQUAL_UINT16(0, aliases.lookup(topic(0), &with_topic));
+    TEST_ASSERT_TRUE(with_topic);
+
+    aliases.reset(2, 1);
+    TEST_ASSERT_EQUAL_UINT16(1, aliases.lookup(topic(0), &with_topic));
+    TEST_ASSERT_EQUAL_UINT16(0, aliases.lookup("", &with_topic));
+    aliases.disable();
+    TEST_ASSERT_FALSE(aliases.enabled());
+    TEST_ASSERT_EQUAL_UINT16(0, aliases.lookup(topic(0), &with_topic));
+    TEST_ASSERT_TRUE(with_topic);
+
+    // Capacity is clamped to MAX_ALIASES
+    MqttTopicAliases many;
+    many.reset(100, 1);
+    for (int i = 0; i < 40; i++) many.lookup(topic(i), &with_topic);
+    TEST_ASSERT_EQUAL_UINT32(MqttTopicAliases::MAX_ALIASES, many.stats().established);
+}
+
+// With every alias taken, a hot topic waits until one has gone unused for
+// COLD_AFTER publishes, then takes the least recently used cold one
+void test_cold_alias_reused() {
+    MqttTopicAliases aliases;
+    aliases.reset(2, 1);
+    bool with_topic = false;
+    std::string a = topic(0), b = topic(1), c = topic(2);
+    TEST_ASSERT_EQUAL_UINT16(1, aliases.lookup(a, &with_topic));
+    TEST_ASSERT_EQUAL_UINT16(2, aliases.lookup(b, &with_topic));
+
+    // Keep b warm while c asks; a, last used on publish 1, is cold once the
+    // next publish is COLD_AFTER past it
+    uint32_t tick = 2;
+    while (tick < MqttTopicAliases::COLD_AFTER) {
+        TEST_ASSERT_EQUAL_UINT16(0, aliases.lookup(c, &with_topic));
+        TEST_ASSERT_EQUAL_UINT16(2, aliases.lookup(b, &with_topic));
+        tick += 2;
+    }
+    TEST_ASSERT_EQUAL_UINT16(1, aliases.lookup(c, &with_topic));
+    TEST_ASSERT_TRUE(with_topic);
+    TEST_ASSERT_EQUAL_UINT16(1, aliases.lookup(c, &with_topic));
+    TEST_ASSERT_FALSE(with_topic);
+
+    // a lost its alias: plain again, and the mapping is not handed back to it
+    TEST_ASSERT_EQUAL_UINT16(0, aliases.lookup(a, &with_topic));
+    TEST_ASSERT_TRUE(with_topic);
+    TEST_ASSERT_EQUAL_UINT32(3, aliases.stats().established);
+}
+
+// The case from the header comment: more topics in rotation than aliases.
+// The first topics to get hot keep their aliases; the rest stay plain instead
+// of evicting them, so mappings are set up once
+void test_rotation_does_not_thrash() {
+    MqttTopicAliases aliases;
+    aliases.reset(5, 2);
+    std::string topics[8];
+    for (int i = 0; i < 8; i++) topics[i] = topic(i);
+
+    bool with_topic = false;
+    for (int i = 0; i < 1000; i++) aliases.lookup(topics[i % 8], &with_topic);
+    mqtt_alias_stats_t s = aliases.stats();
+    TEST_ASSERT_EQUAL_UINT32(5, s.established);
+    // Rounds 1 and 2 are plain (8 + 3), then 5 of every 8 go by alias
+    TEST_ASSERT_EQUAL_UINT32(1000 - 5 - s.aliased, s.plain);
+    TEST_ASSERT_EQUAL_UINT32(1000 / 8 * 5 - 10, s.aliased);
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_UINT16(i + 1, aliases.lookup(topics[i], &with_topic));
+        TEST_ASSERT_FALSE(with_topic);
+    }
+    for (int i = 5; i < 8; i++) TEST_ASSERT_EQUAL_UINT16(0, aliases.lookup(topics[i], &with_topic));
+
+    // More distinct topics than CANDIDATES, each seen once per rotation, never
+    // get hot: each is forgotten before it comes round again
+    MqttTopicAliases wide;
+    wide.reset(5, 2);
+    for (int i = 0; i < 1000; i++) wide.lookup(topic(100 + i % 20), &with_topic);
+    TEST_ASSERT_EQUAL_UINT32(0, wide.stats().established);
+    TEST_ASSERT_EQUAL_UINT32(1000, wide.stats().plain);
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_alias_after_hot_after_publishes);
+    RUN_TEST(test_disabled);
+    RUN_TEST(test_cold_alias_reused);
+    RUN_TEST(test_rotation_does_not_thrash);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
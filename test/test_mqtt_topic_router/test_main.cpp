@@ -0,0 +1,186 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "MqttTopicRouter.hpp"
+
+// Records which subscriptions saw a message, by name
+struct Calls {
+    std::vector<std::string> names;
+
+    MqttMessageHandler handler(const std::string& name) {
+        return [this, name](std::string_view, std::string_view) { names.push_back(name); };
+    }
+
+    std::string take() {
+        std::string all;
+        for (const std::string& n : names) all += (all.empty() ? "" : ",") + n;
+        names.clear();
+        return all;
+    }
+};
+
+static std::string levels(size_t n, const char* last = "x") {
+    std::string topic;
+    for (size_t i = 1; i < n; i++) topic += "l/";
+    return topic + last;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_wildcards() {
+    MqttTopicRouter router;
+    Calls calls;
+    router.add("a/b/c", calls.handler("exact"));
+    router.add("a/+/c", calls.handler("plus"));
+    router.add("a/#", calls.handler("a#"));
+    router.add("+/+", calls.handler("two"));
+    router.add("#", calls.handler("all"));
+
+    // Every matching filter runs once, overlapping or not
+    TEST_ASSERT_EQUAL_size_t(4, router.dispatch("a/b/c", "p"));
+    TEST_ASSERT_EQUAL_STRING("all,a#,exact,plus", calls.take().c_str());
+
+    // '+' is exactly one level, possibly empty
+    TEST_ASSERT_EQUAL_size_t(3, router.dispatch("a//c", "p"));
+    TEST_ASSERT_EQUAL_STRING("all,a#,plus", calls.take().c_str());
+    TEST_ASSERT_EQUAL_size_t(2, router.dispatch("a/b/b/c", "p"));
+    TEST_ASSERT_EQUAL_STRING("all,a#", calls.take().c_str());
+
+    // 'a/#' also matches the parent level 'a' itself
+    TEST_ASSERT_EQUAL_size_t(2, router.dispatch("a", "p"));
+    TEST_ASSERT_EQUAL_STRING("all,a#", calls.take().c_str());
+    TEST_ASSERT_EQUAL_size_t(3, router.dispatch("a/", "p"));
+    TEST_ASSERT_EQUAL_STRING("all,a#,two", calls.take().c_str());
+
+    TEST_ASSERT_EQUAL_size_t(1, router.dispatch("b", "p"));
+    TEST_ASSERT_EQUAL_STRING("all", calls.take().c_str());
+
+    // Two subscriptions to one filter are two handlers
+    router.add("a/b/c", calls.handler("exact2"));
+    TEST_ASSERT_EQUAL_size_t(5, router.dispatch("a/b/c", "p"));
+    TEST_ASSERT_EQUAL_STRING("all,a#,exact,exact2,plus", calls.take().c_str());
+}
+
+// Wildcards in the first level never match '$' topics; filters naming the
+// '$' level do
+void test_dollar_topics() {
+    MqttTopicRouter router;
+    Calls calls;
+    router.add("#", calls.handler("all"));
+    router.add("+/broker/load", calls.handler("plus"));
+    router.add("+/#", calls.handler("plus#"));
+    router.add("$SYS/#", calls.handler("sys#"));
+    router.add("$SYS/+/load", calls.handler("sys+"));
+
+    TEST_ASSERT_EQUAL_size_t(2, router.dispatch("$SYS/broker/load", "1"));
+    TEST_ASSERT_EQUAL_STRING("sys#,sys+", calls.take().c_str());
+    TEST_ASSERT_EQUAL_size_t(1, router.dispatch("$SYS", "1"));
+    TEST_ASSERT_EQUAL_STRING("sys#", calls.take().c_str());
+
+    // '$' only counts at the start of the first level
+    TEST_ASSERT_EQUAL_size_t(3, router.dispatch("x/broker/load", "1"));
+    TEST_ASSERT_EQUAL_STRING("all,plus#,plus", calls.take().c_str());
+    TEST_ASSERT_EQUAL_size_t(2, router.dispatch("x/$SYS", "1"));
+    TEST_ASSERT_EQUAL_STRING("all,plus#", calls.take().c_str());
+}
+
+void test_filter_validation_and_max_levels() {
+    MqttTopicRouter router;
+    Calls calls;
+    for (const char* bad : {"", "a/#/b", "a/b#", "a+/b", "#/a", "a/++"}) {
+        TEST_ASSERT_EQUAL_INT(-1, router.add(bad, calls.handler("bad")));
+    }
+    TEST_ASSERT_EQUAL_size_t(0, router.size());
+
+    // 32 levels are accepted, 33 refused instead of being cut to 32
+    std::string deepest = levels(MqttTopicRouter::MAX_LEVELS);
+    TEST_ASSERT_GREATER_THAN_INT(0, router.add(deepest, calls.handler("deep")));
+    TEST_ASSERT_EQUAL_INT(-1, router.add(levels(MqttTopicRouter::MAX_LEVELS + 1), calls.handler("deeper")));
+    TEST_ASSERT_EQUAL_INT(-1, router.add(levels(MqttTopicRouter::MAX_LEVELS + 1, "#"), calls.handler("deeper")));
+    TEST_ASSERT_GREATER_THAN_INT(0, router.add(levels(MqttTopicRouter::MAX_LEVELS, "#"), calls.handler("deep#")));
+    TEST_ASSERT_GREATER_THAN_INT(0, router.add("#", calls.handler("all")));
+    TEST_ASSERT_EQUAL_size_t(3, router.size());
+
+    TEST_ASSERT_EQUAL_size_t(3, router.dispatch(deepest, "p"));
+    TEST_ASSERT_EQUAL_STRING("all,deep#,deep", calls.take().c_str());
+
+    // A topic deeper than MAX_LEVELS matches nothing, not even '#', rather
+    // than matching on its first 32 levels
+    TEST_ASSERT_EQUAL_size_t(0, router.dispatch(levels(MqttTopicRouter::MAX_LEVELS + 1), "p"));
+    TEST_ASSERT_EQUAL_STRING("", calls.take().c_str());
+}
+
+void test_remove() {
+    MqttTopicRouter router;
+    Calls calls;
+    int a = router.add("a/+", calls.handler("a"));
+    int b = router.add("a/#", calls.handler("b"));
+    TEST_ASSERT_TRUE(router.remove(a));
+    TEST_ASSERT_FALSE(router.remove(a));
+    TEST_ASSERT_FALSE(router.remove(0));
+    TEST_ASSERT_FALSE(router.remove(12345));
+    TEST_ASSERT_EQUAL_size_t(1, router.dispatch("a/x", "p"));
+    TEST_ASSERT_EQUAL_STRING("b", calls.take().c_str());
+    TEST_ASSERT_TRUE(router.remove(b));
+    TEST_ASSERT_EQUAL_size_t(0, router.dispatch("a/x", "p"));
+    TEST_ASSERT_EQUAL_size_t(0, router.size());
+}
+
+// Changes from inside a handler apply once dispatch returns; a handler removed
+// mid-dispatch is not called again for that message
+void test_changes_from_a_handler() {
+    MqttTopicRouter router;
+    Calls calls;
+    int first = 0, second = 0, added = 0;
+
+    // The first handler removes itself and the next one and adds a new filter
+    // that matches the same topic
+    first = router.add("t/+", [&](std::string_view, std::string_view) {
+        calls.names.push_back("first");
+        TEST_ASSERT_TRUE(router.remove(first));
+        TEST_ASSERT_TRUE(router.remove(second));
+        added = router.add("t/#", calls.handler("added"));
+        TEST_ASSERT_GREATER_THAN_INT(0, added);
+    });
+    second = router.add("t/+", calls.handler("second"));
+    router.add("t/x", calls.handler("exact"));
+
+    TEST_ASSERT_EQUAL_size_t(2, router.dispatch("t/x", "p"));
+    TEST_ASSERT_EQUAL_STRING("exact,first", calls.take().c_str());
+    TEST_ASSERT_EQUAL_size_t(2, router.size());
+
+    TEST_ASSERT_EQUAL_size_t(2, router.dispatch("t/x", "p"));
+    TEST_ASSERT_EQUAL_STRING("added,exact", calls.take().c_str());
+
+    // A filter added and removed within one dispatch never runs; a nested
+    // dispatch from a handler sees the table as it was
+    router.add("n/1", [&](std::string_view, std::string_view) {
+        calls.names.push_back("outer");
+        int temp = router.add("n/2", calls.handler("temp"));
+        TEST_ASSERT_EQUAL_size_t(1, router.dispatch("n/2", "p"));
+        TEST_ASSERT_TRUE(router.remove(temp));
+    });
+    router.add("n/2", calls.handler("inner"));
+    TEST_ASSERT_EQUAL_size_t(1, router.dispatch("n/1", "p"));
+    TEST_ASSERT_EQUAL_STRING("outer,inner", calls.take().c_str());
+    TEST_ASSERT_EQUAL_size_t(1, router.dispatch("n/2", "p"));
+    TEST_ASSERT_EQUAL_STRING("inner", calls.take().c_str());
+    TEST_ASSERT_EQUAL_size_t(4, router.size());
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_wildcards);
+    RUN_TEST(test_dollar_topics);
+    RUN_TEST(test_filter_validation_and_max_levels);
+    RUN_TEST(test_remove);
+    RUN_TEST(test_changes_from_a_handler);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,166 @@
+#include <unity.h>
+#include "PulseCounterMath.hpp"
+#ifndef ESP_PLATFORM
+#include "host_fakes.hpp"
+#include "GPIO.hpp"
+#endif
+
+static const int32_t LIMIT = 32767;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ---- PulseCounterMath ----
+
+void test_extender_follows_counter_across_wrap() {
+    PulseExtender ext(LIMIT);
+    int32_t raw = 0;
+    int64_t expected = 0;
+    // The counter clears to 0 on reaching the limit; steps stay under limit / 2
+    for (int i = 0; i < 100; i++) {
+        raw = (raw + 10000) % LIMIT;
+        expected += 10000;
+        TEST_ASSERT_EQUAL_INT64(expected, ext.update(raw));
+    }
+    for (int i = 0; i < 150; i++) {
+        raw = (raw - 10000) % LIMIT;
+        expected -= 10000;
+        TEST_ASSERT_EQUAL_INT64(expected, ext.update(raw));
+    }
+    TEST_ASSERT_LESS_THAN_INT64(0, ext.total());
+}
+
+void test_extender_reset_starts_from_current_reading() {
+    PulseExtender ext(LIMIT);
+    ext.update(500);
+    ext.reset(500);
+    TEST_ASSERT_EQUAL_INT64(0, ext.total());
+    TEST_ASSERT_EQUAL_INT64(-20, ext.update(480));
+}
+
+void test_poll_period_keeps_counter_under_half_range() {
+    uint32_t us = pulse_poll_period_us(LIMIT, 200000);
+    // At max_hz the counter moves at most limit / 4 per period
+    TEST_ASSERT_LESS_OR_EQUAL_UINT64((uint64_t) LIMIT / 4, (uint64_t) us * 200000 / 1000000);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, us);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, pulse_poll_period_us(LIMIT, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, pulse_poll_period_us(LIMIT, UINT32_MAX));
+}
+
+void test_rate_window_steady_and_reversed() {
+    PulseRateWindow rate(1000000);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, rate.rate_hz());
+    // 500 counts per second, sampled every step
+    for (int64_t t = 0; t <= 3000000; t += rate.step_us()) rate.add(t, t / 2000);
+    TEST_ASSERT_DOUBLE_WITHIN(1.0, 500.0, rate.rate_hz());
+    TEST_ASSERT_DOUBLE_WITHIN(1.0, 500.0 * 60.0 / 100.0, rate.rpm(100));
+
+    rate.reset();
+    for (int64_t t = 0; t <= 3000000; t += rate.step_us()) rate.add(t, -t / 1000);
+    TEST_ASSERT_DOUBLE_WITHIN(1.0, -1000.0, rate.rate_hz());
+}
+
+#ifndef ESP_PLATFORM
+// ---- PulseCounter through the host PCNT, whose actions follow the TRM tables ----
+
+static const gpio_num_t PIN_A = GPIO_NUM_32;
+static const gpio_num_t PIN_B = GPIO_NUM_33;
+
+// One quadrature cycle, A leading B: 00 -> 10 -> 11 -> 01 -> 00
+static void forward_cycle() {
+    fake::gpio_input(PIN_A, 1);
+    fake::gpio_input(PIN_B, 1);
+    fake::gpio_input(PIN_A, 0);
+    fake::gpio_input(PIN_B, 0);
+}
+
+// B leading A: 00 -> 01 -> 11 -> 10 -> 00
+static void backward_cycle() {
+    fake::gpio_input(PIN_B, 1);
+    fake::gpio_input(PIN_A, 1);
+    fake::gpio_input(PIN_B, 0);
+    fake::gpio_input(PIN_A, 0);
+}
+
+void test_quadrature_a_leading_b_counts_up() {
+    fake::gpio_reset();
+    GPIO encoder(PIN_A, GPIO_MODE_INPUT);
+    TEST_ASSERT_EQUAL(ESP_OK, encoder.enable_quadrature(PIN_B));
+
+    forward_cycle();
+    TEST_ASSERT_EQUAL_INT64(4, encoder.pulse_count());
+    // Each single step counts, not just whole cycles
+    fake::gpio_input(PIN_A, 1);
+    TEST_ASSERT_EQUAL_INT64(5, encoder.pulse_count());
+    fake::gpio_input(PIN_A, 0);
+    TEST_ASSERT_EQUAL_INT64(4, encoder.pulse_count());
+}
+
+void test_quadrature_b_leading_a_counts_down() {
+    fake::gpio_reset();
+    GPIO encoder(PIN_A, GPIO_MODE_INPUT);
+    TEST_ASSERT_EQUAL(ESP_OK, encoder.enable_quadrature(PIN_B));
+
+    for (int i = 0; i < 10; i++) backward_cycle();
+    TEST_ASSERT_EQUAL_INT64(-40, encoder.pulse_count());
+    for (int i = 0; i < 3; i++) forward_cycle();
+    TEST_ASSERT_EQUAL_INT64(-28, encoder.pulse_count());
+}
+
+void test_quadrature_extends_past_counter_limit() {
+    fake::gpio_reset();
+    GPIO encoder(PIN_A, GPIO_MODE_INPUT);
+    TEST_ASSERT_EQUAL(ESP_OK, encoder.enable_quadrature(PIN_B));
+
+    // 80000 counts forward, then 120000 back: both cross the 16-bit limit
+    for (int i = 1; i <= 20000; i++) {
+        forward_cycle();
+        if (i % 1000 == 0) TEST_ASSERT_EQUAL_INT64(4 * i, encoder.pulse_count());
+    }
+    for (int i = 1; i <= 30000; i++) {
+        backward_cycle();
+        if (i % 1000 == 0) encoder.pulse_count();
+    }
+    TEST_ASSERT_EQUAL_INT64(-40000, encoder.pulse_count());
+}
+
+void test_single_pin_counts_configured_edges() {
+    fake::gpio_reset();
+    GPIO rising(PIN_A, GPIO_MODE_INPUT);
+    TEST_ASSERT_EQUAL(ESP_OK, rising.enable_pulse_counter());
+    PulseCounterConfig both;
+    both.edge = PULSE_EDGE_BOTH;
+    GPIO any(PIN_B, GPIO_MODE_INPUT);
+    TEST_ASSERT_EQUAL(ESP_OK, any.enable_pulse_counter(both));
+
+    for (int i = 0; i < 100; i++) {
+        fake::gpio_input(PIN_A, 1);
+        fake::gpio_input(PIN_A, 0);
+        fake::gpio_input(PIN_B, 1);
+        fake::gpio_input(PIN_B, 0);
+    }
+    TEST_ASSERT_EQUAL_INT64(100, rising.pulse_count());
+    TEST_ASSERT_EQUAL_INT64(200, any.pulse_count());
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_extender_follows_counter_across_wrap);
+    RUN_TEST(test_extender_reset_starts_from_current_reading);
+    RUN_TEST(test_poll_period_keeps_counter_under_half_range);
+    RUN_TEST(test_rate_window_steady_and_reversed);
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_quadrature_a_leading_b_counts_up);
+    RUN_TEST(test_quadrature_b_leading_a_counts_down);
+    RUN_TEST(test_quadrature_extends_past_counter_limit);
+    RUN_TEST(test_single_pin_counts_configured_edges);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
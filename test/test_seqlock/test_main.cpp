@@ -0,0 +1,114 @@
+#include <unity.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "Seqlock.hpp"
+
+// Every word is derived from the store counter, so a copy that mixes two
+// stores is detectable; 13 words so the tail word is partially used
+struct Sample {
+    uint32_t counter;
+    uint32_t words[11];
+    uint16_t check;
+};
+
+static Sample make_sample(uint32_t counter) {
+    Sample s = {};
+    s.counter = counter;
+    for (uint32_t i = 0; i < 11; i++) s.words[i] = counter * 2654435761u + i;
+    s.check = (uint16_t) (counter ^ 0xA5A5);
+    return s;
+}
+
+static bool consistent(const Sample& s) {
+    for (uint32_t i = 0; i < 11; i++) {
+        if (s.words[i] != s.counter * 2654435761u + i) return false;
+    }
+    return s.check == (uint16_t) (s.counter ^ 0xA5A5);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_version_counts_stores() {
+    Seqlock<Sample> slot;
+    TEST_ASSERT_EQUAL_UINT32(0, slot.version());
+    Sample out;
+    uint32_t version = 99;
+    TEST_ASSERT_TRUE(slot.try_load(&out, &version));
+    TEST_ASSERT_EQUAL_UINT32(0, version);
+    TEST_ASSERT_EQUAL_UINT32(0, out.counter);
+
+    for (uint32_t i = 1; i <= 5; i++) slot.store(make_sample(i));
+    TEST_ASSERT_EQUAL_UINT32(5, slot.version());
+    out = slot.load(&version);
+    TEST_ASSERT_EQUAL_UINT32(5, version);
+    TEST_ASSERT_EQUAL_UINT32(5, out.counter);
+    TEST_ASSERT_TRUE(consistent(out));
+
+    Seqlock<Sample> initial(make_sample(7));
+    TEST_ASSERT_EQUAL_UINT32(1, initial.version());
+    TEST_ASSERT_EQUAL_UINT32(7, initial.load().counter);
+}
+
+// One writer storing as fast as it can, several readers loading concurrently:
+// no reader may see a torn value, a value that disagrees with its version, or
+// a version going backwards
+void test_concurrent_readers_never_see_torn_values() {
+    const uint32_t STORES = 2000000;
+    const int READERS = 3;
+    Seqlock<Sample> slot(make_sample(1));
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> torn{0}, mismatched{0}, backwards{0};
+    std::vector<uint64_t> loads(READERS, 0), retries(READERS, 0);
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; r++) {
+        readers.emplace_back([&, r] {
+            uint32_t last = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                Sample s;
+                uint32_t version;
+                if (!slot.try_load(&s, &version)) {
+                    retries[r]++;
+                    continue;
+                }
+                loads[r]++;
+                // Store n carries counter n; the initial store is version 1
+                if (!consistent(s)) torn++;
+                if (s.counter != version) mismatched++;
+                if (version < last) backwards++;
+                last = version;
+            }
+        });
+    }
+
+    for (uint32_t i = 2; i <= STORES; i++) slot.store(make_sample(i));
+    done.store(true, std::memory_order_release);
+    for (auto& t : readers) t.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+    TEST_ASSERT_EQUAL_UINT32(0, mismatched.load());
+    TEST_ASSERT_EQUAL_UINT32(0, backwards.load());
+    for (int r = 0; r < READERS; r++) TEST_ASSERT_GREATER_THAN_UINT64(0, loads[r]);
+
+    uint32_t version;
+    Sample last = slot.load(&version);
+    TEST_ASSERT_EQUAL_UINT32(STORES, version);
+    TEST_ASSERT_EQUAL_UINT32(STORES, last.counter);
+    TEST_ASSERT_TRUE(consistent(last));
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_version_counts_stores);
+    RUN_TEST(test_concurrent_readers_never_see_torn_values);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
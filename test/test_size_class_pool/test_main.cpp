@@ -0,0 +1,265 @@
+#include <unity.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "SizeClassPool.hpp"
+
+// Memory provider that counts its calls and can refuse PSRAM regions
+static std::atomic<int> s_provider_allocs{0};
+static std::atomic<int> s_provider_frees{0};
+static bool s_psram_available = true;
+
+static void* counting_alloc(size_t bytes, bool internal) {
+    if (!internal && !s_psram_available) return nullptr;
+    s_provider_allocs++;
+    return malloc(bytes);
+}
+
+static void counting_free(void* p) {
+    s_provider_frees++;
+    free(p);
+}
+
+static const pool_memory_t COUNTING = {counting_alloc, counting_free};
+
+// Two internal classes, then PSRAM; listed out of order on purpose
+static const pool_class_config_t CLASSES[] = {
+    {1024, 1, false},
+    {256, 1, false},
+    {60, 2, true},   // Rounded up to 64
+    {256, 1, true},
+};
+
+void setUp(void) {
+    s_provider_allocs = 0;
+    s_provider_frees = 0;
+    s_psram_available = true;
+}
+
+void tearDown(void) {}
+
+// Before configure() every request, and its free, goes to the provider
+void test_unconfigured_pool_uses_provider() {
+    SizeClassPool pool;
+    pool.set_memory(COUNTING);
+    void* p = pool.allocate(100);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_FALSE(pool.owns(p));
+    TEST_ASSERT_EQUAL_INT(1, s_provider_allocs.load());
+
+    TEST_ASSERT_TRUE(pool.configure(CLASSES, 4, &COUNTING));
+    TEST_ASSERT_FALSE(pool.configure(CLASSES, 4, &COUNTING));   // Only once
+    pool.deallocate(p);
+    TEST_ASSERT_EQUAL_INT(1, s_provider_frees.load());
+    TEST_ASSERT_EQUAL_UINT32(0, pool.stats().fallback_live);
+}
+
+// Smallest class first, internal before PSRAM at the same size; a full class
+// spills into one at most MAX_SPILL times larger, then to the provider
+void test_search_order_and_spill() {
+    SizeClassPool pool;
+    TEST_ASSERT_TRUE(pool.configure(CLASSES, 4, &COUNTING));
+    int regions = s_provider_allocs.load();
+    TEST_ASSERT_EQUAL_INT(4, regions);
+
+    pool_class_stats_t cs[SizeClassPool::MAX_CLASSES];
+    TEST_ASSERT_EQUAL_size_t(4, pool.class_stats(cs, SizeClassPool::MAX_CLASSES));
+    TEST_ASSERT_EQUAL_UINT32(64, cs[0].block_size);
+    TEST_ASSERT_TRUE(cs[1].block_size == 256 && cs[1].internal);
+    TEST_ASSERT_TRUE(cs[2].block_size == 256 && !cs[2].internal);
+    TEST_ASSERT_EQUAL_UINT32(1024, cs[3].block_size);
+
+    void* small[2] = {pool.allocate(10), pool.allocate(64)};
+    void* spill_internal = pool.allocate(1);    // 64 B class full: 256 B internal
+    void* spill_psram = pool.allocate(1);       // Then 256 B PSRAM
+    void* too_far = pool.allocate(1);           // 1024 B is more than 4 x 64: provider
+    for (void* p : small) TEST_ASSERT_TRUE(pool.owns(p));
+    TEST_ASSERT_TRUE(pool.owns(spill_internal));
+    TEST_ASSERT_TRUE(pool.owns(spill_psram));
+    TEST_ASSERT_FALSE(pool.owns(too_far));
+    TEST_ASSERT_EQUAL_INT(regions + 1, s_provider_allocs.load());
+
+    void* large = pool.allocate(300);            // Only the 1024 B class fits
+    void* huge = pool.allocate(5000);            // Larger than every class
+    TEST_ASSERT_TRUE(pool.owns(large));
+    TEST_ASSERT_FALSE(pool.owns(huge));
+
+    pool.class_stats(cs, SizeClassPool::MAX_CLASSES);
+    TEST_ASSERT_EQUAL_UINT32(2, cs[0].in_use);
+    TEST_ASSERT_EQUAL_UINT32(3, cs[0].exhausted);
+    TEST_ASSERT_EQUAL_UINT32(2, cs[1].exhausted);
+    TEST_ASSERT_EQUAL_UINT32(1, cs[2].exhausted);
+    TEST_ASSERT_EQUAL_UINT32(1, cs[1].in_use);
+    TEST_ASSERT_EQUAL_UINT32(1, cs[2].in_use);
+    TEST_ASSERT_EQUAL_UINT32(1, cs[3].in_use);
+
+    pool_stats_t s = pool.stats();
+    TEST_ASSERT_EQUAL_UINT32(5, s.allocs);
+    TEST_ASSERT_EQUAL_UINT32(2, s.fallback_allocs);
+    TEST_ASSERT_EQUAL_UINT32(2, s.fallback_live);
+    TEST_ASSERT_EQUAL_UINT32(64 * 2 + 256, s.reserved_internal);
+    TEST_ASSERT_EQUAL_UINT32(256 + 1024, s.reserved_psram);
+
+    for (void* p : small) pool.deallocate(p);
+    pool.deallocate(spill_internal);
+    pool.deallocate(spill_psram);
+    pool.deallocate(too_far);
+    pool.deallocate(large);
+    pool.deallocate(huge);
+    s = pool.stats();
+    TEST_ASSERT_EQUAL_UINT32(5, s.frees);
+    TEST_ASSERT_EQUAL_UINT32(0, s.fallback_live);
+    TEST_ASSERT_EQUAL_UINT32(0, s.live_block_bytes);
+    TEST_ASSERT_EQUAL_INT(2, s_provider_frees.load());
+
+    // Freed blocks are reused: the 64 B class serves again
+    void* again = pool.allocate(8);
+    pool.class_stats(cs, SizeClassPool::MAX_CLASSES);
+    TEST_ASSERT_EQUAL_UINT32(1, cs[0].in_use);
+    pool.deallocate(again);
+}
+
+// Without PSRAM those classes stay empty and their requests fall back
+void test_missing_region_falls_back() {
+    s_psram_available = false;
+    SizeClassPool pool;
+    TEST_ASSERT_TRUE(pool.configure(CLASSES, 4, &COUNTING));
+    pool_stats_t s = pool.stats();
+    TEST_ASSERT_EQUAL_UINT32(0, s.reserved_psram);
+    TEST_ASSERT_EQUAL_UINT32(64 * 2 + 256, s.reserved_internal);
+
+    pool_class_stats_t cs[SizeClassPool::MAX_CLASSES];
+    pool.class_stats(cs, SizeClassPool::MAX_CLASSES);
+    TEST_ASSERT_EQUAL_UINT16(0, cs[3].blocks);
+
+    s_psram_available = true;   // Oversize requests may still use it
+    void* p = pool.allocate(900);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_FALSE(pool.owns(p));
+    pool.deallocate(p);
+    TEST_ASSERT_EQUAL_UINT32(0, pool.stats().fallback_live);
+}
+
+void test_stats_report_waste() {
+    SizeClassPool pool;
+    TEST_ASSERT_TRUE(pool.configure(CLASSES, 4, &COUNTING));
+    void* a = pool.allocate(48);    // 64 B block
+    void* b = pool.allocate(128);   // 256 B block
+    pool_stats_t s = pool.stats();
+    TEST_ASSERT_EQUAL_UINT32(176, s.live_requested);
+    TEST_ASSERT_EQUAL_UINT32(320, s.live_block_bytes);
+    TEST_ASSERT_EQUAL_UINT32(45, s.waste_pct);
+    pool.deallocate(a);
+    pool.deallocate(b);
+    TEST_ASSERT_EQUAL_UINT32(0, pool.stats().live_requested);
+}
+
+// A string grown past several classes moves between blocks without touching the heap
+void test_pool_string_grows_in_blocks() {
+    static const pool_class_config_t classes[] = {{64, 8, true}, {512, 4, true}, {2048, 2, false}, {16384, 2, false}};
+    SizeClassPool pool;
+    TEST_ASSERT_TRUE(pool.configure(classes, 4, &COUNTING));
+    int regions = s_provider_allocs.load();
+    {
+        pool_string body{PoolAllocator<char>(pool)};
+        std::string chunk(512, 'x');
+        for (int i = 0; i < 12; i++) body += chunk;
+        TEST_ASSERT_EQUAL_size_t(6144, body.size());
+        TEST_ASSERT_TRUE(pool.owns(body.data()));
+
+        pool_vector<uint32_t> words(100, 7u, PoolAllocator<uint32_t>(pool));
+        TEST_ASSERT_TRUE(pool.owns(words.data()));
+    }
+    TEST_ASSERT_EQUAL_INT(regions, s_provider_allocs.load());
+    pool_stats_t s = pool.stats();
+    TEST_ASSERT_EQUAL_UINT32(0, s.fallback_allocs);
+    TEST_ASSERT_EQUAL_UINT32(s.allocs, s.frees);
+}
+
+// Four threads allocate, fill, check and free buffers of 16 B-4 KB with 32 live
+// each, more than the pool holds, so classes run dry and spill or fall back.
+// A block handed out twice, or a free list corrupted by a race, shows up as a
+// buffer whose pattern changed under its owner.
+void test_concurrent_churn() {
+    static const pool_class_config_t classes[] = {
+        {64, 32, true}, {256, 32, true}, {256, 16, false}, {1024, 16, false}, {4096, 16, false}};
+    static const int THREADS = 4;
+    static const int OPS = 50000;
+    static const int LIVE = 32;
+    SizeClassPool pool;
+    TEST_ASSERT_TRUE(pool.configure(classes, 5, &COUNTING));
+    std::atomic<int> corrupt{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t] {
+            struct Slot {
+                uint8_t* p = nullptr;
+                size_t size = 0;
+                uint8_t tag = 0;
+            } slots[LIVE];
+            uint32_t state = 0x9E3779B9u * (t + 1);
+            for (int op = 0; op < OPS; op++) {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                Slot& s = slots[state % LIVE];
+                if (s.p) {
+                    for (size_t i = 0; i < s.size; i++) {
+                        if (s.p[i] != s.tag) {
+                            corrupt++;
+                            break;
+                        }
+                    }
+                    pool.deallocate(s.p);
+                }
+                s.size = 16 + (state >> 8) % 4081;
+                s.tag = (uint8_t) (t * 64 + op);
+                s.p = (uint8_t*) pool.allocate(s.size);
+                memset(s.p, s.tag, s.size);
+            }
+            for (Slot& s : slots) pool.deallocate(s.p);
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    TEST_ASSERT_EQUAL_INT(0, corrupt.load());
+    pool_stats_t s = pool.stats();
+    TEST_ASSERT_EQUAL_UINT32(THREADS * OPS, s.allocs + s.fallback_allocs);
+    TEST_ASSERT_EQUAL_UINT32(s.allocs, s.frees);
+    TEST_ASSERT_EQUAL_UINT32(0, s.fallback_live);
+    TEST_ASSERT_EQUAL_UINT32(0, s.live_block_bytes);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, s.fallback_allocs);
+
+    // Every block is back on its free list
+    pool_class_stats_t cs[SizeClassPool::MAX_CLASSES];
+    size_t n = pool.class_stats(cs, SizeClassPool::MAX_CLASSES);
+    std::vector<void*> all;
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_UINT32(0, cs[i].in_use);
+        for (uint16_t b = 0; b < cs[i].blocks; b++) all.push_back(pool.allocate(cs[i].block_size));
+    }
+    for (void* p : all) TEST_ASSERT_TRUE(pool.owns(p));
+    TEST_ASSERT_EQUAL_UINT32(s.fallback_allocs, pool.stats().fallback_allocs);
+    for (void* p : all) pool.deallocate(p);
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unconfigured_pool_uses_provider);
+    RUN_TEST(test_search_order_and_spill);
+    RUN_TEST(test_missing_region_falls_back);
+    RUN_TEST(test_stats_report_waste);
+    RUN_TEST(test_pool_string_grows_in_blocks);
+    RUN_TEST(test_concurrent_churn);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,228 @@
+#include <unity.h>
+#include "TelegramNotifier.hpp"
+#ifndef ESP_PLATFORM
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "esp_timer.h"
+#include "host_fakes.hpp"
+
+static bool wait_for(const std::function<bool()>& condition, int timeout_ms = 5000) {
+    for (int i = 0; i < timeout_ms; i++) {
+        if (condition()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+
+// Mock sendMessage endpoint: answers each request with the next scripted status
+// (the last one repeats) and records the body and arrival time
+class Endpoint {
+public:
+    explicit Endpoint(std::vector<int> statuses, std::string error_body = "")
+        : _statuses(std::move(statuses)), _error_body(std::move(error_body)) {
+        fake::http_set_responder([this](const fake::HttpRequest& request) {
+            std::lock_guard<std::mutex> guard(_lock);
+            _urls.push_back(request.url);
+            _bodies.push_back(request.body);
+            _times_us.push_back(esp_timer_get_time());
+            fake::HttpResponse response;
+            response.status = _statuses[std::min(_bodies.size(), _statuses.size()) - 1];
+            response.body = response.status == 200 ? "{\"ok\":true,\"result\":{}}" : _error_body;
+            return response;
+        });
+    }
+
+    ~Endpoint() { fake::http_reset(); }
+
+    size_t count() {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _bodies.size();
+    }
+
+    std::string body(size_t i) {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _bodies.at(i);
+    }
+
+    std::string url(size_t i) {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _urls.at(i);
+    }
+
+    int64_t gap_ms(size_t i) {
+        std::lock_guard<std::mutex> guard(_lock);
+        return (_times_us.at(i) - _times_us.at(i - 1)) / 1000;
+    }
+
+private:
+    std::mutex _lock;
+    std::vector<int> _statuses;
+    std::string _error_body;
+    std::vector<std::string> _urls;
+    std::vector<std::string> _bodies;
+    std::vector<int64_t> _times_us;
+};
+
+static TelegramNotifierConfig config() {
+    TelegramNotifierConfig cfg;
+    cfg.token = "TOKEN";
+    cfg.chat_id = "42";
+    cfg.api_base = "http://telegram.local";
+    cfg.coalesce_ms = 30;
+    cfg.rate_per_sec = 0.0f;   // Unlimited unless a test sets it
+    cfg.retry_base_ms = 20;
+    cfg.retry_max_ms = 1000;
+    return cfg;
+}
+#endif
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#ifndef ESP_PLATFORM
+// Messages within the window go out as one body, repeats counted, in arrival order
+void test_coalesces_and_deduplicates() {
+    Endpoint endpoint({200});
+    TelegramNotifier notifier(config());
+    TEST_ASSERT_EQUAL(ESP_OK, notifier.begin());
+
+    TEST_ASSERT_TRUE(notifier.notify("Door \"A\" open"));
+    TEST_ASSERT_TRUE(notifier.notify("Temp 81 C"));
+    TEST_ASSERT_TRUE(notifier.notify("Door \"A\" open"));
+    TEST_ASSERT_TRUE(wait_for([&] { return notifier.stats().requests == 1; }));
+
+    TEST_ASSERT_EQUAL_STRING("http://telegram.local/botTOKEN/sendMessage", endpoint.url(0).c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"chat_id\": \"42\", \"text\": \"Door \\\"A\\\" open (x2)\\nTemp 81 C\"}",
+                             endpoint.body(0).c_str());
+    telegram_notifier_stats_t s = notifier.stats();
+    TEST_ASSERT_EQUAL_UINT32(3, s.notified);
+    TEST_ASSERT_EQUAL_UINT32(1, s.deduplicated);
+    TEST_ASSERT_EQUAL_UINT32(0, s.failures);
+}
+
+// A chat_id that leaves no room for text is refused up front, so the worker
+// never spins on a batch it cannot build
+void test_oversized_chat_id_refused() {
+    Endpoint endpoint({200});
+    TelegramNotifierConfig cfg = config();
+    cfg.max_payload = 48;
+    cfg.chat_id = std::string(40, '"');   // 80 bytes escaped
+    TelegramNotifier notifier(cfg);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, notifier.begin());
+
+    notifier.notify("never sent");
+    notifier.flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    TEST_ASSERT_EQUAL_size_t(0, endpoint.count());
+    TEST_ASSERT_EQUAL_UINT32(0, notifier.stats().rate_limited);
+
+    // One that only just fits is accepted
+    cfg.chat_id = std::string(14, 'x');
+    TelegramNotifier fits(cfg);
+    TEST_ASSERT_EQUAL(ESP_OK, fits.begin());
+}
+
+// A 429 resends the same body after retry_after; messages arriving meanwhile
+// wait for the next batch
+void test_429_waits_for_retry_after() {
+    Endpoint endpoint({429, 200},
+                      "{\"ok\":false,\"error_code\":429,\"description\":\"Too Many Requests: retry after 1\","
+                      "\"parameters\":{\"retry_after\":1}}");
+    TelegramNotifier notifier(config());
+    TEST_ASSERT_EQUAL(ESP_OK, notifier.begin());
+
+    notifier.notify("first");
+    TEST_ASSERT_TRUE(wait_for([&] { return notifier.stats().retries == 1; }));
+    notifier.notify("second");
+    notifier.flush();
+    TEST_ASSERT_TRUE(wait_for([&] { return endpoint.count() == 3; }));
+
+    TEST_ASSERT_EQUAL_STRING(endpoint.body(0).c_str(), endpoint.body(1).c_str());
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(1000, endpoint.gap_ms(1));
+    TEST_ASSERT_EQUAL_STRING("{\"chat_id\": \"42\", \"text\": \"second\"}", endpoint.body(2).c_str());
+    telegram_notifier_stats_t s = notifier.stats();
+    TEST_ASSERT_EQUAL_UINT32(3, s.requests);
+    TEST_ASSERT_EQUAL_UINT32(1, s.failures);
+    TEST_ASSERT_EQUAL_UINT32(0, s.dropped);
+}
+
+// Server errors back off exponentially, and the batch is dropped and counted
+// once the retries run out
+void test_server_errors_back_off_then_drop() {
+    Endpoint endpoint({500});
+    TelegramNotifierConfig cfg = config();
+    cfg.max_retries = 2;
+    TelegramNotifier notifier(cfg);
+    TEST_ASSERT_EQUAL(ESP_OK, notifier.begin());
+
+    notifier.notify("one");
+    notifier.notify("two");
+    TEST_ASSERT_TRUE(wait_for([&] { return notifier.stats().dropped == 2; }));
+    TEST_ASSERT_EQUAL_size_t(3, endpoint.count());
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(20, endpoint.gap_ms(1));
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(40, endpoint.gap_ms(2));
+    telegram_notifier_stats_t s = notifier.stats();
+    TEST_ASSERT_EQUAL_UINT32(3, s.failures);
+    TEST_ASSERT_EQUAL_UINT32(2, s.retries);
+
+    // The next batch starts with a fresh retry budget
+    notifier.notify("three");
+    TEST_ASSERT_TRUE(wait_for([&] { return notifier.stats().dropped == 3; }));
+    TEST_ASSERT_EQUAL_size_t(6, endpoint.count());
+}
+
+// A client error will fail the same way again: dropped at once
+void test_client_error_not_retried() {
+    Endpoint endpoint({400});
+    TelegramNotifier notifier(config());
+    TEST_ASSERT_EQUAL(ESP_OK, notifier.begin());
+
+    notifier.notify("bad");
+    TEST_ASSERT_TRUE(wait_for([&] { return notifier.stats().dropped == 1; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    TEST_ASSERT_EQUAL_size_t(1, endpoint.count());
+    TEST_ASSERT_EQUAL_UINT32(0, notifier.stats().retries);
+}
+
+// Destruction joins the worker, whether it is idle, backing off or mid-request
+void test_destroy_joins_worker() {
+    Endpoint endpoint({500});
+    for (int i = 0; i < 20; i++) {
+        std::unique_ptr<TelegramNotifier> notifier(new TelegramNotifier(config()));
+        TEST_ASSERT_EQUAL(ESP_OK, notifier->begin());
+        if (i % 2) {
+            notifier->notify("alert");
+            notifier->flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(i));
+        }
+    }
+    size_t sent = endpoint.count();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    TEST_ASSERT_EQUAL_size_t(sent, endpoint.count());
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_coalesces_and_deduplicates);
+    RUN_TEST(test_oversized_chat_id_refused);
+    RUN_TEST(test_429_waits_for_retry_after);
+    RUN_TEST(test_server_errors_back_off_then_drop);
+    RUN_TEST(test_client_error_not_retried);
+    RUN_TEST(test_destroy_joins_worker);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
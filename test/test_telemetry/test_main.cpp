@@ -0,0 +1,255 @@
+#include <unity.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "Telemetry.hpp"
+
+typedef struct {
+    float distance;
+    uint32_t timestamp;
+} sensor_data_t;
+
+static constexpr auto sensor_schema = telemetry::schema<sensor_data_t>(
+    telemetry::field("distance", &sensor_data_t::distance),
+    telemetry::field("timestamp", &sensor_data_t::timestamp));
+
+typedef struct {
+    bool on;
+    uint8_t u8;
+    int16_t i16;
+    uint32_t u32;
+    int64_t i64;
+    float f;
+    double d;
+    char name[8];
+} mixed_t;
+
+static constexpr auto mixed_schema = telemetry::schema<mixed_t>(
+    telemetry::field("on", &mixed_t::on),
+    telemetry::field("u8", &mixed_t::u8),
+    telemetry::field("i16", &mixed_t::i16),
+    telemetry::field("u32", &mixed_t::u32),
+    telemetry::field("i64", &mixed_t::i64),
+    telemetry::field("f", &mixed_t::f),
+    telemetry::field("d", &mixed_t::d),
+    telemetry::field("name", &mixed_t::name));
+
+// One-member structs, to decode a single value at several widths
+template <typename T>
+struct One {
+    T v;
+};
+
+template <typename T>
+static bool decode_one(const uint8_t* item, size_t item_len, T* out) {
+    static constexpr auto one_schema = telemetry::schema<One<T>>(telemetry::field("v", &One<T>::v));
+    uint8_t buf[32] = {0xA1, 0x61, 'v'};
+    memcpy(buf + 3, item, item_len);
+    One<T> one = {};
+    if (!telemetry::decode_cbor(one_schema, buf, 3 + item_len, one)) return false;
+    *out = one.v;
+    return true;
+}
+
+static mixed_t make_mixed() {
+    mixed_t m = {};
+    m.on = true;
+    m.u8 = 200;
+    m.i16 = -300;
+    m.u32 = 70000;
+    m.i64 = -5000000000LL;
+    m.f = 0.1f;
+    m.d = 1.0 / 3.0;
+    strcpy(m.name, "probe");
+    return m;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Preferred serialization: 23.5 fits a half, the timestamp needs four bytes
+void test_sensor_bytes() {
+    sensor_data_t data = {23.5f, 123456};
+    uint8_t buf[32];
+    size_t len = telemetry::encode_cbor(sensor_schema, data, buf, sizeof(buf));
+    const uint8_t expected[] = {0xA2, 0x68, 'd', 'i', 's', 't', 'a', 'n', 'c', 'e', 0xF9, 0x4D, 0xE0,
+                                0x69, 't', 'i', 'm', 'e', 's', 't', 'a', 'm', 'p', 0x1A, 0x00, 0x01, 0xE2, 0x40};
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, len);
+
+    sensor_data_t out = {};
+    TEST_ASSERT_TRUE(telemetry::decode_cbor(sensor_schema, buf, len, out));
+    TEST_ASSERT_EQUAL_FLOAT(23.5f, out.distance);
+    TEST_ASSERT_EQUAL_UINT32(123456, out.timestamp);
+
+    char json[64];
+    size_t json_len = telemetry::encode_json(sensor_schema, data, json, sizeof(json));
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"distance\":23.5,\"timestamp\":123456}", json, json_len);
+}
+
+void test_round_trip_every_type() {
+    mixed_t in = make_mixed();
+    uint8_t buf[96];
+    size_t len = telemetry::encode_cbor(mixed_schema, in, buf, sizeof(buf));
+    TEST_ASSERT_GREATER_THAN_size_t(0, len);
+
+    mixed_t out = {};
+    TEST_ASSERT_TRUE(telemetry::decode_cbor(mixed_schema, buf, len, out));
+    TEST_ASSERT_TRUE(out.on);
+    TEST_ASSERT_EQUAL_UINT8(200, out.u8);
+    TEST_ASSERT_EQUAL_INT16(-300, out.i16);
+    TEST_ASSERT_EQUAL_UINT32(70000, out.u32);
+    TEST_ASSERT_TRUE(out.i64 == -5000000000LL);
+    TEST_ASSERT_EQUAL_FLOAT(0.1f, out.f);   // Not a half: single precision, exact
+    TEST_ASSERT_TRUE(out.d == 1.0 / 3.0);   // Not a float: double precision, exact
+    TEST_ASSERT_EQUAL_STRING("probe", out.name);
+}
+
+// Halves on the wire: normal, negative, zero, infinity and NaN, and the
+// smallest subnormal a decoder must still read
+void test_half_floats() {
+    struct Case {
+        float value;
+        uint16_t half;
+    };
+    const Case cases[] = {{1.0f, 0x3C00}, {-2.5f, 0xC100}, {65504.0f, 0x7BFF}, {0.0f, 0x0000},
+                          {-0.0f, 0x8000}, {INFINITY, 0x7C00}, {-INFINITY, 0xFC00}};
+    for (const Case& c : cases) {
+        One<float> in = {c.value};
+        static constexpr auto one_schema = telemetry::schema<One<float>>(telemetry::field("v", &One<float>::v));
+        uint8_t buf[16];
+        size_t len = telemetry::encode_cbor(one_schema, in, buf, sizeof(buf));
+        TEST_ASSERT_EQUAL_size_t(6, len);
+        TEST_ASSERT_EQUAL_HEX8(0xF9, buf[3]);
+        TEST_ASSERT_EQUAL_HEX16(c.half, (uint16_t) (buf[4] << 8 | buf[5]));
+
+        float out;
+        TEST_ASSERT_TRUE(decode_one(buf + 3, 3, &out));
+        TEST_ASSERT_TRUE(memcmp(&out, &c.value, sizeof(float)) == 0);
+    }
+
+    float out;
+    const uint8_t nan[] = {0xF9, 0x7E, 0x00};
+    TEST_ASSERT_TRUE(decode_one(nan, sizeof(nan), &out));
+    TEST_ASSERT_TRUE(isnan(out));
+    const uint8_t subnormal[] = {0xF9, 0x00, 0x01};
+    TEST_ASSERT_TRUE(decode_one(subnormal, sizeof(subnormal), &out));
+    TEST_ASSERT_EQUAL_FLOAT(ldexpf(1.0f, -24), out);
+
+    // 65520 rounds in a half, so it goes out as a single
+    One<float> big = {65520.0f};
+    static constexpr auto one_schema = telemetry::schema<One<float>>(telemetry::field("v", &One<float>::v));
+    uint8_t buf[16];
+    TEST_ASSERT_EQUAL_size_t(8, telemetry::encode_cbor(one_schema, big, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_HEX8(0xFA, buf[3]);
+}
+
+// Integer heads use the smallest width; the reader accepts any width that fits
+// the member and rejects values that do not
+void test_integer_widths() {
+    const uint64_t boundaries[] = {0, 23, 24, 255, 256, 65535, 65536, 0xFFFFFFFFull, 0x100000000ull};
+    const size_t head_len[] = {1, 1, 2, 2, 3, 3, 5, 5, 9};
+    for (size_t i = 0; i < sizeof(boundaries) / sizeof(boundaries[0]); i++) {
+        One<uint64_t> in = {boundaries[i]};
+        static constexpr auto u64_schema = telemetry::schema<One<uint64_t>>(telemetry::field("v", &One<uint64_t>::v));
+        uint8_t buf[16];
+        TEST_ASSERT_EQUAL_size_t(3 + head_len[i], telemetry::encode_cbor(u64_schema, in, buf, sizeof(buf)));
+        uint64_t out;
+        TEST_ASSERT_TRUE(decode_one(buf + 3, head_len[i], &out));
+        TEST_ASSERT_TRUE(out == boundaries[i]);
+    }
+
+    uint8_t u8;
+    int8_t i8;
+    int32_t i32;
+    const uint8_t wide_small[] = {0x1B, 0, 0, 0, 0, 0, 0, 0, 7};   // 7 in eight bytes
+    TEST_ASSERT_TRUE(decode_one(wide_small, sizeof(wide_small), &u8));
+    TEST_ASSERT_EQUAL_UINT8(7, u8);
+    const uint8_t v256[] = {0x19, 0x01, 0x00};
+    TEST_ASSERT_FALSE(decode_one(v256, sizeof(v256), &u8));
+    const uint8_t minus_one[] = {0x20};
+    TEST_ASSERT_FALSE(decode_one(minus_one, sizeof(minus_one), &u8));
+    TEST_ASSERT_TRUE(decode_one(minus_one, sizeof(minus_one), &i8));
+    TEST_ASSERT_EQUAL_INT8(-1, i8);
+    const uint8_t minus_128[] = {0x38, 0x7F};
+    TEST_ASSERT_TRUE(decode_one(minus_128, sizeof(minus_128), &i8));
+    TEST_ASSERT_EQUAL_INT8(-128, i8);
+    const uint8_t minus_129[] = {0x38, 0x80};
+    TEST_ASSERT_FALSE(decode_one(minus_129, sizeof(minus_129), &i8));
+    TEST_ASSERT_TRUE(decode_one(minus_129, sizeof(minus_129), &i32));
+    TEST_ASSERT_EQUAL_INT32(-129, i32);
+
+    // Integers are accepted for float members, floats are not for integer ones
+    float f;
+    TEST_ASSERT_TRUE(decode_one(minus_129, sizeof(minus_129), &f));
+    TEST_ASSERT_EQUAL_FLOAT(-129.0f, f);
+    const uint8_t half_one[] = {0xF9, 0x3C, 0x00};
+    TEST_ASSERT_FALSE(decode_one(half_one, sizeof(half_one), &i32));
+}
+
+// Keys the schema does not know are skipped, nested containers and tags included;
+// members missing from the map keep their value
+void test_unknown_keys_skipped() {
+    const uint8_t buf[] = {
+        0xA4,
+        0x65, 'e', 'x', 't', 'r', 'a', 0xA2, 0x61, 'a', 0x82, 0x01, 0x02, 0x61, 'b', 0x43, 1, 2, 3,
+        0x69, 't', 'i', 'm', 'e', 's', 't', 'a', 'm', 'p', 0x18, 42,
+        0x64, 't', 'a', 'g', 'd', 0xC1, 0xFA, 0x3F, 0x80, 0x00, 0x00,
+        0x61, 'd', 0xF6,   // A prefix of "distance" is not a match
+    };
+    sensor_data_t out = {9.0f, 0};
+    TEST_ASSERT_TRUE(telemetry::decode_cbor(sensor_schema, buf, sizeof(buf), out));
+    TEST_ASSERT_EQUAL_UINT32(42, out.timestamp);
+    TEST_ASSERT_EQUAL_FLOAT(9.0f, out.distance);
+
+    // Strings longer than the member are cut to fit the terminator
+    const uint8_t long_name[] = {0xA1, 0x64, 'n', 'a', 'm', 'e', 0x6A, '0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    mixed_t m = {};
+    TEST_ASSERT_TRUE(telemetry::decode_cbor(mixed_schema, long_name, sizeof(long_name), m));
+    TEST_ASSERT_EQUAL_STRING("0123456", m.name);
+}
+
+// Every strict prefix of a valid message is rejected, and the encoders report a
+// buffer one byte short as 0
+void test_truncated_buffers() {
+    mixed_t in = make_mixed();
+    uint8_t buf[96];
+    size_t len = telemetry::encode_cbor(mixed_schema, in, buf, sizeof(buf));
+    for (size_t cut = 0; cut < len; cut++) {
+        mixed_t out = {};
+        TEST_ASSERT_FALSE(telemetry::decode_cbor(mixed_schema, buf, cut, out));
+    }
+    TEST_ASSERT_EQUAL_size_t(0, telemetry::encode_cbor(mixed_schema, in, buf, len - 1));
+    TEST_ASSERT_EQUAL_size_t(len, telemetry::encode_cbor(mixed_schema, in, buf, len));
+
+    char json[128];
+    size_t json_len = telemetry::encode_json(mixed_schema, in, json, sizeof(json));
+    TEST_ASSERT_GREATER_THAN_size_t(0, json_len);
+    TEST_ASSERT_EQUAL_size_t(0, telemetry::encode_json(mixed_schema, in, json, json_len - 1));
+
+    // A length running past the end, an indefinite length and a wrong top-level type
+    const uint8_t past_end[] = {0xA1, 0x69, 't', 'i', 'm', 'e'};
+    const uint8_t indefinite[] = {0xBF, 0xFF};
+    const uint8_t array[] = {0x80};
+    sensor_data_t out;
+    TEST_ASSERT_FALSE(telemetry::decode_cbor(sensor_schema, past_end, sizeof(past_end), out));
+    TEST_ASSERT_FALSE(telemetry::decode_cbor(sensor_schema, indefinite, sizeof(indefinite), out));
+    TEST_ASSERT_FALSE(telemetry::decode_cbor(sensor_schema, array, sizeof(array), out));
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sensor_bytes);
+    RUN_TEST(test_round_trip_every_type);
+    RUN_TEST(test_half_floats);
+    RUN_TEST(test_integer_widths);
+    RUN_TEST(test_unknown_keys_skipped);
+    RUN_TEST(test_truncated_buffers);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,257 @@
+#include <unity.h>
+#include <stdint.h>
+#include <map>
+#include <random>
+#include <vector>
+#include "TimerWheel.hpp"
+
+static const uint32_t TICK = 1000;
+
+// Pops every job due at now_us, runs it and finishes it at now_us + run_us
+static std::vector<uint32_t> fire(TimerWheel& wheel, uint64_t now_us, uint64_t run_us = 0) {
+    std::vector<uint32_t> fired;
+    uint32_t id;
+    TimerJobFn* fn;
+    while (wheel.pop_due(now_us, &id, &fn)) {
+        if (*fn) (*fn)();
+        fired.push_back(id);
+        wheel.finish(id, now_us + run_us);
+    }
+    return fired;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_job_fires_on_first_tick_at_or_after_due() {
+    TimerWheel wheel(16, TICK, 0);
+    uint32_t on_tick = wheel.add(0, 5000, 0, nullptr);
+    uint32_t mid_tick = wheel.add(0, 7500, 0, nullptr);
+    TEST_ASSERT_EQUAL_size_t(0, fire(wheel, 4999).size());
+    std::vector<uint32_t> got = fire(wheel, 5000);
+    TEST_ASSERT_EQUAL_size_t(1, got.size());
+    TEST_ASSERT_EQUAL_UINT32(on_tick, got[0]);
+    // Due at 7.5 ms: not at 7 ms, which is early, but on the 8 ms tick
+    TEST_ASSERT_EQUAL_size_t(0, fire(wheel, 7999).size());
+    got = fire(wheel, 8000);
+    TEST_ASSERT_EQUAL_size_t(1, got.size());
+    TEST_ASSERT_EQUAL_UINT32(mid_tick, got[0]);
+    TEST_ASSERT_EQUAL_size_t(0, wheel.size());
+}
+
+void test_same_tick_jobs_fire_in_add_order() {
+    TimerWheel wheel(16, TICK, 0);
+    std::vector<int> order;
+    // 2.5 ms and 3 ms both land on the 3 ms tick; 1.5 ms on the 2 ms tick
+    wheel.add(0, 3000, 0, [&] { order.push_back(1); });
+    wheel.add(0, 2500, 0, [&] { order.push_back(2); });
+    wheel.add(0, 1500, 0, [&] { order.push_back(0); });
+    wheel.add(0, 3000, 0, [&] { order.push_back(3); });
+    // One that cascades down from level 1 before the later adds on its tick
+    wheel.add(0, 100000, 0, [&] { order.push_back(4); });
+    fire(wheel, 90000);
+    wheel.add(90000, 10000, 0, [&] { order.push_back(5); });
+    wheel.add(90000, 9500, 0, [&] { order.push_back(6); });
+    fire(wheel, 100000);
+    TEST_ASSERT_EQUAL_size_t(7, order.size());
+    for (int i = 0; i < 7; i++) TEST_ASSERT_EQUAL_INT(i, order[i]);
+}
+
+void test_far_jobs_cascade_down_to_their_tick() {
+    TimerWheel wheel(16, TICK, 0);
+    // One per level and one past the top level (64^4 ticks)
+    const uint64_t delays_ticks[] = {63, 64, 4095, 4096, 262143, 262144, 16777215, 16777216, 50000000};
+    for (uint64_t d : delays_ticks) wheel.add(0, d * TICK, 0, nullptr);
+    uint64_t now = 0;
+    for (uint64_t d : delays_ticks) {
+        uint64_t due = d * TICK;
+        // Sleep as the scheduler does, through every cascade wakeup
+        while (true) {
+            uint64_t wake = wheel.next_wakeup_us();
+            TEST_ASSERT_LESS_OR_EQUAL_UINT64(due, wake);
+            if (wake == due) break;
+            now = wake;
+            TEST_ASSERT_EQUAL_size_t(0, fire(wheel, now).size());
+        }
+        TEST_ASSERT_EQUAL_size_t(0, fire(wheel, due - 1).size());
+        TEST_ASSERT_EQUAL_size_t(1, fire(wheel, due).size());
+        now = due;
+    }
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, wheel.next_wakeup_us());
+}
+
+void test_periodic_job_is_fixed_rate_and_skips_missed_periods() {
+    TimerWheel wheel(4, TICK, 0);
+    uint32_t id = wheel.add(0, 10000, 10000, nullptr);
+    // Each run takes 3 ms: due times stay on the 10 ms grid
+    for (uint64_t t = 10000; t <= 100000; t += 10000) {
+        TEST_ASSERT_EQUAL_size_t(0, fire(wheel, t - 1).size());
+        TEST_ASSERT_EQUAL_size_t(1, fire(wheel, t, 3000).size());
+    }
+    // The 110 ms run starts 35 ms late and ends at 148 ms: the 120 and 130 ms
+    // runs are dropped, the 140 ms one runs straight after, then back on the grid
+    uint32_t fired_id;
+    TimerJobFn* fn;
+    TEST_ASSERT_TRUE(wheel.pop_due(145000, &fired_id, &fn));
+    TEST_ASSERT_EQUAL_UINT32(35000, wheel.last_late_us());
+    wheel.finish(fired_id, 148000);
+    TEST_ASSERT_EQUAL_size_t(1, fire(wheel, 148000).size());
+    TEST_ASSERT_EQUAL_UINT32(8000, wheel.last_late_us());
+    TEST_ASSERT_EQUAL_size_t(0, fire(wheel, 149999).size());
+    TEST_ASSERT_EQUAL_size_t(1, fire(wheel, 150000).size());
+
+    timer_job_stats_t stats = {};
+    TEST_ASSERT_TRUE(wheel.stats(id, &stats));
+    TEST_ASSERT_EQUAL_UINT32(13, stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.skipped);
+    TEST_ASSERT_EQUAL_UINT32(35000, stats.late_max_us);
+}
+
+void test_cancel_and_stale_ids() {
+    TimerWheel wheel(2, TICK, 0);
+    uint32_t a = wheel.add(0, 1000, 0, nullptr);
+    uint32_t b = wheel.add(0, 1000, 1000, nullptr);
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.add(0, 1000, 0, nullptr));   // Full
+    TEST_ASSERT_TRUE(wheel.cancel(a));
+    TEST_ASSERT_FALSE(wheel.cancel(a));
+    uint32_t c = wheel.add(0, 5000, 0, nullptr);
+    TEST_ASSERT_NOT_EQUAL(a, c);   // Same slot, new generation
+    timer_job_stats_t stats = {};
+    TEST_ASSERT_FALSE(wheel.stats(a, &stats));
+
+    // Cancelled while running: this run completes, no reschedule
+    uint32_t id;
+    TimerJobFn* fn;
+    TEST_ASSERT_TRUE(wheel.pop_due(1000, &id, &fn));
+    TEST_ASSERT_EQUAL_UINT32(b, id);
+    TEST_ASSERT_TRUE(wheel.cancel(b));
+    wheel.finish(b, 1000);
+    TEST_ASSERT_EQUAL_size_t(1, wheel.size());
+    TEST_ASSERT_EQUAL_size_t(0, fire(wheel, 4999).size());
+    TEST_ASSERT_EQUAL_size_t(1, fire(wheel, 5000).size());
+}
+
+// Naive model: every live job with its due time, checked after every step
+struct ModelJob {
+    uint64_t due_us;
+    uint64_t period_us;
+    uint32_t runs;
+    uint32_t skipped;
+};
+
+static uint64_t expires_us(uint64_t due_us) { return (due_us + TICK - 1) / TICK * TICK; }
+
+// Random adds (delays from sub-tick to past the top level), cancels and clock
+// steps (small steps, jumps to next_wakeup_us, long jumps), with runs that
+// overrun their period. The wheel must fire exactly the jobs the model says
+// are due by the current tick, never one early, and keep the same stats.
+void test_randomized_against_naive_model() {
+    const int STEPS = 200000;
+    const size_t CAPACITY = 256;
+    std::mt19937_64 rng(0x7153);
+    uint64_t now = 123456;
+    TimerWheel wheel(CAPACITY, TICK, now);
+    std::map<uint32_t, ModelJob> model;
+    uint64_t fired_total = 0, cancelled_total = 0;
+
+    auto random_delay = [&]() -> uint64_t {
+        int bits = (int) (rng() % 36);   // Up to ~2^35 us, past 64^4 ticks
+        return bits ? rng() % (1ull << bits) : 0;
+    };
+
+    for (int step = 0; step < STEPS; step++) {
+        uint32_t op = rng() % 100;
+        if (op < 30) {
+            uint64_t delay = random_delay();
+            uint64_t period = rng() % 3 ? 0 : 1 + random_delay() % 50000000;
+            uint32_t id = wheel.add(now, delay, period, nullptr);
+            if (model.size() == CAPACITY) {
+                TEST_ASSERT_EQUAL_UINT32(0, id);
+            } else {
+                TEST_ASSERT_NOT_EQUAL(0, id);
+                TEST_ASSERT_EQUAL_size_t(0, model.count(id));
+                model[id] = {now + delay, period, 0, 0};
+            }
+        } else if (op < 40 && !model.empty()) {
+            auto it = model.begin();
+            std::advance(it, rng() % model.size());
+            TEST_ASSERT_TRUE(wheel.cancel(it->first));
+            model.erase(it);
+            cancelled_total++;
+        } else {
+            uint32_t kind = rng() % 10;
+            if (kind < 5) {
+                now += rng() % (3 * TICK);
+            } else if (kind < 9) {
+                uint64_t wake = wheel.next_wakeup_us();
+                // Never sleeps past a job the model has due
+                for (auto& kv : model) TEST_ASSERT_LESS_OR_EQUAL_UINT64(expires_us(kv.second.due_us), wake);
+                if (wake != UINT64_MAX && wake > now) now = wake;
+            } else {
+                now += rng() % (1ull << 34);
+            }
+
+            uint32_t id;
+            TimerJobFn* fn;
+            while (wheel.pop_due(now, &id, &fn)) {
+                auto it = model.find(id);
+                TEST_ASSERT_TRUE_MESSAGE(it != model.end(), "fired a job that is not live");
+                ModelJob& job = it->second;
+                TEST_ASSERT_TRUE_MESSAGE(expires_us(job.due_us) <= now, "fired early");
+                uint64_t late = now - job.due_us;
+                TEST_ASSERT_EQUAL_UINT64(late < UINT32_MAX ? late : UINT32_MAX, wheel.last_late_us());
+                job.runs++;
+                fired_total++;
+
+                uint64_t done = now + (rng() % 4 == 0 ? rng() % (2 * job.period_us + 1) : 0);
+                if (job.period_us && rng() % 20 == 0) {
+                    // Cancelled by another task while running
+                    TEST_ASSERT_TRUE(wheel.cancel(id));
+                    wheel.finish(id, done);
+                    model.erase(it);
+                    continue;
+                }
+                wheel.finish(id, done);
+                if (job.period_us == 0) {
+                    model.erase(it);
+                    continue;
+                }
+                job.due_us += job.period_us;
+                if (done > job.due_us) {
+                    uint64_t missed = (done - job.due_us) / job.period_us;
+                    job.skipped += (uint32_t) missed;
+                    job.due_us += missed * job.period_us;
+                }
+                timer_job_stats_t stats = {};
+                TEST_ASSERT_TRUE(wheel.stats(id, &stats));
+                TEST_ASSERT_EQUAL_UINT32(job.runs, stats.runs);
+                TEST_ASSERT_EQUAL_UINT32(job.skipped, stats.skipped);
+            }
+
+            // Nothing the model has due by this tick is left waiting
+            for (auto& kv : model) {
+                TEST_ASSERT_TRUE_MESSAGE(expires_us(kv.second.due_us) > now / TICK * TICK, "due job not fired");
+            }
+        }
+        TEST_ASSERT_EQUAL_size_t(model.size(), wheel.size());
+    }
+    TEST_ASSERT_GREATER_THAN_UINT64(10000, fired_total);
+    TEST_ASSERT_GREATER_THAN_UINT64(1000, cancelled_total);
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_job_fires_on_first_tick_at_or_after_due);
+    RUN_TEST(test_same_tick_jobs_fire_in_add_order);
+    RUN_TEST(test_far_jobs_cascade_down_to_their_tick);
+    RUN_TEST(test_periodic_job_is_fixed_rate_and_skips_missed_periods);
+    RUN_TEST(test_cancel_and_stale_ids);
+    RUN_TEST(test_randomized_against_naive_model);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
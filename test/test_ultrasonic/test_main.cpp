@@ -0,0 +1,197 @@
+#include <unity.h>
+#include "UltrasonicMath.hpp"
+#ifndef ESP_PLATFORM
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "host_fakes.hpp"
+#include "Ultrasonic.hpp"
+
+static const gpio_num_t TRIG = GPIO_NUM_12;
+static const gpio_num_t ECHO = GPIO_NUM_14;
+static const uint32_t CAPTURE_HZ = 80000000;   // MCPWM capture timer on APB
+
+// What the fake sensor does when triggered
+enum Echo { BOTH_EDGES, RISE_ONLY, NO_ECHO };
+static std::atomic<int> s_echo{BOTH_EDGES};
+static std::atomic<uint32_t> s_width_us{0};
+static std::atomic<uint32_t> s_rise_ticks{0};
+
+// The trigger pulse answers with capture events at the injected timer values,
+// from the thread that called rmt_transmit, as the capture ISR would
+static void install_sensor() {
+    fake::rmt_set_tx_hook([](int pin, const rmt_symbol_word_t*, size_t) {
+        if (pin != TRIG || s_echo == NO_ECHO) return;
+        uint32_t rise = s_rise_ticks.load();
+        fake::mcpwm_capture(ECHO, true, rise);
+        if (s_echo == BOTH_EDGES) {
+            fake::mcpwm_capture(ECHO, false, rise + (uint32_t) ((uint64_t) s_width_us * CAPTURE_HZ / 1000000));
+        }
+    });
+}
+
+static bool wait_for(const std::function<bool()>& condition, int timeout_ms = 2000) {
+    for (int i = 0; i < timeout_ms; i++) {
+        if (condition()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+#endif
+
+void setUp(void) {
+#ifndef ESP_PLATFORM
+    s_echo = BOTH_EDGES;
+    s_width_us = 0;
+    s_rise_ticks = 0;
+    install_sensor();
+#endif
+}
+
+void tearDown(void) {
+#ifndef ESP_PLATFORM
+    fake::rmt_set_tx_hook(nullptr);
+#endif
+}
+
+// ---- UltrasonicMath ----
+
+void test_tick_delta_wraps() {
+    TEST_ASSERT_EQUAL_UINT32(0x200, ultrasonic::tick_delta(0xFFFFFF00u, 0x100u));
+}
+
+void test_pulse_width_to_distance() {
+    // 58.3 us of round trip per cm
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, ultrasonic::pulse_us_to_cm(5831));
+    TEST_ASSERT_EQUAL_UINT32(5830, ultrasonic::max_pulse_us(100.0f));
+    TEST_ASSERT_EQUAL(ULTRASONIC_OK, ultrasonic::classify(5830, 5830));
+    TEST_ASSERT_EQUAL(ULTRASONIC_OUT_OF_RANGE, ultrasonic::classify(5831, 5830));
+}
+
+#ifndef ESP_PLATFORM
+// ---- Driver, with injected capture timestamps ----
+
+void test_echo_width_becomes_distance() {
+    Ultrasonic sonar(TRIG, ECHO, 200.0f);
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.begin());
+
+    const uint32_t widths[] = {150, 1000, 5831, 11000};
+    for (uint32_t width : widths) {
+        s_width_us = width;
+        ultrasonic_result_t r;
+        TEST_ASSERT_EQUAL(ESP_OK, sonar.measure(&r, pdMS_TO_TICKS(1000)));
+        TEST_ASSERT_EQUAL(ULTRASONIC_OK, r.status);
+        TEST_ASSERT_EQUAL_UINT32(width, r.pulse_us);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, width * ultrasonic::SPEED_OF_SOUND_CM_PER_US / 2.0f, r.distance_cm);
+    }
+
+    // The capture counter wrapping between the edges
+    s_rise_ticks = 0xFFFFFFFFu - 1000;
+    s_width_us = 2000;
+    ultrasonic_result_t r;
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.measure(&r, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL_UINT32(2000, r.pulse_us);
+}
+
+// Beyond max_range the echo is reported, but flagged; with no falling edge the
+// deadline reports it; with no echo at all it is a timeout
+void test_long_missing_and_absent_echoes() {
+    Ultrasonic sonar(TRIG, ECHO, 100.0f);
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.begin());
+    ultrasonic_result_t r;
+
+    s_width_us = 7000;
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.measure(&r, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(ULTRASONIC_OUT_OF_RANGE, r.status);
+    TEST_ASSERT_EQUAL_UINT32(7000, r.pulse_us);
+
+    s_echo = RISE_ONLY;
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.measure(&r, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(ULTRASONIC_OUT_OF_RANGE, r.status);
+    TEST_ASSERT_EQUAL_UINT32(0, r.pulse_us);
+
+    s_echo = NO_ECHO;
+    int64_t start = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.measure(&r, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(ULTRASONIC_TIMEOUT, r.status);
+    // Not before the deadline: the longest echo plus the rise margin
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(ultrasonic::max_pulse_us(100.0f), esp_timer_get_time() - start);
+
+    // The sensor is free again afterwards
+    s_echo = BOTH_EDGES;
+    s_width_us = 500;
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.measure(&r, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(ULTRASONIC_OK, r.status);
+}
+
+struct Collector {
+    std::mutex lock;
+    std::vector<ultrasonic_result_t> results;
+    std::atomic<bool> blocking{true};
+    std::atomic<bool> inside{false};
+};
+
+static void collect(const ultrasonic_result_t* result, void* ctx) {
+    Collector* c = (Collector*) ctx;
+    c->inside = true;
+    while (c->blocking) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::lock_guard<std::mutex> guard(c->lock);
+    c->results.push_back(*result);
+}
+
+// A completion that does not fit in the dispatcher queue is counted, keeps the
+// sensor busy, and is reported as a timeout once the deadline passes
+void test_dropped_completion_reported_as_timeout() {
+    Ultrasonic sonar(TRIG, ECHO, 20.0f);
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.begin());
+    Collector c;
+    s_width_us = 300;
+
+    // The first result holds the dispatcher; eight more fill its queue
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.measure_async(collect, &c));
+    TEST_ASSERT_TRUE(wait_for([&] { return c.inside.load(); }));
+    for (int i = 0; i < 8; i++) TEST_ASSERT_EQUAL(ESP_OK, sonar.measure_async(collect, &c));
+
+    uint32_t dropped = Ultrasonic::dropped_completions();
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.measure_async(collect, &c));
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, Ultrasonic::dropped_completions());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, sonar.measure_async(collect, &c));
+
+    c.blocking = false;
+    TEST_ASSERT_TRUE(wait_for([&] {
+        std::lock_guard<std::mutex> guard(c.lock);
+        return c.results.size() == 10;
+    }));
+    for (int i = 0; i < 9; i++) {
+        TEST_ASSERT_EQUAL(ULTRASONIC_OK, c.results[i].status);
+        TEST_ASSERT_EQUAL_UINT32(300, c.results[i].pulse_us);
+    }
+    TEST_ASSERT_EQUAL(ULTRASONIC_TIMEOUT, c.results[9].status);
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, Ultrasonic::dropped_completions());
+
+    ultrasonic_result_t r;
+    TEST_ASSERT_EQUAL(ESP_OK, sonar.measure(&r, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(ULTRASONIC_OK, r.status);
+}
+#endif
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tick_delta_wraps);
+    RUN_TEST(test_pulse_width_to_distance);
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_echo_width_becomes_distance);
+    RUN_TEST(test_long_missing_and_absent_echoes);
+    RUN_TEST(test_dropped_completion_reported_as_timeout);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif
@@ -0,0 +1,156 @@
+#include <unity.h>
+#include <stdint.h>
+#include "WiFiReconnectPolicy.hpp"
+
+static uint32_t s_random = 0;
+
+static uint32_t fixed_random() { return s_random; }
+
+// Deterministic LCG for the jitter range checks
+static uint32_t lcg_random() {
+    s_random = s_random * 1664525u + 1013904223u;
+    return s_random >> 8;
+}
+
+void setUp(void) { s_random = 0; }
+void tearDown(void) {}
+
+void test_boot_with_cache_tries_fast_then_scan() {
+    WiFiReconnectPolicy policy(1000, 60000, fixed_random);
+    TEST_ASSERT_EQUAL(WIFI_LINK_IDLE, policy.state());
+    TEST_ASSERT_EQUAL(WIFI_ACTION_CONNECT_FAST, policy.on_start(true));
+    TEST_ASSERT_EQUAL(WIFI_LINK_FAST_CONNECT, policy.state());
+    // The cached AP is gone: fall back to a scan straight away, no backoff
+    TEST_ASSERT_EQUAL(WIFI_ACTION_CONNECT_SCAN, policy.on_disconnected());
+    TEST_ASSERT_EQUAL(WIFI_LINK_CONNECTING, policy.state());
+    TEST_ASSERT_EQUAL_UINT32(0, policy.attempts());
+    TEST_ASSERT_EQUAL(WIFI_ACTION_SAVE_CACHE, policy.on_got_ip());
+    TEST_ASSERT_EQUAL(WIFI_LINK_ONLINE, policy.state());
+}
+
+void test_boot_without_cache_scans() {
+    WiFiReconnectPolicy policy(1000, 60000, fixed_random);
+    TEST_ASSERT_EQUAL(WIFI_ACTION_CONNECT_SCAN, policy.on_start(false));
+    TEST_ASSERT_EQUAL(WIFI_LINK_CONNECTING, policy.state());
+    TEST_ASSERT_EQUAL(WIFI_ACTION_SAVE_CACHE, policy.on_got_ip());
+    // Online once: the AP is cached now, so a drop goes back to it directly
+    TEST_ASSERT_EQUAL(WIFI_ACTION_CONNECT_FAST, policy.on_disconnected());
+}
+
+void test_fast_reconnect_disabled_never_connects_fast() {
+    WiFiReconnectPolicy policy(1000, 60000, fixed_random, false);
+    TEST_ASSERT_EQUAL(WIFI_ACTION_CONNECT_SCAN, policy.on_start(true));
+    TEST_ASSERT_EQUAL(WIFI_ACTION_SAVE_CACHE, policy.on_got_ip());
+    TEST_ASSERT_EQUAL(WIFI_ACTION_CONNECT_SCAN, policy.on_disconnected());
+    TEST_ASSERT_EQUAL(WIFI_LINK_CONNECTING, policy.state());
+}
+
+void test_failed_scans_back_off_exponentially_to_the_cap() {
+    // random() % (half + 1) == 0 picks the bottom of each range
+    WiFiReconnectPolicy policy(1000, 20000, fixed_random);
+    policy.on_start(false);
+    const uint32_t expected[] = {500, 1000, 2000, 4000, 8000, 10000, 10000, 10000};
+    for (uint32_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        TEST_ASSERT_EQUAL(WIFI_ACTION_WAIT_BACKOFF, policy.on_disconnected());
+        TEST_ASSERT_EQUAL(WIFI_LINK_BACKOFF, policy.state());
+        TEST_ASSERT_EQUAL_UINT32(i + 1, policy.attempts());
+        TEST_ASSERT_EQUAL_UINT32(expected[i], policy.backoff_ms());
+        TEST_ASSERT_EQUAL(WIFI_ACTION_CONNECT_SCAN, policy.on_backoff_elapsed());
+        TEST_ASSERT_EQUAL(WIFI_LINK_CONNECTING, policy.state());
+    }
+    // Never gives up, and the shift stays bounded after many failures
+    for (int i = 0; i < 100; i++) {
+        policy.on_disconnected();
+        policy.on_backoff_elapsed();
+    }
+    TEST_ASSERT_EQUAL_UINT32(108, policy.attempts());
+    TEST_ASSERT_EQUAL_UINT32(10000, policy.backoff_ms());
+    TEST_ASSERT_EQUAL(WIFI_LINK_CONNECTING, policy.state());
+}
+
+void test_backoff_jitter_stays_in_range() {
+    WiFiReconnectPolicy policy(1000, 60000, lcg_random);
+    policy.on_start(false);
+    uint32_t low = UINT32_MAX, high = 0;
+    for (uint32_t attempt = 1; attempt <= 200; attempt++) {
+        policy.on_disconnected();
+        uint32_t shift = attempt - 1 > 16 ? 16 : attempt - 1;
+        uint64_t ceiling = (uint64_t) 1000 << shift;
+        if (ceiling > 60000) ceiling = 60000;
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32((uint32_t) (ceiling / 2), policy.backoff_ms());
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32((uint32_t) ceiling, policy.backoff_ms());
+        if (ceiling == 60000) {
+            if (policy.backoff_ms() < low) low = policy.backoff_ms();
+            if (policy.backoff_ms() > high) high = policy.backoff_ms();
+        }
+        policy.on_backoff_elapsed();
+    }
+    // Capped delays are spread, not all equal
+    TEST_ASSERT_GREATER_THAN_UINT32(low + 10000, high);
+}
+
+void test_reconnect_after_online_resets_attempts() {
+    WiFiReconnectPolicy policy(1000, 60000, fixed_random);
+    policy.on_start(false);
+    for (int i = 0; i < 5; i++) {
+        policy.on_disconnected();
+        policy.on_backoff_elapsed();
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, policy.attempts());
+    TEST_ASSERT_EQUAL(WIFI_ACTION_SAVE_CACHE, policy.on_got_ip());
+    TEST_ASSERT_EQUAL_UINT32(0, policy.attempts());
+
+    // Link drops: cached AP first, then scan, then the backoff starts over
+    TEST_ASSERT_EQUAL(WIFI_ACTION_CONNECT_FAST, policy.on_disconnected());
+    TEST_ASSERT_EQUAL(WIFI_ACTION_CONNECT_SCAN, policy.on_disconnected());
+    TEST_ASSERT_EQUAL(WIFI_ACTION_WAIT_BACKOFF, policy.on_disconnected());
+    TEST_ASSERT_EQUAL_UINT32(1, policy.attempts());
+    TEST_ASSERT_EQUAL_UINT32(500, policy.backoff_ms());
+}
+
+void test_stray_events_are_ignored() {
+    WiFiReconnectPolicy policy(1000, 60000, fixed_random);
+    // Nothing started yet
+    TEST_ASSERT_EQUAL(WIFI_ACTION_NONE, policy.on_disconnected());
+    TEST_ASSERT_EQUAL(WIFI_ACTION_NONE, policy.on_backoff_elapsed());
+    TEST_ASSERT_EQUAL(WIFI_LINK_IDLE, policy.state());
+
+    policy.on_start(false);
+    // A late timer while an attempt is running does not start a second one
+    TEST_ASSERT_EQUAL(WIFI_ACTION_NONE, policy.on_backoff_elapsed());
+    TEST_ASSERT_EQUAL(WIFI_ACTION_WAIT_BACKOFF, policy.on_disconnected());
+    // A second disconnect while backing off is the same failure, not a new one
+    TEST_ASSERT_EQUAL(WIFI_ACTION_NONE, policy.on_disconnected());
+    TEST_ASSERT_EQUAL_UINT32(1, policy.attempts());
+    TEST_ASSERT_EQUAL(WIFI_LINK_BACKOFF, policy.state());
+}
+
+void test_no_random_source_waits_the_full_ceiling() {
+    WiFiReconnectPolicy policy(1000, 3000, nullptr);
+    policy.on_start(false);
+    const uint32_t expected[] = {1000, 2000, 3000, 3000};
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(WIFI_ACTION_WAIT_BACKOFF, policy.on_disconnected());
+        TEST_ASSERT_EQUAL_UINT32(expected[i], policy.backoff_ms());
+        policy.on_backoff_elapsed();
+    }
+}
+
+static int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_boot_with_cache_tries_fast_then_scan);
+    RUN_TEST(test_boot_without_cache_scans);
+    RUN_TEST(test_fast_reconnect_disabled_never_connects_fast);
+    RUN_TEST(test_failed_scans_back_off_exponentially_to_the_cap);
+    RUN_TEST(test_backoff_jitter_stays_in_range);
+    RUN_TEST(test_reconnect_after_online_resets_attempts);
+    RUN_TEST(test_stray_events_are_ignored);
+    RUN_TEST(test_no_random_source_waits_the_full_ceiling);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void) { run_tests(); }
+#else
+int main(int argc, char** argv) { return run_tests(); }
+#endif